@@ -26,6 +26,11 @@
 #cmakedefine HARDINFO2_VK_WAYLAND @HARDINFO2_VK_WAYLAND@
 #cmakedefine HARDINFO2_VK_X11   @HARDINFO2_VK_X11@
 #cmakedefine HARDINFO2_NOSSL    @HARDINFO2_NOSSL@
+#cmakedefine HARDINFO2_COMPRESS_ZSTD @HARDINFO2_COMPRESS_ZSTD@
+#cmakedefine HARDINFO2_COMPRESS_LZ4  @HARDINFO2_COMPRESS_LZ4@
+#cmakedefine HARDINFO2_XRANDR   @HARDINFO2_XRANDR@
+#cmakedefine HARDINFO2_EGL      @HARDINFO2_EGL@
+#cmakedefine HARDINFO2_SYNC_ZSTD @HARDINFO2_SYNC_ZSTD@
 
 #define Release 1
 #define ON 1
@@ -37,6 +42,21 @@
 #if !defined(HARDINFO2_QT5)
   #define HARDINFO2_QT5 0
 #endif
+#if !defined(HARDINFO2_COMPRESS_ZSTD)
+  #define HARDINFO2_COMPRESS_ZSTD 0
+#endif
+#if !defined(HARDINFO2_COMPRESS_LZ4)
+  #define HARDINFO2_COMPRESS_LZ4 0
+#endif
+#if !defined(HARDINFO2_XRANDR)
+  #define HARDINFO2_XRANDR 0
+#endif
+#if !defined(HARDINFO2_EGL)
+  #define HARDINFO2_EGL 0
+#endif
+#if !defined(HARDINFO2_SYNC_ZSTD)
+  #define HARDINFO2_SYNC_ZSTD 0
+#endif
 
 #if defined(HARDINFO2_DEBUG) && (HARDINFO2_DEBUG==1)
   #define DEBUG(msg,...) fprintf(stderr, "*** %s:%d (%s) *** " msg "\n", \
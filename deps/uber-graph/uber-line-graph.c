@@ -800,6 +800,59 @@ uber_line_graph_set_line_width (UberLineGraph *graph, /* IN */
 	uber_graph_redraw(UBER_GRAPH(graph));
 }
 
+/**
+ * uber_line_graph_set_line_data:
+ * @graph: A #UberLineGraph.
+ * @line: The line, starting from 1.
+ * @values: Samples ordered oldest first.
+ * @n_values: The number of samples in @values.
+ *
+ * Replaces the samples of @line with @values. Only the newest samples
+ * that fit within the current stride are kept.
+ *
+ * Returns: None.
+ * Side effects: None.
+ */
+void
+uber_line_graph_set_line_data (UberLineGraph *graph,    /* IN */
+                               guint          line,     /* IN */
+                               const gdouble *values,   /* IN */
+                               guint          n_values) /* IN */
+{
+	UberLineGraphPrivate *priv;
+	LineInfo *info;
+	guint first = 0;
+	guint i;
+
+	g_return_if_fail(UBER_IS_LINE_GRAPH(graph));
+	g_return_if_fail(line > 0);
+	g_return_if_fail(line <= graph->priv->lines->len);
+
+	priv = graph->priv;
+	info = &g_array_index(priv->lines, LineInfo, line - 1);
+	uber_line_graph_init_ring(info->raw_data);
+	if (!values || !n_values) {
+		return;
+	}
+	if (n_values > info->raw_data->len) {
+		first = n_values - info->raw_data->len;
+	}
+	g_ring_append_vals(info->raw_data, values + first, n_values - first);
+	if (priv->autoscale) {
+		for (i = first; i < n_values; i++) {
+			if (isnan(values[i])) {
+				continue;
+			}
+			if (values[i] < priv->range.begin) {
+				priv->range.begin = values[i] - (values[i] * SCALE_FACTOR);
+			} else if (values[i] > priv->range.end) {
+				priv->range.end = values[i] + (values[i] * SCALE_FACTOR);
+			}
+		}
+		priv->range.range = priv->range.end - priv->range.begin;
+	}
+}
+
 /**
  * uber_line_graph_downscale:
  * @graph: A #UberGraph.
@@ -94,6 +94,10 @@ void              uber_line_graph_set_line_dash  (UberLineGraph     *graph,
 void              uber_line_graph_set_line_width (UberLineGraph     *graph,
                                                   gint               line,
                                                   gdouble            width);
+void              uber_line_graph_set_line_data  (UberLineGraph     *graph,
+                                                  guint              line,
+                                                  const gdouble     *values,
+                                                  guint              n_values);
 void uber_line_graph_clear (UberLineGraph     *graph);
 G_END_DECLS
 
@@ -0,0 +1,873 @@
+/*
+ *    Hardinfo2 - System Information and benchmark
+ *    Copyright (C) 2003-2007 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#if GLIB_CHECK_VERSION(2,30,0)
+#include <glib-unix.h>
+#endif
+
+#include <config.h>
+#include "hardinfo.h"
+#include "shell.h"
+#include "report.h"
+#include "socket.h"
+#include "timeseries.h"
+#include "daemon.h"
+
+/* a client must take some of its queued replies within DAEMON_IO_TIMEOUT,
+ * may not leave more than DAEMON_MAX_QUEUE bytes of them unread, and may
+ * not send longer request lines than DAEMON_MAX_LINE */
+#ifndef DAEMON_IO_TIMEOUT
+#define DAEMON_IO_TIMEOUT	5000
+#endif
+#define DAEMON_MAX_QUEUE	(32 * 1024 * 1024)
+#define DAEMON_MAX_LINE		4096
+/* a whole request on the client side must get through by then */
+#define DAEMON_REQUEST_TIMEOUT	30000
+
+typedef struct _DaemonEntry	DaemonEntry;
+typedef struct _DaemonClient	DaemonClient;
+
+struct _DaemonEntry {
+    ShellModuleEntry	*entry;
+    gchar		*id;
+    gboolean		 reload;	/* page has a ReloadInterval */
+    guint		 interval;	/* sampling interval in ms */
+    guint		 source;
+    GHashTable		*last;		/* label -> last value sent */
+};
+
+struct _DaemonClient {
+    GIOChannel		*chan;
+    int			 fd;
+    gboolean		 dead;		/* failed, stalled or too far behind */
+    gboolean		 closing;	/* hung up, goes once out is sent */
+    guint		 watch;		/* requests */
+    guint		 out_watch;	/* sends out while the socket takes it */
+    guint		 stall;		/* drops the client if out doesn't move */
+    gsize		 sent;		/* bytes sent since the last stall check */
+    GString		*in;		/* partial request line */
+    GString		*out;		/* replies not yet taken by the client */
+    GHashTable		*subs;		/* "<entry>\t<label>" */
+};
+
+static GMainLoop *loop = NULL;
+static GSList *daemon_modules = NULL;
+static GSList *daemon_entries = NULL;
+static GHashTable *entry_table = NULL;
+static GSList *clients = NULL;
+static TimeSeriesStore *history = NULL;
+
+static gint64 daemon_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (gint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* waits for a non-blocking fd; FALSE once the deadline has passed */
+static gboolean daemon_wait(int fd, short events, gint64 deadline)
+{
+    struct pollfd pfd = { fd, events, 0 };
+    gint64 left;
+    int r;
+
+    do {
+        left = deadline - daemon_now_ms();
+        if (left <= 0)
+            return FALSE;
+        r = poll(&pfd, 1, (int)left);
+    } while (r < 0 && errno == EINTR);
+
+    return r > 0;
+}
+
+static gboolean daemon_write_all(int fd, const gchar *buf, gsize length, gint64 deadline)
+{
+    while (length) {
+        ssize_t n = write(fd, buf, length);
+
+        if (n > 0) {
+            buf += n;
+            length -= n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && errno == EAGAIN) {
+            if (!daemon_wait(fd, POLLOUT, deadline))
+                return FALSE;
+        } else {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static void set_nonblocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+gchar *daemon_socket_path(void)
+{
+    return g_build_filename(g_get_user_runtime_dir(), "hardinfo2.sock", NULL);
+}
+
+/* page text as a key file, with "..." fields replaced by their live value */
+static GKeyFile *entry_page(DaemonEntry *de)
+{
+    GKeyFile *key_file = g_key_file_new();
+    gchar *text = module_entry_function(de->entry);
+    gchar **groups, **keys;
+    gint i, j;
+
+    if (text)
+        g_key_file_load_from_data(key_file, text, strlen(text), 0, NULL);
+    g_free(text);
+
+    if (!de->entry->fieldfunc)
+        return key_file;
+
+    groups = g_key_file_get_groups(key_file, NULL);
+    for (i = 0; groups[i]; i++) {
+        if (groups[i][0] == '$')
+            continue;
+
+        keys = g_key_file_get_keys(key_file, groups[i], NULL, NULL);
+        for (j = 0; keys && keys[j]; j++) {
+            gchar *value = g_key_file_get_string(key_file, groups[i], keys[j], NULL);
+
+            if (value && g_str_equal(value, "...")) {
+                gchar *live = de->entry->fieldfunc(keys[j]);
+
+                if (live)
+                    g_key_file_set_string(key_file, groups[i], keys[j], live);
+                g_free(live);
+            }
+            g_free(value);
+        }
+        g_strfreev(keys);
+    }
+    g_strfreev(groups);
+
+    return key_file;
+}
+
+typedef void (*PageFieldFunc) (DaemonEntry *de, const gchar *label,
+                               const gchar *value, gpointer data);
+
+static void page_foreach(DaemonEntry *de, GKeyFile *key_file,
+                         PageFieldFunc func, gpointer data)
+{
+    gchar **groups, **keys;
+    gint i, j;
+
+    groups = g_key_file_get_groups(key_file, NULL);
+    for (i = 0; groups[i]; i++) {
+        if (groups[i][0] == '$')
+            continue;
+
+        keys = g_key_file_get_keys(key_file, groups[i], NULL, NULL);
+        for (j = 0; keys && keys[j]; j++) {
+            gchar *value = g_key_file_get_string(key_file, groups[i], keys[j], NULL);
+            gchar *label = NULL;
+
+            key_get_components(keys[j], NULL, NULL, NULL, &label, NULL);
+            if (value && label)
+                func(de, label, value, data);
+
+            g_free(label);
+            g_free(value);
+        }
+        g_strfreev(keys);
+    }
+    g_strfreev(groups);
+}
+
+static void client_free(DaemonClient *client);
+
+/* sends what the socket takes without blocking; FALSE if the client is gone */
+static gboolean client_flush(DaemonClient *client)
+{
+    gsize done = 0;
+
+    while (done < client->out->len) {
+        ssize_t n = write(client->fd, client->out->str + done, client->out->len - done);
+
+        if (n > 0)
+            done += n;
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && errno == EAGAIN)
+            break;
+        else {
+            client->dead = TRUE;
+            break;
+        }
+    }
+
+    g_string_erase(client->out, 0, done);
+    client->sent += done;
+
+    return !client->dead;
+}
+
+static gboolean client_writable(GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+    DaemonClient *client = data;
+
+    if (cond & G_IO_OUT)
+        client_flush(client);
+    else
+        client->dead = TRUE;
+
+    if (client->dead || (client->closing && !client->out->len)) {
+        client->out_watch = 0;
+        client_free(client);
+        return FALSE;
+    }
+    if (!client->out->len) {
+        g_source_remove(client->stall);
+        client->stall = 0;
+        client->out_watch = 0;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean client_stalled(gpointer data)
+{
+    DaemonClient *client = data;
+
+    if (!client->sent) {
+        client->stall = 0;
+        client_free(client);
+        return FALSE;
+    }
+
+    client->sent = 0;
+    return TRUE;
+}
+
+/* replies are queued and sent as the client reads them, so a slow client
+ * never holds up the daemon or the other clients; one that stops reading,
+ * or falls too far behind, is dropped */
+static void client_write(DaemonClient *client, const gchar *buf, gsize length)
+{
+    if (client->dead)
+        return;
+
+    if (client->out->len + length > DAEMON_MAX_QUEUE) {
+        client->dead = TRUE;
+        return;
+    }
+    g_string_append_len(client->out, buf, length);
+}
+
+static void client_push(DaemonClient *client)
+{
+    if (client->dead || client->out_watch || !client_flush(client) || !client->out->len)
+        return;
+
+    client->sent = 0;
+    client->out_watch = g_io_add_watch(client->chan, G_IO_OUT | G_IO_HUP | G_IO_ERR,
+                                       client_writable, client);
+    client->stall = g_timeout_add(DAEMON_IO_TIMEOUT, client_stalled, client);
+}
+
+static void client_send(DaemonClient *client, const gchar *status,
+                        const gchar *payload, gsize length)
+{
+    gchar *header = g_strdup_printf("%s %" G_GSIZE_FORMAT "\n", status, length);
+
+    client_write(client, header, strlen(header));
+    if (length)
+        client_write(client, payload, length);
+    client_push(client);
+
+    g_free(header);
+}
+
+static void client_ok(DaemonClient *client, const gchar *payload)
+{
+    client_send(client, "OK", payload, payload ? strlen(payload) : 0);
+}
+
+static void client_error(DaemonClient *client, const gchar *message)
+{
+    gchar *line = g_strdup_printf("ERR %s\n", message);
+
+    client_write(client, line, strlen(line));
+    client_push(client);
+
+    g_free(line);
+}
+
+static void sample_field(DaemonEntry *de, const gchar *label,
+                         const gchar *value, gpointer data)
+{
+    gchar *name = g_strdup_printf("%s\t%s", de->id, label);
+    gchar *end;
+    gdouble v = g_ascii_strtod(value, &end);
+    GSList *l;
+
+    if (end != value)
+        time_series_store_append(history, name, v);
+
+    if (g_strcmp0(g_hash_table_lookup(de->last, label), value)) {
+        gchar *event = g_strdup_printf("%s\t%s\n", name, value);
+
+        g_hash_table_replace(de->last, g_strdup(label), g_strdup(value));
+        for (l = clients; l; l = l->next) {
+            DaemonClient *client = l->data;
+
+            if (g_hash_table_lookup(client->subs, name))
+                client_send(client, "EVENT", event, strlen(event));
+        }
+        g_free(event);
+    }
+
+    g_free(name);
+}
+
+static gboolean entry_sample(gpointer data)
+{
+    DaemonEntry *de = data;
+    GKeyFile *key_file;
+    GSList *l, *next;
+
+    if (de->reload)
+        module_entry_reload(de->entry);
+
+    key_file = entry_page(de);
+    page_foreach(de, key_file, sample_field, NULL);
+    g_key_file_free(key_file);
+
+    for (l = clients; l; l = next) {
+        next = l->next;
+        if (((DaemonClient *)l->data)->dead)
+            client_free(l->data);
+    }
+
+    return TRUE;
+}
+
+static void entry_watch(DaemonEntry *de, guint interval)
+{
+    if (de->source)
+        return;
+
+    de->interval = interval ? interval : 1000;
+    de->source = g_timeout_add(de->interval, entry_sample, de);
+    entry_sample(de);
+}
+
+/* scan everything once and start sampling the pages that refresh in the GUI */
+static void entries_init(GSList *modules)
+{
+    GSList *m, *e;
+
+    entry_table = g_hash_table_new(g_str_hash, g_str_equal);
+
+    for (m = modules; m; m = m->next) {
+        ShellModule *module = m->data;
+        gchar *name = g_path_get_basename(g_module_name(module->dll));
+
+        strend(name, '.');
+
+        for (e = module->entries; e; e = e->next) {
+            ShellModuleEntry *entry = e->data;
+            DaemonEntry *de;
+            GKeyFile *key_file;
+            gchar **keys;
+            guint interval = 0;
+            gint i;
+
+            if (entry->flags & (MODULE_FLAG_HIDE | MODULE_FLAG_BENCHMARK))
+                continue;
+
+            de = g_new0(DaemonEntry, 1);
+            de->entry = entry;
+            de->id = g_strdup_printf("%s/%d", name, entry->number);
+            de->last = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+            daemon_entries = g_slist_append(daemon_entries, de);
+            g_hash_table_insert(entry_table, de->id, de);
+
+            module_entry_scan(entry);
+            key_file = entry_page(de);
+            keys = g_key_file_get_keys(key_file, "$ShellParam$", NULL, NULL);
+            for (i = 0; keys && keys[i]; i++) {
+                gint ms = g_key_file_get_integer(key_file, "$ShellParam$", keys[i], NULL);
+
+                if (ms <= 0)
+                    continue;
+                if (g_str_equal(keys[i], "ReloadInterval"))
+                    de->reload = TRUE;
+                else if (!g_str_has_prefix(keys[i], "UpdateInterval"))
+                    continue;
+                interval = interval ? MIN(interval, (guint)ms) : (guint)ms;
+            }
+            g_strfreev(keys);
+            g_key_file_free(key_file);
+
+            if (interval)
+                entry_watch(de, interval);
+        }
+
+        g_free(name);
+    }
+}
+
+static void entries_free(void)
+{
+    GSList *l;
+
+    for (l = daemon_entries; l; l = l->next) {
+        DaemonEntry *de = l->data;
+
+        if (de->source)
+            g_source_remove(de->source);
+        g_hash_table_destroy(de->last);
+        g_free(de->id);
+        g_free(de);
+    }
+    g_slist_free(daemon_entries);
+    g_hash_table_destroy(entry_table);
+    daemon_entries = NULL;
+    entry_table = NULL;
+}
+
+/* pages as held: scanned once, and kept fresh by sampling if they have
+ * a ReloadInterval; reload rescans all of them first, as a new -r would */
+static gchar *daemon_report(ReportFormat format, gboolean all_details, gboolean reload)
+{
+    GSList *copies = NULL, *owned, *l;
+    gint old_format = params.report_format;
+    gint old_details = params.force_all_details;
+    gchar *report;
+
+    for (l = reload ? daemon_entries : NULL; l; l = l->next)
+        module_entry_reload(((DaemonEntry *)l->data)->entry);
+
+    /* the report frees the entry lists of the modules it is given */
+    for (l = daemon_modules; l; l = l->next) {
+        ShellModule *copy = g_new(ShellModule, 1);
+
+        *copy = *(ShellModule *)l->data;
+        copy->entries = g_slist_copy(copy->entries);
+        copies = g_slist_append(copies, copy);
+    }
+    owned = g_slist_copy(copies);
+
+    params.report_format = format;
+    params.force_all_details = all_details;
+    report = report_create_from_module_list_format(copies, format);
+    params.report_format = old_format;
+    params.force_all_details = old_details;
+
+    g_slist_free_full(owned, g_free);
+
+    return report;
+}
+
+static void append_field(DaemonEntry *de, const gchar *label,
+                         const gchar *value, gpointer data)
+{
+    gchar **wanted = data;
+
+    if (!wanted[1] && g_str_equal(label, wanted[0]))
+        wanted[1] = g_strdup(value);
+}
+
+static void client_command(DaemonClient *client, gchar *line)
+{
+    gchar **args = g_strsplit(g_strstrip(line), " ", 3);
+    gchar *cmd = args[0];
+    DaemonEntry *de = NULL;
+    gchar *field = NULL;
+
+    if (args[0] && args[1]) {
+        de = g_hash_table_lookup(entry_table, args[1]);
+        /* field labels may have spaces */
+        if (args[2]) {
+            gchar *p = strchr(line, ' ');
+
+            p = p ? strchr(p + 1, ' ') : NULL;
+            field = p ? p + 1 : NULL;
+        }
+    }
+
+    if (!cmd || !*cmd) {
+        client_error(client, "empty request");
+    } else if (g_str_equal(cmd, "LIST")) {
+        GString *list = g_string_new(NULL);
+        GSList *l;
+
+        for (l = daemon_entries; l; l = l->next) {
+            DaemonEntry *e = l->data;
+
+            g_string_append_printf(list, "%s\t%s\n", e->id, e->entry->name);
+        }
+        client_ok(client, list->str);
+        g_string_free(list, TRUE);
+    } else if (g_str_equal(cmd, "REPORT")) {
+        ReportFormat format = REPORT_FORMAT_TEXT;
+        gboolean all = FALSE, reload = FALSE;
+        gchar **opts = g_strsplit(line, " ", -1);
+        gint i;
+
+        for (i = 1; opts[i]; i++) {
+            if (g_str_equal(opts[i], "shell"))
+                format = REPORT_FORMAT_SHELL;
+            else if (g_str_equal(opts[i], "all"))
+                all = TRUE;
+            else if (g_str_equal(opts[i], "reload"))
+                reload = TRUE;
+            else if (*opts[i] && !g_str_equal(opts[i], "text"))
+                break;
+        }
+
+        if (opts[i]) {
+            client_error(client, "unknown report option");
+        } else {
+            gchar *report = daemon_report(format, all, reload);
+
+            client_ok(client, report);
+            g_free(report);
+        }
+        g_strfreev(opts);
+    } else if (!de) {
+        client_error(client, args[1] ? "unknown entry" : "missing entry");
+    } else if (g_str_equal(cmd, "GET")) {
+        GKeyFile *key_file = entry_page(de);
+        gchar *data = g_key_file_to_data(key_file, NULL, NULL);
+
+        client_ok(client, data);
+        g_free(data);
+        g_key_file_free(key_file);
+    } else if (g_str_equal(cmd, "RESCAN")) {
+        module_entry_reload(de->entry);
+        client_ok(client, NULL);
+    } else if (!field) {
+        client_error(client, "missing field");
+    } else if (g_str_equal(cmd, "FIELD")) {
+        GKeyFile *key_file = entry_page(de);
+        gchar *wanted[2] = { field, NULL };
+
+        page_foreach(de, key_file, append_field, wanted);
+        if (wanted[1])
+            client_ok(client, wanted[1]);
+        else
+            client_error(client, "unknown field");
+        g_free(wanted[1]);
+        g_key_file_free(key_file);
+    } else if (g_str_equal(cmd, "MORE")) {
+        gchar *more = module_entry_get_moreinfo(de->entry, field); /*const*/
+
+        if (more)
+            client_ok(client, more);
+        else
+            client_error(client, "no details");
+    } else if (g_str_equal(cmd, "HISTORY")) {
+        gchar *name = g_strdup_printf("%s\t%s", de->id, field);
+        TimeSeries *ts = time_series_store_lookup(history, name);
+
+        if (ts) {
+            GString *values = g_string_new(NULL);
+            guint i;
+
+            for (i = 0; i < ts->len; i++)
+                g_string_append_printf(values, "%g\n", time_series_get(ts, i));
+            client_ok(client, values->str);
+            g_string_free(values, TRUE);
+        } else {
+            client_error(client, "not sampled");
+        }
+        g_free(name);
+    } else if (g_str_equal(cmd, "SUBSCRIBE")) {
+        gchar *name = g_strdup_printf("%s\t%s", de->id, field);
+
+        g_hash_table_replace(client->subs, name, name);
+        client_ok(client, NULL);
+        entry_watch(de, 0);
+    } else if (g_str_equal(cmd, "UNSUBSCRIBE")) {
+        gchar *name = g_strdup_printf("%s\t%s", de->id, field);
+
+        g_hash_table_remove(client->subs, name);
+        client_ok(client, NULL);
+        g_free(name);
+    } else {
+        client_error(client, "unknown command");
+    }
+
+    g_strfreev(args);
+}
+
+static void client_free(DaemonClient *client)
+{
+    clients = g_slist_remove(clients, client);
+    if (client->watch)
+        g_source_remove(client->watch);
+    if (client->out_watch)
+        g_source_remove(client->out_watch);
+    if (client->stall)
+        g_source_remove(client->stall);
+    g_io_channel_shutdown(client->chan, FALSE, NULL);
+    g_io_channel_unref(client->chan);
+    g_hash_table_destroy(client->subs);
+    g_string_free(client->in, TRUE);
+    g_string_free(client->out, TRUE);
+    g_free(client);
+}
+
+static gboolean client_readable(GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+    DaemonClient *client = data;
+    gchar buf[4096], *eol;
+    ssize_t n = 0;
+
+    if (cond & G_IO_IN) {
+        do {
+            n = read(client->fd, buf, sizeof(buf));
+        } while (n < 0 && errno == EINTR);
+        if (n < 0 && errno == EAGAIN)
+            return TRUE;
+    }
+
+    if (n > 0) {
+        g_string_append_len(client->in, buf, n);
+        while (!client->dead && (eol = memchr(client->in->str, '\n', client->in->len))) {
+            gchar *line = g_strndup(client->in->str, eol - client->in->str);
+
+            g_string_erase(client->in, 0, eol - client->in->str + 1);
+            client_command(client, line);
+            g_free(line);
+        }
+
+        /* only part of a line so far, but it can't get any longer */
+        if (client->in->len > DAEMON_MAX_LINE) {
+            client_error(client, "request too long");
+            n = 0;
+        }
+    }
+
+    if (n > 0 && !client->dead)
+        return TRUE;
+
+    /* hung up: replies still queued go out first */
+    client->watch = 0;
+    if (!client->dead && client->out->len)
+        client->closing = TRUE;
+    else
+        client_free(client);
+
+    return FALSE;
+}
+
+static gboolean client_accept(GIOChannel *chan, GIOCondition cond, gpointer data)
+{
+    DaemonClient *client;
+    int fd = accept(g_io_channel_unix_get_fd(chan), NULL, NULL);
+
+    if (fd < 0)
+        return TRUE;
+
+    set_nonblocking(fd);
+
+    client = g_new0(DaemonClient, 1);
+    client->fd = fd;
+    client->chan = g_io_channel_unix_new(fd);
+    client->subs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    client->in = g_string_new(NULL);
+    client->out = g_string_new(NULL);
+    g_io_channel_set_encoding(client->chan, NULL, NULL);
+    g_io_channel_set_flags(client->chan, G_IO_FLAG_NONBLOCK, NULL);
+    g_io_channel_set_close_on_unref(client->chan, TRUE);
+    client->watch = g_io_add_watch(client->chan, G_IO_IN | G_IO_HUP | G_IO_ERR,
+                                   client_readable, client);
+    clients = g_slist_prepend(clients, client);
+
+    return TRUE;
+}
+
+static gboolean daemon_quit(gpointer data)
+{
+    g_main_loop_quit(loop);
+    return FALSE;
+}
+
+static int daemon_listen(const gchar *path)
+{
+    struct sockaddr_un addr;
+    Socket *other;
+    int sock;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        g_printerr("%s: %s\n", path, g_strerror(ENAMETOOLONG));
+        return -1;
+    }
+
+    other = sock_connect_unix(path);
+    if (other) {
+        sock_close(other);
+        g_printerr(_("A daemon is already listening on %s\n"), path);
+        return -1;
+    }
+    g_unlink(path);
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        g_printerr("%s: %s\n", path, g_strerror(errno));
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    if (bind(sock, (struct sockaddr *) (void *) &addr, sizeof(addr)) < 0
+        || chmod(path, 0600) < 0 || listen(sock, 8) < 0) {
+        g_printerr("%s: %s\n", path, g_strerror(errno));
+        close(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+gint daemon_run(GSList *modules)
+{
+    gchar *path = daemon_socket_path();
+    GIOChannel *chan;
+    int sock;
+
+    sock = daemon_listen(path);
+    if (sock < 0) {
+        g_free(path);
+        return 1;
+    }
+
+    /* a client going away mid-reply must not take us down */
+    signal(SIGPIPE, SIG_IGN);
+
+    daemon_modules = modules;
+    history = time_series_store_new(0);
+    entries_init(modules);
+
+    chan = g_io_channel_unix_new(sock);
+    g_io_add_watch(chan, G_IO_IN, client_accept, NULL);
+
+    loop = g_main_loop_new(NULL, FALSE);
+#if GLIB_CHECK_VERSION(2,30,0)
+    g_unix_signal_add(SIGINT, daemon_quit, NULL);
+    g_unix_signal_add(SIGTERM, daemon_quit, NULL);
+#endif
+
+    DEBUG("daemon listening on %s", path);
+    g_main_loop_run(loop);
+
+    while (clients)
+        client_free(clients->data);
+    g_io_channel_unref(chan);
+    close(sock);
+    g_unlink(path);
+
+    entries_free();
+    time_series_store_free(history);
+    g_main_loop_unref(loop);
+    g_free(path);
+
+    return 0;
+}
+
+gchar *daemon_request(const gchar *request)
+{
+    gchar *path = daemon_socket_path();
+    Socket *s = sock_connect_unix(path);
+    gint64 deadline = daemon_now_ms() + DAEMON_REQUEST_TIMEOUT;
+    GString *reply = g_string_new(NULL);
+    gchar *payload = NULL, *req, *eol;
+    gboolean have_header = FALSE;
+    gsize length = 0;
+    gchar buf[4096];
+
+    g_free(path);
+    if (!s) {
+        g_string_free(reply, TRUE);
+        return NULL;
+    }
+
+    /* a wedged daemon must not hang -r; the caller scans by itself */
+    set_nonblocking(s->sock);
+
+    req = g_strconcat(request, "\n", NULL);
+    if (!daemon_write_all(s->sock, req, strlen(req), deadline))
+        goto out;
+
+    for (;;) {
+        ssize_t n;
+
+        if (!have_header && (eol = memchr(reply->str, '\n', reply->len))) {
+            if (sscanf(reply->str, "OK %" G_GSIZE_FORMAT, &length) != 1)
+                goto out;
+            g_string_erase(reply, 0, eol - reply->str + 1);
+            have_header = TRUE;
+        }
+        if (have_header && reply->len >= length)
+            break;
+
+        n = read(s->sock, buf, sizeof(buf));
+        if (n > 0) {
+            g_string_append_len(reply, buf, n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && errno == EAGAIN) {
+            if (!daemon_wait(s->sock, POLLIN, deadline))
+                goto out;
+        } else {
+            goto out;
+        }
+    }
+
+    g_string_truncate(reply, length);
+    payload = g_string_free(reply, FALSE);
+    reply = NULL;
+
+out:
+    if (reply)
+        g_string_free(reply, TRUE);
+    g_free(req);
+    sock_close(s);
+
+    return payload;
+}
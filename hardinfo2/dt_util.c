@@ -82,10 +82,50 @@ struct _dtr_map {
 };
 typedef struct _dtr_map dtr_map;
 
-struct _dtr {
+/* the maps, sorted for display, and hash indexes into them */
+typedef struct {
     dtr_map *aliases;
     dtr_map *symbols;
     dtr_map *phandles;
+    GHashTable *phandle_paths;  /* v -> path */
+    GHashTable *alias_paths;    /* label -> path */
+    GHashTable *path_aliases;   /* path -> label */
+    GHashTable *path_symbols;   /* path -> label */
+} dtr_maps;
+
+/* flattened device tree blob, indexed in one pass over the structure block
+ * https://devicetree-specification.readthedocs.io/en/stable/flattened-format.html */
+#define FDT_MAGIC       0xd00dfeed
+#define FDT_BEGIN_NODE  1
+#define FDT_END_NODE    2
+#define FDT_PROP        3
+#define FDT_NOP         4
+#define FDT_END         9
+#define FDT_ALIGN(x)    (((x) + 3) & ~3)
+
+typedef struct _fdt_entry fdt_entry;
+struct _fdt_entry {
+    const char *name;
+    const uint8_t *data;    /* points into the blob */
+    uint32_t length;
+    char *synth;            /* generated "name" property */
+    GPtrArray *children;    /* fdt_entry, NULL for properties */
+};
+
+typedef struct {
+    int ref;
+    char *file;
+    GMappedFile *mapped;
+    gchar *contents;        /* when it can't be mapped, like sysfs */
+    GPtrArray *entries;     /* owns every fdt_entry */
+    GHashTable *paths;      /* path -> fdt_entry */
+    dtr_maps maps;
+} dtr_fdt;
+
+struct _dtr {
+    dtr_maps own;
+    dtr_maps *maps;         /* own, or shared with fdt */
+    dtr_fdt *fdt;
     char *base_path;
     char *log;
 };
@@ -108,26 +148,20 @@ struct _dtr_obj {
     dtr *dt;
 };
 
-dtr_map *dtr_map_add(dtr_map *map, uint32_t v, const char *label, const char *path) {
-    dtr_map *it;
+static void dtr_map_add(dtr_map **map, uint32_t v, const char *label, const char *path) {
     dtr_map *nmap = malloc(sizeof(dtr_map));
     memset(nmap, 0, sizeof(dtr_map));
     nmap->v = v;
 
     if (label != NULL) nmap->label = strdup(label);
     if (path != NULL) nmap->path = strdup(path);
-    if (map == NULL)
-        return nmap;
-
-    it = map;
-    while(it->next != NULL)
-        it = it->next;
-    it->next = nmap;
 
-    return nmap;
+    /* order doesn't matter until dtr_map_sort() */
+    nmap->next = *map;
+    *map = nmap;
 }
 
-void dtr_map_free(dtr_map *map) {
+static void dtr_map_free(dtr_map *map) {
     dtr_map *it;
     while(map != NULL) {
         it = map->next;
@@ -138,85 +172,333 @@ void dtr_map_free(dtr_map *map) {
     }
 }
 
-/* simple sort for maps
- * sv: 1 = sort by v, 0 = sort by label */
-void dtr_map_sort(dtr_map *map, int sv)
+static gint dtr_map_cmp_v(gconstpointer a, gconstpointer b) {
+    const dtr_map *ma = *(dtr_map * const *)a, *mb = *(dtr_map * const *)b;
+    return (ma->v > mb->v) - (ma->v < mb->v);
+}
+
+static gint dtr_map_cmp_label(gconstpointer a, gconstpointer b) {
+    const dtr_map *ma = *(dtr_map * const *)a, *mb = *(dtr_map * const *)b;
+    return strcmp(ma->label, mb->label);
+}
+
+/* sv: 1 = sort by v, 0 = sort by label; returns the new head */
+static dtr_map *dtr_map_sort(dtr_map *map, int sv)
 {
-    int done = 0, cmp;
-    dtr_map *this, *next, *top = NULL, *next_top;
-    uint32_t tmp_v;
-    char *tmp_l, *tmp_p;
-    if (map == NULL) return;
-    do {
-        this = map;
-        next_top = NULL;
-        while(this != NULL) {
-            next = this->next;
-            if (this == top)
-                break;
-            if (next == NULL)
-                break;
-            if (sv)
-                cmp = (this->v > next->v) ? 1 : 0;
-            else
-                cmp = strcmp(this->label, next->label);
-            if (cmp > 0) {
-                tmp_v = this->v; this->v = next->v; next->v = tmp_v;
-                tmp_l = this->label; this->label = next->label; next->label = tmp_l;
-                tmp_p = this->path; this->path = next->path; next->path = tmp_p;
-                next_top = this;
-            }
-            this = next;
-        }
-        if (next_top == NULL)
-            done = 1;
-        else
-            top = next_top;
-    } while (!done);
+    GPtrArray *items = g_ptr_array_new();
+    dtr_map *it;
+    guint i;
+
+    for (it = map; it != NULL; it = it->next)
+        g_ptr_array_add(items, it);
+    if (items->len < 2) {
+        g_ptr_array_free(items, TRUE);
+        return map;
+    }
+
+    g_ptr_array_sort(items, sv ? dtr_map_cmp_v : dtr_map_cmp_label);
+    for (i = 0; i < items->len; i++)
+        ((dtr_map *)items->pdata[i])->next =
+            (i + 1 < items->len) ? items->pdata[i + 1] : NULL;
+    map = items->pdata[0];
+    g_ptr_array_free(items, TRUE);
+
+    return map;
+}
+
+/* sorts the maps and builds the lookup indexes; the first of equal keys wins,
+ * as it did when the lists were searched */
+static void dtr_maps_index(dtr_maps *m) {
+    dtr_map *it;
+
+    m->aliases = dtr_map_sort(m->aliases, 0);
+    m->symbols = dtr_map_sort(m->symbols, 0);
+    m->phandles = dtr_map_sort(m->phandles, 1);
+
+    m->phandle_paths = g_hash_table_new(NULL, NULL);
+    m->alias_paths = g_hash_table_new(g_str_hash, g_str_equal);
+    m->path_aliases = g_hash_table_new(g_str_hash, g_str_equal);
+    m->path_symbols = g_hash_table_new(g_str_hash, g_str_equal);
+
+    for (it = m->phandles; it != NULL; it = it->next)
+        if (!g_hash_table_lookup(m->phandle_paths, GUINT_TO_POINTER(it->v)))
+            g_hash_table_insert(m->phandle_paths, GUINT_TO_POINTER(it->v), it->path);
+    for (it = m->aliases; it != NULL; it = it->next) {
+        if (!g_hash_table_lookup(m->alias_paths, it->label))
+            g_hash_table_insert(m->alias_paths, it->label, it->path);
+        if (!g_hash_table_lookup(m->path_aliases, it->path))
+            g_hash_table_insert(m->path_aliases, it->path, it->label);
+    }
+    for (it = m->symbols; it != NULL; it = it->next)
+        if (!g_hash_table_lookup(m->path_symbols, it->path))
+            g_hash_table_insert(m->path_symbols, it->path, it->label);
+}
+
+static void dtr_maps_free(dtr_maps *m) {
+    dtr_map_free(m->aliases);
+    dtr_map_free(m->symbols);
+    dtr_map_free(m->phandles);
+    if (m->phandle_paths) g_hash_table_destroy(m->phandle_paths);
+    if (m->alias_paths) g_hash_table_destroy(m->alias_paths);
+    if (m->path_aliases) g_hash_table_destroy(m->path_aliases);
+    if (m->path_symbols) g_hash_table_destroy(m->path_symbols);
+    memset(m, 0, sizeof(dtr_maps));
 }
 
 const char *dtr_phandle_lookup(dtr *s, uint32_t v) {
-    dtr_map *phi = s->phandles;
     /* 0 and 0xffffffff are invalid phandle values */
     /* TODO: perhaps "INVALID" or something */
-    if (v == 0 || v == 0xffffffff)
+    if (v == 0 || v == 0xffffffff || !s->maps->phandle_paths)
         return NULL;
-    while(phi != NULL) {
-        if (phi->v == v)
-            return phi->path;
-        phi = phi->next;
-    }
-    return NULL;
+    return g_hash_table_lookup(s->maps->phandle_paths, GUINT_TO_POINTER(v));
 }
 
 const char *dtr_alias_lookup(dtr *s, const char* label) {
-    dtr_map *ali = s->aliases;
-    while(ali != NULL) {
-        if (strcmp(ali->label, label) == 0)
-            return ali->path;
-        ali = ali->next;
-    }
-    return NULL;
+    if (!s->maps->alias_paths)
+        return NULL;
+    return g_hash_table_lookup(s->maps->alias_paths, label);
 }
 
 const char *dtr_alias_lookup_by_path(dtr *s, const char* path) {
-    dtr_map *ali = s->aliases;
-    while(ali != NULL) {
-        if (strcmp(ali->path, path) == 0)
-            return ali->label;
-        ali = ali->next;
-    }
-    return NULL;
+    if (!s->maps->path_aliases)
+        return NULL;
+    return g_hash_table_lookup(s->maps->path_aliases, path);
 }
 
 const char *dtr_symbol_lookup_by_path(dtr *s, const char* path) {
-    dtr_map *ali = s->symbols;
-    while(ali != NULL) {
-        if (strcmp(ali->path, path) == 0)
-            return ali->label;
-        ali = ali->next;
+    if (!s->maps->path_symbols)
+        return NULL;
+    return g_hash_table_lookup(s->maps->path_symbols, path);
+}
+
+static void fdt_entry_free(fdt_entry *e) {
+    if (e->children)
+        g_ptr_array_free(e->children, TRUE);
+    g_free(e->synth);
+    g_free(e);
+}
+
+static inline uint32_t fdt_u32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/* "//a/b/" -> "/a/b", "" -> "/" */
+static char *fdt_norm_path(const char *path) {
+    GString *np = g_string_new("/");
+    const char *c;
+
+    for (c = path; *c; c++) {
+        if (*c == '/' && np->str[np->len - 1] == '/')
+            continue;
+        g_string_append_c(np, *c);
     }
-    return NULL;
+    if (np->len > 1 && np->str[np->len - 1] == '/')
+        g_string_truncate(np, np->len - 1);
+
+    return g_string_free(np, FALSE);
+}
+
+static fdt_entry *fdt_add(dtr_fdt *f, GPtrArray *nodes, GPtrArray *paths,
+                          const char *name, const uint8_t *data, uint32_t length, int node) {
+    fdt_entry *e = g_new0(fdt_entry, 1);
+    const char *parent = paths->len ? paths->pdata[paths->len - 1] : NULL;
+    char *path;
+
+    e->name = name;
+    e->data = data;
+    e->length = length;
+    if (node)
+        e->children = g_ptr_array_new();
+
+    if (!parent)
+        path = g_strdup("/");
+    else if (strcmp(parent, "/") == 0)
+        path = g_strdup_printf("/%s", name);
+    else
+        path = g_strdup_printf("%s/%s", parent, name);
+
+    g_ptr_array_add(f->entries, e);
+    if (nodes->len)
+        g_ptr_array_add(((fdt_entry *)nodes->pdata[nodes->len - 1])->children, e);
+    /* a broken blob could repeat a name, keep the first */
+    if (!g_hash_table_lookup(f->paths, path))
+        g_hash_table_insert(f->paths, g_strdup(path), e);
+
+    if (node) {
+        g_ptr_array_add(nodes, e);
+        g_ptr_array_add(paths, path);
+        return e;
+    }
+
+    if (parent) {
+        /* what _dtr_read_aliases(), etc. collect from the directories */
+        if (strcmp(name, "phandle") == 0 && length == 4)
+            dtr_map_add(&f->maps.phandles, fdt_u32(data), NULL, parent);
+        else if (length > 1 && data[0] == '/' && data[length - 1] == 0) {
+            if (strcmp(parent, "/aliases") == 0)
+                dtr_map_add(&f->maps.aliases, 0, name, (const char *)data);
+            else if (strcmp(parent, "/__symbols__") == 0)
+                dtr_map_add(&f->maps.symbols, 0, name, (const char *)data);
+        }
+    }
+    g_free(path);
+
+    return e;
+}
+
+/* the kernel adds a "name" property to nodes that don't have one */
+static void fdt_add_name(dtr_fdt *f, GPtrArray *nodes, GPtrArray *paths) {
+    fdt_entry *node = nodes->pdata[nodes->len - 1], *e;
+    guint i;
+
+    for (i = 0; i < node->children->len; i++) {
+        e = node->children->pdata[i];
+        if (!e->children && strcmp(e->name, "name") == 0)
+            return;
+    }
+
+    e = fdt_add(f, nodes, paths, "name", NULL, 0, 0);
+    e->synth = g_strdup(node->name);
+    strend(e->synth, '@');
+    e->data = (const uint8_t *)e->synth;
+    e->length = strlen(e->synth) + 1;
+}
+
+static int fdt_parse(dtr_fdt *f, const uint8_t *blob, gsize size) {
+    uint32_t total, off_struct, off_strings, size_strings, size_struct, version;
+    const uint8_t *p, *end;
+    const char *strings;
+    GPtrArray *nodes, *paths;
+    int ok = 0;
+
+    if (size < 40 || fdt_u32(blob) != FDT_MAGIC)
+        return 0;
+
+    total = fdt_u32(blob + 4);
+    off_struct = fdt_u32(blob + 8);
+    off_strings = fdt_u32(blob + 12);
+    version = fdt_u32(blob + 20);
+    size_strings = fdt_u32(blob + 32);
+    size_struct = (version >= 17) ? fdt_u32(blob + 36) : total - off_struct;
+    if (total > size || off_struct > total || size_struct > total - off_struct
+        || off_strings > total || size_strings > total - off_strings)
+        return 0;
+
+    strings = (const char *)blob + off_strings;
+    p = blob + off_struct;
+    end = p + size_struct;
+    nodes = g_ptr_array_new();
+    paths = g_ptr_array_new_with_free_func(g_free);
+
+    while (p + 4 <= end) {
+        uint32_t token = fdt_u32(p);
+        p += 4;
+
+        if (token == FDT_BEGIN_NODE) {
+            const char *name = (const char *)p;
+            size_t len = strnlen(name, end - p);
+
+            if (p + len >= end)
+                break;
+            fdt_add(f, nodes, paths, name, NULL, 0, 1);
+            p += FDT_ALIGN(len + 1);
+        } else if (token == FDT_END_NODE) {
+            if (!nodes->len)
+                break;
+            fdt_add_name(f, nodes, paths);
+            g_ptr_array_remove_index(nodes, nodes->len - 1);
+            g_ptr_array_remove_index(paths, paths->len - 1);
+        } else if (token == FDT_PROP) {
+            uint32_t len, nameoff;
+
+            if (p + 8 > end || !nodes->len)
+                break;
+            len = fdt_u32(p);
+            nameoff = fdt_u32(p + 4);
+            p += 8;
+            if (len > (uint32_t)(end - p) || nameoff >= size_strings
+                || strnlen(strings + nameoff, size_strings - nameoff) == size_strings - nameoff)
+                break;
+            fdt_add(f, nodes, paths, strings + nameoff, p, len, 0);
+            p += FDT_ALIGN(len);
+        } else if (token == FDT_END) {
+            ok = (nodes->len == 0);
+            break;
+        } else if (token != FDT_NOP)
+            break;
+    }
+
+    g_ptr_array_free(nodes, TRUE);
+    g_ptr_array_free(paths, TRUE);
+    return ok;
+}
+
+static void dtr_fdt_unref(dtr_fdt *f) {
+    if (f == NULL || --f->ref > 0)
+        return;
+    g_hash_table_destroy(f->paths);
+    g_ptr_array_free(f->entries, TRUE);
+    dtr_maps_free(&f->maps);
+    if (f->mapped)
+#if GLIB_CHECK_VERSION(2,22,0)
+        g_mapped_file_unref(f->mapped);
+#else
+        g_mapped_file_free(f->mapped);
+#endif
+    g_free(f->contents);
+    g_free(f->file);
+    g_free(f);
+}
+
+/* dtr_get_string() and friends make a new dtr for every value,
+ * so the last blob stays parsed */
+static dtr_fdt *fdt_cache = NULL;
+
+static dtr_fdt *dtr_fdt_get(const char *file) {
+    dtr_fdt *f;
+    const uint8_t *blob;
+    gsize size;
+
+    if (fdt_cache && strcmp(fdt_cache->file, file) == 0) {
+        fdt_cache->ref++;
+        return fdt_cache;
+    }
+
+    f = g_new0(dtr_fdt, 1);
+    f->ref = 1;
+    f->file = g_strdup(file);
+    f->entries = g_ptr_array_new_with_free_func((GDestroyNotify)fdt_entry_free);
+    f->paths = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    f->mapped = g_mapped_file_new(file, FALSE, NULL);
+    if (f->mapped) {
+        blob = (const uint8_t *)g_mapped_file_get_contents(f->mapped);
+        size = g_mapped_file_get_length(f->mapped);
+    } else if (g_file_get_contents(file, &f->contents, &size, NULL)) {
+        blob = (const uint8_t *)f->contents;
+    } else {
+        dtr_fdt_unref(f);
+        return NULL;
+    }
+
+    if (!fdt_parse(f, blob, size)) {
+        dtr_fdt_unref(f);
+        return NULL;
+    }
+    dtr_maps_index(&f->maps);
+
+    dtr_fdt_unref(fdt_cache);
+    fdt_cache = f;
+    f->ref++;
+
+    return f;
+}
+
+static fdt_entry *fdt_lookup(dtr *s, const char *path) {
+    char *np = fdt_norm_path(path);
+    fdt_entry *e = g_hash_table_lookup(s->fdt->paths, np);
+    g_free(np);
+    return e;
 }
 
 void _dtr_read_aliases(dtr *);
@@ -225,14 +507,32 @@ void _dtr_map_phandles(dtr *, char *np);
 int dtr_inh_find(dtr_obj *obj, char *qprop, int limit);
 #define UMIN(a,b) MIN(((uint32_t)(a)), ((uint32_t)(b)))
 
+#ifndef DTR_FDT_PATH
+#define DTR_FDT_PATH "/sys/firmware/fdt"
+#endif
+#ifndef DTR_PROC_PATH
+#define DTR_PROC_PATH "/proc/device-tree"
+#endif
+#ifndef DTR_SYSFS_PATH
+#define DTR_SYSFS_PATH "/sys/firmware/devicetree/base"
+#endif
+
 const char *dtr_find_device_tree_root() {
     char *candidates[] = {
-        "/proc/device-tree",
-        "/sys/firmware/devicetree/base",
+        DTR_PROC_PATH,
+        DTR_SYSFS_PATH,
         /* others? */
         NULL
     };
     int i = 0;
+
+    if (params.path_dtb)
+        return params.path_dtb;
+
+    /* one read of the blob the kernel booted with, instead of a few
+     * thousand small files; only readable by root */
+    if (access(DTR_FDT_PATH, R_OK) != -1)
+        return DTR_FDT_PATH;
     while (candidates[i] != NULL) {
         if(access(candidates[i], F_OK) != -1)
             return candidates[i];
@@ -246,6 +546,7 @@ dtr *dtr_new_x(const char *base_path, int fast) {
     if (dt != NULL) {
         memset(dt, 0, sizeof(dtr));
         dt->log = strdup("");
+        dt->maps = &dt->own;
 
         if (base_path == NULL)
             base_path = DTR_ROOT;
@@ -257,14 +558,26 @@ dtr *dtr_new_x(const char *base_path, int fast) {
             return dt;
         }
 
+        /* a .dtb, or /sys/firmware/fdt, instead of a directory tree */
+        if (g_file_test(base_path, G_FILE_TEST_IS_REGULAR)) {
+            dt->fdt = dtr_fdt_get(base_path);
+            if (dt->fdt == NULL) {
+                dtr_msg(dt, "%s is not a valid flattened device tree.\n", base_path);
+                free(dt->base_path);
+                dt->base_path = NULL;
+                return dt;
+            }
+            /* the blob has all maps built already */
+            dt->maps = &dt->fdt->maps;
+            return dt;
+        }
+
         /* build alias and phandle lists */
-        dt->aliases = NULL;
-        dt->symbols = NULL;
-        dt->phandles = NULL;
         if (!fast) {
             _dtr_read_aliases(dt);
             _dtr_read_symbols(dt);
             _dtr_map_phandles(dt, "");
+            dtr_maps_index(dt->maps);
         }
     }
     return dt;
@@ -276,9 +589,8 @@ dtr *dtr_new(const char *base_path) {
 
 void dtr_free(dtr *s) {
     if (s != NULL) {
-        dtr_map_free(s->aliases);
-        dtr_map_free(s->symbols);
-        dtr_map_free(s->phandles);
+        dtr_maps_free(&s->own);
+        dtr_fdt_unref(s->fdt);
         free(s->base_path);
         free(s->log);
         free(s);
@@ -365,6 +677,26 @@ dtr_obj *dtr_obj_read(dtr *s, const char *dtp) {
             obj->prefix = NULL;
         }
 
+        if (s->fdt) {
+            fdt_entry *e = fdt_lookup(s, obj->path);
+
+            if (e == NULL) {
+                dtr_obj_free(obj);
+                return NULL;
+            }
+            if (e->children) {
+                obj->type = DT_NODE;
+            } else {
+                /* NUL terminated, like g_file_get_contents() */
+                obj->data = malloc(e->length + 1);
+                memcpy(obj->data, e->data, e->length);
+                obj->data_str[e->length] = 0;
+                obj->length = e->length;
+                obj->type = dtr_guess_type(obj);
+            }
+            return obj;
+        }
+
         /* read data */
         full_path = g_strdup_printf("%s%s", s->base_path, obj->path);
         if ( g_file_test(full_path, G_FILE_TEST_IS_DIR) ) {
@@ -434,6 +766,54 @@ char *dtr_obj_full_path(dtr_obj *s) {
     return NULL;
 }
 
+char **dtr_children(dtr *s, const char *np, int nodes_only) {
+    GPtrArray *names;
+    guint i;
+
+    if (!dtr_was_found(s) || np == NULL)
+        return NULL;
+
+    names = g_ptr_array_new();
+    if (s->fdt) {
+        fdt_entry *node = fdt_lookup(s, np);
+
+        if (node == NULL || node->children == NULL) {
+            g_ptr_array_free(names, TRUE);
+            return NULL;
+        }
+        for (i = 0; i < node->children->len; i++) {
+            fdt_entry *e = node->children->pdata[i];
+            if (!nodes_only || e->children)
+                g_ptr_array_add(names, g_strdup(e->name));
+        }
+    } else {
+        gchar *dir_path = g_strdup_printf("%s/%s", s->base_path, np);
+        GDir *dir = g_dir_open(dir_path, 0 , NULL);
+        const gchar *fn;
+
+        if (dir == NULL) {
+            g_free(dir_path);
+            g_ptr_array_free(names, TRUE);
+            return NULL;
+        }
+        while((fn = g_dir_read_name(dir)) != NULL) {
+            if (nodes_only) {
+                gchar *ftmp = g_strdup_printf("%s/%s", dir_path, fn);
+                gboolean is_dir = g_file_test(ftmp, G_FILE_TEST_IS_DIR);
+                g_free(ftmp);
+                if (!is_dir)
+                    continue;
+            }
+            g_ptr_array_add(names, g_strdup(fn));
+        }
+        g_dir_close(dir);
+        g_free(dir_path);
+    }
+    g_ptr_array_add(names, NULL);
+
+    return (char **)g_ptr_array_free(names, FALSE);
+}
+
 dtr_obj *dtr_get_prop_obj(dtr *s, dtr_obj *node, const char *name) {
     dtr_obj *prop;
     char *ptmp;
@@ -935,9 +1315,7 @@ dt_opp_range *dtr_get_opp_range(dtr *s, const char *name) {
     uint32_t opp_ph = 0;
     const char *opp_table_path = NULL;
     char *tab_compat = NULL, *tab_status = NULL;
-    const gchar *fn;
-    gchar *full_path;
-    GDir *dir;
+    char **rows;
     uint64_t khz = 0;
     uint32_t lns = 0;
     char *row_status = NULL;
@@ -960,8 +1338,8 @@ dt_opp_range *dtr_get_opp_range(dtr *s, const char *name) {
             ret->clock_latency_ns = dtr_get_prop_u32(s, obj, "clock-latency");
 
             /* pairs of (kHz,uV) */
-            for (i = 0; i < table_obj->length; i += 2) {
-                khz = table_obj->data_int[i];
+            for (i = 0; i + 1 < table_obj->length / 4; i += 2) {
+                khz = be32toh(table_obj->data_int[i]);
                 if (khz > ret->khz_max)
                     ret->khz_max = khz;
                 if (khz < ret->khz_min || ret->khz_min == 0)
@@ -1005,12 +1383,11 @@ dt_opp_range *dtr_get_opp_range(dtr *s, const char *name) {
     ret->version = 2;
     ret->phandle = opp_ph;
 
-    full_path = dtr_obj_full_path(table_obj);
-    dir = g_dir_open(full_path, 0 , NULL);
-    if (dir) {
-        while((fn = g_dir_read_name(dir)) != NULL) {
-            row_obj = dtr_get_prop_obj(s, table_obj, fn);
-            if (row_obj->type == DT_NODE) {
+    rows = dtr_children(s, dtr_obj_path(table_obj), 1);
+    if (rows) {
+        for (i = 0; rows[i] != NULL; i++) {
+            row_obj = dtr_get_prop_obj(s, table_obj, rows[i]);
+            if (row_obj && row_obj->type == DT_NODE) {
                 row_status = dtr_get_prop_str(s, row_obj, "status");
                 if (!row_status || strcmp(row_status, "disabled") != 0) {
                     khz = dtr_get_prop_u64(s, row_obj, "opp-hz");
@@ -1027,9 +1404,8 @@ dt_opp_range *dtr_get_opp_range(dtr *s, const char *name) {
             dtr_obj_free(row_obj);
             row_obj = NULL;
         }
-        g_dir_close(dir);
+        g_strfreev(rows);
     }
-    g_free(full_path);
 
 get_opp_finish:
     dtr_obj_free(obj);
@@ -1046,7 +1422,6 @@ void _dtr_read_aliases(dtr *s) {
     GDir *dir;
     const gchar *fn;
     dtr_obj *anode, *prop;
-    dtr_map *al;
     anode = dtr_obj_read(s, "/aliases");
 
     dir_path = g_strdup_printf("%s/aliases", s->base_path);
@@ -1056,9 +1431,7 @@ void _dtr_read_aliases(dtr *s) {
             prop = dtr_get_prop_obj(s, anode, fn);
             if (prop->type == DTP_STR) {
                 if (*prop->data_str == '/') {
-                    al = dtr_map_add(s->aliases, 0, prop->name, prop->data_str);
-                    if (s->aliases == NULL)
-                        s->aliases = al;
+                    dtr_map_add(&s->own.aliases, 0, prop->name, prop->data_str);
                 }
             }
             dtr_obj_free(prop);
@@ -1067,7 +1440,6 @@ void _dtr_read_aliases(dtr *s) {
     }
     g_free(dir_path);
     dtr_obj_free(anode);
-    dtr_map_sort(s->aliases, 0);
 }
 
 void _dtr_read_symbols(dtr *s) {
@@ -1075,7 +1447,6 @@ void _dtr_read_symbols(dtr *s) {
     GDir *dir;
     const gchar *fn;
     dtr_obj *anode, *prop;
-    dtr_map *al;
     anode = dtr_obj_read(s, "/__symbols__");
 
     dir_path = g_strdup_printf("%s/__symbols__", s->base_path);
@@ -1085,9 +1456,7 @@ void _dtr_read_symbols(dtr *s) {
             prop = dtr_get_prop_obj(s, anode, fn);
             if (prop->type == DTP_STR) {
                 if (*prop->data_str == '/') {
-                    al = dtr_map_add(s->symbols, 0, prop->name, prop->data_str);
-                    if (s->symbols == NULL)
-                        s->symbols = al;
+                    dtr_map_add(&s->own.symbols, 0, prop->name, prop->data_str);
                 }
             }
             dtr_obj_free(prop);
@@ -1096,7 +1465,6 @@ void _dtr_read_symbols(dtr *s) {
     }
     g_free(dir_path);
     dtr_obj_free(anode);
-    dtr_map_sort(s->symbols, 0);
 }
 
 /* TODO: rewrite */
@@ -1106,7 +1474,6 @@ void _dtr_map_phandles(dtr *s, char *np) {
     const gchar *fn;
     GDir *dir;
     dtr_obj *prop, *ph_prop;
-    dtr_map *ph;
 
     if (np == NULL) np = "";
     dir_path = g_strdup_printf("%s/%s", s->base_path, np);
@@ -1121,9 +1488,7 @@ void _dtr_map_phandles(dtr *s, char *np) {
                 ptmp = g_strdup_printf("%s/phandle", ntmp);
                 ph_prop = dtr_obj_read(s, ptmp);
                 if (ph_prop != NULL) {
-                    ph = dtr_map_add(s->phandles, be32toh(*ph_prop->data_int), NULL, ntmp);
-                    if (s->phandles == NULL)
-                        s->phandles = ph;
+                    dtr_map_add(&s->own.phandles, be32toh(*ph_prop->data_int), NULL, ntmp);
                 }
                 _dtr_map_phandles(s, ntmp);
                 g_free(ptmp);
@@ -1135,7 +1500,6 @@ void _dtr_map_phandles(dtr *s, char *np) {
         g_dir_close(dir);
     }
     dtr_obj_free(prop);
-    dtr_map_sort(s->phandles, 1);
 }
 
 /*
@@ -1172,9 +1536,9 @@ char *dtr_map_info_section(dtr *s, dtr_map *map, char *title, int kvl) {
 char *dtr_maps_info(dtr *s) {
     gchar *ph_map, *al_map, *sy_map, *ret;
 
-    ph_map = dtr_map_info_section(s, s->phandles, _("phandle Map"), 1);
-    al_map = dtr_map_info_section(s, s->aliases, _("Alias Map"), 0);
-    sy_map = dtr_map_info_section(s, s->symbols, _("Symbol Map"), 0);
+    ph_map = dtr_map_info_section(s, s->maps->phandles, _("phandle Map"), 1);
+    al_map = dtr_map_info_section(s, s->maps->aliases, _("Alias Map"), 0);
+    sy_map = dtr_map_info_section(s, s->maps->symbols, _("Symbol Map"), 0);
     ret = g_strdup_printf("%s%s%s", ph_map, sy_map, al_map);
     g_free(ph_map);
     g_free(al_map);
@@ -18,6 +18,8 @@
  *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
  */
 
+#include <fcntl.h>
+#include <time.h>
 #include "hardinfo.h"
 #include "gpu_util.h"
 #include "nice_name.h"
@@ -101,33 +103,45 @@ static void intel_fill_freq(gpud *s) {
     }
 }
 
-static void amdgpu_parse_dpmclk(gchar *path, int *min, int *max) {
-    gchar *data = NULL, *p, *next_nl;
-    int sp, i, clk;
+/* pp_dpm_sclk and friends list the clock levels, the active one marked;
+ * APUs may add an "S:" deep sleep level, which is not part of the range:
+ *   S: 19Mhz
+ *   0: 500Mhz
+ *   1: 2100Mhz *
+ * min and max get the range (-1 if none); returns the active clock or -1 */
+int amdgpu_dpmclk_parse(const char *text, int *min, int *max) {
+    const char *p = text, *next_nl;
+    int i, clk, active = -1;
 
     *min = -1;
     *max = -1;
 
-    g_file_get_contents(path, &data, NULL, NULL);
-    if (data) {
-        p = data;
-
-        while(next_nl = strchr(p, '\n')) {
-            strend(p, '\n');
-            sp = sscanf(p, "%d: %dMhz", &i, &clk);
-
-            if (sp == 2) {
-                if (clk > 0) {
-                    if (*min < 0 || clk < *min)
-                        *min = clk;
-                    if (clk > *max)
-                        *max = clk;
-                }
-            }
-
-            p = next_nl + 1;
+    while(p && *p) {
+        next_nl = strchr(p, '\n');
+        if (sscanf(p, "%d: %d", &i, &clk) == 2 && clk > 0) {
+            if (*min < 0 || clk < *min)
+                *min = clk;
+            if (clk > *max)
+                *max = clk;
+        } else if (sscanf(p, "S: %d", &clk) != 1) {
+            clk = -1;
         }
+        if (clk > 0 && memchr(p, '*', next_nl ? (size_t)(next_nl - p) : strlen(p)))
+            active = clk;
+        p = next_nl ? next_nl + 1 : NULL;
     }
+    return active;
+}
+
+static void amdgpu_parse_dpmclk(gchar *path, int *min, int *max) {
+    gchar *data = NULL;
+
+    *min = -1;
+    *max = -1;
+
+    g_file_get_contents(path, &data, NULL, NULL);
+    if (data)
+        amdgpu_dpmclk_parse(data, min, max);
     g_free(data);
 }
 
@@ -156,6 +170,182 @@ static void amdgpu_fill_freq(gpud *s) {
     }
 }
 
+/* Live values are read from files kept open under /sys/class/drm/cardN,
+ * with pread() so a sample is one syscall per value. Reading them wakes a
+ * runtime-suspended card, so nothing is read unless it is awake. */
+enum {
+    GS_BUSY,        /* amdgpu */
+    GS_SCLK,        /* amdgpu */
+    GS_MCLK,        /* amdgpu */
+    GS_ACT_FREQ,    /* i915 */
+    GS_VRAM_USED,   /* amdgpu */
+    GS_VRAM_TOTAL,  /* amdgpu */
+    GS_POWER,       /* hwmon, uW */
+    GS_ENERGY,      /* hwmon, uJ; i915 has no power file */
+    GS_N_FILES
+};
+
+/* relative to the card; the hwmon ones are looked up in device/hwmon/ */
+static const char *gs_files[GS_N_FILES] = {
+    "device/gpu_busy_percent",
+    "device/pp_dpm_sclk",
+    "device/pp_dpm_mclk",
+    "gt_act_freq_mhz",
+    "device/mem_info_vram_used",
+    "device/mem_info_vram_total",
+    "power1_average",
+    "energy1_input",
+};
+
+struct gpu_sampler {
+    int fd[GS_N_FILES];
+    int runtime_fd; /* device/power/runtime_status, -1 if there is none */
+    double last_energy; /* J, < 0 while unknown */
+    double last_t;
+};
+
+static double gs_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *gs_read(gpu_sampler *s, int f, char *buf, size_t size) {
+    ssize_t n;
+    if (s->fd[f] < 0)
+        return NULL;
+    n = pread(s->fd[f], buf, size - 1, 0);
+    if (n <= 0)
+        return NULL;
+    buf[n] = 0;
+    return buf;
+}
+
+static int64_t gs_read_int(gpu_sampler *s, int f) {
+    char buf[32];
+    long long v;
+    if (!gs_read(s, f, buf, sizeof(buf)) || sscanf(buf, "%lld", &v) != 1)
+        return -1;
+    return v;
+}
+
+/* card_path is a /sys/class/drm/cardN; NULL if it has nothing to sample */
+gpu_sampler *gpu_sampler_new(const char *card_path) {
+    gpu_sampler *s = g_new0(gpu_sampler, 1);
+    gchar *path, *hwmon_dir;
+    const gchar *entry;
+    GDir *dir;
+    int i, open_files = 0;
+
+    for (i = 0; i < GS_N_FILES; i++)
+        s->fd[i] = -1;
+    s->last_energy = -1;
+
+    path = g_build_filename(card_path, "device", "power", "runtime_status", NULL);
+    s->runtime_fd = open(path, O_RDONLY | O_CLOEXEC);
+    g_free(path);
+
+    for (i = 0; i < GS_POWER; i++) {
+        path = g_build_filename(card_path, gs_files[i], NULL);
+        s->fd[i] = open(path, O_RDONLY | O_CLOEXEC);
+        g_free(path);
+    }
+
+    hwmon_dir = g_build_filename(card_path, "device", "hwmon", NULL);
+    dir = g_dir_open(hwmon_dir, 0, NULL);
+    if (dir) {
+        while ((entry = g_dir_read_name(dir)) && s->fd[GS_POWER] < 0 && s->fd[GS_ENERGY] < 0) {
+            if (!g_str_has_prefix(entry, "hwmon"))
+                continue;
+            for (i = GS_POWER; i < GS_N_FILES; i++) {
+                path = g_build_filename(hwmon_dir, entry, gs_files[i], NULL);
+                s->fd[i] = open(path, O_RDONLY | O_CLOEXEC);
+                g_free(path);
+            }
+        }
+        g_dir_close(dir);
+    }
+    g_free(hwmon_dir);
+
+    for (i = 0; i < GS_N_FILES; i++)
+        if (s->fd[i] >= 0)
+            open_files++;
+    if (!open_files) {
+        if (s->runtime_fd >= 0)
+            close(s->runtime_fd);
+        g_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void gpu_sampler_free(gpu_sampler *s) {
+    int i;
+    if (s) {
+        for (i = 0; i < GS_N_FILES; i++)
+            if (s->fd[i] >= 0)
+                close(s->fd[i]);
+        if (s->runtime_fd >= 0)
+            close(s->runtime_fd);
+        g_free(s);
+    }
+}
+
+/* "unsupported" is a card without runtime pm, which is always powered */
+static gboolean gs_awake(gpu_sampler *s) {
+    char buf[32];
+    ssize_t n;
+
+    if (s->runtime_fd < 0)
+        return TRUE;
+    n = pread(s->runtime_fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0)
+        return FALSE;
+    buf[n] = 0;
+    return g_str_has_prefix(buf, "active") || g_str_has_prefix(buf, "unsupported");
+}
+
+/* all -1 while the card is suspended */
+void gpu_sampler_read(gpu_sampler *s, gpu_sample *out) {
+    char buf[1024];
+    int min, max;
+    int64_t v;
+
+    if (!gs_awake(s)) {
+        out->busy_percent = out->core_mhz = out->mem_mhz = -1;
+        out->power_w = -1;
+        out->vram_used = out->vram_total = -1;
+        return;
+    }
+
+    out->busy_percent = gs_read_int(s, GS_BUSY);
+
+    out->core_mhz = -1;
+    if (gs_read(s, GS_SCLK, buf, sizeof(buf)))
+        out->core_mhz = amdgpu_dpmclk_parse(buf, &min, &max);
+    if (out->core_mhz < 0)
+        out->core_mhz = gs_read_int(s, GS_ACT_FREQ);
+
+    out->mem_mhz = -1;
+    if (gs_read(s, GS_MCLK, buf, sizeof(buf)))
+        out->mem_mhz = amdgpu_dpmclk_parse(buf, &min, &max);
+
+    out->vram_used = gs_read_int(s, GS_VRAM_USED);
+    out->vram_total = gs_read_int(s, GS_VRAM_TOTAL);
+
+    out->power_w = -1;
+    if ((v = gs_read_int(s, GS_POWER)) >= 0) {
+        out->power_w = v / 1e6;
+    } else if ((v = gs_read_int(s, GS_ENERGY)) >= 0) {
+        /* average power since the previous sample */
+        double e = v / 1e6, t = gs_now();
+        if (s->last_energy >= 0 && e >= s->last_energy && t > s->last_t)
+            out->power_w = (e - s->last_energy) / (t - s->last_t);
+        s->last_energy = e;
+        s->last_t = t;
+    }
+}
+
 gpud *gpud_new() {
     return g_new0(gpud, 1);
 }
@@ -259,10 +449,10 @@ static void make_nice_name(gpud *s) {
  *  Usually a gpu dt node will have ./name = "gpu"
  */
 static gchar *dt_find_gpu(dtr *dt, char *np) {
-    gchar *dir_path, *dt_path, *ret;
+    gchar *dt_path, *ret;
     gchar *ftmp, *ntmp;
-    const gchar *fn;
-    GDir *dir;
+    gchar **names;
+    int i;
     dtr_obj *obj;
 
     /* consider self */
@@ -280,28 +470,20 @@ static gchar *dt_find_gpu(dtr *dt, char *np) {
     }
 
     /* search children ... */
-    dir_path = g_strdup_printf("%s/%s", dtr_base_path(dt), np);
-    dir = g_dir_open(dir_path, 0 , NULL);
-    if (dir) {
-        while((fn = g_dir_read_name(dir)) != NULL) {
-            ftmp = g_strdup_printf("%s/%s", dir_path, fn);
-            if ( g_file_test(ftmp, G_FILE_TEST_IS_DIR) ) {
-                if (strcmp(np, "/") == 0)
-                    ntmp = g_strdup_printf("/%s", fn);
-                else
-                    ntmp = g_strdup_printf("%s/%s", np, fn);
-                ret = dt_find_gpu(dt, ntmp);
-                g_free(ntmp);
-                if (ret != NULL) {
-                    g_free(ftmp);
-                    g_dir_close(dir);
-                    return ret;
-                }
-            }
-            g_free(ftmp);
+    names = dtr_children(dt, np, 1);
+    for (i = 0; names && names[i] != NULL; i++) {
+        if (strcmp(np, "/") == 0)
+            ntmp = g_strdup_printf("/%s", names[i]);
+        else
+            ntmp = g_strdup_printf("%s/%s", np, names[i]);
+        ret = dt_find_gpu(dt, ntmp);
+        g_free(ntmp);
+        if (ret != NULL) {
+            g_strfreev(names);
+            return ret;
         }
-        g_dir_close(dir);
     }
+    g_strfreev(names);
 
     return NULL;
 }
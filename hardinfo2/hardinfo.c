@@ -25,6 +25,9 @@
 #include <iconcache.h>
 #include <stock.h>
 #include <vendor.h>
+#include <inventory.h>
+#include <scan_profile.h>
+#include <daemon.h>
 #include <syncmanager.h>
 #include <gio/gio.h>
 #include <glib/gstdio.h>
@@ -34,6 +37,67 @@
 
 ProgramParameters params = { 0 };
 
+/* copies a report written to file to stdout */
+static void report_print_file(const gchar *file)
+{
+    FILE *io=fopen(file,"r");
+    char buf[65536];
+    size_t n;
+
+    if(!io) return;
+    while((n=fread(buf, 1, sizeof(buf), io))>0)
+        fwrite(buf, 1, n, stdout);
+    fclose(io);
+}
+
+/* prints a report, or only the part of it matching --topic */
+static void report_print(gchar *report)
+{
+    if(params.topic){
+        int active=0;
+        size_t poslen,plen;
+        gchar *p=report,*pos=report,*header=NULL;
+        while(*pos!=0){
+            while( (*pos!=0) && (*pos!='\n') ) pos++;
+            if(*pos){
+                *pos=0;
+                poslen=strlen(pos+1);
+                plen=strlen(p);
+                //stop before printing new header/module
+                if((active==1) && (poslen>=2) && (((*(pos+1)=='*') && (*(pos+2)=='*'))) ) {active=-1;} //next is module
+                if((active>=2) && (poslen>=2) && (((*(pos+1)=='-') && (*(pos+2)=='-')) || ((*(pos+1)=='*') && (*(pos+2)=='*'))) ) {if(active==2) active=-1; else active=0;} //next is heading/module
+
+                if(strcmp(params.topic,"getlist")==0) {
+                    if((*(p+0)==' ') && (*(p+3)=='-')) {active=4;}//subblock
+                    if((*(p+0)=='-') && (*(p+1)!='-')) {active=3;}//subheading
+                    if((*(p+0)!='-') && (*(p+0)>32) && (*(p+0)!='*')) {active=1;}//heading
+                    if(active) g_print("%s\n",p);
+                    active=0;
+                } else {
+                    if((*(p+0)!='-') && (*(p+0)>32) && (*(p+0)!='*')) {if(header) g_free(header);header=g_strdup(p);}//heading
+                    //if((*(p+0)=='-') && (*(p+1)!='-')) {if(header) header=g_strconcat(header,p,NULL); else header=g_strdup(p);}//subheading
+                    //start
+                    if((active==0) && (plen>=(4+strlen(params.topic))) && (g_ascii_strncasecmp(p+4,params.topic,strlen(params.topic))==0) ) {active=4;if(header) g_print("%s\n",header);}//subblock
+                    if((active==0) && (plen>=(1+strlen(params.topic))) && (g_ascii_strncasecmp(p+1,params.topic,strlen(params.topic))==0) ) {active=3;if(header) g_print("%s\n",header);}//subheading
+                    if((active==0) && (plen>=(  strlen(params.topic))) && (g_ascii_strncasecmp(p  ,params.topic,strlen(params.topic))==0) && ((poslen>=1)&&(*(pos+1)=='-')) ) {active=2;}//heading
+                    if((active==0) && (plen>=(  strlen(params.topic))) && (g_ascii_strncasecmp(p  ,params.topic,strlen(params.topic))==0) && ((poslen>=1)&&(*(pos+1)=='*')) ) {active=1;}//module
+                    if((*params.topic=='*') && (strlen(params.topic)>=2) && (strstr(p,params.topic+1)!=0)) {active=1;}//text search
+                    //print
+                    if(active>0) g_print("%s\n",p);
+                    //Stop
+                    if(*params.topic=='*') {active=0;}//text search
+                    if((active>=4) && (poslen>=4) && (*(pos+4)=='-')) {active=0;} //active subblock and next is new subblock
+                    if((active>=3) && (poslen>=1) && (*(pos+1)=='-')) {active=0;} //active and next is subheader
+                }
+
+                pos++; p=pos;
+            }
+        }
+    } else {
+        g_print("%s", report);
+    }
+}
+
 int main(int argc, char **argv)
 {
     int exit_code = 0;
@@ -54,6 +118,8 @@ int main(int argc, char **argv)
 
     /* parse all command line parameters */
     parameters_init(&argc, &argv, &params);
+    if (params.profile_scans)
+        scan_profile_init(params.profile_scans);
 
     params.path_data=g_strdup(PREFIX);
     params.path_lib=g_strdup(LIBPREFIX);
@@ -90,6 +156,7 @@ int main(int argc, char **argv)
         path = g_build_filename(g_get_user_config_dir(), "hardinfo2","sdcard.ids", NULL);g_remove(path);g_free(path);
         path = g_build_filename(g_get_user_config_dir(), "hardinfo2","usb.ids", NULL);g_remove(path);g_free(path);
         path = g_build_filename(g_get_user_config_dir(), "hardinfo2","vendor.ids", NULL);g_remove(path);g_free(path);
+        path = g_build_filename(g_get_user_config_dir(), "hardinfo2","toolchains.conf", NULL);g_remove(path);g_free(path);
 	//update settings.ini
 	g_key_file_set_string(key_file, "Application", "Version", VERSION);
 #if GLIB_CHECK_VERSION(2,40,0)
@@ -121,7 +188,30 @@ int main(int argc, char **argv)
         return 0;
     }
 
-    if (!params.create_report && !params.run_benchmark) {
+    /* a running daemon already has the modules loaded; it only sees the
+       real system, so any override or benchmark run is done here */
+    if (params.create_report && !params.daemon && !params.topiccached && !params.bench_user_note
+        && !params.run_benchmark && !params.path_sysfs && !params.path_modules && !params.path_dtb && !params.profile_scans
+        && (params.report_format == REPORT_FORMAT_TEXT || params.report_format == REPORT_FORMAT_SHELL)) {
+        gchar *request = g_strdup_printf("REPORT %s%s",
+                                         params.report_format == REPORT_FORMAT_SHELL ? "shell" : "text",
+                                         params.force_all_details ? " all" : "");
+        gchar *report = daemon_request(request);
+
+        g_free(request);
+        if (report) {
+            gchar *file = g_build_filename(g_get_user_config_dir(), "hardinfo2", "cachedreport", NULL);
+
+            /* --topic-cache reads what the last -r left */
+            g_file_set_contents(file, report, -1, NULL);
+            g_free(file);
+            report_print(report);
+            g_free(report);
+            return 0;
+        }
+    }
+
+    if (!params.create_report && !params.run_benchmark && !params.daemon) {
         /* we only try to open the UI if the user didn't ask for a report. */
         params.gui_running = ui_init(&argc, &argv);
 
@@ -157,6 +247,8 @@ int main(int argc, char **argv)
           g_print("%s\n", result);
           g_free(result);
         }
+    } else if (params.daemon) {
+        exit_code = daemon_run(modules);
     } else if (params.gui_running) {
 	/* initialize gui and start gtk+ main loop */
 	icon_cache_init();
@@ -167,6 +259,13 @@ int main(int argc, char **argv)
 	DEBUG("entering gtk+ main loop");
 
 	gtk_main();
+    } else if (params.create_report
+               && (params.report_format == REPORT_FORMAT_JSON || params.report_format == REPORT_FORMAT_CBOR)) {
+	DEBUG("generating structured report");
+
+	inventory_init();
+	report_create_structured(stdout, modules, params.report_format, params.select);
+	inventory_shutdown();
     } else if (params.create_report) {
 	/* generate report */
 	gchar *report=NULL;
@@ -177,73 +276,35 @@ int main(int argc, char **argv)
 
 	DEBUG("generating report");
 
-#define REPORTSIZE 1024*1024
+	gchar *file=g_build_filename(g_get_user_config_dir(), "hardinfo2", "cachedreport", NULL);
 	if(params.topiccached){
-            gchar *file=g_build_filename(g_get_user_config_dir(), "hardinfo2", "cachedreport", NULL);
-	    FILE *io=fopen(file,"r");
-	    if(io){
-	        report=g_malloc(REPORTSIZE);
-		if(report){
-		  if(fread(report, 1, REPORTSIZE, io)==0) {
-		        g_free(report);
-			report=NULL;
-		    }
-		}
-	        fclose(io);
-	    }
+	    if(!g_file_get_contents(file, &report, NULL, NULL))
+	        report=NULL;
 	}
 	if(!report){
-	    report = report_create_from_module_list_format(modules, params.report_format);
-
-	    gchar *file=g_build_filename(g_get_user_config_dir(), "hardinfo2", "cachedreport", NULL);
+	    /* the report goes to the cache file while modules are scanned,
+	       so only a --topic lookup needs it in memory afterwards */
 	    FILE *io=fopen(file,"w");
-	    fputs(report,io);
-	    fclose(io);
-	}
 
-	if(params.topic){
-	    int active=0;
-	    size_t poslen,plen;
-	    gchar *p=report,*pos=report,*header=NULL;
-	    while(*pos!=0){
-	        while( (*pos!=0) && (*pos!='\n') ) pos++;
-	        if(*pos){
-	            *pos=0;
-		    poslen=strlen(pos+1);
-		    plen=strlen(p);
-		    //stop before printing new header/module
-		    if((active==1) && (poslen>=2) && (((*(pos+1)=='*') && (*(pos+2)=='*'))) ) {active=-1;} //next is module
-		    if((active>=2) && (poslen>=2) && (((*(pos+1)=='-') && (*(pos+2)=='-')) || ((*(pos+1)=='*') && (*(pos+2)=='*'))) ) {if(active==2) active=-1; else active=0;} //next is heading/module
-
-		    if(strcmp(params.topic,"getlist")==0) {
-		        if((*(p+0)==' ') && (*(p+3)=='-')) {active=4;}//subblock
-		        if((*(p+0)=='-') && (*(p+1)!='-')) {active=3;}//subheading
-		        if((*(p+0)!='-') && (*(p+0)>32) && (*(p+0)!='*')) {active=1;}//heading
-		        if(active) g_print("%s\n",p);
-		        active=0;
-		    } else {
-		        if((*(p+0)!='-') && (*(p+0)>32) && (*(p+0)!='*')) {if(header) g_free(header);header=g_strdup(p);}//heading
-		        //if((*(p+0)=='-') && (*(p+1)!='-')) {if(header) header=g_strconcat(header,p,NULL); else header=g_strdup(p);}//subheading
-		        //start
-			if((active==0) && (plen>=(4+strlen(params.topic))) && (g_ascii_strncasecmp(p+4,params.topic,strlen(params.topic))==0) ) {active=4;if(header) g_print("%s\n",header);}//subblock
-			if((active==0) && (plen>=(1+strlen(params.topic))) && (g_ascii_strncasecmp(p+1,params.topic,strlen(params.topic))==0) ) {active=3;if(header) g_print("%s\n",header);}//subheading
-			if((active==0) && (plen>=(  strlen(params.topic))) && (g_ascii_strncasecmp(p  ,params.topic,strlen(params.topic))==0) && ((poslen>=1)&&(*(pos+1)=='-')) ) {active=2;}//heading
-			if((active==0) && (plen>=(  strlen(params.topic))) && (g_ascii_strncasecmp(p  ,params.topic,strlen(params.topic))==0) && ((poslen>=1)&&(*(pos+1)=='*')) ) {active=1;}//module
-			if((*params.topic=='*') && (strlen(params.topic)>=2) && (strstr(p,params.topic+1)!=0)) {active=1;}//text search
-			//print
-			if(active>0) g_print("%s\n",p);
-			//Stop
-			if(*params.topic=='*') {active=0;}//text search
-			if((active>=4) && (poslen>=4) && (*(pos+4)=='-')) {active=0;} //active subblock and next is new subblock
-			if((active>=3) && (poslen>=1) && (*(pos+1)=='-')) {active=0;} //active and next is subheader
-		    }
-
-		    pos++; p=pos;
-	        }
+	    inventory_init();
+	    if(io){
+	        report_create_to_stream(io, modules, params.report_format);
+	        fclose(io);
+	        if(params.topic)
+	            g_file_get_contents(file, &report, NULL, NULL);
+	        else
+	            report_print_file(file);
+	    } else if(!params.topic){
+	        report_create_to_stream(stdout, modules, params.report_format);
+	    } else {
+	        report = report_create_from_module_list_format(modules, params.report_format);
 	    }
-	} else {
-	    g_print("%s", report);
+	    inventory_shutdown();
 	}
+	g_free(file);
+
+	if(report)
+	    report_print(report);
 
 	if(params.bench_user_note) {//synchronize
 	    if(!params.skip_benchmarks)
@@ -0,0 +1,317 @@
+/*
+ *    Hardinfo2 - System Information and benchmark
+ *    Copyright (C) 2003-2007 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <sys/stat.h>
+#include <locale.h>
+#include <glib/gstdio.h>
+#include "hardinfo.h"
+#include "inventory.h"
+
+static GKeyFile *inventory = NULL;
+static gchar *inventory_path = NULL;
+static gchar *inventory_global = NULL;
+static gboolean inventory_dirty = FALSE;
+
+void inventory_init(void)
+{
+    if (inventory)
+        return;
+    /* tokens are taken from the live system, they can't tell
+       whether another --sysfs tree, --modules dir or --dtb blob changed */
+    if (params.path_sysfs || params.path_modules || params.path_dtb)
+        return;
+
+    inventory_path = g_build_filename(g_get_user_config_dir(), "hardinfo2",
+                                      "inventory.cache", NULL);
+    inventory = g_key_file_new();
+    g_key_file_load_from_file(inventory, inventory_path, 0, NULL);
+
+    /* anything that changes the text a module produces; the message
+     * locale is taken per entry, as structured reports switch it */
+    inventory_global = g_strdup_printf("%s:%s:%d:%d:%d", VERSION,
+                                       inventory_boot_id(),
+                                       params.fmt_opts, params.markup_ok,
+                                       params.force_all_details);
+}
+
+void inventory_shutdown(void)
+{
+    if (!inventory)
+        return;
+
+    if (inventory_dirty) {
+        gchar *dir = g_path_get_dirname(inventory_path);
+
+        g_mkdir_with_parents(dir, 0755);
+        g_free(dir);
+#if GLIB_CHECK_VERSION(2,40,0)
+        g_key_file_save_to_file(inventory, inventory_path, NULL);
+#else
+        gsize length;
+        gchar *data = g_key_file_to_data(inventory, &length, NULL);
+        g_file_set_contents(inventory_path, data, length, NULL);
+        g_free(data);
+#endif
+    }
+
+    g_key_file_free(inventory);
+    g_free(inventory_path);
+    g_free(inventory_global);
+    inventory = NULL;
+    inventory_path = inventory_global = NULL;
+    inventory_dirty = FALSE;
+}
+
+gchar *inventory_entry_id(ShellModule *module, ShellModuleEntry *entry)
+{
+    gchar *base, *id;
+
+    if (!entry->tokenfunc || !module->dll)
+        return NULL;
+
+    base = g_path_get_basename(g_module_name(module->dll));
+    id = g_strdup_printf("%s/%d", base, entry->number);
+    g_free(base);
+
+    return id;
+}
+
+gchar *inventory_entry_token(ShellModuleEntry *entry)
+{
+    gchar *token, *ret;
+
+    if (!inventory || !entry->tokenfunc)
+        return NULL;
+
+    token = entry->tokenfunc(entry->number);
+    if (!token)
+        return NULL;
+
+    ret = g_strdup_printf("%s:%s|%s", inventory_global,
+                          setlocale(LC_MESSAGES, NULL), token);
+    g_free(token);
+
+    return ret;
+}
+
+gchar *inventory_get(const gchar *id, const gchar *token)
+{
+    gchar *stored;
+
+    if (!inventory || !id || !token)
+        return NULL;
+
+    stored = g_key_file_get_string(inventory, id, "Token", NULL);
+    if (!stored || !g_str_equal(stored, token)) {
+        g_free(stored);
+        return NULL;
+    }
+    g_free(stored);
+
+    return g_key_file_get_string(inventory, id, "Data", NULL);
+}
+
+static gchar *moreinfo_key(const gchar *tag)
+{
+    gchar *sum = g_compute_checksum_for_string(G_CHECKSUM_MD5, tag, -1);
+    gchar *key = g_strdup_printf("MoreInfo-%s", sum);
+
+    g_free(sum);
+    return key;
+}
+
+gchar *inventory_get_moreinfo(const gchar *id, const gchar *tag)
+{
+    gchar *key, *data;
+
+    if (!inventory || !id || !tag)
+        return NULL;
+
+    key = moreinfo_key(tag);
+    data = g_key_file_get_string(inventory, id, key, NULL);
+    g_free(key);
+
+    return data;
+}
+
+/* live values are refreshed by fieldfunc and can't be replayed */
+static gboolean has_live_fields(const gchar *data)
+{
+    return strstr(data, "=...\n") != NULL;
+}
+
+void inventory_put(const gchar *id, const gchar *token, const gchar *data)
+{
+    if (!inventory || !id || !token || !data)
+        return;
+
+    if (g_key_file_has_group(inventory, id))
+        g_key_file_remove_group(inventory, id, NULL);
+    inventory_dirty = TRUE;
+
+    if (has_live_fields(data))
+        return;
+
+    g_key_file_set_string(inventory, id, "Token", token);
+    g_key_file_set_string(inventory, id, "Data", data);
+}
+
+void inventory_put_moreinfo(const gchar *id, const gchar *tag, const gchar *data)
+{
+    gchar *key;
+
+    if (!inventory || !id || !tag || !data)
+        return;
+    if (!g_key_file_has_key(inventory, id, "Token", NULL))
+        return;
+
+    if (has_live_fields(data)) {
+        g_key_file_remove_group(inventory, id, NULL);
+        return;
+    }
+
+    key = moreinfo_key(tag);
+    g_key_file_set_string(inventory, id, key, data);
+    g_free(key);
+}
+
+const gchar *inventory_boot_id(void)
+{
+    static gchar *boot_id = NULL;
+
+    if (!boot_id) {
+        if (g_file_get_contents("/proc/sys/kernel/random/boot_id", &boot_id, NULL, NULL))
+            g_strstrip(boot_id);
+        else
+            boot_id = g_strdup("-");
+    }
+
+    return boot_id;
+}
+
+gchar *inventory_stat_token(const gchar *path)
+{
+    struct stat st;
+
+    if (!path || stat(path, &st) != 0)
+        return g_strdup("-");
+
+    return g_strdup_printf("%lld.%lld.%llu", (long long)st.st_mtime,
+                           (long long)st.st_size, (unsigned long long)st.st_ino);
+}
+
+gchar *inventory_file_token(const gchar *path)
+{
+    gchar *contents, *sum;
+    gsize length;
+
+    if (!g_file_get_contents(path, &contents, &length, NULL))
+        return g_strdup("-");
+
+    sum = g_compute_checksum_for_data(G_CHECKSUM_MD5, (const guchar *)contents, length);
+    g_free(contents);
+
+    return sum;
+}
+
+gchar *inventory_fields_token(const gchar *path, gint fields)
+{
+    GChecksum *sum;
+    gchar *contents, **lines, *ret;
+    gint i, j;
+
+    if (!g_file_get_contents(path, &contents, NULL, NULL))
+        return g_strdup("-");
+
+    sum = g_checksum_new(G_CHECKSUM_MD5);
+    lines = g_strsplit(contents, "\n", -1);
+    for (i = 0; lines[i]; i++) {
+        gchar **words = g_strsplit_set(lines[i], " \t", fields + 1);
+
+        for (j = 0; j < fields && words[j]; j++) {
+            g_checksum_update(sum, (const guchar *)words[j], -1);
+            g_checksum_update(sum, (const guchar *)" ", 1);
+        }
+        g_checksum_update(sum, (const guchar *)"\n", 1);
+        g_strfreev(words);
+    }
+    g_strfreev(lines);
+    g_free(contents);
+
+    ret = g_strdup(g_checksum_get_string(sum));
+    g_checksum_free(sum);
+
+    return ret;
+}
+
+gchar *inventory_dir_token(const gchar *dir, const gchar *file)
+{
+    GChecksum *sum;
+    GDir *gdir;
+    GSList *names = NULL, *l;
+    const gchar *name;
+    gchar *ret;
+
+    gdir = g_dir_open(dir, 0, NULL);
+    if (!gdir)
+        return g_strdup("-");
+
+    while ((name = g_dir_read_name(gdir)))
+        names = g_slist_prepend(names, g_strdup(name));
+    g_dir_close(gdir);
+    names = g_slist_sort(names, (GCompareFunc)g_strcmp0);
+
+    sum = g_checksum_new(G_CHECKSUM_MD5);
+    for (l = names; l; l = l->next) {
+        g_checksum_update(sum, (const guchar *)l->data, -1);
+        if (file) {
+            gchar *path = g_build_filename(dir, l->data, file, NULL);
+            gchar *contents;
+            gsize length;
+
+            if (g_file_get_contents(path, &contents, &length, NULL)) {
+                g_checksum_update(sum, (const guchar *)contents, length);
+                g_free(contents);
+            }
+            g_free(path);
+        }
+        g_checksum_update(sum, (const guchar *)"\n", 1);
+    }
+    g_slist_free_full(names, g_free);
+
+    ret = g_strdup(g_checksum_get_string(sum));
+    g_checksum_free(sum);
+
+    return ret;
+}
+
+gchar *inventory_ids_token(const gchar *ids_file)
+{
+    gchar *user = g_build_filename(g_get_user_config_dir(), "hardinfo2", ids_file, NULL);
+    gchar *sys = g_build_filename(params.path_data, ids_file, NULL);
+    gchar *user_token = inventory_stat_token(user);
+    gchar *sys_token = inventory_stat_token(sys);
+    gchar *ret = g_strdup_printf("%s:%s", user_token, sys_token);
+
+    g_free(user);
+    g_free(sys);
+    g_free(user_token);
+    g_free(sys_token);
+
+    return ret;
+}
@@ -18,20 +18,18 @@
  *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
  */
 
+#include <sys/utsname.h>
 #include "hardinfo.h"
 #include "pci_util.h"
 #include "util_ids.h"
 
 gchar *pci_ids_file = NULL;
 GTimer *pci_ids_timer = NULL;
-gboolean nolspci = TRUE; /*Only very old distros=>disable lspci*/
 
-/* Two pieces of info still only from lspci:
- * - kernel driver in use
- * - kernel modules list
- *
- * TODO: could use readlink() and basename() to get kernel driver from sysfs
- * - /sys/bus/pci/devices/<addy>/driver is a symlink
+/* Everything comes from sysfs, nothing is spawned:
+ * - ids, class and revision from the config space header
+ * - kernel driver in use from the driver symlink
+ * - kernel modules by matching modalias against modules.alias, like lspci
  */
 
 const gchar *find_pci_ids_file() {
@@ -187,68 +185,88 @@ void pcid_free(pcid *s) {
         g_free(s->sub_device_id_str);
         g_free(s->driver);
         g_free(s->driver_list);
+        g_free(s->power_state);
+        g_free(s->runtime_status);
         g_free(s);
     }
 }
 
-static char *lspci_line_value(char *line, const char *prefix) {
-    if (g_str_has_prefix(g_strstrip(line), prefix)) {
-        line += strlen(prefix) + 1;
-        return g_strstrip(line);
-    } else
+
+/* "pci:" patterns of modules.alias as pattern, module pairs, loaded once */
+static GPtrArray *pci_aliases = NULL;
+/* modalias => module list, NULL value if nothing matched */
+static GHashTable *pci_alias_modules = NULL;
+
+/* modules.alias of the kernel the devices come from: --modules, or the
+ * running kernel's, but not for a --sysfs copy from another machine */
+static gchar *pci_aliases_path(void) {
+    struct utsname un;
+
+    if (params.path_modules)
+        return g_build_filename(params.path_modules, "modules.alias", NULL);
+    if (params.path_sysfs || uname(&un) != 0)
         return NULL;
+    return g_build_filename("/lib/modules", un.release, "modules.alias", NULL);
 }
 
-/* read output line of lspci -vmmnn */
-/*static int lspci_line_string_and_code(char *line, char *prefix, char **str, uint32_t *code) {
-    char *l = lspci_line_value(line, prefix);
-    char *e;
-
-    if (l) {
-        e = strchr(l, 0);
-        while (e > l && *e != '[') e--;
-        sscanf(e, "[%x]", code);
-        *e = 0; // terminate at start of code
-        if (*str) free(*str); // free if replacing
-        *str = strdup(g_strstrip(l));
-    }
-    return 0;
-}*/
-
-static gboolean pci_fill_details(pcid *s) {
-    if (nolspci) return FALSE;
-    gboolean spawned;
-    gchar *out, *err, *p, *l, *next_nl;
-    gchar *pci_loc = pci_address_str(s->domain, s->bus, s->device, s->function);
-    gchar *lspci_cmd = g_strdup_printf("lspci -D -s %s -vvv", pci_loc);
-
-    spawned = hardinfo_spawn_command_line_sync(lspci_cmd,
-            &out, &err, NULL, NULL);
-    g_free(lspci_cmd);
-    g_free(pci_loc);
-    if (spawned) {
-        p = out;
-        while(next_nl = strchr(p, '\n')) {
-            strend(p, '\n');
-            g_strstrip(p);
-            if (l = lspci_line_value(p, "Kernel driver in use")) {
-                s->driver = g_strdup(l);
-                goto pci_details_next;
-            }
-            if (l = lspci_line_value(p, "Kernel modules")) {
-                s->driver_list = g_strdup(l);
-                goto pci_details_next;
+static void pci_load_aliases(void) {
+    gchar *path, *contents, **lines, **l;
+
+    if (pci_aliases) return;
+    pci_aliases = g_ptr_array_new_with_free_func(g_free);
+    pci_alias_modules = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    path = pci_aliases_path();
+    if (path && g_file_get_contents(path, &contents, NULL, NULL)) {
+        lines = g_strsplit(contents, "\n", -1);
+        for (l = lines; *l; l++) {
+            gchar **f;
+            if (!g_str_has_prefix(*l, "alias pci:")) continue;
+            f = g_strsplit(*l, " ", 3);
+            if (f[1] && f[2]) {
+                g_ptr_array_add(pci_aliases, f[1]);
+                g_ptr_array_add(pci_aliases, f[2]);
+                f[1] = f[2] = NULL; /* now owned by pci_aliases */
             }
-            /* TODO: more details */
-
-            pci_details_next:
-                p = next_nl + 1;
+            g_strfreev(f);
         }
-        g_free(out);
-        g_free(err);
-        return TRUE;
+        g_strfreev(lines);
+        g_free(contents);
     }
-    return FALSE;
+    g_free(path);
+}
+
+/* list is "a, b, c" */
+static gboolean pci_module_listed(const gchar *list, const gchar *module) {
+    gchar **mods = g_strsplit(list, ", ", -1);
+    gboolean ret = FALSE;
+    int i;
+
+    for (i = 0; mods[i] && !ret; i++)
+        ret = SEQ(mods[i], module);
+    g_strfreev(mods);
+    return ret;
+}
+
+static gchar *pci_modules_for_alias(const gchar *modalias) {
+    gpointer cached;
+    gchar *ret = NULL;
+    guint i;
+
+    pci_load_aliases();
+    if (g_hash_table_lookup_extended(pci_alias_modules, modalias, NULL, &cached))
+        return g_strdup(cached);
+
+    for (i = 0; i + 1 < pci_aliases->len; i += 2) {
+        const gchar *module = g_ptr_array_index(pci_aliases, i + 1);
+        if (!g_pattern_match_simple(g_ptr_array_index(pci_aliases, i), modalias))
+            continue;
+        if (ret && pci_module_listed(ret, module)) continue;
+        ret = ret ? appf(ret, ", ", "%s", module) : g_strdup(module);
+    }
+    g_hash_table_insert(pci_alias_modules, g_strdup(modalias), g_strdup(ret));
+
+    return ret;
 }
 
 char *pci_address_str(uint32_t dom, uint32_t bus, uint32_t  dev, uint32_t func) {
@@ -256,13 +274,23 @@ char *pci_address_str(uint32_t dom, uint32_t bus, uint32_t  dev, uint32_t func)
 }
 
 /* /sys/bus/pci/devices/0000:01:00.0/ */
-char *_sysfs_bus_pci(uint32_t dom, uint32_t bus, uint32_t dev, uint32_t func, const char *item) {
-    char *ret = NULL, *pci_loc, *sysfs_path;
+static char *_sysfs_bus_pci_path(uint32_t dom, uint32_t bus, uint32_t dev, uint32_t func) {
+    char *ret, *pci_loc, *root;
     pci_loc = pci_address_str(dom, bus, dev, func);
-    sysfs_path = g_strdup_printf("%s/%s/%s", SYSFS_PCI_ROOT, pci_loc, item);
+    root = h_sysfs_path("bus/pci/devices");
+    ret = g_build_filename(root, pci_loc, NULL);
+    g_free(pci_loc);
+    g_free(root);
+    return ret;
+}
+
+char *_sysfs_bus_pci(uint32_t dom, uint32_t bus, uint32_t dev, uint32_t func, const char *item) {
+    char *ret = NULL, *path, *sysfs_path;
+    path = _sysfs_bus_pci_path(dom, bus, dev, func);
+    sysfs_path = g_build_filename(path, item, NULL);
     g_file_get_contents(sysfs_path, &ret, NULL, NULL);
-    free(pci_loc);
-    free(sysfs_path);
+    g_free(path);
+    g_free(sysfs_path);
     return ret;
 }
 
@@ -280,9 +308,43 @@ gboolean _sysfs_bus_pci_read_hex(uint32_t dom, uint32_t bus, uint32_t dev, uint3
     return FALSE;
 }
 
+#define PCI_CONFIG_U16(c, o) ((uint32_t)(c)[o] | (uint32_t)(c)[(o) + 1] << 8)
+
+/* the first 64 bytes of config space are readable by anyone, but reading
+ * them resumes a runtime-suspended device; callers check that first */
+static gboolean pci_get_device_config(uint32_t dom, uint32_t bus, uint32_t dev, uint32_t func, pcid *s) {
+    guchar *c = NULL;
+    gsize len = 0;
+    gchar *path = _sysfs_bus_pci_path(dom, bus, dev, func);
+    gchar *config = g_build_filename(path, "config", NULL);
+    gboolean ret = FALSE;
+
+    if (g_file_get_contents(config, (gchar **)&c, &len, NULL) && len >= 64
+        && PCI_CONFIG_U16(c, 0x00) != 0xffff) {
+        s->vendor_id = PCI_CONFIG_U16(c, 0x00);
+        s->device_id = PCI_CONFIG_U16(c, 0x02);
+        s->revision = c[0x08];
+        s->class = c[0x0b] << 8 | c[0x0a]; /* without prog-if, like sysfs class >> 8 */
+        if ((c[0x0e] & 0x7f) == 0) {
+            s->sub_vendor_id = PCI_CONFIG_U16(c, 0x2c);
+            s->sub_device_id = PCI_CONFIG_U16(c, 0x2e);
+        } else {
+            /* bridges keep the subsystem ids in a capability */
+            _sysfs_bus_pci_read_hex(dom, bus, dev, func, "subsystem_device", &s->sub_device_id);
+            _sysfs_bus_pci_read_hex(dom, bus, dev, func, "subsystem_vendor", &s->sub_vendor_id);
+        }
+        ret = TRUE;
+    }
+
+    g_free(c);
+    g_free(config);
+    g_free(path);
+    return ret;
+}
+
 /* https://www.kernel.org/doc/Documentation/ABI/testing/sysfs-bus-pci */
 static gboolean pci_get_device_sysfs(uint32_t dom, uint32_t bus, uint32_t dev, uint32_t func, pcid *s) {
-    char *tmp = NULL;
+    char *tmp = NULL, *path, *link;
     int ec = 0;
     float tf;
     s->domain = dom;
@@ -290,14 +352,25 @@ static gboolean pci_get_device_sysfs(uint32_t dom, uint32_t bus, uint32_t dev, u
     s->device = dev;
     s->function = func;
     s->slot_str = s->slot_str ? s->slot_str : pci_address_str(dom, bus, dev, func);
-    if (! _sysfs_bus_pci_read_hex(dom, bus, dev, func, "class", &s->class) )
-        return FALSE;
-    s->class >>= 8; /* TODO: find out why */
-    _sysfs_bus_pci_read_hex(dom, bus, dev, func, "device", &s->device_id);
-    _sysfs_bus_pci_read_hex(dom, bus, dev, func, "vendor", &s->vendor_id);
-    _sysfs_bus_pci_read_hex(dom, bus, dev, func, "subsystem_device", &s->sub_device_id);
-    _sysfs_bus_pci_read_hex(dom, bus, dev, func, "subsystem_vendor", &s->sub_vendor_id);
-    _sysfs_bus_pci_read_hex(dom, bus, dev, func, "revision", &s->revision);
+
+    path = _sysfs_bus_pci_path(dom, bus, dev, func);
+    s->runtime_status = h_sysfs_read_string(path, "power/runtime_status");
+
+    /* the per-attribute files are cached by the kernel and leave a
+     * suspended device (eg. the dGPU of a laptop) asleep */
+    if ((s->runtime_status && g_str_has_prefix(s->runtime_status, "suspend"))
+        || !pci_get_device_config(dom, bus, dev, func, s)) {
+        if (! _sysfs_bus_pci_read_hex(dom, bus, dev, func, "class", &s->class) ) {
+            g_free(path);
+            return FALSE;
+        }
+        s->class >>= 8; /* drop prog-if */
+        _sysfs_bus_pci_read_hex(dom, bus, dev, func, "device", &s->device_id);
+        _sysfs_bus_pci_read_hex(dom, bus, dev, func, "vendor", &s->vendor_id);
+        _sysfs_bus_pci_read_hex(dom, bus, dev, func, "subsystem_device", &s->sub_device_id);
+        _sysfs_bus_pci_read_hex(dom, bus, dev, func, "subsystem_vendor", &s->sub_vendor_id);
+        _sysfs_bus_pci_read_hex(dom, bus, dev, func, "revision", &s->revision);
+    }
 
     tmp = _sysfs_bus_pci(dom, bus, dev, func, "max_link_speed");
     if (tmp) {
@@ -321,54 +394,24 @@ static gboolean pci_get_device_sysfs(uint32_t dom, uint32_t bus, uint32_t dev, u
         s->pcie_width_curr = strtoul(tmp, NULL, 0);
         free(tmp);
     }
-    return TRUE;
-}
-
-/*static gboolean pci_get_device_lspci(uint32_t dom, uint32_t bus, uint32_t dev, uint32_t func, pcid *s) {
-    if (nolspci) return FALSE;
-    gboolean spawned;
-    gchar *out, *err, *p, *l, *next_nl;
-    gchar *pci_loc = pci_address_str(dom, bus, dev, func);
-    gchar *lspci_cmd = g_strdup_printf("lspci -D -s %s -vmmnn", pci_loc);
-
-    s->domain = dom;
-    s->bus = bus;
-    s->device = dev;
-    s->function = func;
 
-    spawned = hardinfo_spawn_command_line_sync(lspci_cmd,
-            &out, &err, NULL, NULL);
-    g_free(lspci_cmd);
-    if (spawned) {
-        p = out;
-        while(next_nl = strchr(p, '\n')) {
-            strend(p, '\n');
-            g_strstrip(p);
-            if (l = lspci_line_value(p, "Slot")) {
-                s->slot_str = g_strdup(l);
-                if (strcmp(s->slot_str, pci_loc) != 0) {
-                   printf("PCI: %s != %s\n", s->slot_str, pci_loc);
-                }
-            }
-            if (l = lspci_line_value(p, "Rev")) {
-                s->revision = strtol(l, NULL, 16);
-            }
-            lspci_line_string_and_code(p, "Class", &s->class_str, &s->class);
-            lspci_line_string_and_code(p, "Vendor", &s->vendor_id_str, &s->vendor_id);
-            lspci_line_string_and_code(p, "Device", &s->device_id_str, &s->device_id);
-            lspci_line_string_and_code(p, "SVendor", &s->sub_vendor_id_str, &s->sub_vendor_id);
-            lspci_line_string_and_code(p, "SDevice", &s->sub_device_id_str, &s->sub_device_id);
-
-            p = next_nl + 1;
-        }
-        g_free(out);
-        g_free(err);
-        g_free(pci_loc);
-        return TRUE;
+    link = g_build_filename(path, "driver", NULL);
+    tmp = g_file_read_link(link, NULL);
+    if (tmp) {
+        s->driver = g_path_get_basename(tmp);
+        g_free(tmp);
     }
-    g_free(pci_loc);
-    return FALSE;
-    }*/
+    g_free(link);
+    tmp = h_sysfs_read_string(path, "modalias");
+    if (tmp) {
+        s->driver_list = pci_modules_for_alias(tmp);
+        g_free(tmp);
+    }
+    s->power_state = h_sysfs_read_string(path, "power_state");
+    g_free(path);
+
+    return TRUE;
+}
 
 pcid *pci_get_device_str(const char *addy) {
     uint32_t dom, bus, dev, func;
@@ -389,7 +432,6 @@ pcid *pci_get_device(uint32_t dom, uint32_t bus, uint32_t dev, uint32_t func) {
         ok = pci_get_device_sysfs(dom, bus, dev, func, s);
         if (ok) {
             ok |= pci_lookup_ids(s);
-            //if (!ok) ok |= pci_get_device_lspci(dom, bus, dev, func, s);
         }
         if (!ok) {
             pcid_free(s);
@@ -399,39 +441,6 @@ pcid *pci_get_device(uint32_t dom, uint32_t bus, uint32_t dev, uint32_t func) {
     return s;
 }
 
-/*static pcid_list pci_get_device_list_lspci(uint32_t class_min, uint32_t class_max) {
-    if (nolspci) return NULL;
-    gboolean spawned;
-    gchar *out, *err, *p, *next_nl;
-    pcid_list dl = NULL;
-    pcid *nd;
-    uint32_t dom, bus, dev, func, cls;
-    int ec;
-
-    if (class_max == 0) class_max = 0xffff;
-
-    spawned = hardinfo_spawn_command_line_sync("lspci -D -mn",
-            &out, &err, NULL, NULL);
-    if (spawned) {
-        p = out;
-        while(next_nl = strchr(p, '\n')) {
-            strend(p, '\n');
-            ec = sscanf(p, "%x:%x:%x.%x \"%x\"", &dom, &bus, &dev, &func, &cls);
-            if (ec == 5) {
-                if (cls >= class_min && cls <= class_max) {
-                    nd = pci_get_device(dom, bus, dev, func);
-                    pci_fill_details(nd);
-                    dl = g_slist_append(dl, nd);
-                }
-            }
-            p = next_nl + 1;
-        }
-        g_free(out);
-        g_free(err);
-    }
-    return dl;
-    }*/
-
 static pcid_list pci_get_device_list_sysfs(uint32_t class_min, uint32_t class_max) {
     pcid_list dl = NULL;
     pcid *nd;
@@ -441,20 +450,24 @@ static pcid_list pci_get_device_list_sysfs(uint32_t class_min, uint32_t class_ma
     if (class_max == 0) class_max = 0xffff;
 
     const gchar *f = NULL;
-    GDir *d = g_dir_open("/sys/bus/pci/devices", 0, NULL);
-    if (!d) return 0;
+    gchar *root = h_sysfs_path("bus/pci/devices");
+    GDir *d = g_dir_open(root, 0, NULL);
+    if (!d) {
+        g_free(root);
+        return 0;
+    }
 
     while((f = g_dir_read_name(d))) {
         ec = sscanf(f, "%x:%x:%x.%x", &dom, &bus, &dev, &func);
         if (ec == 4) {
-            gchar *cf = g_strdup_printf("/sys/bus/pci/devices/%s/class", f);
+            gchar *cf = g_build_filename(root, f, "class", NULL);
             gchar *cstr = NULL;
             if (g_file_get_contents(cf, &cstr, NULL, NULL) ) {
                 cls = strtoul(cstr, NULL, 16) >> 8;
                 if (cls >= class_min && cls <= class_max) {
                     nd = pci_get_device(dom, bus, dev, func);
-                    pci_fill_details(nd);
-                    dl = g_slist_append(dl, nd);
+                    if (nd)
+                        dl = g_slist_append(dl, nd);
                 }
             }
             g_free(cstr);
@@ -462,13 +475,13 @@ static pcid_list pci_get_device_list_sysfs(uint32_t class_min, uint32_t class_ma
         }
     }
     g_dir_close(d);
+    g_free(root);
     return dl;
 }
 
 pcid_list pci_get_device_list(uint32_t class_min, uint32_t class_max) {
     pcid_list dl = NULL;
     dl = pci_get_device_list_sysfs(class_min, class_max);
-    //if (!dl) dl = pci_get_device_list_lspci(class_min, class_max);
     return dl;
 }
 
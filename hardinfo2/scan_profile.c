@@ -0,0 +1,287 @@
+/*
+ *    Hardinfo2 - System Information and benchmark
+ *    Copyright (C) 2003-2007 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "scan_profile.h"
+
+struct _ScanProfileEvent {
+    ScanProfileKind kind;
+    gchar   *name;
+    gint     tid;
+    gint64   start_us;   /* since scan_profile_init() */
+    gint64   wall_us;
+    gint64   cpu_us;     /* this thread plus waited-for children */
+    guint    children;
+    guint64  bytes_read; /* /proc/self/io rchar, so the whole process */
+
+    /* counters at begin, turned into the deltas above by end */
+    gint64   cpu_start;
+    guint    children_start;
+    guint64  rchar_start;
+};
+
+static gboolean enabled = FALSE;
+static gchar *trace_path = NULL;
+static gint64 t0 = 0;
+static guint spawn_count = 0;
+static GPtrArray *events = NULL;
+G_LOCK_DEFINE_STATIC(scan_profile);
+
+static const gchar *kind_names[SCAN_PROFILE_N_KINDS] = { "scan", "page", "spawn" };
+
+static gint64 clock_us(clockid_t id)
+{
+    struct timespec ts;
+
+    if (clock_gettime(id, &ts) != 0)
+        return 0;
+    return (gint64)ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+static gint64 children_cpu_us(void)
+{
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_CHILDREN, &ru) != 0)
+        return 0;
+    return (gint64)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * G_USEC_PER_SEC
+           + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+/* bytes read so far; the kernel's figure doesn't have this read of
+ * /proc/self/io yet, with_self adds it so it isn't charged to a span */
+static guint64 read_rchar(gboolean with_self)
+{
+    char buf[512], *p;
+    guint64 rchar = 0;
+    ssize_t n;
+    FILE *io = fopen("/proc/self/io", "r");
+
+    if (!io)
+        return 0;
+    n = fread(buf, 1, sizeof(buf) - 1, io);
+    fclose(io);
+    if (n <= 0)
+        return 0;
+    buf[n] = 0;
+    if ((p = strstr(buf, "rchar:")))
+        rchar = g_ascii_strtoull(p + 6, NULL, 10);
+    return with_self ? rchar + n : rchar;
+}
+
+gboolean scan_profile_enabled(void)
+{
+    return enabled;
+}
+
+ScanProfileEvent *scan_profile_begin(ScanProfileKind kind, const gchar *name)
+{
+    ScanProfileEvent *ev;
+
+    if (!enabled)
+        return NULL;
+
+    ev = g_new0(ScanProfileEvent, 1);
+    ev->kind = kind;
+    ev->name = g_strdup(name ? name : "(unnamed)");
+    ev->tid = (gint)syscall(SYS_gettid);
+
+    G_LOCK(scan_profile);
+    if (kind == SCAN_PROFILE_SPAWN)
+        spawn_count++;
+    ev->children_start = spawn_count - (kind == SCAN_PROFILE_SPAWN);
+    G_UNLOCK(scan_profile);
+
+    ev->rchar_start = read_rchar(TRUE);
+    ev->cpu_start = clock_us(CLOCK_THREAD_CPUTIME_ID) + children_cpu_us();
+    ev->start_us = clock_us(CLOCK_MONOTONIC) - t0;
+
+    return ev;
+}
+
+void scan_profile_end(ScanProfileEvent *ev)
+{
+    if (!ev)
+        return;
+
+    ev->wall_us = clock_us(CLOCK_MONOTONIC) - t0 - ev->start_us;
+    ev->cpu_us = clock_us(CLOCK_THREAD_CPUTIME_ID) + children_cpu_us() - ev->cpu_start;
+    ev->bytes_read = read_rchar(FALSE) - ev->rchar_start;
+
+    G_LOCK(scan_profile);
+    ev->children = spawn_count - ev->children_start;
+    if (events) {
+        g_ptr_array_add(events, ev);
+        ev = NULL;
+    }
+    G_UNLOCK(scan_profile);
+
+    /* only when it outlived scan_profile_finish() */
+    if (ev) {
+        g_free(ev->name);
+        g_free(ev);
+    }
+}
+
+typedef struct {
+    ScanProfileKind kind;
+    const gchar *name;
+    guint    calls;
+    gint64   wall_us, cpu_us;
+    guint    children;
+    guint64  bytes_read;
+} ScanProfileRow;
+
+static gint row_cmp(gconstpointer a, gconstpointer b)
+{
+    const ScanProfileRow *ra = *(ScanProfileRow * const *)a;
+    const ScanProfileRow *rb = *(ScanProfileRow * const *)b;
+
+    if (ra->wall_us != rb->wall_us)
+        return ra->wall_us < rb->wall_us ? 1 : -1;
+    return g_strcmp0(ra->name, rb->name);
+}
+
+/* one row per kind and name, slowest first */
+static void print_table(FILE *out)
+{
+    GHashTable *rows = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    GPtrArray *sorted = g_ptr_array_new();
+    guint i;
+
+    for (i = 0; i < events->len; i++) {
+        ScanProfileEvent *ev = g_ptr_array_index(events, i);
+        gchar *key = g_strdup_printf("%d:%s", ev->kind, ev->name);
+        ScanProfileRow *row = g_hash_table_lookup(rows, key);
+
+        if (!row) {
+            row = g_new0(ScanProfileRow, 1);
+            row->kind = ev->kind;
+            row->name = ev->name;
+            g_hash_table_insert(rows, key, row);
+            g_ptr_array_add(sorted, row);
+        } else {
+            g_free(key);
+        }
+        row->calls++;
+        row->wall_us += ev->wall_us;
+        row->cpu_us += ev->cpu_us;
+        row->children += ev->children;
+        row->bytes_read += ev->bytes_read;
+    }
+    g_ptr_array_sort(sorted, row_cmp);
+
+    fprintf(out, "\n%10s %10s %6s %8s %12s  %-5s  %s\n",
+            "Wall ms", "CPU ms", "Calls", "Children", "Bytes read", "Kind", "Name");
+    for (i = 0; i < sorted->len; i++) {
+        ScanProfileRow *row = g_ptr_array_index(sorted, i);
+
+        fprintf(out, "%10.2f %10.2f %6u %8u %12" G_GUINT64_FORMAT "  %-5s  %s\n",
+                row->wall_us / 1000.0, row->cpu_us / 1000.0, row->calls,
+                row->children, row->bytes_read, kind_names[row->kind], row->name);
+    }
+
+    g_ptr_array_free(sorted, TRUE);
+    g_hash_table_destroy(rows);
+}
+
+static void json_string(FILE *out, const gchar *s)
+{
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            fprintf(out, "\\%c", *s);
+        else if ((guchar)*s < 0x20)
+            fprintf(out, "\\u%04x", (guchar)*s);
+        else
+            fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+/* Chrome trace-event format, complete ("X") events */
+static void write_trace(const gchar *path)
+{
+    FILE *out = fopen(path, "w");
+    gint pid = (gint)getpid();
+    guint i;
+
+    if (!out) {
+        fprintf(stderr, "scan profile: can't write %s\n", path);
+        return;
+    }
+
+    fputs("{\"traceEvents\":[\n", out);
+    for (i = 0; i < events->len; i++) {
+        ScanProfileEvent *ev = g_ptr_array_index(events, i);
+
+        fputs("{\"name\":", out);
+        json_string(out, ev->name);
+        fprintf(out, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%" G_GINT64_FORMAT
+                ",\"dur\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%d,"
+                "\"args\":{\"cpu_us\":%" G_GINT64_FORMAT ",\"children\":%u,"
+                "\"bytes_read\":%" G_GUINT64_FORMAT "}}%s\n",
+                kind_names[ev->kind], ev->start_us, ev->wall_us, pid, ev->tid,
+                ev->cpu_us, ev->children, ev->bytes_read,
+                i + 1 < events->len ? "," : "");
+    }
+    fputs("],\"displayTimeUnit\":\"ms\"}\n", out);
+    fclose(out);
+}
+
+static void scan_profile_finish(void)
+{
+    guint i;
+
+    if (!enabled)
+        return;
+    enabled = FALSE;
+
+    G_LOCK(scan_profile);
+    print_table(stderr);
+    if (trace_path)
+        write_trace(trace_path);
+    for (i = 0; i < events->len; i++) {
+        ScanProfileEvent *ev = g_ptr_array_index(events, i);
+        g_free(ev->name);
+        g_free(ev);
+    }
+    g_ptr_array_free(events, TRUE);
+    events = NULL;
+    G_UNLOCK(scan_profile);
+}
+
+/* results are emitted from atexit(), which also covers the paths
+ * that leave through exit() */
+void scan_profile_init(const gchar *trace_file)
+{
+    if (enabled)
+        return;
+
+    events = g_ptr_array_new();
+    trace_path = g_strdup(trace_file);
+    t0 = clock_us(CLOCK_MONOTONIC);
+    enabled = TRUE;
+    atexit(scan_profile_finish);
+}
@@ -24,6 +24,7 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 #include <glib.h>
@@ -125,3 +126,31 @@ void sock_close(Socket * s)
     close(s->sock);
     g_free(s);
 }
+
+Socket *sock_connect_unix(const gchar * path)
+{
+    struct sockaddr_un server;
+    Socket *s;
+    int sock;
+
+    if (strlen(path) >= sizeof(server.sun_path))
+	return NULL;
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0)
+	return NULL;
+
+    memset(&server, 0, sizeof(server));
+    server.sun_family = AF_UNIX;
+    strcpy(server.sun_path, path);
+
+    if (connect(sock, (struct sockaddr *) (void *) &server, sizeof(server)) < 0) {
+	close(sock);
+	return NULL;
+    }
+
+    s = g_new0(Socket, 1);
+    s->sock = sock;
+
+    return s;
+}
@@ -0,0 +1,279 @@
+/*
+ *    HardInfo - Displays System Information
+ *    Copyright (C) 2003-2007 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <string.h>
+#include <sys/stat.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+#include "config.h"
+#include "sync_util.h"
+
+#if(HARDINFO2_SYNC_ZSTD)
+#include <zstd.h>
+#endif
+
+static gchar *sync_inflate(const guint8 *buf, gsize len, GZlibCompressorFormat format,
+                           gsize *out_len, GError **error)
+{
+    GConverter *conv = G_CONVERTER(g_zlib_decompressor_new(format));
+    GString *out = g_string_sized_new(len * 4);
+    GConverterResult r;
+    gchar chunk[16384];
+    gsize nread, nwritten;
+
+    do {
+        r = g_converter_convert(conv, buf, len, chunk, sizeof(chunk),
+                                G_CONVERTER_INPUT_AT_END, &nread, &nwritten, error);
+        if (r == G_CONVERTER_ERROR) {
+            g_string_free(out, TRUE);
+            g_object_unref(conv);
+            return NULL;
+        }
+        buf += nread;
+        len -= nread;
+        g_string_append_len(out, chunk, nwritten);
+    } while (r != G_CONVERTER_FINISHED);
+    g_object_unref(conv);
+
+    *out_len = out->len;
+    return g_string_free(out, FALSE);
+}
+
+#if(HARDINFO2_SYNC_ZSTD)
+static gchar *sync_unzstd(const guint8 *buf, gsize len, gsize *out_len, GError **error)
+{
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    ZSTD_inBuffer in = { buf, len, 0 };
+    GString *out = g_string_sized_new(len * 4);
+    gchar chunk[16384];
+    size_t r = 1;
+
+    while (dctx && r) {
+        ZSTD_outBuffer o = { chunk, sizeof(chunk), 0 };
+        r = ZSTD_decompressStream(dctx, &o, &in);
+        if (ZSTD_isError(r) || (r && !o.pos && in.pos == in.size)) {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "zstd: %s",
+                        ZSTD_isError(r) ? ZSTD_getErrorName(r) : "truncated");
+            break;
+        }
+        g_string_append_len(out, chunk, o.pos);
+    }
+    ZSTD_freeDCtx(dctx);
+    if (r) {
+        g_string_free(out, TRUE);
+        return NULL;
+    }
+    *out_len = out->len;
+    return g_string_free(out, FALSE);
+}
+#endif
+
+gchar *sync_decode_body(const gchar *encoding, const guint8 *buf, gsize len,
+                        gsize *out_len, GError **error)
+{
+    gchar *ret;
+
+    if (!encoding || !*encoding || g_ascii_strcasecmp(encoding, "identity") == 0) {
+        ret = g_malloc(len + 1);
+        memcpy(ret, buf, len);
+        ret[len] = 0;
+        *out_len = len;
+        return ret;
+    }
+    if (g_ascii_strcasecmp(encoding, "gzip") == 0 || g_ascii_strcasecmp(encoding, "x-gzip") == 0)
+        return sync_inflate(buf, len, G_ZLIB_COMPRESSOR_FORMAT_GZIP, out_len, error);
+    if (g_ascii_strcasecmp(encoding, "deflate") == 0)
+        return sync_inflate(buf, len, G_ZLIB_COMPRESSOR_FORMAT_ZLIB, out_len, error);
+#if(HARDINFO2_SYNC_ZSTD)
+    if (g_ascii_strcasecmp(encoding, "zstd") == 0)
+        return sync_unzstd(buf, len, out_len, error);
+#endif
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                "unsupported Content-Encoding: %s", encoding);
+    return NULL;
+}
+
+gchar *sync_apply_line_delta(const gchar *base, gsize base_len,
+                             const gchar *delta, gsize delta_len, gsize *out_len)
+{
+    const gchar *p, *nl, *end = base + base_len, *dend = delta + delta_len;
+    GPtrArray *lines = g_ptr_array_new();
+    GString *out = g_string_sized_new(base_len + delta_len);
+    gulong line, count, nlines, pos = 0;
+    gchar cmd, *e;
+
+    for (p = base; p < end; p = nl) {
+        g_ptr_array_add(lines, (gpointer)p);
+        nl = memchr(p, '\n', end - p);
+        nl = nl ? nl + 1 : end;
+    }
+    nlines = lines->len;
+    g_ptr_array_add(lines, (gpointer)end);
+
+#define BASE_COPY_TO(n) \
+    g_string_append_len(out, lines->pdata[pos], \
+        (const gchar *)lines->pdata[n] - (const gchar *)lines->pdata[pos]); \
+    pos = n;
+
+    p = delta;
+    while (p < dend) {
+        cmd = *p;
+        if ((cmd != 'a' && cmd != 'd') || !g_ascii_isdigit(p[1]))
+            goto fail;
+        line = strtoul(p + 1, &e, 10);
+        if (*e != ' ' || !g_ascii_isdigit(e[1]))
+            goto fail;
+        count = strtoul(e + 1, &e, 10);
+        if (*e != '\n' || !count)
+            goto fail;
+        p = e + 1;
+
+        if (cmd == 'd') {
+            if (line < 1 || line - 1 < pos || line - 1 > nlines
+                || count > nlines - (line - 1))
+                goto fail;
+            BASE_COPY_TO(line - 1);
+            pos += count;
+        } else {
+            if (line < pos || line > nlines)
+                goto fail;
+            BASE_COPY_TO(line);
+            while (count--) {
+                if (p >= dend)
+                    goto fail;
+                nl = memchr(p, '\n', dend - p);
+                nl = nl ? nl + 1 : dend;
+                g_string_append_len(out, p, nl - p);
+                p = nl;
+            }
+        }
+    }
+    BASE_COPY_TO(nlines);
+#undef BASE_COPY_TO
+
+    g_ptr_array_free(lines, TRUE);
+    *out_len = out->len;
+    return g_string_free(out, FALSE);
+
+fail:
+    g_ptr_array_free(lines, TRUE);
+    g_string_free(out, TRUE);
+    return NULL;
+}
+
+void sync_cache_request_headers(const SyncCacheFile *f, SyncHeaderFunc set, gpointer data)
+{
+    gchar *uri, *size, *etag, *lm;
+    struct stat st;
+
+    set("Accept-Encoding", SYNC_ACCEPT_ENCODING, data);
+    if (f->upload)
+        return;
+
+    uri = g_key_file_get_string(f->meta, f->name, "uri", NULL);
+    size = g_key_file_get_string(f->meta, f->name, "size", NULL);
+    if (uri && size && g_str_equal(uri, f->uri) && g_stat(f->path, &st) == 0
+        && (guint64)st.st_size == g_ascii_strtoull(size, NULL, 10)) {
+        etag = g_key_file_get_string(f->meta, f->name, "etag", NULL);
+        lm = g_key_file_get_string(f->meta, f->name, "last-modified", NULL);
+        if (etag) {
+            set("If-None-Match", etag, data);
+            if (g_str_has_suffix(f->name, ".ids"))
+                set("A-IM", SYNC_DELTA_IM, data);
+        }
+        if (lm)
+            set("If-Modified-Since", lm, data);
+        g_free(etag);
+        g_free(lm);
+    }
+    g_free(size);
+    g_free(uri);
+}
+
+static void sync_cache_update(const SyncCacheFile *f, const SyncResponse *r, gboolean replaced)
+{
+    gchar *data, *size;
+    gsize len;
+    struct stat st;
+
+    if (replaced)
+        g_key_file_remove_group(f->meta, f->name, NULL);
+    if (r->etag)
+        g_key_file_set_string(f->meta, f->name, "etag", r->etag);
+    if (r->last_modified)
+        g_key_file_set_string(f->meta, f->name, "last-modified", r->last_modified);
+    if (g_key_file_has_group(f->meta, f->name)) {
+        g_key_file_set_string(f->meta, f->name, "uri", f->uri);
+        if (g_stat(f->path, &st) == 0) {
+            size = g_strdup_printf("%" G_GUINT64_FORMAT, (guint64)st.st_size);
+            g_key_file_set_string(f->meta, f->name, "size", size);
+            g_free(size);
+        }
+    }
+
+    data = g_key_file_to_data(f->meta, &len, NULL);
+    g_file_set_contents(f->meta_path, data, len, NULL);
+    g_free(data);
+}
+
+SyncStoreResult sync_cache_store(const SyncCacheFile *f, const SyncResponse *r,
+                                 const guint8 *buf, gsize len, GError **error)
+{
+    SyncStoreResult ret = SYNC_STORE_FAILED;
+    gchar *data, *full, *base = NULL;
+    gsize data_len, full_len, base_len;
+
+    if (r->status == SYNC_STATUS_NOT_MODIFIED) {
+        sync_cache_update(f, r, FALSE);
+        return SYNC_STORE_NOT_MODIFIED;
+    }
+    if (r->status < 200 || r->status > 299)
+        return SYNC_STORE_BAD_STATUS;
+
+    data = sync_decode_body(r->content_encoding, buf ? buf : (const guint8 *)"",
+                            buf ? len : 0, &data_len, error);
+    if (!data)
+        return SYNC_STORE_FAILED;
+
+    if (r->status == SYNC_STATUS_IM_USED) {
+        if (!r->im || !strstr(r->im, SYNC_DELTA_IM)
+            || !g_file_get_contents(f->path, &base, &base_len, NULL)) {
+            ret = SYNC_STORE_UNEXPECTED_DELTA;
+            goto out;
+        }
+        full = sync_apply_line_delta(base, base_len, data, data_len, &full_len);
+        if (!full) {
+            ret = SYNC_STORE_INVALID_DELTA;
+            goto out;
+        }
+        g_free(data);
+        data = full;
+        data_len = full_len;
+    }
+
+    if (g_file_set_contents(f->path, data, data_len, error)) {
+        sync_cache_update(f, r, TRUE);
+        ret = SYNC_STORE_STORED;
+    }
+
+out:
+    g_free(base);
+    g_free(data);
+    return ret;
+}
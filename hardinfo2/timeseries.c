@@ -0,0 +1,133 @@
+/*
+ *    Hardinfo2 - System Information and benchmark
+ *    Copyright (C) 2003-2007 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <string.h>
+#include "timeseries.h"
+
+struct _TimeSeriesStore {
+    GHashTable *series;
+    guint       size;
+};
+
+TimeSeries *time_series_new(guint size)
+{
+    TimeSeries *ts;
+
+    if (!size) size = TIME_SERIES_DEFAULT_SIZE;
+
+    ts = g_new0(TimeSeries, 1);
+    ts->values = g_new0(gdouble, size);
+    ts->size = size;
+
+    return ts;
+}
+
+void time_series_free(TimeSeries *ts)
+{
+    if (!ts) return;
+    g_free(ts->values);
+    g_free(ts);
+}
+
+void time_series_clear(TimeSeries *ts)
+{
+    if (!ts) return;
+    ts->len = ts->head = 0;
+}
+
+void time_series_append(TimeSeries *ts, gdouble value)
+{
+    if (!ts) return;
+    ts->values[ts->head] = value;
+    ts->head = (ts->head + 1) % ts->size;
+    if (ts->len < ts->size) ts->len++;
+}
+
+gdouble time_series_get(const TimeSeries *ts, guint i)
+{
+    if (!ts || i >= ts->len) return 0.0;
+    return ts->values[(ts->head + ts->size - ts->len + i) % ts->size];
+}
+
+gdouble time_series_last(const TimeSeries *ts)
+{
+    if (!ts || !ts->len) return 0.0;
+    return ts->values[(ts->head + ts->size - 1) % ts->size];
+}
+
+guint time_series_copy(const TimeSeries *ts, gdouble *out, guint max)
+{
+    guint n, first, tail;
+
+    if (!ts || !out) return 0;
+
+    n = MIN(ts->len, max);
+    first = (ts->head + ts->size - n) % ts->size;
+
+    /* at most two contiguous runs in the ring */
+    tail = MIN(n, ts->size - first);
+    memcpy(out, ts->values + first, tail * sizeof(gdouble));
+    if (n > tail)
+        memcpy(out + tail, ts->values, (n - tail) * sizeof(gdouble));
+
+    return n;
+}
+
+TimeSeriesStore *time_series_store_new(guint size)
+{
+    TimeSeriesStore *store = g_new0(TimeSeriesStore, 1);
+
+    store->size = size;
+    store->series = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                          (GDestroyNotify)time_series_free);
+
+    return store;
+}
+
+void time_series_store_free(TimeSeriesStore *store)
+{
+    if (!store) return;
+    g_hash_table_destroy(store->series);
+    g_free(store);
+}
+
+void time_series_store_clear(TimeSeriesStore *store)
+{
+    if (!store) return;
+    g_hash_table_remove_all(store->series);
+}
+
+TimeSeries *time_series_store_lookup(TimeSeriesStore *store, const gchar *name)
+{
+    if (!store || !name) return NULL;
+    return g_hash_table_lookup(store->series, name);
+}
+
+void time_series_store_append(TimeSeriesStore *store, const gchar *name, gdouble value)
+{
+    TimeSeries *ts;
+
+    if (!store || !name) return;
+
+    ts = g_hash_table_lookup(store->series, name);
+    if (!ts) {
+        ts = time_series_new(store->size);
+        g_hash_table_insert(store->series, g_strdup(name), ts);
+    }
+    time_series_append(ts, value);
+}
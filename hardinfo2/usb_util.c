@@ -23,10 +23,9 @@
 #include "usb_util.h"
 #include "util_ids.h"
 
-#define SYSFS_DIR_USB_DEVICES "/sys/bus/usb/devices"
+#define SYSFS_DIR_USB_DEVICES "bus/usb/devices"
 
 gchar *usb_ids_file = NULL;
-gboolean nolsusb = TRUE; /*Only very old distros=>disable lsusb*/
 
 usbi *usbi_new() {
     return g_new0(usbi, 1);
@@ -70,6 +69,8 @@ void usbd_free(usbd *s) {
         g_free(s->dev_class_str);
         g_free(s->dev_subclass_str);
         g_free(s->dev_protocol_str);
+        g_free(s->driver);
+        g_free(s->power_state);
         g_free(s);
     }
 }
@@ -158,121 +159,6 @@ int usbd_list_count(usbd *s) {
     return usbd_list_append(s, NULL);
 }
 
-static char *lsusb_line_value(char *line, const char *prefix) {
-    if( nolsusb ) return NULL;
-    if (g_str_has_prefix(line, prefix)) {
-        line += strlen(prefix) + 1;
-        return g_strstrip(line);
-    } else
-        return NULL;
-}
-
-static gboolean usb_get_device_lsusb(int bus, int dev, usbd *s) {
-    if( nolsusb ) return FALSE;
-    gboolean spawned;
-    gchar *out, *err, *p, *l, *t, *next_nl;
-    gchar *lsusb_cmd = g_strdup_printf("lsusb -s %d:%d -v", bus, dev);
-    usbi *curr_if = NULL; // do not free
-
-    s->bus = bus;
-    s->dev = dev;
-
-    spawned = hardinfo_spawn_command_line_sync(lsusb_cmd,
-            &out, &err, NULL, NULL);
-    g_free(lsusb_cmd);
-    if (spawned) {
-        if (strstr(err, "information will be missing")) {
-            s->user_scan = TRUE;
-        }
-        p = out;
-        while(next_nl = strchr(p, '\n')) {
-            strend(p, '\n');
-            g_strstrip(p);
-
-            // device info
-            if (l = lsusb_line_value(p, "idVendor")) {
-                s->vendor_id = strtol(l, NULL, 0);
-                if (t = strchr(l, ' '))
-                    s->vendor = g_strdup(t + 1);
-            } else if (l = lsusb_line_value(p, "idProduct")) {
-                s->product_id = strtol(l, NULL, 0);
-                if (t = strchr(l, ' '))
-                    s->product = g_strdup(t + 1);
-            } else if (l = lsusb_line_value(p, "MaxPower")) {
-                s->max_curr_ma = atoi(l);
-            } else if (l = lsusb_line_value(p, "bcdUSB")) {
-                s->usb_version = g_strdup(l);
-            } else if (l = lsusb_line_value(p, "bcdDevice")) {
-                s->device_version = g_strdup(l);
-            } else if (l = lsusb_line_value(p, "bDeviceClass")) {
-                s->dev_class = atoi(l);
-                if (t = strchr(l, ' '))
-                    s->dev_class_str = g_strdup(t + 1);
-            } else if (l = lsusb_line_value(p, "bDeviceSubClass")) {
-                s->dev_subclass = atoi(l);
-                if (t = strchr(l, ' '))
-                    s->dev_subclass_str = g_strdup(t + 1);
-            } else if (l = lsusb_line_value(p, "bDeviceProtocol")) {
-                s->dev_protocol = atoi(l);
-                if (t = strchr(l, ' '))
-                    s->dev_protocol_str = g_strdup(t + 1);
-            } else if (l = lsusb_line_value(p, "iManufacturer")) {
-                if (t = strchr(l, ' '))
-                    s->manufacturer = g_strdup(t + 1);
-            } else if (l = lsusb_line_value(p, "iProduct")) {
-                if (t = strchr(l, ' '))
-                    s->device = g_strdup(t + 1);
-            } else if (l = lsusb_line_value(p, "iSerial")) {
-                if (t = strchr(l, ' '))
-                    s->serial = g_strdup(t + 1);
-
-            // interface info
-            } else if (l = lsusb_line_value(p, "bInterfaceNumber")) {
-                curr_if = usbi_new();
-                curr_if->if_number = atoi(l);
-
-                // This may parse same interface multiple times when there
-                // are multiple Configuration descriptors per device
-                // As a workaround usbd_append_interface appends interface
-                // with same if_number only once
-                if (!usbd_append_interface(s, curr_if)){
-                    usbi_free(curr_if);
-                    curr_if = NULL;
-                }
-            } else if (l = lsusb_line_value(p, "bInterfaceClass")) {
-                if (curr_if != NULL){
-                    curr_if->if_class = atoi(l);
-                    if (t = strchr(l, ' '))
-                        curr_if->if_class_str = g_strdup(t + 1);
-                }
-            } else if (l = lsusb_line_value(p, "bInterfaceSubClass")) {
-                if (curr_if != NULL){
-                    curr_if->if_subclass = atoi(l);
-                    if (t = strchr(l, ' '))
-                        curr_if->if_subclass_str = g_strdup(t + 1);
-                }
-            } else if (l = lsusb_line_value(p, "bInterfaceProtocol")) {
-                if (curr_if != NULL){
-                    curr_if->if_protocol = atoi(l);
-                    if (t = strchr(l, ' '))
-                        curr_if->if_protocol_str = g_strdup(t + 1);
-                }
-            } else if (l = lsusb_line_value(p, "iInterface")) {
-                if (curr_if != NULL){
-                    if (t = strchr(l, ' '))
-                        curr_if->if_label = g_strdup(t + 1);
-                }
-            }
-
-            p = next_nl + 1;
-        }
-        g_free(out);
-        g_free(err);
-        return TRUE;
-    }
-    return FALSE;
-}
-
 static gboolean usb_get_interface_sysfs(int conf, int number,
                                         const char* devpath, usbi *intf){
     gchar *ifpath, *drvpath, *tmp;
@@ -363,7 +249,7 @@ static gboolean usb_get_device_sysfs(int bus, int dev, const char* sysfspath, us
     gboolean ok;
     int i, if_count = 0, conf = 0, ver;
     ids_query_result result;// = {};
-    gchar *qpath;
+    gchar *qpath, *tmp;
 
     memset(&result,0,sizeof(ids_query_result));
     if (sysfspath == NULL)
@@ -384,6 +270,15 @@ static gboolean usb_get_device_sysfs(int bus, int dev, const char* sysfspath, us
     s->dev_subclass = h_sysfs_read_hex(sysfspath, "bDeviceSubClass");
     s->dev_protocol = h_sysfs_read_hex(sysfspath, "bDeviceProtocol");
     s->speed_mbs = h_sysfs_read_int(sysfspath, "speed");
+    s->power_state = h_sysfs_read_string(sysfspath, "power/runtime_status");
+
+    qpath = g_build_filename(sysfspath, "driver", NULL);
+    tmp = g_file_read_link(qpath, NULL);
+    if (tmp) {
+        s->driver = g_path_get_basename(tmp);
+        g_free(tmp);
+    }
+    g_free(qpath);
 
     if (s->product == NULL && s->vendor == NULL) {
         qpath = g_strdup_printf("%04x/%04x", s->vendor_id, s->product_id);
@@ -454,12 +349,7 @@ usbd *usb_get_device(int bus, int dev, const gchar* sysfspath) {
     usbd *s = usbd_new();
     int ok = 0;
     if (s) {
-        /* try sysfs */
         ok = usb_get_device_sysfs(bus, dev, sysfspath, s);
-        if (!ok) {
-            /* try lsusb */
-            ok = usb_get_device_lsusb(bus, dev, s);
-        }
         if (!ok) {
             usbd_free(s);
             s = NULL;
@@ -468,41 +358,12 @@ usbd *usb_get_device(int bus, int dev, const gchar* sysfspath) {
     return s;
 }
 
-static usbd *usb_get_device_list_lsusb() {
-    gboolean spawned;
-    gchar *out, *err, *p, *next_nl;
-    usbd *head = NULL, *nd;
-    int bus, dev, vend, prod, ec;
-
-    spawned = hardinfo_spawn_command_line_sync("lsusb",
-            &out, &err, NULL, NULL);
-    if (spawned) {
-        p = out;
-        while(next_nl = strchr(p, '\n')) {
-            strend(p, '\n');
-            ec = sscanf(p, "Bus %d Device %d: ID %x:%x", &bus, &dev, &vend, &prod);
-            if (ec == 4) {
-                nd = usb_get_device(bus, dev, NULL);
-                if (head == NULL) {
-                    head = nd;
-                } else {
-                    usbd_list_append(head, nd);
-                }
-            }
-            p = next_nl + 1;
-        }
-        g_free(out);
-        g_free(err);
-    }
-    return head;
-}
-
 static usbd *usb_get_device_list_sysfs() {
     GDir *dir;
     GRegex *regex;
     GMatchInfo *match_info;
     usbd *head = NULL, *nd;
-    gchar *devpath;
+    gchar *devpath, *root;
     const char *entry;
     int bus, dev;
 
@@ -511,8 +372,11 @@ static usbd *usb_get_device_list_sysfs() {
         return NULL;
     }
 
-    dir = g_dir_open(SYSFS_DIR_USB_DEVICES, 0, NULL);
+    root = h_sysfs_path(SYSFS_DIR_USB_DEVICES);
+    dir = g_dir_open(root, 0, NULL);
     if (!dir){
+        g_regex_unref(regex);
+        g_free(root);
         return NULL;
     }
 
@@ -520,7 +384,7 @@ static usbd *usb_get_device_list_sysfs() {
         g_regex_match(regex, entry, 0, &match_info);
 
         if (g_match_info_matches(match_info)) {
-            devpath = g_build_filename(SYSFS_DIR_USB_DEVICES, entry, NULL);
+            devpath = g_build_filename(root, entry, NULL);
             bus = h_sysfs_read_int(devpath, "busnum");
             dev = h_sysfs_read_int(devpath, "devnum");
 
@@ -539,6 +403,7 @@ static usbd *usb_get_device_list_sysfs() {
 
     g_dir_close(dir);
     g_regex_unref(regex);
+    g_free(root);
 
     return head;
 }
@@ -547,8 +412,6 @@ usbd *usb_get_device_list() {
     usbd *lst, *l;
 
     lst = usb_get_device_list_sysfs();
-    if (lst == NULL)
-        lst = usb_get_device_list_lsusb();
 
     l = lst;
     while(l) {
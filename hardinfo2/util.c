@@ -34,6 +34,7 @@
 #include <shell.h>
 #include <iconcache.h>
 #include <hardinfo.h>
+#include <scan_profile.h>
 #include <gtk/gtk.h>
 
 #include <stdbool.h>
@@ -317,6 +318,7 @@ log_handler(const gchar * log_domain,
 void parameters_init(int *argc, char ***argv, ProgramParameters * param)
 {
     static gint create_report = FALSE;
+    static gint daemon = FALSE;
     static gint force_all_details = FALSE;
     static gint show_version = FALSE;
     static gint skip_benchmarks = FALSE;
@@ -324,9 +326,14 @@ void parameters_init(int *argc, char ***argv, ProgramParameters * param)
     static gchar *topic = NULL;
     static gchar *topiccached = NULL;
     static gchar *report_format = NULL;
+    static gchar *select_fields = NULL;
     static gchar *run_benchmark = NULL;
     static gchar *result_format = NULL;
     static gchar *bench_user_note = NULL;
+    static gchar *dtb = NULL;
+    static gchar *sysfs = NULL;
+    static gchar *modules = NULL;
+    static gchar *profile_scans = NULL;
     static gint max_bench_results = 250;
 
     static GOptionEntry options[] = {
@@ -342,12 +349,24 @@ void parameters_init(int *argc, char ***argv, ProgramParameters * param)
 	 .arg = G_OPTION_ARG_NONE,
 	 .arg_data = &create_report,
 	 .description = N_("creates a report and prints to standard output")},
+	{
+	 .long_name = "daemon",
+	 .short_name = 'd',
+	 .arg = G_OPTION_ARG_NONE,
+	 .arg_data = &daemon,
+	 .description = N_("keeps running and serves reports and live values over a local socket")},
 	{
 	 .long_name = "report-format",
 	 .short_name = 'f',
 	 .arg = G_OPTION_ARG_STRING,
 	 .arg_data = &report_format,
-	 .description = N_("chooses a report format ([text], html)")},
+	 .description = N_("chooses a report format ([text], html, shell, json, cbor); json and cbor are always in English")},
+	{
+	 .long_name = "select",
+	 .short_name = 'p',
+	 .arg = G_OPTION_ARG_STRING,
+	 .arg_data = &select_fields,
+	 .description = N_("only include these fields in json/cbor reports eg. -p 'devices.pci_devices[*].vendor'")},
 	{
 	 .long_name = "topic",
 	 .short_name = 't',
@@ -402,6 +421,30 @@ void parameters_init(int *argc, char ***argv, ProgramParameters * param)
 	 .arg = G_OPTION_ARG_NONE,
 	 .arg_data = &force_all_details,
 	 .description = N_("show all details")},
+	{
+	 .long_name = "dtb",
+	 .short_name = 0,
+	 .arg = G_OPTION_ARG_FILENAME,
+	 .arg_data = &dtb,
+	 .description = N_("read the device tree from a .dtb file")},
+	{
+	 .long_name = "sysfs",
+	 .short_name = 0,
+	 .arg = G_OPTION_ARG_FILENAME,
+	 .arg_data = &sysfs,
+	 .description = N_("read PCI and USB devices from a copy of /sys")},
+	{
+	 .long_name = "modules",
+	 .short_name = 0,
+	 .arg = G_OPTION_ARG_FILENAME,
+	 .arg_data = &modules,
+	 .description = N_("match PCI devices against modules.alias in this directory instead of /lib/modules/`uname -r`")},
+	{
+	 .long_name = "profile-scans",
+	 .short_name = 0,
+	 .arg = G_OPTION_ARG_FILENAME,
+	 .arg_data = &profile_scans,
+	 .description = N_("time every scan and command run, print a table and write a Chrome trace to this file")},
 	{NULL}
     };
     GOptionContext *ctx;
@@ -423,8 +466,15 @@ void parameters_init(int *argc, char ***argv, ProgramParameters * param)
 
     if(topiccached) {param->topiccached=1;topic=topiccached;}
     param->topic=topic;
+    param->select=select_fields;
+    param->path_dtb=dtb;
+    param->path_sysfs=sysfs;
+    param->path_modules=modules;
+    param->profile_scans=profile_scans;
     if(topic) {create_report=1; skip_benchmarks=1;quiet=1;}
+    if(daemon) {skip_benchmarks=1;quiet=1;}
     param->create_report = create_report;
+    param->daemon = daemon;
     param->report_format = REPORT_FORMAT_TEXT;
     param->show_version = show_version;
     param->run_benchmark = run_benchmark;
@@ -440,6 +490,10 @@ void parameters_init(int *argc, char ***argv, ProgramParameters * param)
             param->report_format = REPORT_FORMAT_HTML;
         if (g_str_equal(report_format, "shell"))
             param->report_format = REPORT_FORMAT_SHELL;
+        if (g_str_equal(report_format, "json"))
+            param->report_format = REPORT_FORMAT_JSON;
+        if (g_str_equal(report_format, "cbor"))
+            param->report_format = REPORT_FORMAT_CBOR;
     }
 
     /* check user note */
@@ -468,7 +522,7 @@ void parameters_init(int *argc, char ***argv, ProgramParameters * param)
      * report text: no
      * anything else? */
     param->markup_ok = TRUE;
-    if (param->create_report && param->report_format != REPORT_FORMAT_HTML)
+    if ((param->create_report || param->daemon) && param->report_format != REPORT_FORMAT_HTML)
         param->markup_ok = FALSE;
 
     // TODO: fmt_opts: FMT_OPT_ATERM, FMT_OPT_HTML, FMT_OPT_PANGO...
@@ -727,8 +781,11 @@ static ShellModule *module_load(gchar * filename)
 			    (gpointer) & (entry->fieldfunc));
 	    g_module_symbol(module->dll, "hi_note_func",
 			    (gpointer) & (entry->notefunc));
+	    g_module_symbol(module->dll, "hi_inventory_token",
+			    (gpointer) & (entry->tokenfunc));
 
 	    entry->name = _(entries[i].name); //gettext unname N_() in computer.c line 67 etc...
+	    entry->msgid = entries[i].name;
 	    entry->scan_func = entries[i].scan_callback;
 	    entry->func = entries[i].callback;
 	    entry->number = i;
@@ -917,7 +974,9 @@ void module_entry_scan_all_except(ModuleEntry * entries, gint except_entry)
 	g_free(text);
 
 	if ((scan_callback = entry.scan_callback)) {
+	    ScanProfileEvent *ev = scan_profile_begin(SCAN_PROFILE_SCAN, entry.name);
 	    scan_callback(FALSE);
+	    scan_profile_end(ev);
 	}
     }
 
@@ -934,14 +993,18 @@ void module_entry_reload(ShellModuleEntry * module_entry)
 {
 
     if (module_entry->scan_func) {
+	ScanProfileEvent *ev = scan_profile_begin(SCAN_PROFILE_SCAN, module_entry->name);
 	module_entry->scan_func(TRUE);
+	scan_profile_end(ev);
     }
 }
 
 void module_entry_scan(ShellModuleEntry * module_entry)
 {
     if (module_entry->scan_func) {
+	ScanProfileEvent *ev = scan_profile_begin(SCAN_PROFILE_SCAN, module_entry->name);
 	module_entry->scan_func(FALSE);
+	scan_profile_end(ev);
     }
 }
 
@@ -957,7 +1020,10 @@ gchar *module_entry_get_field(ShellModuleEntry * module_entry, gchar * field)
 gchar *module_entry_function(ShellModuleEntry * module_entry)
 {
     if (module_entry->func) {
-	return module_entry->func();
+	ScanProfileEvent *ev = scan_profile_begin(SCAN_PROFILE_PAGE, module_entry->name);
+	gchar *page = module_entry->func();
+	scan_profile_end(ev);
+	return page;
     }
 
     return NULL;
@@ -1118,6 +1184,12 @@ h_sysfs_read_string(const gchar *endpoint, const gchar *entry)
 	return return_value;
 }
 
+gchar *
+h_sysfs_path(const gchar *path)
+{
+	return g_build_filename(params.path_sysfs ? params.path_sysfs : "/sys", path, NULL);
+}
+
 static GHashTable *_moreinfo = NULL;
 
 void
@@ -1313,9 +1385,14 @@ gboolean hardinfo_spawn_command_line_sync(const gchar *command_line,
                                           gint *exit_status,
                                           GError **error)
 {
+    ScanProfileEvent *ev = scan_profile_begin(SCAN_PROFILE_SPAWN, command_line);
+    gboolean spawned;
+
     shell_status_pulse();
-    return g_spawn_command_line_sync(command_line, standard_output,
-                                     standard_error, exit_status, error);
+    spawned = g_spawn_command_line_sync(command_line, standard_output,
+                                        standard_error, exit_status, error);
+    scan_profile_end(ev);
+    return spawned;
 }
 
 
@@ -21,6 +21,14 @@
 #include "hardinfo.h"
 #include "x_util.h"
 #include <X11/Xlib.h>
+#if(HARDINFO2_XRANDR)
+#include <X11/Xatom.h>
+#include <X11/extensions/Xrandr.h>
+#endif
+#if(HARDINFO2_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 
 /* wayland stuff lives here for now */
 
@@ -240,10 +248,26 @@ gboolean fill_xinfo(xinfo *xi) {
     return FALSE;
 }
 
+static void xrr_set_edid_hex(x_output *o, const char *hex) {
+    int i, len = strlen(hex) / 2;
+    unsigned int b;
+
+    if (len < 128) return;
+    o->edid = malloc(len);
+    if (!o->edid) return;
+    for (i = 0; i < len; i++) {
+        sscanf(hex + i * 2, "%2x", &b);
+        o->edid[i] = b;
+    }
+    o->edid_len = len;
+}
+
 gboolean fill_xrr_info(xrr_info *xrr) {
     gboolean spawned;
     gchar *out, *err, *p, *next_nl;
     gchar *xrr_cmd = g_strdup("xrandr --prop");
+    GString *edid_hex = NULL;
+    char *star;
     int ec;
 
     x_screen ts;
@@ -267,6 +291,30 @@ gboolean fill_xrr_info(xrr_info *xrr) {
             strend(p, '\n');
             g_strstrip(p);
 
+            /* EDID property of the last output, as lines of hex */
+            if (edid_hex) {
+                if (*p && strspn(p, "0123456789abcdefABCDEF") == strlen(p)) {
+                    g_string_append(edid_hex, p);
+                    goto xrr_next_line;
+                }
+                xrr_set_edid_hex(&xrr->outputs[xrr->output_count-1], edid_hex->str);
+                g_string_free(edid_hex, TRUE);
+                edid_hex = NULL;
+            }
+            if (xrr->output_count && strcmp(p, "EDID:") == 0) {
+                edid_hex = g_string_new(NULL);
+                goto xrr_next_line;
+            }
+
+            /* mode list line, * marks the current mode */
+            if (xrr->output_count && isdigit(*p) && (star = strchr(p, '*'))) {
+                while (star > p && (isdigit(star[-1]) || star[-1] == '.'))
+                    star--;
+                xrr->outputs[xrr->output_count-1].refresh_mhz =
+                    (int)(g_ascii_strtod(star, NULL) * 1000 + 0.5);
+                goto xrr_next_line;
+            }
+
             ec = sscanf(p, "Screen %d: minimum %d x %d, current %d x %d, maximum %d x %d",
                 &ts.number,
                 &ts.min_px_width, &ts.min_px_height,
@@ -335,6 +383,10 @@ gboolean fill_xrr_info(xrr_info *xrr) {
             xrr_next_line:
                 p = next_nl + 1;
         }
+        if (edid_hex) {
+            xrr_set_edid_hex(&xrr->outputs[xrr->output_count-1], edid_hex->str);
+            g_string_free(edid_hex, TRUE);
+        }
         g_free(out);
         g_free(err);
         return TRUE;
@@ -342,6 +394,256 @@ gboolean fill_xrr_info(xrr_info *xrr) {
     return FALSE;
 }
 
+#if(HARDINFO2_XRANDR)
+static void xrr_add_screen(xrr_info *xrr, x_screen *ts) {
+    x_screen *n = realloc(xrr->screens, (xrr->screen_count + 1) * sizeof(x_screen));
+    if (!n) return;
+    xrr->screens = n;
+    memcpy(&xrr->screens[xrr->screen_count++], ts, sizeof(x_screen));
+}
+
+static void xrr_add_output(xrr_info *xrr, x_output *to) {
+    x_output *n = realloc(xrr->outputs, (xrr->output_count + 1) * sizeof(x_output));
+    if (!n) { free(to->edid); return; }
+    xrr->outputs = n;
+    memcpy(&xrr->outputs[xrr->output_count++], to, sizeof(x_output));
+}
+
+static int xrr_mode_refresh_mhz(XRRScreenResources *res, RRMode mode) {
+    int i;
+    double vtotal;
+
+    for (i = 0; i < res->nmode; i++) {
+        XRRModeInfo *m = &res->modes[i];
+        if (m->id != mode) continue;
+        vtotal = m->vTotal;
+        if (m->modeFlags & RR_DoubleScan) vtotal *= 2;
+        if (m->modeFlags & RR_Interlace) vtotal /= 2;
+        if (!m->hTotal || !vtotal) return 0;
+        return (int)(m->dotClock * 1000.0 / (m->hTotal * vtotal) + 0.5);
+    }
+    return 0;
+}
+
+static void xrr_get_edid(Display *display, RROutput output, x_output *to) {
+    Atom edid_atom, actual_type;
+    int actual_format;
+    unsigned long nitems, bytes_after;
+    unsigned char *prop = NULL;
+
+    edid_atom = XInternAtom(display, RR_PROPERTY_RANDR_EDID, True);
+    if (edid_atom == None) return;
+    /* 256 longs = 1024 bytes, room for the base block and extensions */
+    if (XRRGetOutputProperty(display, output, edid_atom, 0, 256, False, False,
+            AnyPropertyType, &actual_type, &actual_format,
+            &nitems, &bytes_after, &prop) != Success)
+        return;
+    if (actual_type == XA_INTEGER && actual_format == 8 && nitems >= 128) {
+        to->edid = malloc(nitems);
+        if (to->edid) {
+            memcpy(to->edid, prop, nitems);
+            to->edid_len = nitems;
+        }
+    }
+    XFree(prop);
+}
+
+/* screens and outputs straight from the server; GetScreenResourcesCurrent
+ * does not reprobe the outputs, which is what makes xrandr slow */
+static gboolean fill_xrr_info_xlib(xrr_info *xrr, Display *display) {
+    int ev, er, major = 0, minor = 0, s, o;
+
+    if (!XRRQueryExtension(display, &ev, &er)
+        || !XRRQueryVersion(display, &major, &minor)
+        || major < 1 || (major == 1 && minor < 3))
+        return FALSE;
+
+    for (s = 0; s < ScreenCount(display); s++) {
+        Window root = RootWindow(display, s);
+        XRRScreenResources *res;
+        x_screen ts;
+
+        memset(&ts, 0, sizeof(x_screen));
+        ts.number = s;
+        ts.px_width = DisplayWidth(display, s);
+        ts.px_height = DisplayHeight(display, s);
+        XRRGetScreenSizeRange(display, root,
+            &ts.min_px_width, &ts.min_px_height,
+            &ts.max_px_width, &ts.max_px_height);
+        xrr_add_screen(xrr, &ts);
+
+        res = XRRGetScreenResourcesCurrent(display, root);
+        if (!res) continue;
+        for (o = 0; o < res->noutput; o++) {
+            XRROutputInfo *oi = XRRGetOutputInfo(display, res, res->outputs[o]);
+            x_output to;
+
+            if (!oi) continue;
+            memset(&to, 0, sizeof(x_output));
+            g_strlcpy(to.name, oi->name, sizeof(to.name));
+            switch (oi->connection) {
+                case RR_Connected: to.connected = 1; break;
+                case RR_Disconnected: to.connected = 0; break;
+                default: to.connected = -1; break;
+            }
+            to.mm_width = oi->mm_width;
+            to.mm_height = oi->mm_height;
+            to.screen = -1;
+            if (oi->crtc) {
+                XRRCrtcInfo *ci = XRRGetCrtcInfo(display, res, oi->crtc);
+                if (ci) {
+                    if (ci->mode != None) {
+                        to.screen = xrr->screen_count - 1;
+                        to.px_width = ci->width;
+                        to.px_height = ci->height;
+                        to.px_offset_x = ci->x;
+                        to.px_offset_y = ci->y;
+                        to.refresh_mhz = xrr_mode_refresh_mhz(res, ci->mode);
+                    }
+                    XRRFreeCrtcInfo(ci);
+                }
+            }
+            xrr_get_edid(display, res->outputs[o], &to);
+            xrr_add_output(xrr, &to);
+            XRRFreeOutputInfo(oi);
+        }
+        XRRFreeScreenResources(res);
+    }
+    return TRUE;
+}
+
+/* what xdpyinfo would print, without running it */
+static gboolean fill_xinfo_xlib(xinfo *xi) {
+    Display *display;
+    int rn;
+
+    display = XOpenDisplay(NULL);
+    if (!display)
+        return FALSE;
+
+    xi->display_name = g_strdup(DisplayString(display));
+    xi->vendor = g_strdup(ServerVendor(display));
+    rn = VendorRelease(display);
+    xi->release_number = g_strdup_printf("%d", rn);
+    if (strstr(xi->vendor, "X.Org") && rn >= 10000000) {
+        xi->version = (rn % 1000)
+            ? g_strdup_printf("%d.%d.%d.%d", rn / 10000000, (rn / 100000) % 100,
+                              (rn / 1000) % 100, rn % 1000)
+            : g_strdup_printf("%d.%d.%d", rn / 10000000, (rn / 100000) % 100,
+                              (rn / 1000) % 100);
+    }
+
+    if (!fill_xrr_info_xlib(xi->xrr, display)) {
+        XCloseDisplay(display);
+        /* no usable RandR, let xrandr or fill_basic_xlib() try */
+        return FALSE;
+    }
+    XCloseDisplay(display);
+    return TRUE;
+}
+#endif
+
+#if(HARDINFO2_EGL)
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#ifndef EGL_NO_CONFIG_KHR
+#define EGL_NO_CONFIG_KHR ((EGLConfig)0)
+#endif
+#define HI_GL_VENDOR 0x1F00
+#define HI_GL_RENDERER 0x1F01
+#define HI_GL_VERSION 0x1F02
+#define HI_GL_SHADING_LANGUAGE_VERSION 0x8B8C
+
+typedef const unsigned char *(*hi_gl_get_string)(unsigned int);
+
+/* make a context current without any surface and read its strings,
+ * api is EGL_OPENGL_API or EGL_OPENGL_ES_API */
+static gboolean egl_query_strings(EGLDisplay dpy, EGLenum api, const EGLint *attribs,
+                                  char **vendor, char **renderer,
+                                  char **version, char **sl_version) {
+    static const EGLint gl_cfg[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    static const EGLint es_cfg[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT, EGL_NONE };
+    const char *exts = eglQueryString(dpy, EGL_EXTENSIONS);
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    EGLContext ctx;
+    EGLint n = 0;
+    hi_gl_get_string get_string;
+    const char *str;
+
+    if (!eglBindAPI(api))
+        return FALSE;
+    if (!exts || (!strstr(exts, "EGL_KHR_no_config_context")
+                  && !strstr(exts, "EGL_MESA_configless_context"))) {
+        if (!eglChooseConfig(dpy, api == EGL_OPENGL_API ? gl_cfg : es_cfg, &config, 1, &n) || !n)
+            return FALSE;
+    }
+    ctx = eglCreateContext(dpy, config, EGL_NO_CONTEXT, attribs);
+    if (ctx == EGL_NO_CONTEXT)
+        return FALSE;
+    if (!eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+        eglDestroyContext(dpy, ctx);
+        return FALSE;
+    }
+
+    get_string = (hi_gl_get_string)eglGetProcAddress("glGetString");
+    if (get_string) {
+#define EGL_GET_STRING(name, dest) \
+    if (dest && (str = (const char *)get_string(name))) *dest = g_strdup(str);
+        EGL_GET_STRING(HI_GL_VENDOR, vendor);
+        EGL_GET_STRING(HI_GL_RENDERER, renderer);
+        EGL_GET_STRING(HI_GL_VERSION, version);
+        EGL_GET_STRING(HI_GL_SHADING_LANGUAGE_VERSION, sl_version);
+#undef EGL_GET_STRING
+    }
+
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(dpy, ctx);
+    return get_string != NULL;
+}
+
+/* GL strings from a surfaceless EGL context: no window, no X connection,
+ * works the same under Xvfb/llvmpipe, Wayland or a bare render node */
+static gboolean fill_glx_info_egl(glx_info *glx) {
+    static const EGLint core_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 2,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE };
+    static const EGLint es_attribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display;
+    const char *client_exts;
+    EGLDisplay dpy;
+    gboolean ok;
+
+    client_exts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (!client_exts || !strstr(client_exts, "EGL_MESA_platform_surfaceless"))
+        return FALSE;
+    get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+        eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (!get_platform_display)
+        return FALSE;
+    dpy = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, NULL, NULL))
+        return FALSE;
+
+    ok = egl_query_strings(dpy, EGL_OPENGL_API, NULL,
+            &glx->ogl_vendor, &glx->ogl_renderer,
+            &glx->ogl_version, &glx->ogl_sl_version);
+    if (ok) {
+        /* EGL contexts are always direct */
+        glx->direct_rendering = 1;
+        egl_query_strings(dpy, EGL_OPENGL_API, core_attribs,
+            NULL, NULL, &glx->ogl_core_version, &glx->ogl_core_sl_version);
+        egl_query_strings(dpy, EGL_OPENGL_ES_API, es_attribs,
+            NULL, NULL, &glx->ogles_version, &glx->ogles_sl_version);
+    }
+
+    eglTerminate(dpy);
+    eglReleaseThread();
+    return ok;
+}
+#endif
+
 gboolean fill_basic_xlib(xinfo *xi) {
     Display *display;
     int s, w, h, rn;
@@ -399,6 +701,9 @@ xrr_info *xrr_create() {
 
 void xrr_free(xrr_info *xrr) {
     if (xrr) {
+        int n;
+        for (n = 0; n < xrr->output_count; n++)
+            free(xrr->outputs[n].edid);
         free(xrr->screens);
         free(xrr->outputs);
         free(xrr->providers);
@@ -422,12 +727,20 @@ xinfo *xinfo_get_info() {
     xi->vk = vk_create();
     if(!xi->vk) {free(xi->glx);free(xi->xrr);free(xi);return NULL;}
 
-    if(!fill_xinfo(xi)) fail++;
-    if(fill_xrr_info(xi->xrr)) fail++;
+#if(HARDINFO2_XRANDR)
+    if(!fill_xinfo_xlib(xi))
+#endif
+    {
+        if(!xi->display_name && !fill_xinfo(xi)) fail++;
+        if(!fill_xrr_info(xi->xrr)) fail++;
+    }
 
     /* as fallback, try xlib directly */
     if ( fail && !fill_basic_xlib(xi) ) xi->nox = 1;
 
+#if(HARDINFO2_EGL)
+    if(!fill_glx_info_egl(xi->glx))
+#endif
     fill_glx_info(xi->glx);
     fill_vk_info(xi->vk);
 
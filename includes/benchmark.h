@@ -6,6 +6,16 @@
 
 #define BENCH_PTR_BITS ((unsigned int)sizeof(void*) * 8)
 
+/* the compression backend is picked at build time and results of different
+ * backends can't be compared, so each stores and looks up its own name */
+#if HARDINFO2_COMPRESS_ZSTD
+#define BENCH_COMPRESS_NAME "CPU Compression (zstd)"
+#elif HARDINFO2_COMPRESS_LZ4
+#define BENCH_COMPRESS_NAME "CPU Compression (lz4)"
+#else
+#define BENCH_COMPRESS_NAME "CPU Compression (zlib)"
+#endif
+
 extern ProgramParameters params;
 
 enum BenchmarkEntries {
@@ -13,11 +23,18 @@ enum BenchmarkEntries {
     BENCHMARK_BLOWFISH_THREADS,
     BENCHMARK_BLOWFISH_CORES,
     BENCHMARK_ZLIB,
+    BENCHMARK_COMPRESS,
     BENCHMARK_CRYPTOHASH,
+    BENCHMARK_SHA256,
+    BENCHMARK_BLAKE3,
+    BENCHMARK_AES_CTR,
+    BENCHMARK_CHACHA20,
     BENCHMARK_FIB,
     BENCHMARK_NQUEENS,
     BENCHMARK_FFT,
+    BENCHMARK_FFT_SINGLE,
     BENCHMARK_RAYTRACE,
+    BENCHMARK_RAYTRACE_THREADS,
     BENCHMARK_IPERF3_SINGLE,
     BENCHMARK_SBCPU_SINGLE,
     BENCHMARK_SBCPU_ALL,
@@ -49,13 +66,20 @@ void benchmark_sbcpu_single(void);
 void benchmark_sbcpu_all(void);
 void benchmark_sbcpu_quad(void);
 void benchmark_cryptohash(void);
+void benchmark_sha256(void);
+void benchmark_blake3(void);
+void benchmark_aes_ctr(void);
+void benchmark_chacha20(void);
 void benchmark_fft(void);
+void benchmark_fft_single(void);
 void benchmark_fib(void);
 void benchmark_fish(void);
 void benchmark_gui(void);
 void benchmark_nqueens(void);
 void benchmark_raytrace(void);
+void benchmark_raytrace_threads(void);
 void benchmark_zlib(void);
+void benchmark_compress(void);
 void benchmark_iperf3_single(void);
 #if(HARDINFO2_QT5)
 void benchmark_opengl(void);
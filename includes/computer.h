@@ -157,6 +157,7 @@ void init_memory_labels(void);
 void scan_memory_do(void);
 void scan_boots_real(void);
 void scan_languages(OperatingSystem *os);
+gchar *locale_get_info(const gchar *name);
 void scan_groups_do(void);
 
 void kernel_module_icon_init(void);
@@ -0,0 +1,54 @@
+/*
+ *    Hardinfo2 - System Information and benchmark
+ *    Copyright (C) 2003-2007 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __DAEMON_H__
+#define __DAEMON_H__
+
+#include "hardinfo.h"
+
+/*
+ * hardinfo2 --daemon keeps the modules scanned and samples pages that have
+ * an UpdateInterval or ReloadInterval, serving them on
+ * $XDG_RUNTIME_DIR/hardinfo2.sock.
+ *
+ * A request is one line, "COMMAND [args]\n", of at most 4096 bytes. The
+ * reply is "OK <length>\n" followed by length bytes, or "ERR <message>\n".
+ * Replies are queued: a client that stops reading them for 5 seconds, or
+ * leaves 32 MiB unread, is disconnected.
+ * Subscribed clients also get "EVENT <length>\n<entry>\t<field>\t<value>\n".
+ * Entries are addressed as "<module>/<number>", fields by label.
+ *
+ *   LIST                         "<entry>\t<name>" lines
+ *   GET <entry>                  page with live values filled in
+ *   FIELD <entry> <field>        one value
+ *   MORE <entry> <tag>           details of a flagged key
+ *   RESCAN <entry>               rescan now
+ *   REPORT [text|shell] [all] [reload]
+ *                                same as -r [-f shell] [-w], from the pages
+ *                                as held; reload rescans all of them first
+ *   HISTORY <entry> <field>      sampled numeric values, oldest first
+ *   SUBSCRIBE <entry> <field>    push changes of a field
+ *   UNSUBSCRIBE <entry> <field>
+ */
+
+gchar *daemon_socket_path(void);
+gint   daemon_run(GSList *modules);
+/* reply payload of a running daemon, NULL if none answers */
+gchar *daemon_request(const gchar *request);
+
+#endif /* __DAEMON_H__ */
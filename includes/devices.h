@@ -50,11 +50,18 @@ gchar *processor_frequency_desc(GSList *processors);
 gchar *ldlinux_hwcaps_info(void);
 
 /* Printers */
-void init_cups(void);
+void printers_shutdown(void);
 
 /* Battery */
 void scan_battery_do(void);
 
+/* Kernel uevents, drained at scan time */
+#define UEVENT_CHANGE      (1 << 0)
+#define UEVENT_ADD_REMOVE  (1 << 1)
+#define UEVENT_LOST        (1 << 2) /* or no socket: assume anything changed */
+int uevent_open(void);
+guint uevent_drain(int fd, const gchar *subsystem);
+
 /* PCI */
 void scan_pci_do(void);
 
@@ -67,6 +74,7 @@ void scan_printers_do(void);
 void scan_sensors_do(void);
 void sensor_init(void);
 void sensor_shutdown(void);
+gchar *gpu_sensor_field(const gchar *field);
 void __scan_dtree(void);
 void scan_gpu_do(void);
 gboolean __scan_udisks2_devices(void);
@@ -82,6 +90,7 @@ extern gchar *battery_list;
 extern gchar *input_icons;
 extern gchar *input_list;
 extern gchar *lginterval;
+extern gchar *battery_lginterval;
 extern gchar *meminfo;
 extern gchar *pci_list;
 extern gchar *printer_icons;
@@ -95,7 +104,6 @@ extern gchar *usb_icons;
 extern GHashTable *_pci_devices;
 extern GHashTable *sensor_compute;
 extern GHashTable *sensor_labels;
-extern GModule *cups;
 
 extern gchar *dmi_info;
 extern gchar *dtree_info;
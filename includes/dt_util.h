@@ -44,7 +44,7 @@ typedef uint64_t dt_uint64; /* big-endian */
 typedef struct _dtr dtr;
 typedef struct _dtr_obj dtr_obj;
 
-dtr *dtr_new(const char *base_path); /* NULL for DTR_ROOT */
+dtr *dtr_new(const char *base_path); /* NULL for DTR_ROOT, may also be a .dtb file */
 void dtr_free(dtr *);
 int dtr_was_found(dtr *);
 const char *dtr_base_path(dtr *);
@@ -66,6 +66,10 @@ char *dtr_get_prop_str(dtr *, dtr_obj *node, const char *name);
 uint32_t dtr_get_prop_u32(dtr *, dtr_obj *node, const char *name);
 uint64_t dtr_get_prop_u64(dtr *, dtr_obj *node, const char *name);
 
+/* names of the properties and child nodes of node path np,
+ * or only the child nodes; free with g_strfreev() */
+char **dtr_children(dtr *, const char *np, int nodes_only);
+
 /* attempts to render the object as a string */
 char* dtr_str(dtr_obj *obj);
 
@@ -0,0 +1,44 @@
+#ifndef __FBENCH_H__
+#define __FBENCH_H__
+
+#define max_surfaces 10
+#define FBENCH_ALIGN 64
+
+typedef struct _FBench	FBench;
+
+/* everything fbench() used to keep in globals */
+struct _FBench {
+  short current_surfaces;
+  short paraxial;
+
+  double clear_aperture;
+
+  double aberr_lspher;
+  double aberr_osc;
+  double aberr_lchrom;
+
+  double max_lspher;
+  double max_osc;
+  double max_lchrom;
+
+  double radius_of_curvature;
+  double object_distance;
+  double ray_height;
+  double axis_slope_angle;
+  double from_index;
+  double to_index;
+
+  double spectral_line[9];
+  double s[max_surfaces][5];
+  double od_sa[2][2];
+
+  int itercount;	/* part of the context so the compiler can't
+			   optimise out the loop over the ray tracing
+			   code */
+};
+
+FBench *fbench_new(void);
+void fbench_run(FBench *fbench);
+void fbench_free(FBench *fbench);
+
+#endif /* __FBENCH_H__ */
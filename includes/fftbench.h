@@ -3,17 +3,22 @@
 
 #include <glib.h>
 
+#define FFT_ALIGN 64
+
 typedef struct _FFTBench	FFTBench;
 
+/* one per thread; a is N*N row-major, restored from a0 on every run */
 struct _FFTBench {
-  double **a, *b, *r;
+  double *a, *a0, *b, *r, *y;
   int *p;
+  long seed;
+  unsigned long runs;
 };
 
 FFTBench *fft_bench_new(void);
 void fft_bench_run(FFTBench *fftbench);
+/* solution of the last run, n doubles */
+const double *fft_bench_result(FFTBench *fftbench, int *n);
 void fft_bench_free(FFTBench *fftbench);
 
 #endif /* __FFTBENCH_H__ */
-
-
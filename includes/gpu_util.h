@@ -52,6 +52,23 @@ typedef struct gpud {
     struct gpud *next; /* this is a linked list */
 } gpud;
 
+/* live values of a DRM card, -1 where the driver doesn't report one */
+typedef struct gpu_sample {
+    int busy_percent;
+    int core_mhz, mem_mhz;
+    double power_w;
+    int64_t vram_used, vram_total; /* bytes */
+} gpu_sample;
+
+/* keeps the sysfs files of one card open to sample them cheaply */
+typedef struct gpu_sampler gpu_sampler;
+
+gpu_sampler *gpu_sampler_new(const char *card_path);
+void gpu_sampler_free(gpu_sampler *);
+void gpu_sampler_read(gpu_sampler *, gpu_sample *);
+
+int amdgpu_dpmclk_parse(const char *text, int *min, int *max);
+
 gpud *gpu_get_device_list();
 int gpud_list_count(gpud *);
 void gpud_list_free(gpud *);
@@ -46,6 +46,7 @@ typedef struct _ProgramParameters	ProgramParameters;
 
 struct _ProgramParameters {
   gint create_report;
+  gint daemon;
   gint force_all_details; /* for create_report, include any "moreinfo" that exists for any item */
   gint show_version;
   gint gui_running;
@@ -66,12 +67,17 @@ struct _ProgramParameters {
   gint     max_bench_results;
   gint     topiccached;
   gchar   *topic;
+  gchar   *select;
   gchar   *run_benchmark;
   gchar   *bench_user_note;
   gchar   *result_format;
   gchar   *path_lib;
   gchar   *path_data;
   gchar   *path_locale;
+  gchar   *path_dtb;
+  gchar   *path_sysfs;
+  gchar   *path_modules; /* holds modules.alias */
+  gchar   *profile_scans; /* trace file, scans are timed when set */
   gchar   *argv0;
   float   scale;
 };
@@ -155,6 +161,8 @@ gfloat		h_sysfs_read_float(const gchar *endpoint, const gchar *entry);
 gint		h_sysfs_read_int(const gchar *endpoint, const gchar *entry);
 gint		h_sysfs_read_hex(const gchar *endpoint, const gchar *entry);
 gchar	       *h_sysfs_read_string(const gchar *endpoint, const gchar *entry);
+/* path under /sys, or under --sysfs when given */
+gchar	       *h_sysfs_path(const gchar *path);
 
 #define SCAN_START()  static gboolean scanned = FALSE; if (reload) scanned = FALSE; if (scanned) {return;} else {DEBUG("SCAN_RELOAD");}
 #define SCAN_END()    scanned = TRUE;
@@ -0,0 +1,64 @@
+/*
+ *    Hardinfo2 - System Information and benchmark
+ *    Copyright (C) 2003-2007 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __INVENTORY_H__
+#define __INVENTORY_H__
+
+#include "hardinfo.h"
+
+/*
+ * Cross-run cache of scanned module entries, stored in
+ * ~/.config/hardinfo2/inventory.cache.
+ *
+ * A module opts in by exporting hi_inventory_token(gint entry), returning a
+ * cheap string that changes whenever the entry must be rescanned (or NULL
+ * if the entry can't be cached). Entries with live "..." fields are never
+ * stored, and nothing is cached with --sysfs or --dtb.
+ *
+ * Only report generation (-r and the structured formats) uses it; the GUI
+ * scans live, as its moreinfo and update fields need the module's own state.
+ */
+
+void   inventory_init(void);
+void   inventory_shutdown(void);
+
+/* "<module file>/<entry number>", NULL if the entry has no token function */
+gchar *inventory_entry_id(ShellModule *module, ShellModuleEntry *entry);
+gchar *inventory_entry_token(ShellModuleEntry *entry);
+
+/* cached data, or NULL if missing or stale */
+gchar *inventory_get(const gchar *id, const gchar *token);
+gchar *inventory_get_moreinfo(const gchar *id, const gchar *tag);
+void   inventory_put(const gchar *id, const gchar *token, const gchar *data);
+void   inventory_put_moreinfo(const gchar *id, const gchar *tag, const gchar *data);
+
+/* token helpers for hi_inventory_token() */
+const gchar *inventory_boot_id(void);
+/* mtime/size/inode of a file, "-" if missing */
+gchar *inventory_stat_token(const gchar *path);
+/* checksum of a file's contents, for /proc files without size or mtime */
+gchar *inventory_file_token(const gchar *path);
+/* checksum of the first fields of every line, for /proc files that also
+ * carry counters (refcounts, states) the entry doesn't show */
+gchar *inventory_fields_token(const gchar *path, gint fields);
+/* checksum of a directory listing, and of dir/<entry>/<file> if file is given */
+gchar *inventory_dir_token(const gchar *dir, const gchar *file);
+/* user and system copies of an .ids file */
+gchar *inventory_ids_token(const gchar *ids_file);
+
+#endif /* __INVENTORY_H__ */
@@ -25,6 +25,14 @@
 
 typedef struct _LoadGraph LoadGraph;
 
+/* the uber graph draws pinned fields on extra lines; the simple GTK2
+ * graph has only line 0, so pinning is not offered there */
+#if GTK_CHECK_VERSION(3, 0, 0)
+#define LG_MAX_LINES 9
+#else
+#define LG_MAX_LINES 1
+#endif
+
 typedef enum {
     LG_COLOR_GREEN = 0x4FB05A,
     LG_COLOR_BLUE  = 0x4F58B0,
@@ -38,6 +46,9 @@ GtkWidget   *load_graph_get_framed(LoadGraph *lg);
 
 void         load_graph_update(LoadGraph *lg, gdouble value);
 void         load_graph_update_ex(LoadGraph *lg, guint line, gdouble value);
+/* replaces a line with already collected samples, oldest first;
+ * line must be < LG_MAX_LINES */
+void         load_graph_set_history(LoadGraph *lg, guint line, const gdouble *values, guint n);
 
 void         load_graph_set_color(LoadGraph *lg, LoadGraphColor color);
 void         load_graph_clear(LoadGraph *lg);
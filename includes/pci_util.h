@@ -45,6 +45,8 @@ typedef struct pcid {
 
     char *driver; /* Kernel driver in use */
     char *driver_list; /* Kernel modules */
+    char *power_state; /* D0, D3hot, ... */
+    char *runtime_status; /* active, suspended, ... */
 
     float pcie_speed_max;   /* GT/s */
     float pcie_speed_curr;  /* GT/s */
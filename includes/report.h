@@ -18,6 +18,7 @@
 
 #ifndef __REPORT_H__
 #define __REPORT_H__
+#include <stdio.h>
 #include <gtk/gtk.h>
 #include <shell.h>
 
@@ -25,6 +26,8 @@ typedef enum {
     REPORT_FORMAT_HTML,
     REPORT_FORMAT_TEXT,
     REPORT_FORMAT_SHELL,
+    REPORT_FORMAT_JSON,
+    REPORT_FORMAT_CBOR,
     N_REPORT_FORMAT
 } ReportFormat;
 
@@ -41,7 +44,8 @@ typedef struct _ReportContext	ReportContext;
 
 struct _ReportContext {
   ShellModuleEntry	*entry;
-  gchar			*output;
+  FILE			*stream;	/* written as generated, or */
+  GString		*output;	/* collected here when stream is NULL */
 
   void (*header)      	(ReportContext *ctx);
   void (*footer)      	(ReportContext *ctx);
@@ -66,6 +70,9 @@ struct _ReportContext {
   GHashTable		*column_titles;
   GHashTable *icon_refs;
   GHashTable *icon_data;
+
+  gchar			*inventory_id;
+  gboolean		inventory_hit;
 };
 
 struct _ReportDialog {
@@ -97,6 +104,12 @@ void		 report_details		(ReportContext *ctx, gchar *key, gchar *value, gchar *det
 
 void             report_create_from_module_list(ReportContext *ctx, GSList *modules);
 gchar           *report_create_from_module_list_format(GSList *modules, ReportFormat format);
+/* any format, written to out while scanning instead of built in memory */
+gboolean         report_create_to_stream(FILE *out, GSList *modules, ReportFormat format);
+/* JSON or CBOR, written to out while scanning; select is a comma separated
+ * list of "module.entry[index].key" paths, any part may be '*' */
+void             report_create_structured(FILE *out, GSList *modules, ReportFormat format,
+                                          const gchar *select);
 
 void		 report_context_free(ReportContext *ctx);
 void             report_module_list_free(GSList *modules);
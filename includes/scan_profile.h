@@ -0,0 +1,45 @@
+/*
+ *    Hardinfo2 - System Information and benchmark
+ *    Copyright (C) 2003-2007 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __SCAN_PROFILE_H__
+#define __SCAN_PROFILE_H__
+
+#include <glib.h>
+
+/* --profile-scans: times every module entry scan, page and spawned
+ * command, then prints a table to stderr and writes a Chrome
+ * trace-event file (chrome://tracing, Perfetto) when the program exits */
+
+typedef enum {
+    SCAN_PROFILE_SCAN,   /* ShellModuleEntry scan_func */
+    SCAN_PROFILE_PAGE,   /* ShellModuleEntry func */
+    SCAN_PROFILE_SPAWN,  /* hardinfo_spawn_command_line_sync() */
+    SCAN_PROFILE_N_KINDS
+} ScanProfileKind;
+
+typedef struct _ScanProfileEvent ScanProfileEvent;
+
+void scan_profile_init(const gchar *trace_file);
+gboolean scan_profile_enabled(void);
+
+/* both are no-ops returning/taking NULL while profiling is off; times
+ * are inclusive, so a scan that triggers another one contains it */
+ScanProfileEvent *scan_profile_begin(ScanProfileKind kind, const gchar *name);
+void scan_profile_end(ScanProfileEvent *ev);
+
+#endif /* __SCAN_PROFILE_H__ */
@@ -156,6 +156,7 @@ struct _ShellModuleMethod {
 
 struct _ShellModuleEntry {
     gchar		*name;
+    const gchar		*msgid;		/* name before translation */
     GdkPixbuf		*icon;
     gchar		*icon_file;
     gboolean		 selected;
@@ -168,6 +169,7 @@ struct _ShellModuleEntry {
     gchar		*(*fieldfunc) (gchar * entry);
     gchar 		*(*morefunc)  (gchar * entry);
     gchar		*(*notefunc)  (gint entry);
+    gchar		*(*tokenfunc) (gint entry);
 };
 
 struct _ShellFieldUpdate {
@@ -26,6 +26,7 @@ struct _Socket {
 };
 
 Socket *sock_connect(gchar * host, gint port);
+Socket *sock_connect_unix(const gchar * path);
 int	sock_write(Socket * s, gchar * str);
 int	sock_read(Socket * s, gchar * buffer, gint size);
 void	sock_close(Socket * s);
@@ -0,0 +1,94 @@
+/*
+ *    HardInfo - Displays System Information
+ *    Copyright (C) 2003-2007 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __SYNC_UTIL_H__
+#define __SYNC_UTIL_H__
+
+#include <glib.h>
+
+/* RFC 3229 delta encoding: with A-IM the server may answer 226 IM Used
+ * and send a line based delta (diff -n, RCS format) against the copy
+ * named by If-None-Match instead of the whole file */
+#define SYNC_DELTA_IM "rcsdiff"
+#define SYNC_STATUS_IM_USED 226
+#define SYNC_STATUS_NOT_MODIFIED 304
+
+/* Bodies are decoded by sync_decode_body() rather than by libsoup, so
+ * zstd works on every libsoup version */
+#if(HARDINFO2_SYNC_ZSTD)
+#define SYNC_ACCEPT_ENCODING "zstd, gzip"
+#else
+#define SYNC_ACCEPT_ENCODING "gzip"
+#endif
+
+/* A synced file and its group in sync-cache.conf, which keeps the ETag,
+ * Last-Modified, url and size it was stored with */
+typedef struct {
+    GKeyFile *meta;
+    const gchar *meta_path;     /* where meta is saved */
+    const gchar *name;          /* group in meta */
+    const gchar *uri;
+    const gchar *path;          /* the stored copy */
+    gboolean upload;            /* a POST, never conditional */
+} SyncCacheFile;
+
+/* The response headers sync_cache_store() looks at, NULL when absent */
+typedef struct {
+    guint status;
+    const gchar *content_encoding;
+    const gchar *im;
+    const gchar *etag;
+    const gchar *last_modified;
+} SyncResponse;
+
+typedef enum {
+    SYNC_STORE_FAILED,          /* error is set */
+    SYNC_STORE_NOT_MODIFIED,
+    SYNC_STORE_STORED,
+    SYNC_STORE_BAD_STATUS,
+    SYNC_STORE_UNEXPECTED_DELTA,
+    SYNC_STORE_INVALID_DELTA,
+} SyncStoreResult;
+
+typedef void (*SyncHeaderFunc)(const gchar *name, const gchar *value, gpointer data);
+
+/* a nul terminated copy of the body, undoing any Content-Encoding; zstd
+ * only when built with HARDINFO2_SYNC_ZSTD */
+gchar *sync_decode_body(const gchar *encoding, const guint8 *buf, gsize len,
+                        gsize *out_len, GError **error);
+
+/* Apply a diff -n (RCS) delta to base, NULL if it doesn't fit:
+ *   dL N  delete N lines starting at line L
+ *   aL N  insert the N lines that follow after line L
+ * line numbers refer to base and increase through the delta */
+gchar *sync_apply_line_delta(const gchar *base, gsize base_len,
+                             const gchar *delta, gsize delta_len, gsize *out_len);
+
+/* Call set for each header a request for f sends: Accept-Encoding, and
+ * the validators (and A-IM for .ids files) only while f->path is still
+ * the copy they describe */
+void sync_cache_request_headers(const SyncCacheFile *f, SyncHeaderFunc set, gpointer data);
+
+/* Store the response to a request for f: nothing on 304, the patched
+ * copy on 226, the decoded body on any other 2xx. f->path and
+ * f->meta_path are replaced atomically, and only when the whole
+ * response could be used. */
+SyncStoreResult sync_cache_store(const SyncCacheFile *f, const SyncResponse *r,
+                                 const guint8 *buf, gsize len, GError **error);
+
+#endif /* __SYNC_UTIL_H__ */
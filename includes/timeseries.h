@@ -0,0 +1,55 @@
+/*
+ *    Hardinfo2 - System Information and benchmark
+ *    Copyright (C) 2003-2007 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __TIMESERIES_H__
+#define __TIMESERIES_H__
+
+#include <glib.h>
+
+/* 10 minutes of samples at the usual UpdateInterval of 1000ms */
+#define TIME_SERIES_DEFAULT_SIZE 600
+
+typedef struct _TimeSeries      TimeSeries;
+typedef struct _TimeSeriesStore TimeSeriesStore;
+
+/* fixed size ring of numeric samples, oldest sample is overwritten */
+struct _TimeSeries {
+    gdouble *values;
+    guint    size;  /* capacity */
+    guint    len;   /* valid samples, <= size */
+    guint    head;  /* next write position */
+};
+
+TimeSeries *time_series_new(guint size);
+void        time_series_free(TimeSeries *ts);
+void        time_series_clear(TimeSeries *ts);
+void        time_series_append(TimeSeries *ts, gdouble value);
+/* i = 0 is the oldest sample still in the ring */
+gdouble     time_series_get(const TimeSeries *ts, guint i);
+gdouble     time_series_last(const TimeSeries *ts);
+/* copies up to max of the newest samples, oldest first; returns count */
+guint       time_series_copy(const TimeSeries *ts, gdouble *out, guint max);
+
+/* named series, created on first append */
+TimeSeriesStore *time_series_store_new(guint size);
+void             time_series_store_free(TimeSeriesStore *store);
+void             time_series_store_clear(TimeSeriesStore *store);
+void             time_series_store_append(TimeSeriesStore *store, const gchar *name, gdouble value);
+TimeSeries      *time_series_store_lookup(TimeSeriesStore *store, const gchar *name);
+
+#endif /* __TIMESERIES_H__ */
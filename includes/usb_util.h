@@ -43,6 +43,9 @@ typedef struct usbd {
 
     int speed_mbs;
 
+    char *driver;
+    char *power_state; /* runtime pm: active, suspended, ... */
+
     vendor_list vendors;
 
     gboolean user_scan; /* not scanned as root */
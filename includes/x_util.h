@@ -83,6 +83,9 @@ typedef struct {
     int px_offset_y;
     int mm_width;
     int mm_height;
+    int refresh_mhz; /* current mode, 0 if unknown */
+    int edid_len;
+    unsigned char *edid; /* raw EDID blob or NULL, owned by xrr_info */
 } x_output;
 
 typedef struct {
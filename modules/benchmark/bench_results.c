@@ -317,6 +317,27 @@ static gchar *get_cpu_desc(JsonObject *machine)
     return ret;
 }
 
+/* first revision of a benchmark that results are comparable with; older
+ * results are still listed, with the same note as old HardInfo ones */
+static const struct {
+    const char *name;
+    int revision;
+} bench_min_revision[] = {
+    { "FPU FFT", 4 },   /* work per run changed */
+    { NULL, 0 }
+};
+
+static gboolean bench_revision_is_legacy(const gchar *bench_name, int revision)
+{
+    int i;
+
+    for (i = 0; bench_min_revision[i].name; i++) {
+        if (g_str_equal(bench_name, bench_min_revision[i].name))
+            return revision >= 0 && revision < bench_min_revision[i].revision;
+    }
+    return FALSE;
+}
+
 bench_result *bench_result_benchmarkjson(const gchar *bench_name,
                                          JsonNode *node)
 {
@@ -338,6 +359,8 @@ bench_result *bench_result_benchmarkjson(const gchar *bench_name,
         .threads_used = json_get_int(machine, "UsedThreads"),
         .revision = json_get_int(machine, "BenchmarkVersion"),//Revision
     };
+    if (bench_revision_is_legacy(bench_name, b->bvalue.revision))
+        b->legacy = TRUE;
 
     snprintf(b->bvalue.extra, sizeof(b->bvalue.extra), "%s",
              json_get_string(machine, "ExtraInfo"));
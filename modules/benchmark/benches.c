@@ -50,12 +50,19 @@ void SN(gboolean reload) { \
 BENCH_SIMPLE(BENCHMARK_FIB, "CPU Fibonacci", benchmark_fib, 1);
 BENCH_SIMPLE(BENCHMARK_NQUEENS, "CPU N-Queens", benchmark_nqueens, 1);
 BENCH_SIMPLE(BENCHMARK_FFT, "FPU FFT", benchmark_fft, 1);
+BENCH_SIMPLE(BENCHMARK_FFT_SINGLE, "FPU FFT (Single-thread)", benchmark_fft_single, 1);
 BENCH_SIMPLE(BENCHMARK_RAYTRACE, "FPU Raytracing (Single-thread)", benchmark_raytrace, 1);
+BENCH_SIMPLE(BENCHMARK_RAYTRACE_THREADS, "FPU Raytracing (Multi-thread)", benchmark_raytrace_threads, 1);
 BENCH_SIMPLE(BENCHMARK_BLOWFISH_SINGLE, "CPU Blowfish (Single-thread)", benchmark_bfish_single, 1);
 BENCH_SIMPLE(BENCHMARK_BLOWFISH_THREADS, "CPU Blowfish (Multi-thread)", benchmark_bfish_threads, 1);
 BENCH_SIMPLE(BENCHMARK_BLOWFISH_CORES, "CPU Blowfish (Multi-core)", benchmark_bfish_cores, 1);
 BENCH_SIMPLE(BENCHMARK_ZLIB, "CPU Zlib", benchmark_zlib, 1);
+BENCH_SIMPLE(BENCHMARK_COMPRESS, BENCH_COMPRESS_NAME, benchmark_compress, 1);
 BENCH_SIMPLE(BENCHMARK_CRYPTOHASH, "CPU CryptoHash", benchmark_cryptohash, 1);
+BENCH_SIMPLE(BENCHMARK_SHA256, "CPU SHA-256", benchmark_sha256, 1);
+BENCH_SIMPLE(BENCHMARK_BLAKE3, "CPU BLAKE3", benchmark_blake3, 1);
+BENCH_SIMPLE(BENCHMARK_AES_CTR, "CPU AES-128-CTR", benchmark_aes_ctr, 1);
+BENCH_SIMPLE(BENCHMARK_CHACHA20, "CPU ChaCha20", benchmark_chacha20, 1);
 BENCH_SIMPLE(BENCHMARK_IPERF3_SINGLE, "Internal Network Speed", benchmark_iperf3_single, 1);
 #if(HARDINFO2_QT5)
 BENCH_SIMPLE(BENCHMARK_OPENGL, "GPU OpenGL Drawing", benchmark_opengl, 1);
@@ -102,11 +109,18 @@ static char *entries_english_name[] = {
             "CPU Blowfish (Multi-thread)",
             "CPU Blowfish (Multi-core)",
             "CPU Zlib",
+            BENCH_COMPRESS_NAME,
             "CPU CryptoHash",
+            "CPU SHA-256",
+            "CPU BLAKE3",
+            "CPU AES-128-CTR",
+            "CPU ChaCha20",
             "CPU Fibonacci",
             "CPU N-Queens",
             "FPU FFT",
+            "FPU FFT (Single-thread)",
             "FPU Raytracing (Single-thread)",
+            "FPU Raytracing (Multi-thread)",
             "Internal Network Speed",
             "SysBench CPU (Single-thread)",
             "SysBench CPU (Multi-thread)",
@@ -132,11 +146,18 @@ static int entries_btimer[] = {
     7,//"CPU Blowfish (Multi-thread)",
     7,//"CPU Blowfish (Multi-core)",
     7,//"CPU Zlib",
+    14,//BENCH_COMPRESS_NAME,
     5,//"CPU CryptoHash",
+    5,//"CPU SHA-256",
+    5,//"CPU BLAKE3",
+    5,//"CPU AES-128-CTR",
+    5,//"CPU ChaCha20",
     5,//"CPU Fibonacci",
     5,//"CPU N-Queens",
     5,//"FPU FFT",
+    5,//"FPU FFT (Single-thread)",
     5,//"FPU Raytracing (Single-thread)",
+    5,//"FPU Raytracing (Multi-thread)",
     10,//"Internal Network Speed",
     7,//"SysBench CPU (Single-thread)",
     7,//"SysBench CPU (Multi-thread)",
@@ -190,6 +211,14 @@ static ModuleEntry entries[] = {
             scan_benchmark_zlib,
             MODULE_FLAG_BENCHMARK,
         },
+    [BENCHMARK_COMPRESS] =
+        {
+            N_(BENCH_COMPRESS_NAME),
+            "compress.svg",
+            callback_benchmark_compress,
+            scan_benchmark_compress,
+            MODULE_FLAG_BENCHMARK,
+        },
     [BENCHMARK_CRYPTOHASH] =
         {
             N_("CPU CryptoHash"),
@@ -198,6 +227,38 @@ static ModuleEntry entries[] = {
             scan_benchmark_cryptohash,
             MODULE_FLAG_BENCHMARK,
         },
+    [BENCHMARK_SHA256] =
+        {
+            N_("CPU SHA-256"),
+            "cryptohash.svg",
+            callback_benchmark_sha256,
+            scan_benchmark_sha256,
+            MODULE_FLAG_BENCHMARK,
+        },
+    [BENCHMARK_BLAKE3] =
+        {
+            N_("CPU BLAKE3"),
+            "cryptohash.svg",
+            callback_benchmark_blake3,
+            scan_benchmark_blake3,
+            MODULE_FLAG_BENCHMARK,
+        },
+    [BENCHMARK_AES_CTR] =
+        {
+            N_("CPU AES-128-CTR"),
+            "cryptohash.svg",
+            callback_benchmark_aes_ctr,
+            scan_benchmark_aes_ctr,
+            MODULE_FLAG_BENCHMARK,
+        },
+    [BENCHMARK_CHACHA20] =
+        {
+            N_("CPU ChaCha20"),
+            "cryptohash.svg",
+            callback_benchmark_chacha20,
+            scan_benchmark_chacha20,
+            MODULE_FLAG_BENCHMARK,
+        },
     [BENCHMARK_FIB] =
         {
             N_("CPU Fibonacci"),
@@ -222,6 +283,14 @@ static ModuleEntry entries[] = {
             scan_benchmark_fft,
             MODULE_FLAG_BENCHMARK,
         },
+    [BENCHMARK_FFT_SINGLE] =
+        {
+            N_("FPU FFT (Single-thread)"),
+            "fft.svg",
+            callback_benchmark_fft_single,
+            scan_benchmark_fft_single,
+            MODULE_FLAG_BENCHMARK,
+        },
     [BENCHMARK_RAYTRACE] =
         {
             N_("FPU Raytracing (Single-thread)"),
@@ -230,6 +299,14 @@ static ModuleEntry entries[] = {
             scan_benchmark_raytrace,
             MODULE_FLAG_BENCHMARK,
         },
+    [BENCHMARK_RAYTRACE_THREADS] =
+        {
+            N_("FPU Raytracing (Multi-thread)"),
+            "raytrace.svg",
+            callback_benchmark_raytrace_threads,
+            scan_benchmark_raytrace_threads,
+            MODULE_FLAG_BENCHMARK,
+        },
     [BENCHMARK_IPERF3_SINGLE] =
         {
             N_("Internal Network Speed"),
@@ -351,6 +428,10 @@ const gchar *hi_note_func(gint entry)
     case BENCHMARK_MEMORY_DUAL:
     case BENCHMARK_MEMORY_QUAD:
     case BENCHMARK_MEMORY_ALL:
+    case BENCHMARK_SHA256:
+    case BENCHMARK_BLAKE3:
+    case BENCHMARK_AES_CTR:
+    case BENCHMARK_CHACHA20:
         return _("Results in MiB/second. Higher is better.");
     case BENCHMARK_IPERF3_SINGLE:
         return _("Results in Gbits/s. Higher is better.");
@@ -360,13 +441,16 @@ const gchar *hi_note_func(gint entry)
     case BENCHMARK_BLOWFISH_CORES:
     case BENCHMARK_ZLIB:
     case BENCHMARK_FFT:
+    case BENCHMARK_FFT_SINGLE:
     case BENCHMARK_RAYTRACE:
+    case BENCHMARK_RAYTRACE_THREADS:
     case BENCHMARK_FIB:
     case BENCHMARK_NQUEENS:
         return _("Results in HIMarks. Higher is better.");
     case BENCHMARK_GUI:
         return _("Results in HIMarks. Higher is better.\n"
 		 "Many Desktop Environments only uses software.");
+    case BENCHMARK_COMPRESS:
     case BENCHMARK_STORAGE:
     case BENCHMARK_CACHEMEM:
         return _("Results in MB/s. Higher is better.");
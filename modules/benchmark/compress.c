@@ -0,0 +1,449 @@
+/*
+ *    Hardinfo2 - System Information and benchmark
+ *    Copyright (C) 2003-2007 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/* Compress and decompress a text, a binary and an incompressible corpus at
+ * levels 1, 6 and 9 on all threads. Every thread keeps its compressor state
+ * and buffers for the whole run, so only the codec is timed.
+ * Result is the geometric mean of the six MB/s figures, extra has them per
+ * level as compress/decompress. */
+
+#include <glib.h>
+#include <math.h>
+#include <string.h>
+
+#include "benchmark.h"
+
+#if HARDINFO2_COMPRESS_ZSTD
+#include <zstd.h>
+#elif HARDINFO2_COMPRESS_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#else
+#include <zlib.h>
+#endif
+
+/* if anything changes in this block, increment revision */
+#define BENCH_REVISION 1
+#define CORPUS_SIZE 131072
+#define CORPUS_SEED 0x48617264496e666fULL
+#define CRUNCH_TIME 2
+
+static const int levels[] = { 1, 6, 9 };
+#define N_LEVELS G_N_ELEMENTS(levels)
+
+enum {
+    CORPUS_TEXT,
+    CORPUS_BINARY,
+    CORPUS_RANDOM,
+    N_CORPUS
+};
+
+/* backend: state is set up once per thread and level and reused */
+
+#if HARDINFO2_COMPRESS_ZSTD
+
+typedef struct {
+    ZSTD_CCtx *cctx;
+    ZSTD_DCtx *dctx;
+    int level;
+} CompressState;
+
+static gchar *compress_backend(void)
+{
+    return g_strdup_printf("zstd %s", ZSTD_versionString());
+}
+
+static gsize compress_bound(gsize len)
+{
+    return ZSTD_compressBound(len);
+}
+
+static gboolean compress_state_init(CompressState *s, int level)
+{
+    s->level = level;
+    s->cctx = ZSTD_createCCtx();
+    s->dctx = ZSTD_createDCtx();
+    return s->cctx && s->dctx;
+}
+
+static void compress_state_free(CompressState *s)
+{
+    ZSTD_freeCCtx(s->cctx);
+    ZSTD_freeDCtx(s->dctx);
+}
+
+static gsize compress_block(CompressState *s, guchar *dst, gsize dst_len,
+                            const guchar *src, gsize len)
+{
+    size_t r = ZSTD_compressCCtx(s->cctx, dst, dst_len, src, len, s->level);
+    return ZSTD_isError(r) ? 0 : r;
+}
+
+static gsize decompress_block(CompressState *s, guchar *dst, gsize dst_len,
+                              const guchar *src, gsize len)
+{
+    size_t r = ZSTD_decompressDCtx(s->dctx, dst, dst_len, src, len);
+    return ZSTD_isError(r) ? 0 : r;
+}
+
+#elif HARDINFO2_COMPRESS_LZ4
+
+/* level 1 is plain LZ4, higher levels are LZ4HC */
+typedef struct {
+    void *state;
+    int level;
+} CompressState;
+
+static gchar *compress_backend(void)
+{
+    return g_strdup_printf("lz4 %s", LZ4_versionString());
+}
+
+static gsize compress_bound(gsize len)
+{
+    return LZ4_compressBound(len);
+}
+
+static gboolean compress_state_init(CompressState *s, int level)
+{
+    s->level = level;
+    s->state = g_malloc(level > 1 ? LZ4_sizeofStateHC() : LZ4_sizeofState());
+    return s->state != NULL;
+}
+
+static void compress_state_free(CompressState *s)
+{
+    g_free(s->state);
+}
+
+static gsize compress_block(CompressState *s, guchar *dst, gsize dst_len,
+                            const guchar *src, gsize len)
+{
+    int r;
+
+    if (s->level > 1)
+        r = LZ4_compress_HC_extStateHC(s->state, (const char *)src, (char *)dst,
+                                       len, dst_len, s->level);
+    else
+        r = LZ4_compress_fast_extState(s->state, (const char *)src, (char *)dst,
+                                       len, dst_len, 1);
+    return r > 0 ? (gsize)r : 0;
+}
+
+static gsize decompress_block(CompressState *s, guchar *dst, gsize dst_len,
+                              const guchar *src, gsize len)
+{
+    int r = LZ4_decompress_safe((const char *)src, (char *)dst, len, dst_len);
+    return r > 0 ? (gsize)r : 0;
+}
+
+#else
+
+typedef struct {
+    z_stream def, inf;
+    gboolean def_ok, inf_ok;
+} CompressState;
+
+static gchar *compress_backend(void)
+{
+    return g_strdup_printf("zlib %s", zlibVersion());
+}
+
+static gsize compress_bound(gsize len)
+{
+    return compressBound(len);
+}
+
+static gboolean compress_state_init(CompressState *s, int level)
+{
+    memset(s, 0, sizeof(*s));
+    s->def_ok = deflateInit(&s->def, level) == Z_OK;
+    s->inf_ok = inflateInit(&s->inf) == Z_OK;
+    return s->def_ok && s->inf_ok;
+}
+
+static void compress_state_free(CompressState *s)
+{
+    if (s->def_ok)
+        deflateEnd(&s->def);
+    if (s->inf_ok)
+        inflateEnd(&s->inf);
+}
+
+static gsize compress_block(CompressState *s, guchar *dst, gsize dst_len,
+                            const guchar *src, gsize len)
+{
+    deflateReset(&s->def);
+    s->def.next_in = (Bytef *)src;
+    s->def.avail_in = len;
+    s->def.next_out = dst;
+    s->def.avail_out = dst_len;
+    if (deflate(&s->def, Z_FINISH) != Z_STREAM_END)
+        return 0;
+    return s->def.total_out;
+}
+
+static gsize decompress_block(CompressState *s, guchar *dst, gsize dst_len,
+                              const guchar *src, gsize len)
+{
+    inflateReset(&s->inf);
+    s->inf.next_in = (Bytef *)src;
+    s->inf.avail_in = len;
+    s->inf.next_out = dst;
+    s->inf.avail_out = dst_len;
+    if (inflate(&s->inf, Z_FINISH) != Z_STREAM_END)
+        return 0;
+    return s->inf.total_out;
+}
+
+#endif
+
+/* corpus, the same bytes on every machine for a given seed */
+
+static guint32 corpus_rand(guint64 *s)
+{
+    /* xorshift64* */
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return (guint32)((*s * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+static void corpus_put_le32(guchar *p, guint32 v)
+{
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+/* log lines, word frequencies skewed towards the start of the list */
+static void corpus_text(guchar *buf, gsize len, guint64 *seed)
+{
+    static const char *words[] = {
+        "the", "of", "to", "and", "a", "in", "is", "for", "on", "with",
+        "device", "connected", "link", "up", "down", "error", "timeout",
+        "request", "response", "user", "session", "opened", "closed",
+        "started", "stopped", "service", "interface", "address", "port",
+        "packet", "received", "sent", "retry", "queue", "buffer", "flush",
+        "cache", "miss", "hit", "disk", "write", "read", "block", "sector",
+        "temperature", "voltage", "fan", "speed", "memory", "allocated",
+    };
+    static const char *hosts[] = { "alpha", "bravo", "charlie", "delta" };
+    static const char *daemons[] = { "kernel", "sshd", "systemd", "cron", "dhcpd", "smartd" };
+    gsize pos = 0;
+    guint ms = 0;
+
+    while (pos < len) {
+        gchar line[256];
+        int n, w, nwords = 4 + corpus_rand(seed) % 12;
+        /* one draw per statement, argument order is unspecified */
+        guint host = corpus_rand(seed) % G_N_ELEMENTS(hosts);
+        guint daemon = corpus_rand(seed) % G_N_ELEMENTS(daemons);
+        guint pid = 1000 + corpus_rand(seed) % 200;
+
+        ms += corpus_rand(seed) % 5000;
+        n = g_snprintf(line, sizeof(line), "%02u:%02u:%02u.%03u %s %s[%u]:",
+                       ms / 3600000 % 24, ms / 60000 % 60, ms / 1000 % 60, ms % 1000,
+                       hosts[host], daemons[daemon], pid);
+        for (w = 0; w < nwords && n < (int)sizeof(line) - 32; w++) {
+            guint a = corpus_rand(seed) % G_N_ELEMENTS(words);
+            guint b = corpus_rand(seed) % G_N_ELEMENTS(words);
+            n += g_snprintf(line + n, sizeof(line) - n, " %s", words[MIN(a, b)]);
+        }
+        line[n++] = '\n';
+
+        n = MIN((gsize)n, len - pos);
+        memcpy(buf + pos, line, n);
+        pos += n;
+    }
+}
+
+/* 32-byte sensor records: counters, slowly moving readings, zero padding */
+static void corpus_binary(guchar *buf, gsize len, guint64 *seed)
+{
+    guint32 id = 0, stamp = 1700000000, reading[4] = { 5000, 12000, 3300, 900 };
+    gsize pos;
+    int i;
+
+    memset(buf, 0, len);
+    for (pos = 0; pos + 32 <= len; pos += 32) {
+        stamp += 1 + corpus_rand(seed) % 3;
+        corpus_put_le32(buf + pos, id++);
+        corpus_put_le32(buf + pos + 4, stamp);
+        for (i = 0; i < 4; i++) {
+            reading[i] += (gint32)(corpus_rand(seed) % 21) - 10;
+            corpus_put_le32(buf + pos + 8 + i * 4, reading[i]);
+        }
+        buf[pos + 24] = corpus_rand(seed) % 8 == 0;
+    }
+}
+
+/* stands in for media and archives, which don't compress again */
+static void corpus_random(guchar *buf, gsize len, guint64 *seed)
+{
+    gsize pos;
+
+    for (pos = 0; pos + 4 <= len; pos += 4)
+        corpus_put_le32(buf + pos, corpus_rand(seed));
+}
+
+typedef struct {
+    CompressState state;
+    guchar *packed;   /* compress output */
+    guchar *unpacked; /* decompress output */
+} CompressThread;
+
+typedef struct {
+    guchar *corpus[N_CORPUS];
+    guchar *packed[N_CORPUS]; /* reference compressed corpus, read by all threads */
+    gsize packed_len[N_CORPUS];
+    gsize bound;
+    CompressThread *threads;
+    gint errors;
+} CompressTask;
+
+static gpointer compress_for(void *in_data, gint thread_number)
+{
+    CompressTask *task = (CompressTask *)in_data;
+    CompressThread *t = &task->threads[thread_number];
+    int c;
+
+    for (c = 0; c < N_CORPUS; c++) {
+        if (!compress_block(&t->state, t->packed, task->bound, task->corpus[c], CORPUS_SIZE))
+            g_atomic_int_inc(&task->errors);
+    }
+
+    return NULL;
+}
+
+static gpointer decompress_for(void *in_data, gint thread_number)
+{
+    CompressTask *task = (CompressTask *)in_data;
+    CompressThread *t = &task->threads[thread_number];
+    int c;
+
+    for (c = 0; c < N_CORPUS; c++) {
+        if (decompress_block(&t->state, t->unpacked, CORPUS_SIZE,
+                             task->packed[c], task->packed_len[c]) != CORPUS_SIZE)
+            g_atomic_int_inc(&task->errors);
+    }
+
+    return NULL;
+}
+
+/* MB/s over the whole corpus set */
+static double compress_rate(bench_value r)
+{
+    if (r.result <= 0 || r.elapsed_time <= 0)
+        return 0;
+    return r.result * N_CORPUS * CORPUS_SIZE / 1000000.0 / r.elapsed_time;
+}
+
+void
+benchmark_compress(void)
+{
+    int cpu_procs, cpu_cores, cpu_threads, cpu_nodes;
+    bench_value r = EMPTY_BENCH_VALUE, rc, rd;
+    CompressTask task;
+    GString *rates;
+    gchar *backend, *d;
+    guchar *all;
+    guint64 seed = CORPUS_SEED;
+    double log_sum = 0;
+    int c, t, threads_used = 0;
+    gsize l;
+
+    shell_view_set_enabled(FALSE);
+    shell_status_update("Running Compression benchmark...");
+
+    cpu_procs_cores_threads_nodes(&cpu_procs, &cpu_cores, &cpu_threads, &cpu_nodes);
+    memset(&task, 0, sizeof(task));
+    task.bound = compress_bound(CORPUS_SIZE);
+
+    all = g_malloc(N_CORPUS * CORPUS_SIZE);
+    for (c = 0; c < N_CORPUS; c++) {
+        task.corpus[c] = all + c * CORPUS_SIZE;
+        task.packed[c] = g_malloc(task.bound);
+    }
+    corpus_text(task.corpus[CORPUS_TEXT], CORPUS_SIZE, &seed);
+    corpus_binary(task.corpus[CORPUS_BINARY], CORPUS_SIZE, &seed);
+    corpus_random(task.corpus[CORPUS_RANDOM], CORPUS_SIZE, &seed);
+    d = md5_digest_str((const char *)all, N_CORPUS * CORPUS_SIZE);
+
+    task.threads = g_new0(CompressThread, cpu_threads);
+    for (t = 0; t < cpu_threads; t++) {
+        task.threads[t].packed = g_malloc(task.bound);
+        task.threads[t].unpacked = g_malloc(CORPUS_SIZE);
+    }
+
+    backend = compress_backend();
+    rates = g_string_new(NULL);
+    for (l = 0; l < N_LEVELS; l++) {
+        CompressState ref;
+        gboolean ok = TRUE;
+
+        /* reference data for decompression, checked once before timing */
+        ok = compress_state_init(&ref, levels[l]);
+        for (c = 0; ok && c < N_CORPUS; c++) {
+            task.packed_len[c] = compress_block(&ref, task.packed[c], task.bound,
+                                                task.corpus[c], CORPUS_SIZE);
+            ok = task.packed_len[c]
+                && decompress_block(&ref, task.threads[0].unpacked, CORPUS_SIZE,
+                                    task.packed[c], task.packed_len[c]) == CORPUS_SIZE
+                && memcmp(task.threads[0].unpacked, task.corpus[c], CORPUS_SIZE) == 0;
+        }
+        compress_state_free(&ref);
+        for (t = 0; ok && t < cpu_threads; t++)
+            ok = compress_state_init(&task.threads[t].state, levels[l]);
+        if (!ok) {
+            while (--t >= 0)
+                compress_state_free(&task.threads[t].state);
+            task.errors++;
+            break;
+        }
+
+        rc = benchmark_crunch_for(CRUNCH_TIME, 0, compress_for, &task);
+        rd = benchmark_crunch_for(CRUNCH_TIME, 0, decompress_for, &task);
+        for (t = 0; t < cpu_threads; t++)
+            compress_state_free(&task.threads[t].state);
+
+        threads_used = rc.threads_used;
+        log_sum += log(MAX(compress_rate(rc), 0.001)) + log(MAX(compress_rate(rd), 0.001));
+        g_string_append_printf(rates, " %d:%.0f/%.0f", levels[l],
+                               compress_rate(rc), compress_rate(rd));
+    }
+
+    if (l == N_LEVELS && !task.errors) {
+        r.result = exp(log_sum / (N_LEVELS * 2));
+        r.threads_used = threads_used;
+        r.elapsed_time = N_LEVELS * 2 * CRUNCH_TIME;
+    }
+    r.revision = BENCH_REVISION;
+    snprintf(r.extra, 255, "%s,%s, d:%s, e:%d", backend, rates->str, d, task.errors);
+    bench_results[BENCHMARK_COMPRESS] = r;
+
+    g_string_free(rates, TRUE);
+    g_free(backend);
+    g_free(d);
+    for (t = 0; t < cpu_threads; t++) {
+        g_free(task.threads[t].packed);
+        g_free(task.threads[t].unpacked);
+    }
+    g_free(task.threads);
+    for (c = 0; c < N_CORPUS; c++)
+        g_free(task.packed[c]);
+    g_free(all);
+}
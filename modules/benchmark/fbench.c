@@ -234,49 +234,20 @@
 #include <math.h>
 #endif
 
+#include "fbench.h"
+
 #define cot(x) (1.0 / tan(x))
 
 #define TRUE  1
 #define FALSE 0
 
-#define max_surfaces 10
-
-/*  Local variables  */
+/*  Local variables are in FBench, so every thread can trace its own
+    lens  */
 
 /*static char tbfr[132];*/
 
-static short current_surfaces;
-static short paraxial;
-
-static double clear_aperture;
-
-static double aberr_lspher;
-static double aberr_osc;
-static double aberr_lchrom;
-
-static double max_lspher;
-static double max_osc;
-static double max_lchrom;
-
-static double radius_of_curvature;
-static double object_distance;
-static double ray_height;
-static double axis_slope_angle;
-static double from_index;
-static double to_index;
-
-static double spectral_line[9];
-static double s[max_surfaces][5];
-static double od_sa[2][2];
-
 				/*static char outarr[8][80];*//* Computed output of program goes here */
 
-static int itercount;			/* The iteration counter for the main loop
-				   in the program is made global so that
-				   the compiler should not be allowed to
-				   optimise out the loop over the ray
-				   tracing code. */
-
 #define ITERATIONS 300
 static int niter = ITERATIONS;		/* Iteration counter */
 
@@ -584,7 +555,7 @@ double x;
 
 */
 
-static void transit_surface()
+static void transit_surface(FBench *fb)
 {
     double iang,		/* Incidence angle */
      rang,			/* Refraction angle */
@@ -592,153 +563,176 @@ static void transit_surface()
      rang_sin,			/* Refraction angle sin */
      old_axis_slope_angle, sagitta;
 
-    if (paraxial) {
-	if (radius_of_curvature != 0.0) {
-	    if (object_distance == 0.0) {
-		axis_slope_angle = 0.0;
-		iang_sin = ray_height / radius_of_curvature;
+    if (fb->paraxial) {
+	if (fb->radius_of_curvature != 0.0) {
+	    if (fb->object_distance == 0.0) {
+		fb->axis_slope_angle = 0.0;
+		iang_sin = fb->ray_height / fb->radius_of_curvature;
 	    } else
-		iang_sin = ((object_distance -
-			     radius_of_curvature) / radius_of_curvature) *
-		    axis_slope_angle;
-
-	    rang_sin = (from_index / to_index) * iang_sin;
-	    old_axis_slope_angle = axis_slope_angle;
-	    axis_slope_angle = axis_slope_angle + iang_sin - rang_sin;
-	    if (object_distance != 0.0)
-		ray_height = object_distance * old_axis_slope_angle;
-	    object_distance = ray_height / axis_slope_angle;
+		iang_sin = ((fb->object_distance -
+			     fb->radius_of_curvature) / fb->radius_of_curvature) *
+		    fb->axis_slope_angle;
+
+	    rang_sin = (fb->from_index / fb->to_index) * iang_sin;
+	    old_axis_slope_angle = fb->axis_slope_angle;
+	    fb->axis_slope_angle = fb->axis_slope_angle + iang_sin - rang_sin;
+	    if (fb->object_distance != 0.0)
+		fb->ray_height = fb->object_distance * old_axis_slope_angle;
+	    fb->object_distance = fb->ray_height / fb->axis_slope_angle;
 	    return;
 	}
-	object_distance = object_distance * (to_index / from_index);
-	axis_slope_angle = axis_slope_angle * (from_index / to_index);
+	fb->object_distance = fb->object_distance * (fb->to_index / fb->from_index);
+	fb->axis_slope_angle = fb->axis_slope_angle * (fb->from_index / fb->to_index);
 	return;
     }
 
-    if (radius_of_curvature != 0.0) {
-	if (object_distance == 0.0) {
-	    axis_slope_angle = 0.0;
-	    iang_sin = ray_height / radius_of_curvature;
+    if (fb->radius_of_curvature != 0.0) {
+	if (fb->object_distance == 0.0) {
+	    fb->axis_slope_angle = 0.0;
+	    iang_sin = fb->ray_height / fb->radius_of_curvature;
 	} else {
-	    iang_sin = ((object_distance -
-			 radius_of_curvature) / radius_of_curvature) *
-		sin(axis_slope_angle);
+	    iang_sin = ((fb->object_distance -
+			 fb->radius_of_curvature) / fb->radius_of_curvature) *
+		sin(fb->axis_slope_angle);
 	}
 	iang = asin(iang_sin);
-	rang_sin = (from_index / to_index) * iang_sin;
-	old_axis_slope_angle = axis_slope_angle;
-	axis_slope_angle = axis_slope_angle + iang - asin(rang_sin);
+	rang_sin = (fb->from_index / fb->to_index) * iang_sin;
+	old_axis_slope_angle = fb->axis_slope_angle;
+	fb->axis_slope_angle = fb->axis_slope_angle + iang - asin(rang_sin);
 	sagitta = sin((old_axis_slope_angle + iang) / 2.0);
-	sagitta = 2.0 * radius_of_curvature * sagitta * sagitta;
-	object_distance =
-	    ((radius_of_curvature * sin(old_axis_slope_angle + iang)) *
-	     cot(axis_slope_angle)) + sagitta;
+	sagitta = 2.0 * fb->radius_of_curvature * sagitta * sagitta;
+	fb->object_distance =
+	    ((fb->radius_of_curvature * sin(old_axis_slope_angle + iang)) *
+	     cot(fb->axis_slope_angle)) + sagitta;
 	return;
     }
 
-    rang = -asin((from_index / to_index) * sin(axis_slope_angle));
-    object_distance = object_distance * ((to_index *
-					  cos(-rang)) / (from_index *
+    rang = -asin((fb->from_index / fb->to_index) * sin(fb->axis_slope_angle));
+    fb->object_distance = fb->object_distance * ((fb->to_index *
+					  cos(-rang)) / (fb->from_index *
 							 cos
-							 (axis_slope_angle)));
-    axis_slope_angle = -rang;
+							 (fb->axis_slope_angle)));
+    fb->axis_slope_angle = -rang;
 }
 
 /*  Perform ray trace in specific spectral line  */
 
-static void trace_line(int line, double ray_h)
+static void trace_line(FBench *fb, int line, double ray_h)
 {
     int i;
 
-    object_distance = 0.0;
-    ray_height = ray_h;
-    from_index = 1.0;
-
-    for (i = 1; i <= current_surfaces; i++) {
-	radius_of_curvature = s[i][1];
-	to_index = s[i][2];
-	if (to_index > 1.0)
-	    to_index = to_index + ((spectral_line[4] -
-				    spectral_line[line]) /
-				   (spectral_line[3] -
-				    spectral_line[6])) * ((s[i][2] -
-							   1.0) / s[i][3]);
-	transit_surface();
-	from_index = to_index;
-	if (i < current_surfaces)
-	    object_distance = object_distance - s[i][4];
+    fb->object_distance = 0.0;
+    fb->ray_height = ray_h;
+    fb->from_index = 1.0;
+
+    for (i = 1; i <= fb->current_surfaces; i++) {
+	fb->radius_of_curvature = fb->s[i][1];
+	fb->to_index = fb->s[i][2];
+	if (fb->to_index > 1.0)
+	    fb->to_index = fb->to_index + ((fb->spectral_line[4] -
+				    fb->spectral_line[line]) /
+				   (fb->spectral_line[3] -
+				    fb->spectral_line[6])) * ((fb->s[i][2] -
+							   1.0) / fb->s[i][3]);
+	transit_surface(fb);
+	fb->from_index = fb->to_index;
+	if (i < fb->current_surfaces)
+	    fb->object_distance = fb->object_distance - fb->s[i][4];
     }
 }
 
 /*  Initialise when called the first time  */
 
-void fbench()
+void fbench_run(FBench *fb)
 {
     int i, j;
     double od_fline, od_cline;
 
-    spectral_line[1] = 7621.0;	/* A */
-    spectral_line[2] = 6869.955;	/* B */
-    spectral_line[3] = 6562.816;	/* C */
-    spectral_line[4] = 5895.944;	/* D */
-    spectral_line[5] = 5269.557;	/* E */
-    spectral_line[6] = 4861.344;	/* F */
-    spectral_line[7] = 4340.477;	/* G' */
-    spectral_line[8] = 3968.494;	/* H */
+    fb->spectral_line[1] = 7621.0;	/* A */
+    fb->spectral_line[2] = 6869.955;	/* B */
+    fb->spectral_line[3] = 6562.816;	/* C */
+    fb->spectral_line[4] = 5895.944;	/* D */
+    fb->spectral_line[5] = 5269.557;	/* E */
+    fb->spectral_line[6] = 4861.344;	/* F */
+    fb->spectral_line[7] = 4340.477;	/* G' */
+    fb->spectral_line[8] = 3968.494;	/* H */
 
     /* Load test case into working array */
 
-    clear_aperture = 4.0;
-    current_surfaces = 4;
-    for (i = 0; i < current_surfaces; i++)
+    fb->clear_aperture = 4.0;
+    fb->current_surfaces = 4;
+    for (i = 0; i < fb->current_surfaces; i++)
 	for (j = 0; j < 4; j++)
-	    s[i + 1][j + 1] = testcase[i][j];
+	    fb->s[i + 1][j + 1] = testcase[i][j];
 
-    for (itercount = 0; itercount < niter; itercount++) {
+    for (fb->itercount = 0; fb->itercount < niter; fb->itercount++) {
         /* Do main trace in D light */
 
-        paraxial = FALSE;
+        fb->paraxial = FALSE;
 
-        trace_line(4, clear_aperture / 2.0);
-        od_sa[0][0] = object_distance;
-        od_sa[0][1] = axis_slope_angle;
+        trace_line(fb, 4, fb->clear_aperture / 2.0);
+        fb->od_sa[0][0] = fb->object_distance;
+        fb->od_sa[0][1] = fb->axis_slope_angle;
 
-        paraxial = TRUE;
+        fb->paraxial = TRUE;
 
-        trace_line(4, clear_aperture / 2.0);
-        od_sa[1][0] = object_distance;
-        od_sa[1][1] = axis_slope_angle;
+        trace_line(fb, 4, fb->clear_aperture / 2.0);
+        fb->od_sa[1][0] = fb->object_distance;
+        fb->od_sa[1][1] = fb->axis_slope_angle;
 
-        paraxial = FALSE;
+        fb->paraxial = FALSE;
 
 	/* Trace marginal ray in C */
 
-	trace_line(3, clear_aperture / 2.0);
-	od_cline = object_distance;
+	trace_line(fb, 3, fb->clear_aperture / 2.0);
+	od_cline = fb->object_distance;
 
 	/* Trace marginal ray in F */
 
-	trace_line(6, clear_aperture / 2.0);
-	od_fline = object_distance;
+	trace_line(fb, 6, fb->clear_aperture / 2.0);
+	od_fline = fb->object_distance;
 
-	aberr_lspher = od_sa[1][0] - od_sa[0][0];
-	aberr_osc = 1.0 - (od_sa[1][0] * od_sa[1][1]) /
-	    (sin(od_sa[0][1]) * od_sa[0][0]);
-	aberr_lchrom = od_fline - od_cline;
-	max_lspher = sin(od_sa[0][1]);
+	fb->aberr_lspher = fb->od_sa[1][0] - fb->od_sa[0][0];
+	fb->aberr_osc = 1.0 - (fb->od_sa[1][0] * fb->od_sa[1][1]) /
+	    (sin(fb->od_sa[0][1]) * fb->od_sa[0][0]);
+	fb->aberr_lchrom = od_fline - od_cline;
+	fb->max_lspher = sin(fb->od_sa[0][1]);
 
 	/* D light */
 
-	max_lspher = 0.0000926 / (max_lspher * max_lspher);
-	max_osc = 0.0025;
-	max_lchrom = max_lspher;
+	fb->max_lspher = 0.0000926 / (fb->max_lspher * fb->max_lspher);
+	fb->max_osc = 0.0025;
+	fb->max_lchrom = fb->max_lspher;
     }
 }
 
+/*  Contexts are cache line aligned, so threads tracing side by side
+    don't share lines  */
+
+FBench *fbench_new(void)
+{
+    void *fb = NULL;
+
+    if (posix_memalign(&fb, FBENCH_ALIGN, sizeof(FBench)) != 0)
+	return NULL;
+    memset(fb, 0, sizeof(FBench));
+
+    return fb;
+}
+
+void fbench_free(FBench *fb)
+{
+    free(fb);
+}
+
 #ifdef __FBENCH_TEST__
 int main(void)
 {
-    fbench();
+    FBench *fb = fbench_new();
+
+    fbench_run(fb);
+    printf("%.11f %.11f\n", fb->od_sa[0][0], fb->od_sa[0][1]);
+    fbench_free(fb);
 
     return 0;
 }
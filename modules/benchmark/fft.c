@@ -22,7 +22,8 @@
 #include "fftbench.h"
 
 /* if anything changes in this block, increment revision */
-#define BENCH_REVISION 3
+#define BENCH_REVISION 4
+#define BENCH_REVISION_SINGLE 3
 #define CRUNCH_TIME 5
 
 static gpointer fft_for(void *in_data, gint thread_number)
@@ -34,35 +35,102 @@ static gpointer fft_for(void *in_data, gint thread_number)
     return NULL;
 }
 
-void
-benchmark_fft(void)
+static gchar *fft_digest(FFTBench *fftbench)
 {
-    int cpu_procs, cpu_cores, cpu_threads, cpu_nodes;
-    bench_value r = EMPTY_BENCH_VALUE;
+    int n;
+    const double *x = fft_bench_result(fftbench, &n);
 
-    int i;
-    FFTBench **benches=NULL;
+    return md5_digest_str((const char *)x, sizeof(double) * n);
+}
 
-    shell_view_set_enabled(FALSE);
-    shell_status_update("Running FFT benchmark...");
+/* every thread solved the same system, so all must match a fresh solve */
+static int fft_errors(FFTBench **benches, int n)
+{
+    FFTBench *ref = fft_bench_new();
+    gchar *ref_digest, *digest;
+    int i, errors = 0;
+
+    if (!ref)
+        return n;
+    fft_bench_run(ref);
+    ref_digest = fft_digest(ref);
+
+    for (i = 0; i < n; i++) {
+        if (!benches[i]->runs)
+            continue; /* never ran */
+        digest = fft_digest(benches[i]);
+        if (!SEQ(digest, ref_digest))
+            errors++;
+        g_free(digest);
+    }
+
+    g_free(ref_digest);
+    fft_bench_free(ref);
+
+    return errors;
+}
+
+static bench_value fft_crunch(gint n_threads, int *errors)
+{
+    int cpu_procs, cpu_cores, cpu_threads, cpu_nodes;
+    bench_value r = EMPTY_BENCH_VALUE;
+    FFTBench **benches;
+    int i, n;
 
     cpu_procs_cores_threads_nodes(&cpu_procs, &cpu_cores, &cpu_threads, &cpu_nodes);
+    n = (n_threads > 0) ? n_threads : cpu_threads;
 
     /* Pre-allocate all benchmarks */
-    benches = g_new0(FFTBench *, cpu_threads);
-    for (i = 0; i < cpu_threads; i++) {benches[i] = fft_bench_new();}
+    benches = g_new0(FFTBench *, n);
+    for (i = 0; i < n; i++) {
+        benches[i] = fft_bench_new();
+        if (!benches[i])
+            goto fft_free;
+    }
 
     /* Run the benchmark */
-    r = benchmark_crunch_for(CRUNCH_TIME, 0, fft_for, benches);
+    r = benchmark_crunch_for(CRUNCH_TIME, n_threads, fft_for, benches);
+    if (errors)
+        *errors = fft_errors(benches, n);
+
+    r.result /= 100;
 
+fft_free:
     /* Free up the memory */
-    for (i = 0; i < cpu_threads; i++) {
+    for (i = 0; i < n; i++) {
         fft_bench_free(benches[i]);
     }
     g_free(benches);
 
-    r.result /= 100;
-    
+    return r;
+}
+
+void
+benchmark_fft(void)
+{
+    bench_value r = EMPTY_BENCH_VALUE;
+    int errors = 0;
+
+    shell_view_set_enabled(FALSE);
+    shell_status_update("Running FFT benchmark...");
+
+    r = fft_crunch(0, &errors);
+
     r.revision = BENCH_REVISION;
+    snprintf(r.extra, 255, "e:%d", errors);
     bench_results[BENCHMARK_FFT] = r;
 }
+
+void
+benchmark_fft_single(void)
+{
+    bench_value r = EMPTY_BENCH_VALUE;
+
+    shell_view_set_enabled(FALSE);
+    shell_status_update("Running FFT benchmark on one thread...");
+
+    r = fft_crunch(1, NULL);
+
+    r.revision = BENCH_REVISION_SINGLE;
+    bench_results[BENCHMARK_FFT_SINGLE] = r;
+}
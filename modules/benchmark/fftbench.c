@@ -33,7 +33,8 @@
 #include "fftbench.h"
 
 // embedded random number generator; ala Park and Miller
-static long seed = 1325;
+// seeded per bench, so threads don't share it
+static const long SEED = 1325;
 static const long IA = 16807;
 static const long IM = 2147483647;
 static const double AM = 4.65661287525E-10;
@@ -41,10 +42,11 @@ static const long IQ = 127773;
 static const long IR = 2836;
 static const long MASK = 123459876;
 
-static double random_double()
+static double random_double(FFTBench *fftbench)
 {
     long k;
     double result;
+    long seed = fftbench->seed;
 
     seed ^= MASK;
     k = seed / IQ;
@@ -55,6 +57,7 @@ static double random_double()
 
     result = AM * seed;
     seed ^= MASK;
+    fftbench->seed = seed;
 
     return result;
 }
@@ -63,14 +66,15 @@ static const int N = 100;
 static const int NM1 = 99;	// N - 1
 //static const int NP1 = 101;	// N + 1
 
+// rows are contiguous, a[i][j] is a[i * N + j]
+#define A(i, j) a[(i) * N + (j)]
+
 static void lup_decompose(FFTBench *fftbench)
 {
     int i, j, k, k2=0, t;
-    double p, temp, **a;
+    double p, temp, *a;
 
-    int *perm = (int *) malloc(sizeof(double) * N);
-    free(fftbench->p);
-    fftbench->p = perm;
+    int *perm = fftbench->p;
     a = fftbench->a;
     
     for (i = 0; i < N; ++i)
@@ -80,7 +84,7 @@ static void lup_decompose(FFTBench *fftbench)
 	p = 0.0;
 
 	for (i = k; i < N; ++i) {
-	    temp = fabs(a[i][k]);
+	    temp = fabs(A(i, k));
 
 	    if (temp > p) {
 		p = temp;
@@ -98,29 +102,29 @@ static void lup_decompose(FFTBench *fftbench)
 	perm[k2] = t;
 
 	for (i = 0; i < N; ++i) {
-	    temp = a[k][i];
-	    a[k][i] = a[k2][i];
-	    a[k2][i] = temp;
+	    temp = A(k, i);
+	    A(k, i) = A(k2, i);
+	    A(k2, i) = temp;
 	}
 
 	for (i = k + 1; i < N; ++i) {
-	    a[i][k] /= a[k][k];
+	    A(i, k) /= A(k, k);
 
 	    for (j = k + 1; j < N; ++j)
-		a[i][j] -= a[i][k] * a[k][j];
+		A(i, j) -= A(i, k) * A(k, j);
 	}
     }
 }
 
-static double *lup_solve(FFTBench *fftbench)
+static void lup_solve(FFTBench *fftbench)
 {
     int i, j, j2;
     double sum, u;
 
-    double *y = (double *) malloc(sizeof(double) * N);
-    double *x = (double *) malloc(sizeof(double) * N);
+    double *y = fftbench->y;
+    double *x = fftbench->r;
     
-    double **a = fftbench->a;
+    double *a = fftbench->a;
     double *b = fftbench->b;
     int *perm = fftbench->p;
 
@@ -134,7 +138,7 @@ static double *lup_solve(FFTBench *fftbench)
 	j2 = 0;
 
 	for (j = 1; j <= i; ++j) {
-	    sum += a[i][j2] * y[j2];
+	    sum += A(i, j2) * y[j2];
 	    ++j2;
 	}
 
@@ -145,10 +149,10 @@ static double *lup_solve(FFTBench *fftbench)
 
     while (1) {
 	sum = 0.0;
-	u = a[i][i];
+	u = A(i, i);
 
 	for (j = i + 1; j < N; ++j)
-	    sum += a[i][j] * x[j];
+	    sum += A(i, j) * x[j];
 
 	x[i] = (y[i] - sum) / u;
 
@@ -157,57 +161,80 @@ static double *lup_solve(FFTBench *fftbench)
 
 	--i;
     }
+}
 
-    free(y);
+// one cache line aligned block per bench, so threads don't share lines
+static void *fft_alloc(size_t size)
+{
+    void *mem = NULL;
 
-    return x;
+    size = (size + FFT_ALIGN - 1) & ~(size_t)(FFT_ALIGN - 1);
+    if (posix_memalign(&mem, FFT_ALIGN, size) != 0)
+	return NULL;
+
+    return mem;
 }
 
 FFTBench *fft_bench_new(void)
 {
     FFTBench *fftbench;
-    int i, j;
+    int i;
     
-    fftbench = g_new0(FFTBench, 1);
+    fftbench = fft_alloc(sizeof(FFTBench));
+    if (!fftbench)
+	return NULL;
+    memset(fftbench, 0, sizeof(FFTBench));
+    fftbench->seed = SEED;
 
     // generate test data            
-    fftbench->a = (double **) malloc(sizeof(double *) * N);
-
-    for (i = 0; i < N; ++i) {
-	fftbench->a[i] = (double *) malloc(sizeof(double) * N);
-
-	for (j = 0; j < N; ++j)
-	    fftbench->a[i][j] = random_double();
+    fftbench->a = fft_alloc(sizeof(double) * N * N);
+    fftbench->a0 = fft_alloc(sizeof(double) * N * N);
+    fftbench->b = fft_alloc(sizeof(double) * N);
+    fftbench->r = fft_alloc(sizeof(double) * N);
+    fftbench->y = fft_alloc(sizeof(double) * N);
+    fftbench->p = fft_alloc(sizeof(int) * N);
+    if (!fftbench->a || !fftbench->a0 || !fftbench->b || !fftbench->r
+	|| !fftbench->y || !fftbench->p) {
+	fft_bench_free(fftbench);
+	return NULL;
     }
 
-    fftbench->b = (double *) malloc(sizeof(double) * N);
-    fftbench->p = NULL;
+    for (i = 0; i < N * N; ++i)
+	fftbench->a0[i] = random_double(fftbench);
 
     for (i = 0; i < N; ++i)
-	fftbench->b[i] = random_double();
+	fftbench->b[i] = random_double(fftbench);
 
     return fftbench;
 }
 
 void fft_bench_run(FFTBench *fftbench)
 {
+    // every run solves the same system
+    memcpy(fftbench->a, fftbench->a0, sizeof(double) * N * N);
     lup_decompose(fftbench);
-    double *x = lup_solve(fftbench);
-    free(x);
+    lup_solve(fftbench);
+    fftbench->runs++;
+}
+
+const double *fft_bench_result(FFTBench *fftbench, int *n)
+{
+    *n = N;
+    return fftbench->r;
 }
 
 void fft_bench_free(FFTBench *fftbench)
 {
-    int i;
-    
-    // clean up
-    for (i = 0; i < N; ++i)
-	free(fftbench->a[i]);
+    if (!fftbench)
+	return;
 
+    // clean up
     free(fftbench->a);
+    free(fftbench->a0);
     free(fftbench->b);
     free(fftbench->p);
     free(fftbench->r);
+    free(fftbench->y);
     
-    g_free(fftbench);
+    free(fftbench);
 }
@@ -0,0 +1,941 @@
+/*
+ *    Hardinfo2 - System Information and benchmark
+ *    Copyright (C) 2003-2007 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/* SHA-256, BLAKE3, AES-128-CTR and ChaCha20 over a 64KB buffer on all
+ * threads. Each has a scalar path and the SIMD or crypto instruction paths
+ * the processor flags allow; every usable path is checked against known
+ * answers and the best one that passes is timed.
+ * Results are MiB/s, extra tells which path ran. */
+
+#include <stdint.h>
+#include <string.h>
+#include "hardinfo.h"
+#include "cpu_util.h"
+#include "benchmark.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HC_X86 1
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__GNUC__)
+#define HC_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* if anything changes in this block, increment revision */
+#define BENCH_REVISION 1
+#define BENCH_DATA_SIZE 65536
+#define CRUNCH_TIME 5
+
+typedef void (*hc_func)(const guchar *key, const guchar *in, guchar *out, gsize len);
+
+typedef struct {
+    const gchar *name;   /* for bench_value.extra */
+    const gchar *flags;  /* processor flags needed, NULL for none */
+    hc_func func;
+} HashCipherPath;
+
+typedef struct {
+    const gchar *name;
+    const HashCipherPath *paths; /* best first, NULL terminated */
+    const guchar *key;
+    gsize out_len;               /* digest size, 0 for same as input */
+    /* known answer: func(key, kat_in[kat_len]) gives kat_out */
+    gsize kat_len;
+    const gchar *kat_out;
+} HashCipher;
+
+static inline uint32_t hc_le32(const guchar *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void hc_put_le32(guchar *p, uint32_t v)
+{
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static inline uint32_t hc_be32(const guchar *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static inline void hc_put_be32(guchar *p, uint32_t v)
+{
+    p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+/* big-endian 128-bit counter block */
+static inline void hc_ctr_inc(guchar *ctr)
+{
+    int i;
+    for (i = 15; i >= 0; i--)
+        if (++ctr[i])
+            break;
+}
+
+/* SHA-256 */
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/* shared with BLAKE3 */
+static const uint32_t sha256_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+typedef void (*sha256_blocks_func)(uint32_t state[8], const guchar *p, gsize blocks);
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_blocks_scalar(uint32_t state[8], const guchar *p, gsize blocks)
+{
+    uint32_t w[64], a, b, c, d, e, f, g, h, t1, t2;
+    int i;
+
+    for (; blocks; blocks--, p += 64) {
+        for (i = 0; i < 16; i++)
+            w[i] = hc_be32(p + i * 4);
+        for (i = 16; i < 64; i++) {
+            uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        a = state[0]; b = state[1]; c = state[2]; d = state[3];
+        e = state[4]; f = state[5]; g = state[6]; h = state[7];
+        for (i = 0; i < 64; i++) {
+            t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g))
+                + sha256_k[i] + w[i];
+            t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+#if HC_X86
+__attribute__((target("sha,sse4.1")))
+static void sha256_blocks_shani(uint32_t state[8], const guchar *p, gsize blocks)
+{
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, tmp, msg, m[4], abef, cdgh;
+    int i;
+
+    /* ABCD EFGH -> ABEF CDGH */
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xb1);
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1b);
+    state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+    for (; blocks; blocks--, p += 64) {
+        abef = state0;
+        cdgh = state1;
+        for (i = 0; i < 4; i++)
+            m[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + i * 16)), bswap);
+
+        for (i = 0; i < 16; i++) {
+            msg = _mm_add_epi32(m[i & 3], _mm_loadu_si128((const __m128i *)&sha256_k[i * 4]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0e));
+            if (i < 12) {
+                /* w[4i+16 .. 4i+19] replaces w[4i .. 4i+3] */
+                tmp = _mm_add_epi32(_mm_sha256msg1_epu32(m[i & 3], m[(i + 1) & 3]),
+                                    _mm_alignr_epi8(m[(i + 3) & 3], m[(i + 2) & 3], 4));
+                m[i & 3] = _mm_sha256msg2_epu32(tmp, m[(i + 3) & 3]);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    /* ABEF CDGH -> ABCD EFGH */
+    tmp = _mm_shuffle_epi32(state0, 0x1b);
+    state1 = _mm_shuffle_epi32(state1, 0xb1);
+    _mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(tmp, state1, 0xf0));
+    _mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(state1, tmp, 8));
+}
+#endif
+
+/* only when the compiler targets the crypto extension */
+#if HC_NEON && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define HC_ARMV8_SHA2 1
+static void sha256_blocks_armv8(uint32_t state[8], const guchar *p, gsize blocks)
+{
+    uint32x4_t state0 = vld1q_u32(&state[0]), state1 = vld1q_u32(&state[4]);
+    uint32x4_t abcd, efgh, msg, tmp, m[4];
+    int i;
+
+    for (; blocks; blocks--, p += 64) {
+        abcd = state0;
+        efgh = state1;
+        for (i = 0; i < 4; i++)
+            m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + i * 16)));
+
+        for (i = 0; i < 16; i++) {
+            msg = vaddq_u32(m[i & 3], vld1q_u32(&sha256_k[i * 4]));
+            if (i < 12)
+                m[i & 3] = vsha256su1q_u32(vsha256su0q_u32(m[i & 3], m[(i + 1) & 3]),
+                                           m[(i + 2) & 3], m[(i + 3) & 3]);
+            tmp = state0;
+            state0 = vsha256hq_u32(state0, state1, msg);
+            state1 = vsha256h2q_u32(state1, tmp, msg);
+        }
+
+        state0 = vaddq_u32(state0, abcd);
+        state1 = vaddq_u32(state1, efgh);
+    }
+
+    vst1q_u32(&state[0], state0);
+    vst1q_u32(&state[4], state1);
+}
+#endif
+
+static void sha256(sha256_blocks_func blocks, const guchar *in, gsize len, guchar *out)
+{
+    uint32_t state[8];
+    guchar tail[128] = {0};
+    gsize full = len / 64, rest = len % 64, tail_len;
+    uint64_t bits = (uint64_t)len * 8;
+    int i;
+
+    memcpy(state, sha256_iv, sizeof(state));
+    blocks(state, in, full);
+
+    memcpy(tail, in + full * 64, rest);
+    tail[rest] = 0x80;
+    tail_len = (rest < 56) ? 64 : 128;
+    hc_put_be32(tail + tail_len - 8, bits >> 32);
+    hc_put_be32(tail + tail_len - 4, (uint32_t)bits);
+    blocks(state, tail, tail_len / 64);
+
+    for (i = 0; i < 8; i++)
+        hc_put_be32(out + i * 4, state[i]);
+}
+
+static void sha256_scalar(const guchar *key, const guchar *in, guchar *out, gsize len)
+{
+    sha256(sha256_blocks_scalar, in, len, out);
+}
+
+#if HC_X86
+static void sha256_shani(const guchar *key, const guchar *in, guchar *out, gsize len)
+{
+    sha256(sha256_blocks_shani, in, len, out);
+}
+#endif
+
+#if HC_ARMV8_SHA2
+static void sha256_armv8(const guchar *key, const guchar *in, guchar *out, gsize len)
+{
+    sha256(sha256_blocks_armv8, in, len, out);
+}
+#endif
+
+/* BLAKE3, unkeyed with 32 byte output */
+
+#define BLAKE3_BLOCK_LEN 64
+#define BLAKE3_CHUNK_LEN 1024
+#define BLAKE3_CHUNK_START 1
+#define BLAKE3_CHUNK_END 2
+#define BLAKE3_PARENT 4
+#define BLAKE3_ROOT 8
+
+#define blake3_iv sha256_iv
+
+static const uint8_t blake3_schedule[7][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+    {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+    {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+    {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+    {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+    {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+};
+
+/* the lane parallel ChaCha20 and BLAKE3 kernels */
+#define HC_LANES 1
+#define HC_SUFFIX scalar
+#define HC_TARGET
+#include "hashcipher_vec.c"
+#undef HC_LANES
+#undef HC_SUFFIX
+#undef HC_TARGET
+
+#if HC_X86
+#define HC_LANES 4
+#define HC_SUFFIX sse41
+#define HC_TARGET __attribute__((target("sse4.1")))
+#include "hashcipher_vec.c"
+#undef HC_LANES
+#undef HC_SUFFIX
+#undef HC_TARGET
+
+#define HC_LANES 8
+#define HC_SUFFIX avx2
+#define HC_TARGET __attribute__((target("avx2")))
+#include "hashcipher_vec.c"
+#undef HC_LANES
+#undef HC_SUFFIX
+#undef HC_TARGET
+
+#define HC_LANES 16
+#define HC_SUFFIX avx512
+#define HC_TARGET __attribute__((target("avx512f")))
+#include "hashcipher_vec.c"
+#undef HC_LANES
+#undef HC_SUFFIX
+#undef HC_TARGET
+#endif
+
+#if HC_NEON
+#define HC_LANES 4
+#define HC_SUFFIX neon
+#define HC_TARGET
+#include "hashcipher_vec.c"
+#undef HC_LANES
+#undef HC_SUFFIX
+#undef HC_TARGET
+#endif
+
+static void blake3_compress(const uint32_t cv[8], const uint32_t m[16], uint64_t counter,
+                            uint32_t block_len, uint32_t flags, uint32_t out[16])
+{
+    uint32_t v[16];
+    int i, r;
+
+    memcpy(v, cv, 8 * sizeof(uint32_t));
+    memcpy(v + 8, blake3_iv, 4 * sizeof(uint32_t));
+    v[12] = (uint32_t)counter;
+    v[13] = (uint32_t)(counter >> 32);
+    v[14] = block_len;
+    v[15] = flags;
+
+#define G(a, b, c, d, mx, my) \
+    v[a] += v[b] + (mx); v[d] = ROTR(v[d] ^ v[a], 16); \
+    v[c] += v[d]; v[b] = ROTR(v[b] ^ v[c], 12); \
+    v[a] += v[b] + (my); v[d] = ROTR(v[d] ^ v[a], 8); \
+    v[c] += v[d]; v[b] = ROTR(v[b] ^ v[c], 7);
+    for (r = 0; r < 7; r++) {
+        const uint8_t *s = blake3_schedule[r];
+        G(0, 4, 8, 12, m[s[0]], m[s[1]]) G(1, 5, 9, 13, m[s[2]], m[s[3]])
+        G(2, 6, 10, 14, m[s[4]], m[s[5]]) G(3, 7, 11, 15, m[s[6]], m[s[7]])
+        G(0, 5, 10, 15, m[s[8]], m[s[9]]) G(1, 6, 11, 12, m[s[10]], m[s[11]])
+        G(2, 7, 8, 13, m[s[12]], m[s[13]]) G(3, 4, 9, 14, m[s[14]], m[s[15]])
+    }
+#undef G
+
+    for (i = 0; i < 8; i++) {
+        out[i] = v[i] ^ v[i + 8];
+        out[i + 8] = v[i + 8] ^ cv[i];
+    }
+}
+
+/* the last compression of a node, kept until we know if it's the root */
+typedef struct {
+    uint32_t cv[8], m[16];
+    uint64_t counter;
+    uint32_t block_len, flags;
+} Blake3Output;
+
+static void blake3_output_cv(const Blake3Output *o, uint32_t cv[8])
+{
+    uint32_t out[16];
+    blake3_compress(o->cv, o->m, o->counter, o->block_len, o->flags, out);
+    memcpy(cv, out, 8 * sizeof(uint32_t));
+}
+
+static void blake3_parent(const uint32_t left[8], const uint32_t right[8], Blake3Output *o)
+{
+    memcpy(o->cv, blake3_iv, sizeof(o->cv));
+    memcpy(o->m, left, 8 * sizeof(uint32_t));
+    memcpy(o->m + 8, right, 8 * sizeof(uint32_t));
+    o->counter = 0;
+    o->block_len = BLAKE3_BLOCK_LEN;
+    o->flags = BLAKE3_PARENT;
+}
+
+/* last, possibly partial or empty, chunk */
+static void blake3_last_chunk(const guchar *in, gsize len, uint64_t counter, Blake3Output *o)
+{
+    guchar block[BLAKE3_BLOCK_LEN];
+    uint32_t out[16];
+    int i;
+
+    memcpy(o->cv, blake3_iv, sizeof(o->cv));
+    o->counter = counter;
+    o->flags = BLAKE3_CHUNK_START;
+    for (; len > BLAKE3_BLOCK_LEN; len -= BLAKE3_BLOCK_LEN, in += BLAKE3_BLOCK_LEN) {
+        for (i = 0; i < 16; i++)
+            o->m[i] = hc_le32(in + i * 4);
+        blake3_compress(o->cv, o->m, counter, BLAKE3_BLOCK_LEN, o->flags, out);
+        memcpy(o->cv, out, sizeof(o->cv));
+        o->flags = 0;
+    }
+
+    memset(block, 0, sizeof(block));
+    memcpy(block, in, len);
+    for (i = 0; i < 16; i++)
+        o->m[i] = hc_le32(block + i * 4);
+    o->block_len = len;
+    o->flags |= BLAKE3_CHUNK_END;
+}
+
+typedef void (*blake3_chunks_func)(const guchar *in, uint64_t counter, uint32_t cv_out[][8]);
+
+#define BLAKE3_MAX_LANES 16
+#define BLAKE3_MAX_DEPTH 54
+
+static void blake3(blake3_chunks_func chunks, int lanes, const guchar *in, gsize len, guchar *out)
+{
+    uint32_t stack[BLAKE3_MAX_DEPTH][8], cvs[BLAKE3_MAX_LANES][8], root[16];
+    gsize n_chunks = len ? (len - 1) / BLAKE3_CHUNK_LEN + 1 : 1;
+    uint64_t done = 0, total;
+    int depth = 0, i;
+    Blake3Output o;
+
+    /* every chunk but the last is whole, hash them lanes at a time */
+    while (done + 1 < n_chunks) {
+        int n = MIN((gsize)lanes, n_chunks - 1 - done);
+
+        if (n == lanes)
+            chunks(in + done * BLAKE3_CHUNK_LEN, done, cvs);
+        else
+            for (i = 0; i < n; i++)
+                blake3_chunks_scalar(in + (done + i) * BLAKE3_CHUNK_LEN, done + i, &cvs[i]);
+
+        for (i = 0; i < n; i++) {
+            uint32_t *cv = cvs[i];
+
+            /* merge completed subtrees, as many as trailing zero bits */
+            for (total = ++done; !(total & 1); total >>= 1) {
+                blake3_parent(stack[--depth], cv, &o);
+                blake3_output_cv(&o, stack[depth]);
+                cv = stack[depth];
+            }
+            if (cv != stack[depth])
+                memcpy(stack[depth], cv, sizeof(stack[depth]));
+            depth++;
+        }
+    }
+
+    blake3_last_chunk(in + done * BLAKE3_CHUNK_LEN, len - done * BLAKE3_CHUNK_LEN, done, &o);
+    while (depth > 0) {
+        uint32_t cv[8];
+
+        blake3_output_cv(&o, cv);
+        blake3_parent(stack[--depth], cv, &o);
+    }
+
+    blake3_compress(o.cv, o.m, o.counter, o.block_len, o.flags | BLAKE3_ROOT, root);
+    for (i = 0; i < 8; i++)
+        hc_put_le32(out + i * 4, root[i]);
+}
+
+/* AES-128 */
+
+static const guchar aes_sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+/* SubBytes + MixColumns of one byte, as a big-endian column */
+static uint32_t aes_te[256];
+
+static void aes_init_tables(void)
+{
+    static gboolean done = FALSE;
+    int i;
+
+    if (done)
+        return;
+    for (i = 0; i < 256; i++) {
+        uint32_t s = aes_sbox[i], s2 = (s << 1) ^ ((s & 0x80) ? 0x11b : 0);
+        aes_te[i] = s2 << 24 | s << 16 | s << 8 | (s2 ^ s);
+    }
+    done = TRUE;
+}
+
+/* round keys in FIPS-197 byte order, which is also what AES-NI and
+ * the ARMv8 instructions take */
+static void aes128_expand(const guchar *key, guchar rk[176])
+{
+    guchar rcon = 1;
+    int i;
+
+    memcpy(rk, key, 16);
+    for (i = 16; i < 176; i += 4) {
+        guchar t[4] = { rk[i - 4], rk[i - 3], rk[i - 2], rk[i - 1] };
+
+        if (i % 16 == 0) {
+            guchar t0 = t[0];
+            t[0] = aes_sbox[t[1]] ^ rcon;
+            t[1] = aes_sbox[t[2]];
+            t[2] = aes_sbox[t[3]];
+            t[3] = aes_sbox[t0];
+            rcon = (rcon << 1) ^ ((rcon & 0x80) ? 0x1b : 0);
+        }
+        rk[i] = rk[i - 16] ^ t[0];
+        rk[i + 1] = rk[i - 15] ^ t[1];
+        rk[i + 2] = rk[i - 14] ^ t[2];
+        rk[i + 3] = rk[i - 13] ^ t[3];
+    }
+}
+
+#define TE(i, r) ROTR(aes_te[i], r)
+
+static void aes128_encrypt_scalar(const guchar rk[176], const guchar in[16], guchar out[16])
+{
+    uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+    int r;
+
+    s0 = hc_be32(in) ^ hc_be32(rk);
+    s1 = hc_be32(in + 4) ^ hc_be32(rk + 4);
+    s2 = hc_be32(in + 8) ^ hc_be32(rk + 8);
+    s3 = hc_be32(in + 12) ^ hc_be32(rk + 12);
+
+    for (r = 1; r < 10; r++) {
+        const guchar *k = rk + r * 16;
+        t0 = aes_te[s0 >> 24] ^ TE((s1 >> 16) & 0xff, 8) ^ TE((s2 >> 8) & 0xff, 16) ^ TE(s3 & 0xff, 24) ^ hc_be32(k);
+        t1 = aes_te[s1 >> 24] ^ TE((s2 >> 16) & 0xff, 8) ^ TE((s3 >> 8) & 0xff, 16) ^ TE(s0 & 0xff, 24) ^ hc_be32(k + 4);
+        t2 = aes_te[s2 >> 24] ^ TE((s3 >> 16) & 0xff, 8) ^ TE((s0 >> 8) & 0xff, 16) ^ TE(s1 & 0xff, 24) ^ hc_be32(k + 8);
+        t3 = aes_te[s3 >> 24] ^ TE((s0 >> 16) & 0xff, 8) ^ TE((s1 >> 8) & 0xff, 16) ^ TE(s2 & 0xff, 24) ^ hc_be32(k + 12);
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+#define SB(x, s) ((uint32_t)aes_sbox[((x) >> (s)) & 0xff] << (s))
+    t0 = SB(s0, 24) | SB(s1, 16) | SB(s2, 8) | SB(s3, 0);
+    t1 = SB(s1, 24) | SB(s2, 16) | SB(s3, 8) | SB(s0, 0);
+    t2 = SB(s2, 24) | SB(s3, 16) | SB(s0, 8) | SB(s1, 0);
+    t3 = SB(s3, 24) | SB(s0, 16) | SB(s1, 8) | SB(s2, 0);
+#undef SB
+    hc_put_be32(out, t0 ^ hc_be32(rk + 160));
+    hc_put_be32(out + 4, t1 ^ hc_be32(rk + 164));
+    hc_put_be32(out + 8, t2 ^ hc_be32(rk + 168));
+    hc_put_be32(out + 12, t3 ^ hc_be32(rk + 172));
+}
+
+/* key is the 16 byte key followed by the 16 byte initial counter block */
+static void aes128_ctr_scalar(const guchar *key, const guchar *in, guchar *out, gsize len)
+{
+    guchar rk[176], ctr[16], ks[16];
+    gsize i, n;
+
+    aes128_expand(key, rk);
+    memcpy(ctr, key + 16, 16);
+    for (; len; len -= n, in += n, out += n) {
+        aes128_encrypt_scalar(rk, ctr, ks);
+        hc_ctr_inc(ctr);
+        n = MIN(len, 16);
+        for (i = 0; i < n; i++)
+            out[i] = in[i] ^ ks[i];
+    }
+}
+
+#if HC_X86
+#define AESNI_WAY 8
+__attribute__((target("aes,sse4.1")))
+static void aes128_ctr_aesni(const guchar *key, const guchar *in, guchar *out, gsize len)
+{
+    guchar rkb[176], ctr[16], ks[AESNI_WAY * 16];
+    __m128i rk[11], b[AESNI_WAY];
+    gsize i, n;
+    int j, r;
+
+    aes128_expand(key, rkb);
+    for (r = 0; r < 11; r++)
+        rk[r] = _mm_loadu_si128((const __m128i *)(rkb + r * 16));
+    memcpy(ctr, key + 16, 16);
+
+    /* whole groups of blocks */
+    for (; len >= sizeof(ks); len -= sizeof(ks), in += sizeof(ks), out += sizeof(ks)) {
+        for (j = 0; j < AESNI_WAY; j++) {
+            b[j] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)ctr), rk[0]);
+            hc_ctr_inc(ctr);
+        }
+        for (r = 1; r < 10; r++)
+            for (j = 0; j < AESNI_WAY; j++)
+                b[j] = _mm_aesenc_si128(b[j], rk[r]);
+        for (j = 0; j < AESNI_WAY; j++) {
+            b[j] = _mm_aesenclast_si128(b[j], rk[10]);
+            b[j] = _mm_xor_si128(b[j], _mm_loadu_si128((const __m128i *)(in + j * 16)));
+            _mm_storeu_si128((__m128i *)(out + j * 16), b[j]);
+        }
+    }
+
+    for (; len; len -= n, in += n, out += n) {
+        b[0] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)ctr), rk[0]);
+        hc_ctr_inc(ctr);
+        for (r = 1; r < 10; r++)
+            b[0] = _mm_aesenc_si128(b[0], rk[r]);
+        _mm_storeu_si128((__m128i *)ks, _mm_aesenclast_si128(b[0], rk[10]));
+        n = MIN(len, 16);
+        for (i = 0; i < n; i++)
+            out[i] = in[i] ^ ks[i];
+    }
+}
+#endif
+
+#if HC_NEON && (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+#define HC_ARMV8_AES 1
+static void aes128_ctr_armv8(const guchar *key, const guchar *in, guchar *out, gsize len)
+{
+    guchar rkb[176], ctr[16], ks[16];
+    uint8x16_t rk[11], b;
+    gsize i, n;
+    int r;
+
+    aes128_expand(key, rkb);
+    for (r = 0; r < 11; r++)
+        rk[r] = vld1q_u8(rkb + r * 16);
+    memcpy(ctr, key + 16, 16);
+
+    for (; len; len -= n, in += n, out += n) {
+        b = vld1q_u8(ctr);
+        hc_ctr_inc(ctr);
+        for (r = 0; r < 9; r++)
+            b = vaesmcq_u8(vaeseq_u8(b, rk[r]));
+        b = veorq_u8(vaeseq_u8(b, rk[9]), rk[10]);
+        n = MIN(len, 16);
+        if (n == 16) {
+            vst1q_u8(out, veorq_u8(b, vld1q_u8(in)));
+        } else {
+            vst1q_u8(ks, b);
+            for (i = 0; i < n; i++)
+                out[i] = in[i] ^ ks[i];
+        }
+    }
+}
+#endif
+
+/* ChaCha20 (RFC 8439) */
+
+typedef void (*chacha20_blocks_func)(const uint32_t st[16], uint32_t counter,
+                                     const guchar *in, guchar *out);
+
+/* key is the 32 byte key, the 4 byte initial counter and the 12 byte nonce */
+static void chacha20(chacha20_blocks_func blocks, int lanes, const guchar *key,
+                     const guchar *in, guchar *out, gsize len)
+{
+    uint32_t st[16] = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+    guchar tmp[64];
+    gsize step = lanes * 64, i;
+    uint32_t counter;
+
+    for (i = 0; i < 8; i++)
+        st[4 + i] = hc_le32(key + i * 4);
+    counter = hc_le32(key + 32);
+    for (i = 0; i < 3; i++)
+        st[13 + i] = hc_le32(key + 36 + i * 4);
+
+    for (; len >= step; len -= step, in += step, out += step, counter += lanes)
+        blocks(st, counter, in, out);
+    for (; len >= 64; len -= 64, in += 64, out += 64, counter++)
+        chacha20_blocks_scalar(st, counter, in, out);
+    if (len) {
+        memset(tmp, 0, sizeof(tmp));
+        memcpy(tmp, in, len);
+        chacha20_blocks_scalar(st, counter, tmp, tmp);
+        memcpy(out, tmp, len);
+    }
+}
+
+#undef ROTR
+
+#define HC_LANE_FUNCS(sfx, lanes) \
+static void blake3_##sfx(const guchar *key, const guchar *in, guchar *out, gsize len) \
+{ blake3(blake3_chunks_##sfx, lanes, in, len, out); } \
+static void chacha20_##sfx(const guchar *key, const guchar *in, guchar *out, gsize len) \
+{ chacha20(chacha20_blocks_##sfx, lanes, key, in, out, len); }
+
+HC_LANE_FUNCS(scalar, 1)
+#if HC_X86
+HC_LANE_FUNCS(sse41, 4)
+HC_LANE_FUNCS(avx2, 8)
+HC_LANE_FUNCS(avx512, 16)
+#endif
+#if HC_NEON
+HC_LANE_FUNCS(neon, 4)
+#endif
+
+static const HashCipherPath sha256_paths[] = {
+#if HC_X86
+    { "sha-ni", "sha_ni sse4_1", sha256_shani },
+#endif
+#if HC_ARMV8_SHA2
+    { "armv8-sha2", "sha2", sha256_armv8 },
+#endif
+    { "scalar", NULL, sha256_scalar },
+    { NULL }
+};
+
+static const HashCipherPath blake3_paths[] = {
+#if HC_X86
+    { "avx512", "avx512f", blake3_avx512 },
+    { "avx2", "avx2", blake3_avx2 },
+    { "sse4.1", "sse4_1", blake3_sse41 },
+#endif
+#if HC_NEON
+    { "neon", "asimd", blake3_neon },
+#endif
+    { "scalar", NULL, blake3_scalar },
+    { NULL }
+};
+
+static const HashCipherPath aes_paths[] = {
+#if HC_X86
+    { "aes-ni", "aes sse4_1", aes128_ctr_aesni },
+#endif
+#if HC_ARMV8_AES
+    { "armv8-aes", "aes", aes128_ctr_armv8 },
+#endif
+    { "scalar", NULL, aes128_ctr_scalar },
+    { NULL }
+};
+
+static const HashCipherPath chacha20_paths[] = {
+#if HC_X86
+    { "avx512", "avx512f", chacha20_avx512 },
+    { "avx2", "avx2", chacha20_avx2 },
+    { "sse4.1", "sse4_1", chacha20_sse41 },
+#endif
+#if HC_NEON
+    { "neon", "asimd", chacha20_neon },
+#endif
+    { "scalar", NULL, chacha20_scalar },
+    { NULL }
+};
+
+/* known answers are over the bytes i % 251, like the BLAKE3 test vectors,
+ * long enough to go through the wide kernels and the tails */
+
+/* SP 800-38A F.5.1 key and counter */
+static const guchar aes_key[32] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+    0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff,
+};
+
+/* RFC 8439 2.4.2 key, counter and nonce */
+static const guchar chacha20_key[48] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+    0x01, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4a, 0x00, 0x00, 0x00, 0x00,
+};
+
+enum {
+    HC_SHA256,
+    HC_BLAKE3,
+    HC_AES_CTR,
+    HC_CHACHA20,
+};
+
+/* kat_out is the digest, or the md5 of the cipher text */
+static const HashCipher hash_ciphers[] = {
+    [HC_SHA256] = { "SHA-256", sha256_paths, NULL, 32, 5000,
+                    "69dbee893909fa17d1be397e0c07691336fe42049c29d403467d3d4a1fc3b5a1" },
+    [HC_BLAKE3] = { "BLAKE3", blake3_paths, NULL, 32, 102400,
+                    "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085" },
+    [HC_AES_CTR] = { "AES-128-CTR", aes_paths, aes_key, 0, 5000,
+                     "a7b46603d579089ee2127f088a7a259e" },
+    [HC_CHACHA20] = { "ChaCha20", chacha20_paths, chacha20_key, 0, 5000,
+                      "b5d00f1e49ba662be581c74e643ee32e" },
+};
+
+static gboolean hash_cipher_kat(const HashCipher *hc, const HashCipherPath *path)
+{
+    gsize out_len = hc->out_len ? hc->out_len : hc->kat_len, i;
+    guchar *in = g_malloc(hc->kat_len), *out = g_malloc(out_len);
+    gchar *result;
+    gboolean ok;
+
+    for (i = 0; i < hc->kat_len; i++)
+        in[i] = i % 251;
+    path->func(hc->key, in, out, hc->kat_len);
+
+    if (hc->out_len) {
+        GString *hex = g_string_new(NULL);
+        for (i = 0; i < out_len; i++)
+            g_string_append_printf(hex, "%02x", out[i]);
+        result = g_string_free(hex, FALSE);
+    } else {
+        result = md5_digest_str((const char *)out, out_len);
+    }
+    ok = SEQ(result, hc->kat_out);
+
+    g_free(result);
+    g_free(in);
+    g_free(out);
+    return ok;
+}
+
+static gboolean hash_cipher_usable(const HashCipherPath *path)
+{
+    static gchar *cpu_flags = NULL;
+    gchar **flags;
+    gboolean ok = TRUE;
+    int i;
+
+    if (!path->flags)
+        return TRUE;
+    if (!cpu_flags) {
+        cpu_flags = module_call_method("devices::getProcessorFlags");
+        if (!cpu_flags)
+            cpu_flags = g_strdup("");
+    }
+
+    flags = g_strsplit(path->flags, " ", 0);
+    for (i = 0; flags[i] && ok; i++)
+        ok = processor_has_flag(cpu_flags, flags[i]);
+    g_strfreev(flags);
+
+    return ok;
+}
+
+/* the best path that passes its known answer test, NULL if none does */
+static const HashCipherPath *hash_cipher_path(const HashCipher *hc, int *passed, int *tried)
+{
+    const HashCipherPath *path, *best = NULL;
+
+    *passed = *tried = 0;
+    for (path = hc->paths; path->name; path++) {
+        if (!hash_cipher_usable(path))
+            continue;
+        (*tried)++;
+        if (hash_cipher_kat(hc, path)) {
+            (*passed)++;
+            if (!best)
+                best = path;
+        } else {
+            DEBUG("%s %s failed its known answer test", hc->name, path->name);
+        }
+    }
+
+    return best;
+}
+
+typedef struct {
+    const HashCipher *hc;
+    hc_func func;
+    const guchar *data;
+    guchar **out; /* one per thread, so no allocation while timing */
+} HashCipherTask;
+
+static gpointer hash_cipher_for(void *in_data, gint thread_number)
+{
+    HashCipherTask *task = (HashCipherTask *)in_data;
+
+    task->func(task->hc->key, task->data, task->out[thread_number], BENCH_DATA_SIZE);
+
+    return NULL;
+}
+
+static void benchmark_hash_cipher(int hc_id, int bench_id)
+{
+    int cpu_procs, cpu_cores, cpu_threads, cpu_nodes;
+    const HashCipher *hc = &hash_ciphers[hc_id];
+    const HashCipherPath *path;
+    bench_value r = EMPTY_BENCH_VALUE;
+    HashCipherTask task;
+    gchar *status, *test_data;
+    int i, passed, tried;
+
+    test_data = get_test_data(BENCH_DATA_SIZE);
+    if (!test_data)
+        return;
+
+    status = g_strdup_printf("Running %s benchmark...", hc->name);
+    shell_view_set_enabled(FALSE);
+    shell_status_update(status);
+    g_free(status);
+
+    aes_init_tables();
+    path = hash_cipher_path(hc, &passed, &tried);
+    if (!path) {
+        snprintf(r.extra, 255, "kat:0/%d", tried);
+        bench_results[bench_id] = r;
+        g_free(test_data);
+        return;
+    }
+
+    cpu_procs_cores_threads_nodes(&cpu_procs, &cpu_cores, &cpu_threads, &cpu_nodes);
+    task.hc = hc;
+    task.func = path->func;
+    task.data = (const guchar *)test_data;
+    task.out = g_new0(guchar *, cpu_threads);
+    for (i = 0; i < cpu_threads; i++)
+        task.out[i] = g_malloc(hc->out_len ? hc->out_len : BENCH_DATA_SIZE);
+
+    r = benchmark_crunch_for(CRUNCH_TIME, 0, hash_cipher_for, &task);
+    if (r.elapsed_time > 0)
+        r.result = r.result * BENCH_DATA_SIZE / (1024 * 1024) / r.elapsed_time;
+    r.revision = BENCH_REVISION;
+    snprintf(r.extra, 255, "p:%s, kat:%d/%d", path->name, passed, tried);
+
+    for (i = 0; i < cpu_threads; i++)
+        g_free(task.out[i]);
+    g_free(task.out);
+    g_free(test_data);
+
+    bench_results[bench_id] = r;
+}
+
+void benchmark_sha256(void)
+{
+    benchmark_hash_cipher(HC_SHA256, BENCHMARK_SHA256);
+}
+
+void benchmark_blake3(void)
+{
+    benchmark_hash_cipher(HC_BLAKE3, BENCHMARK_BLAKE3);
+}
+
+void benchmark_aes_ctr(void)
+{
+    benchmark_hash_cipher(HC_AES_CTR, BENCHMARK_AES_CTR);
+}
+
+void benchmark_chacha20(void)
+{
+    benchmark_hash_cipher(HC_CHACHA20, BENCHMARK_CHACHA20);
+}
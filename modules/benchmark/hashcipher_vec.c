@@ -0,0 +1,134 @@
+/*
+ *    Hardinfo2 - System Information and benchmark
+ *    Copyright (C) 2003-2007 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/* Included by hashcipher.c once per code path, with
+ *   HC_LANES   number of 32-bit lanes
+ *   HC_SUFFIX  function name suffix
+ *   HC_TARGET  function attributes, eg. __attribute__((target("avx2")))
+ * Lane l of every vector works on its own ChaCha20 block or BLAKE3 chunk,
+ * so the same source becomes scalar, SSE, AVX2, AVX-512 or NEON code. */
+
+#define HC_CAT_(a, b) a##_##b
+#define HC_CAT(a, b) HC_CAT_(a, b)
+#define HC_VEC HC_CAT(hc_vec, HC_SUFFIX)
+#define HC_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+typedef uint32_t HC_VEC __attribute__((vector_size(HC_LANES * 4)));
+
+/* HC_LANES ChaCha20 blocks from counter, in and out are HC_LANES * 64 bytes */
+HC_TARGET
+static void HC_CAT(chacha20_blocks, HC_SUFFIX)(const uint32_t st[16], uint32_t counter,
+                                              const guchar *in, guchar *out)
+{
+    HC_VEC x[16], s[16];
+    uint32_t words[16][HC_LANES];
+    int i, l;
+
+    for (i = 0; i < 16; i++)
+        s[i] = (HC_VEC){0} + st[i];
+    for (l = 0; l < HC_LANES; l++)
+        s[12][l] = counter + l;
+    memcpy(x, s, sizeof(x));
+
+#define QR(a, b, c, d) \
+    x[a] += x[b]; x[d] ^= x[a]; x[d] = HC_ROTR(x[d], 16); \
+    x[c] += x[d]; x[b] ^= x[c]; x[b] = HC_ROTR(x[b], 20); \
+    x[a] += x[b]; x[d] ^= x[a]; x[d] = HC_ROTR(x[d], 24); \
+    x[c] += x[d]; x[b] ^= x[c]; x[b] = HC_ROTR(x[b], 25);
+    for (i = 0; i < 10; i++) {
+        QR(0, 4, 8, 12) QR(1, 5, 9, 13) QR(2, 6, 10, 14) QR(3, 7, 11, 15)
+        QR(0, 5, 10, 15) QR(1, 6, 11, 12) QR(2, 7, 8, 13) QR(3, 4, 9, 14)
+    }
+#undef QR
+
+    for (i = 0; i < 16; i++) {
+        x[i] += s[i];
+        memcpy(words[i], &x[i], sizeof(words[i]));
+    }
+    for (l = 0; l < HC_LANES; l++) {
+        for (i = 0; i < 16; i++) {
+            uint32_t k = hc_le32(in + l * 64 + i * 4) ^ words[i][l];
+            hc_put_le32(out + l * 64 + i * 4, k);
+        }
+    }
+}
+
+/* chaining values of HC_LANES whole chunks, starting at chunk number counter */
+HC_TARGET
+static void HC_CAT(blake3_chunks, HC_SUFFIX)(const guchar *in, uint64_t counter,
+                                            uint32_t cv_out[][8])
+{
+    HC_VEC cv[8], v[16], m[16], ctr_lo, ctr_hi;
+    uint32_t words[16][HC_LANES];
+    int b, i, l, r;
+
+    for (i = 0; i < 8; i++)
+        cv[i] = (HC_VEC){0} + blake3_iv[i];
+    for (l = 0; l < HC_LANES; l++) {
+        ctr_lo[l] = (uint32_t)(counter + l);
+        ctr_hi[l] = (uint32_t)((counter + l) >> 32);
+    }
+
+    for (b = 0; b < BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN; b++) {
+        uint32_t flags = (b == 0 ? BLAKE3_CHUNK_START : 0)
+            | (b == BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN - 1 ? BLAKE3_CHUNK_END : 0);
+
+        for (l = 0; l < HC_LANES; l++)
+            for (i = 0; i < 16; i++)
+                words[i][l] = hc_le32(in + l * BLAKE3_CHUNK_LEN + b * BLAKE3_BLOCK_LEN + i * 4);
+        for (i = 0; i < 16; i++)
+            memcpy(&m[i], words[i], sizeof(words[i]));
+
+        for (i = 0; i < 8; i++)
+            v[i] = cv[i];
+        for (i = 0; i < 4; i++)
+            v[8 + i] = (HC_VEC){0} + blake3_iv[i];
+        v[12] = ctr_lo;
+        v[13] = ctr_hi;
+        v[14] = (HC_VEC){0} + BLAKE3_BLOCK_LEN;
+        v[15] = (HC_VEC){0} + flags;
+
+#define G(a, b, c, d, mx, my) \
+    v[a] += v[b] + (mx); v[d] = HC_ROTR(v[d] ^ v[a], 16); \
+    v[c] += v[d]; v[b] = HC_ROTR(v[b] ^ v[c], 12); \
+    v[a] += v[b] + (my); v[d] = HC_ROTR(v[d] ^ v[a], 8); \
+    v[c] += v[d]; v[b] = HC_ROTR(v[b] ^ v[c], 7);
+        for (r = 0; r < 7; r++) {
+            const uint8_t *s = blake3_schedule[r];
+            G(0, 4, 8, 12, m[s[0]], m[s[1]]) G(1, 5, 9, 13, m[s[2]], m[s[3]])
+            G(2, 6, 10, 14, m[s[4]], m[s[5]]) G(3, 7, 11, 15, m[s[6]], m[s[7]])
+            G(0, 5, 10, 15, m[s[8]], m[s[9]]) G(1, 6, 11, 12, m[s[10]], m[s[11]])
+            G(2, 7, 8, 13, m[s[12]], m[s[13]]) G(3, 4, 9, 14, m[s[14]], m[s[15]])
+        }
+#undef G
+
+        for (i = 0; i < 8; i++)
+            cv[i] = v[i] ^ v[i + 8];
+    }
+
+    for (i = 0; i < 8; i++)
+        memcpy(words[i], &cv[i], sizeof(words[i]));
+    for (l = 0; l < HC_LANES; l++)
+        for (i = 0; i < 8; i++)
+            cv_out[l][i] = words[i][l];
+}
+
+#undef HC_ROTR
+#undef HC_VEC
+#undef HC_CAT
+#undef HC_CAT_
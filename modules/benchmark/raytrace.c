@@ -16,39 +16,122 @@
  *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
  */
 
+#include "hardinfo.h"
+#include "cpu_util.h"
 #include "benchmark.h"
+#include "fbench.h"
 
 /* if anything changes in this block, increment revision */
 #define BENCH_REVISION 2
+#define BENCH_REVISION_THREADS 1
 #define CRUNCH_TIME 5
 
-void fbench();	/* fbench.c */
-
 static gpointer parallel_raytrace(void *in_data, gint thread_number)
 {
-    fbench();
+    FBench **benches = (FBench **)in_data;
+
+    fbench_run(benches[thread_number]);
 
     return NULL;
 }
 
+static gchar *raytrace_digest(FBench *fb)
+{
+    double out[] = {
+        fb->od_sa[0][0], fb->od_sa[0][1], fb->od_sa[1][0], fb->od_sa[1][1],
+        fb->aberr_lspher, fb->aberr_osc, fb->aberr_lchrom, fb->max_lspher,
+    };
+
+    return md5_digest_str((const char *)out, sizeof(out));
+}
+
+/* every thread traced the same lens, so all must match a fresh trace */
+static int raytrace_errors(FBench **benches, int n)
+{
+    FBench *ref = fbench_new();
+    gchar *ref_digest, *digest;
+    int i, errors = 0;
+
+    if (!ref)
+        return n;
+    fbench_run(ref);
+    ref_digest = raytrace_digest(ref);
+
+    for (i = 0; i < n; i++) {
+        if (!benches[i]->itercount)
+            continue; /* never ran */
+        digest = raytrace_digest(benches[i]);
+        if (!SEQ(digest, ref_digest))
+            errors++;
+        g_free(digest);
+    }
+
+    g_free(ref_digest);
+    fbench_free(ref);
+
+    return errors;
+}
+
+static bench_value raytrace_crunch(gint n_threads, int *errors)
+{
+    int cpu_procs, cpu_cores, cpu_threads, cpu_nodes;
+    bench_value r = EMPTY_BENCH_VALUE;
+    FBench **benches;
+    int i, n;
+
+    cpu_procs_cores_threads_nodes(&cpu_procs, &cpu_cores, &cpu_threads, &cpu_nodes);
+    n = (n_threads > 0) ? n_threads : cpu_threads;
+
+    /* Pre-allocate a context for each thread */
+    benches = g_new0(FBench *, n);
+    for (i = 0; i < n; i++) {
+        benches[i] = fbench_new();
+        if (!benches[i])
+            goto raytrace_free;
+    }
+
+    r = benchmark_crunch_for(CRUNCH_TIME, n_threads, parallel_raytrace, benches);
+    if (errors)
+        *errors = raytrace_errors(benches, n);
+    r.result /= 10;
+
+raytrace_free:
+    for (i = 0; i < n; i++)
+        fbench_free(benches[i]);
+    g_free(benches);
+
+    return r;
+}
+
 void
 benchmark_raytrace(void)
 {
     bench_value r = EMPTY_BENCH_VALUE;
-    gchar *test_data = get_test_data(1000);
 
     shell_view_set_enabled(FALSE);
     shell_status_update("Performing John Walker's FBENCH...");
 
-    r = benchmark_crunch_for(CRUNCH_TIME, 1, parallel_raytrace, test_data);
+    r = raytrace_crunch(1, NULL);
 
     r.revision = BENCH_REVISION;
     snprintf(r.extra, 255, "r:%d", 500);//niter from fbench
 
-    g_free(test_data);
-
-    r.result /= 10;
-    
     bench_results[BENCHMARK_RAYTRACE] = r;
 }
 
+void
+benchmark_raytrace_threads(void)
+{
+    bench_value r = EMPTY_BENCH_VALUE;
+    int errors = 0;
+
+    shell_view_set_enabled(FALSE);
+    shell_status_update("Performing John Walker's FBENCH on all threads...");
+
+    r = raytrace_crunch(0, &errors);
+
+    r.revision = BENCH_REVISION_THREADS;
+    snprintf(r.extra, 255, "r:%d, e:%d", 500, errors);//niter from fbench
+
+    bench_results[BENCHMARK_RAYTRACE_THREADS] = r;
+}
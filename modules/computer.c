@@ -23,6 +23,7 @@
 #include <string.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/utsname.h>
 #include <time.h>
 
 #include <hardinfo.h>
@@ -30,11 +31,13 @@
 #include <shell.h>
 
 #include <vendor.h>
+#include <inventory.h>
 
 #include "computer.h"
 
 #include "dmi_util.h" /* for dmi_get_str() */
 #include "dt_util.h" /* for dtr_get_string() */
+#include "util_edid.h" /* for edid_new() */
 
 #include "info.h"
 
@@ -121,6 +124,8 @@ gchar *hi_more_info(gchar * entry)
 {
     gchar *info = moreinfo_lookup_with_prefix("COMP", entry);
 
+    if (!info)
+        info = locale_get_info(entry);
     if (info)
         return g_strdup(info);
 
@@ -250,124 +255,6 @@ void scan_groups(gboolean reload)
     SCAN_END();
 }
 
-#if GLIB_CHECK_VERSION(2,14,0)
-static gchar *dev_list = NULL;
-void scan_dev(gboolean reload)
-{
-    SCAN_START();
-
-    guint i;
-    struct {
-       gchar *compiler_name;
-       gchar *version_command;
-       gchar *regex;
-       gboolean read_stdout;
-    } detect_lang[] = {
-       { N_("Scripting Languages"), NULL, FALSE },
-       { N_("Gambas3 (gbr3)"), "gbr3 --version", "\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_("Python (default)"), "python -V", "\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_("Python2"), "python2 -V", "\\d+\\.\\d+\\.\\d+", FALSE },
-       { N_("Python3"), "python3 -V", "\\d+\\.\\d+\\.\\d+(a|b|rc)?\\d*", TRUE },
-       { N_("Perl"), "perl -v", "\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_("Rakudo (Perl6)"), "rakudo -v", "(?<=Rakudo™ v)\\d+\\.\\d+", TRUE },
-       { N_("PHP"), "php --version", "\\d+\\.\\d+\\.\\S+", TRUE},
-       { N_("Ruby"), "ruby --version", "\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_("Bash"), "bash --version", "\\d+\\.\\d+\\.\\d+", TRUE},
-       { N_("JavaScript (Node.js)"), "node --version", "(?<=v)(\\d\\.?)+", TRUE },
-       { N_("awk"), "awk --version", "(?<=GNU Awk )\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_("Compilers"), NULL, FALSE },
-       { N_("C (GCC)"), "gcc --version", "\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_("C (Clang)"), "clang --version", "\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_("D (dmd)"), "dmd --help", "\\d+\\.\\d+", TRUE },
-       { N_("Gambas3 (gbc3)"), "gbc3 --version", "\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_("Java"), "javac -version", "\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_(".NET"), "dotnet --version", "\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_("Vala"), "valac --version", "\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_("Haskell (GHC)"), "ghc --version", "\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_("FreePascal"), "fpc -iV", "\\d+\\.\\d+\\.?\\d*", TRUE },
-       { N_("Go"), "go version", "\\d+\\.\\d+\\.?\\d* ", TRUE },
-       { N_("Rust"), "rustc --version", "(?<=rustc )(\\d\\.?)+", TRUE },
-       { N_("Tools"), NULL, FALSE },
-       { N_("make"), "make --version", "\\d+\\.\\d+", TRUE },
-       { N_("ninja"), "ninja --version", "\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_("GDB"), "gdb --version", "\\d+\\.\\d+\\.?\\d*", TRUE },
-       { N_("LLDB"), "lldb --version", "(?<=lldb version )(\\d\\.?)+", TRUE },
-       { N_("strace"), "strace -V", "\\d+\\.\\d+\\.?\\d*", TRUE },
-       { N_("valgrind"), "valgrind --version", "\\d+\\.\\d+\\.\\S+", TRUE },
-       { N_("QMake"), "qmake --version", "\\d+\\.\\S+", TRUE},
-       { N_("CMake"), "cmake --version", "\\d+\\.\\d+\\.?\\d*", TRUE},
-       { N_("Gambas3 IDE"), "gambas3 --version", "\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_("Radare2"), "radare2 -v", "(?<=radare2 )(\\d+\\.?)+(-git)?", TRUE },
-       { N_("ltrace"), "ltrace --version", "(?<=ltrace )\\d+\\.\\d+\\.\\d+", TRUE },
-       { N_("Powershell"), "pwsh --version", "\\d+\\.\\d+\\.\\d+", TRUE },
-    };
-
-    g_free(dev_list);
-
-    dev_list = g_strdup("");
-
-    for (i = 0; i < G_N_ELEMENTS(detect_lang); i++) {
-       gchar *version = NULL;
-       gchar *output, *ignored;
-       gchar *temp;
-       GRegex *regex;
-       GMatchInfo *match_info;
-       gboolean found;
-
-       if (!detect_lang[i].regex) {
-            dev_list = h_strdup_cprintf("[%s]\n", dev_list, _(detect_lang[i].compiler_name));
-            continue;
-       }
-
-       if (detect_lang[i].read_stdout) {
-            found = hardinfo_spawn_command_line_sync(detect_lang[i].version_command, &output, &ignored, NULL, NULL);
-       } else {
-            found = hardinfo_spawn_command_line_sync(detect_lang[i].version_command, &ignored, &output, NULL, NULL);
-       }
-       g_free(ignored);
-
-       if (found) {
-           regex = g_regex_new(detect_lang[i].regex, 0, 0, NULL);
-
-           g_regex_match(regex, output, 0, &match_info);
-           if (g_match_info_matches(match_info)) {
-               version = g_match_info_fetch(match_info, 0);
-           }
-
-           g_match_info_free(match_info);
-           g_regex_unref(regex);
-           g_free(output);
-       }
-
-       if (version == NULL)
-           version = strdup(_("Not found"));
-
-       dev_list = h_strdup_cprintf("%s=%s\n", dev_list, detect_lang[i].compiler_name, version);
-       g_free(version);
-
-       temp = g_strdup_printf(_("Detecting version: %s"),
-                              detect_lang[i].compiler_name);
-       shell_status_update(temp);
-       g_free(temp);
-    }
-
-    SCAN_END();
-}
-
-gchar *callback_dev(void)
-{
-    return g_strdup_printf(
-                "[$ShellParam$]\n"
-                "ViewType=5\n"
-                "ColumnTitle$TextValue=%s\n" /* Program */
-                "ColumnTitle$Value=%s\n" /* Version */
-                "ShowColumnHeaders=true\n"
-                "%s",
-                _("Program"), _("Version"),
-                dev_list);
-}
-#endif /* GLIB_CHECK_VERSION(2,14,0) */
-
 gchar *callback_memory_usage()
 {
     extern gchar *lginterval;
@@ -793,6 +680,14 @@ gchar *callback_display(void)
             : g_strdup_printf(_("%dx%d pixels, offset (%d, %d)"),
                     xrr->outputs[n].px_width, xrr->outputs[n].px_height,
                     xrr->outputs[n].px_offset_x, xrr->outputs[n].px_offset_y);
+        if (xrr->outputs[n].screen != -1 && xrr->outputs[n].refresh_mhz)
+            dims = h_strdup_cprintf(", %.2f Hz", dims, xrr->outputs[n].refresh_mhz / 1000.0);
+        if (xrr->outputs[n].edid) {
+            edid *e = edid_new((const char *)xrr->outputs[n].edid, xrr->outputs[n].edid_len);
+            if (e && e->name)
+                dims = h_strdup_cprintf(", %s", dims, e->name);
+            edid_free(e);
+        }
 
         outputs_str = h_strdup_cprintf("%s=%s; %s\n", outputs_str,
             xrr->outputs[n].name, connection, dims);
@@ -1179,3 +1074,43 @@ const gchar *hi_note_func(gint entry)
     }
     return NULL;
 }
+
+gchar *hi_inventory_token(gint entry)
+{
+    gchar *a, *ret;
+
+    switch (entry) {
+    case ENTRY_KMOD: {
+        struct utsname uts;
+        gchar *dep = NULL, *names, *files;
+
+        /* loaded module names and sizes, not their refcounts or states;
+         * modules.dep changes when the .ko files modinfo reads do */
+        if (uname(&uts) == 0)
+            dep = g_strdup_printf("/lib/modules/%s/modules.dep", uts.release);
+        names = inventory_fields_token("/proc/modules", 2);
+        files = inventory_stat_token(dep);
+        a = g_strdup_printf("%s:%s", names, files);
+        g_free(names);
+        g_free(files);
+        g_free(dep);
+        break;
+    }
+    case ENTRY_LANGUAGES:
+        a = inventory_stat_token("/usr/lib/locale/locale-archive");
+        break;
+    case ENTRY_USERS:
+        a = inventory_stat_token("/etc/passwd");
+        break;
+    case ENTRY_GROUPS:
+        a = inventory_stat_token("/etc/group");
+        break;
+    default:
+        return NULL;
+    }
+
+    ret = g_strdup_printf("%s:%s", inventory_boot_id(), a);
+    g_free(a);
+
+    return ret;
+}
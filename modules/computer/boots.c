@@ -18,12 +18,336 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <utmp.h>
 #include "hardinfo.h"
 #include "computer.h"
 
 extern void scan_os(gboolean reload);
 
-void scan_boots_real(void)
+typedef struct {
+    time_t time;
+    gchar *kernel;     /* from wtmp, NULL for journal only boots */
+    guchar boot_id[16]; /* journal boots only */
+} boot_entry;
+
+/* a journal boot and a wtmp boot record this close are the same boot */
+#define BOOT_MATCH_SECONDS 300
+#define WTMP_CHUNK 256
+
+#ifndef BOOTS_WTMP
+#define BOOTS_WTMP _PATH_WTMP
+#endif
+#ifndef BOOTS_MACHINE_ID
+#define BOOTS_MACHINE_ID "/etc/machine-id"
+#endif
+#ifndef BOOTS_JOURNAL_PERSISTENT
+#define BOOTS_JOURNAL_PERSISTENT "/var/log/journal"
+#endif
+#ifndef BOOTS_JOURNAL_VOLATILE
+#define BOOTS_JOURNAL_VOLATILE "/run/log/journal"
+#endif
+
+/* utmp BOOT_TIME records, newest first, until max boots are known */
+static void boots_read_wtmp(const gchar *path, GArray *boots, guint max)
+{
+    struct utmp *buf;
+    off_t pos, start;
+    int fd, i;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+
+    pos = lseek(fd, 0, SEEK_END);
+    pos -= pos % sizeof(struct utmp);
+    buf = g_new(struct utmp, WTMP_CHUNK);
+    while (pos > 0 && (!max || boots->len < max)) {
+        start = pos - (off_t)(WTMP_CHUNK * sizeof(struct utmp));
+        if (start < 0) start = 0;
+        if (pread(fd, buf, pos - start, start) != pos - start) break;
+
+        for (i = (pos - start) / sizeof(struct utmp) - 1; i >= 0; i--) {
+            boot_entry b;
+            if (buf[i].ut_type != BOOT_TIME) continue;
+            memset(&b, 0, sizeof(b));
+            b.time = buf[i].ut_tv.tv_sec;
+            b.kernel = g_strndup(buf[i].ut_host, sizeof(buf[i].ut_host));
+            g_array_append_val(boots, b);
+            if (max && boots->len >= max) break;
+        }
+        pos = start;
+    }
+    g_free(buf);
+    close(fd);
+}
+
+/* systemd journal files, see systemd's journal-def.h
+ * Only the entry arrays and the entry headers are read: every entry
+ * carries its boot id, realtime and monotonic time, and the entries of one
+ * boot are consecutive, so each boot costs a few lookups instead of a full
+ * walk. Realtime minus monotonic is when that boot started, however long
+ * after it the first entry still kept in the journal was written. */
+#define JOURNAL_HEADER_MIN 208
+#define JOURNAL_INCOMPAT_COMPACT (1 << 4)
+#define JOURNAL_OBJECT_ENTRY 3
+#define JOURNAL_OBJECT_ENTRY_ARRAY 6
+
+typedef struct {
+    const guchar *map;
+    gsize len;
+    int item_size;
+    GArray *arrays; /* guint64 pairs: items offset, item count */
+    guint64 n_entries;
+} journal_file;
+
+static gboolean jf_u64(journal_file *jf, guint64 off, guint64 *v)
+{
+    if (off > jf->len || jf->len - off < 8) return FALSE;
+    memcpy(v, jf->map + off, 8);
+    *v = GUINT64_FROM_LE(*v);
+    return TRUE;
+}
+
+static guint64 jf_entry_offset(journal_file *jf, guint64 n)
+{
+    guint64 *a = (guint64 *)jf->arrays->data, v = 0;
+    guint i;
+    guint32 v32;
+
+    for (i = 0; i < jf->arrays->len; i += 2) {
+        if (n < a[i + 1]) {
+            guint64 off = a[i] + n * jf->item_size;
+            if (jf->item_size == 4) {
+                memcpy(&v32, jf->map + off, 4);
+                return GUINT32_FROM_LE(v32);
+            }
+            jf_u64(jf, off, &v);
+            return v;
+        }
+        n -= a[i + 1];
+    }
+    return 0;
+}
+
+/* boot id and the boot's start (realtime - monotonic, usec) of entry n */
+static gboolean jf_entry(journal_file *jf, guint64 n, guchar *boot_id, guint64 *boot_usec)
+{
+    guint64 off = jf_entry_offset(jf, n), realtime, monotonic;
+
+    if (!off || off > jf->len || jf->len - off < 56
+        || jf->map[off] != JOURNAL_OBJECT_ENTRY)
+        return FALSE;
+    jf_u64(jf, off + 24, &realtime);
+    jf_u64(jf, off + 32, &monotonic);
+    memcpy(boot_id, jf->map + off + 40, 16);
+    *boot_usec = (monotonic < realtime) ? realtime - monotonic : realtime;
+    return TRUE;
+}
+
+static gboolean jf_same_boot(journal_file *jf, guint64 n, const guchar *boot_id)
+{
+    guchar id[16];
+    guint64 usec;
+    return jf_entry(jf, n, id, &usec) && memcmp(id, boot_id, 16) == 0;
+}
+
+static void boots_add_journal_boot(GArray *jboots, const guchar *boot_id, guint64 boot_usec)
+{
+    boot_entry b, *e;
+    guint i;
+
+    for (i = 0; i < jboots->len; i++) {
+        e = &g_array_index(jboots, boot_entry, i);
+        if (memcmp(e->boot_id, boot_id, 16) == 0) {
+            if ((time_t)(boot_usec / 1000000) < e->time)
+                e->time = boot_usec / 1000000;
+            return;
+        }
+    }
+    memset(&b, 0, sizeof(b));
+    b.time = boot_usec / 1000000;
+    memcpy(b.boot_id, boot_id, 16);
+    g_array_append_val(jboots, b);
+}
+
+static void boots_read_journal_file(const gchar *path, GArray *jboots)
+{
+    GMappedFile *mf;
+    journal_file jf;
+    guint64 incompat, off, size, count, next, total = 0, n, lo, hi, step, mid, usec;
+    guchar boot_id[16];
+
+    mf = g_mapped_file_new(path, FALSE, NULL);
+    if (!mf) return;
+
+    memset(&jf, 0, sizeof(jf));
+    jf.map = (const guchar *)g_mapped_file_get_contents(mf);
+    jf.len = g_mapped_file_get_length(mf);
+    if (!jf.map || jf.len < JOURNAL_HEADER_MIN || memcmp(jf.map, "LPKSHHRH", 8) != 0)
+        goto out;
+
+    incompat = GUINT32_FROM_LE(*(guint32 *)(jf.map + 12));
+    jf.item_size = (incompat & JOURNAL_INCOMPAT_COMPACT) ? 4 : 8;
+    jf_u64(&jf, 152, &jf.n_entries);
+    jf_u64(&jf, 176, &off);
+    jf.arrays = g_array_new(FALSE, FALSE, sizeof(guint64));
+
+    /* the chain of entry arrays, each one twice the size of the previous */
+    while (off && total < jf.n_entries) {
+        if (off > jf.len - 24 || jf.map[off] != JOURNAL_OBJECT_ENTRY_ARRAY)
+            break;
+        jf_u64(&jf, off + 8, &size);
+        jf_u64(&jf, off + 16, &next);
+        if (size < 24 || size > jf.len - off)
+            break;
+        count = (size - 24) / jf.item_size;
+        off += 24;
+        g_array_append_val(jf.arrays, off);
+        g_array_append_val(jf.arrays, count);
+        total += count;
+        if (next <= off) break;
+        off = next;
+    }
+    if (total < jf.n_entries)
+        jf.n_entries = total;
+
+    n = 0;
+    while (n < jf.n_entries && jf_entry(&jf, n, boot_id, &usec)) {
+        boots_add_journal_boot(jboots, boot_id, usec);
+
+        /* gallop to the first entry of another boot */
+        lo = n;
+        step = 1;
+        while (lo + step < jf.n_entries && jf_same_boot(&jf, lo + step, boot_id)) {
+            lo += step;
+            step *= 2;
+        }
+        hi = MIN(lo + step, jf.n_entries);
+        while (hi - lo > 1) {
+            mid = lo + (hi - lo) / 2;
+            if (jf_same_boot(&jf, mid, boot_id))
+                lo = mid;
+            else
+                hi = mid;
+        }
+        n = hi;
+    }
+    g_array_free(jf.arrays, TRUE);
+
+out:
+#if GLIB_CHECK_VERSION(2,22,0)
+    g_mapped_file_unref(mf);
+#else
+    g_mapped_file_free(mf);
+#endif
+}
+
+static void boots_read_journal_dir(const gchar *dir, GArray *jboots)
+{
+    GDir *d;
+    const gchar *name;
+    gchar *path;
+
+    d = g_dir_open(dir, 0, NULL);
+    if (!d) return;
+    while ((name = g_dir_read_name(d))) {
+        /* system.journal, archived system@... and dirty system@...journal~ */
+        if (!g_str_has_prefix(name, "system") || !strstr(name, ".journal"))
+            continue;
+        path = g_build_filename(dir, name, NULL);
+        boots_read_journal_file(path, jboots);
+        g_free(path);
+    }
+    g_dir_close(d);
+}
+
+static void boots_read_journal(GArray *jboots)
+{
+    const gchar *roots[] = { BOOTS_JOURNAL_PERSISTENT, BOOTS_JOURNAL_VOLATILE };
+    gchar *machine_id = NULL, *dir;
+    const gchar *name;
+    GDir *d;
+    int i;
+
+    g_file_get_contents(BOOTS_MACHINE_ID, &machine_id, NULL, NULL);
+    if (machine_id) g_strstrip(machine_id);
+
+    for (i = 0; i < (int)G_N_ELEMENTS(roots); i++) {
+        d = g_dir_open(roots[i], 0, NULL);
+        if (!d) continue;
+        while ((name = g_dir_read_name(d))) {
+            if (machine_id && *machine_id && strcmp(name, machine_id) != 0)
+                continue;
+            dir = g_build_filename(roots[i], name, NULL);
+            boots_read_journal_dir(dir, jboots);
+            g_free(dir);
+        }
+        g_dir_close(d);
+    }
+    g_free(machine_id);
+}
+
+static gint boots_cmp_newest(gconstpointer a, gconstpointer b)
+{
+    time_t ta = ((const boot_entry *)a)->time, tb = ((const boot_entry *)b)->time;
+    return (ta < tb) - (ta > tb);
+}
+
+/* wtmp boots plus the journal boots that wtmp has no record of,
+ * newest first, at most max (0 = all) */
+static GArray *boots_collect(guint max)
+{
+    GArray *boots = g_array_new(FALSE, FALSE, sizeof(boot_entry));
+    GArray *jboots = g_array_new(FALSE, FALSE, sizeof(boot_entry));
+    gchar *rotated;
+    guint i, j, n_wtmp;
+
+    boots_read_wtmp(BOOTS_WTMP, boots, max);
+    if (!max || boots->len < max) {
+        rotated = g_strdup_printf("%s.1", BOOTS_WTMP);
+        boots_read_wtmp(rotated, boots, max);
+        g_free(rotated);
+    }
+    n_wtmp = boots->len;
+
+    boots_read_journal(jboots);
+    for (i = 0; i < jboots->len; i++) {
+        boot_entry *jb = &g_array_index(jboots, boot_entry, i);
+        for (j = 0; j < n_wtmp; j++) {
+            boot_entry *wb = &g_array_index(boots, boot_entry, j);
+            if (ABS(wb->time - jb->time) <= BOOT_MATCH_SECONDS)
+                break;
+        }
+        if (j == n_wtmp)
+            g_array_append_val(boots, *jb);
+    }
+    g_array_free(jboots, TRUE);
+
+    g_array_sort(boots, boots_cmp_newest);
+    if (max && boots->len > max) {
+        for (i = max; i < boots->len; i++)
+            g_free(g_array_index(boots, boot_entry, i).kernel);
+        g_array_set_size(boots, max);
+    }
+    return boots;
+}
+
+/* same text as last -F */
+static gchar *boots_format_time(time_t t)
+{
+    struct tm tm;
+    char buf[64];
+    gchar *s;
+
+    localtime_r(&t, &tm);
+    if (!strftime(buf, sizeof(buf), "%a %b %e %H:%M:%S %Y", &tm))
+        return g_strdup("");
+    s = g_strdup(buf);
+    return strreplace(s, "  ", " ");
+}
+
+static void scan_boots_last(void)
 {
     gchar **tmp;
     gboolean spawned;
@@ -31,11 +355,6 @@ void scan_boots_real(void)
     int cnt;
     cnt=0;
 
-    scan_os(FALSE);
-
-    if (computer->os->boots) g_free(computer->os->boots);
-    computer->os->boots = strdup("");
-
     spawned = hardinfo_spawn_command_line_sync("last -F -w", &out, &err, NULL, NULL);
 
     if (spawned && out != NULL) {
@@ -65,3 +384,29 @@ void scan_boots_real(void)
       g_free(err);
     }
 }
+
+void scan_boots_real(void)
+{
+    GArray *boots;
+    guint i;
+
+    scan_os(FALSE);
+
+    if (computer->os->boots) g_free(computer->os->boots);
+    computer->os->boots = strdup("");
+
+    boots = boots_collect((!params.create_report || params.force_all_details) ? 0 : 25);
+    for (i = 0; i < boots->len; i++) {
+        boot_entry *b = &g_array_index(boots, boot_entry, i);
+        gchar *when = boots_format_time(b->time);
+        computer->os->boots = h_strdup_cprintf("\n%s=%s", computer->os->boots,
+            when, (b->kernel && *b->kernel) ? b->kernel : _("(Unknown)"));
+        g_free(when);
+        g_free(b->kernel);
+    }
+
+    /* no wtmp nor journal (eg. wtmpdb), let last find them */
+    if (!boots->len)
+        scan_boots_last();
+    g_array_free(boots, TRUE);
+}
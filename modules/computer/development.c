@@ -0,0 +1,406 @@
+/*
+ *    HardInfo - Displays System Information
+ *    Copyright (C) 2003-2007 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/* Versions of installed languages and tools. Each command is looked up on
+ * PATH first, the ones found run all at once with a deadline, and the
+ * versions are cached keyed by the binary so unchanged toolchains are
+ * never run again. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "hardinfo.h"
+#include "scan_profile.h"
+#include "shell.h"
+#include "computer.h"
+
+#if GLIB_CHECK_VERSION(2,14,0)
+
+#ifndef DEV_TIMEOUT_MS
+#define DEV_TIMEOUT_MS 5000
+#endif
+#define DEV_MAX_OUTPUT 65536
+
+static const struct {
+    gchar *compiler_name;
+    gchar *version_command;
+    gchar *regex;
+    gboolean read_stdout;
+} detect_lang[] = {
+    { N_("Scripting Languages"), NULL, FALSE },
+    { N_("Gambas3 (gbr3)"), "gbr3 --version", "\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_("Python (default)"), "python -V", "\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_("Python2"), "python2 -V", "\\d+\\.\\d+\\.\\d+", FALSE },
+    { N_("Python3"), "python3 -V", "\\d+\\.\\d+\\.\\d+(a|b|rc)?\\d*", TRUE },
+    { N_("Perl"), "perl -v", "\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_("Rakudo (Perl6)"), "rakudo -v", "(?<=Rakudo™ v)\\d+\\.\\d+", TRUE },
+    { N_("PHP"), "php --version", "\\d+\\.\\d+\\.\\S+", TRUE},
+    { N_("Ruby"), "ruby --version", "\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_("Bash"), "bash --version", "\\d+\\.\\d+\\.\\d+", TRUE},
+    { N_("JavaScript (Node.js)"), "node --version", "(?<=v)(\\d\\.?)+", TRUE },
+    { N_("awk"), "awk --version", "(?<=GNU Awk )\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_("Compilers"), NULL, FALSE },
+    { N_("C (GCC)"), "gcc --version", "\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_("C (Clang)"), "clang --version", "\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_("D (dmd)"), "dmd --help", "\\d+\\.\\d+", TRUE },
+    { N_("Gambas3 (gbc3)"), "gbc3 --version", "\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_("Java"), "javac -version", "\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_(".NET"), "dotnet --version", "\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_("Vala"), "valac --version", "\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_("Haskell (GHC)"), "ghc --version", "\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_("FreePascal"), "fpc -iV", "\\d+\\.\\d+\\.?\\d*", TRUE },
+    { N_("Go"), "go version", "\\d+\\.\\d+\\.?\\d* ", TRUE },
+    { N_("Rust"), "rustc --version", "(?<=rustc )(\\d\\.?)+", TRUE },
+    { N_("Tools"), NULL, FALSE },
+    { N_("make"), "make --version", "\\d+\\.\\d+", TRUE },
+    { N_("ninja"), "ninja --version", "\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_("GDB"), "gdb --version", "\\d+\\.\\d+\\.?\\d*", TRUE },
+    { N_("LLDB"), "lldb --version", "(?<=lldb version )(\\d\\.?)+", TRUE },
+    { N_("strace"), "strace -V", "\\d+\\.\\d+\\.?\\d*", TRUE },
+    { N_("valgrind"), "valgrind --version", "\\d+\\.\\d+\\.\\S+", TRUE },
+    { N_("QMake"), "qmake --version", "\\d+\\.\\S+", TRUE},
+    { N_("CMake"), "cmake --version", "\\d+\\.\\d+\\.?\\d*", TRUE},
+    { N_("Gambas3 IDE"), "gambas3 --version", "\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_("Radare2"), "radare2 -v", "(?<=radare2 )(\\d+\\.?)+(-git)?", TRUE },
+    { N_("ltrace"), "ltrace --version", "(?<=ltrace )\\d+\\.\\d+\\.\\d+", TRUE },
+    { N_("Powershell"), "pwsh --version", "\\d+\\.\\d+\\.\\d+", TRUE },
+};
+
+typedef struct {
+    gchar  **argv;
+    gchar   *path;      /* where PATH finds argv[0], NULL if it doesn't */
+    gchar   *real_path; /* symlinks resolved, what the cache is keyed on */
+    struct stat st;
+    GPid     pid;
+    gint     fd;        /* the stream the version is read from, -1 when done */
+    GString *output;
+    gboolean timed_out; /* not cached, it may just be a slow start */
+    ScanProfileEvent *ev; /* until reaped, as the probes run side by side */
+    gchar   *version;
+} dev_probe;
+
+static gchar *dev_list = NULL;
+static GRegex *dev_regex[G_N_ELEMENTS(detect_lang)];
+
+static gint64 now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (gint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static gchar *dev_cache_path(void)
+{
+    return g_build_filename(g_get_user_config_dir(), "hardinfo2", "toolchains.conf", NULL);
+}
+
+/* inode, size and mtime of the resolved binary */
+static gchar *dev_stamp(const dev_probe *p)
+{
+    return g_strdup_printf("%llu:%llu:%llu",
+                           (unsigned long long)p->st.st_ino,
+                           (unsigned long long)p->st.st_size,
+                           (unsigned long long)p->st.st_mtime);
+}
+
+/* the cached version is only good for the very same binary */
+static gboolean dev_cache_lookup(GKeyFile *cache, const gchar *command, dev_probe *p)
+{
+    gchar *path = g_key_file_get_string(cache, command, "Path", NULL);
+    gchar *stamp = g_key_file_get_string(cache, command, "Stamp", NULL);
+    gchar *cur = dev_stamp(p);
+    gboolean ok = path && stamp && g_str_equal(path, p->real_path) && g_str_equal(stamp, cur)
+        && g_key_file_has_key(cache, command, "Version", NULL);
+
+    if (ok) {
+        p->version = g_key_file_get_string(cache, command, "Version", NULL);
+        if (p->version && !*p->version) {
+            g_free(p->version);
+            p->version = NULL;
+        }
+    }
+    g_free(cur);
+    g_free(stamp);
+    g_free(path);
+    return ok;
+}
+
+static void dev_cache_store(GKeyFile *cache, const gchar *command, const dev_probe *p)
+{
+    gchar *stamp = dev_stamp(p);
+
+    g_key_file_set_string(cache, command, "Path", p->real_path);
+    g_key_file_set_string(cache, command, "Stamp", stamp);
+    g_key_file_set_string(cache, command, "Version", p->version ? p->version : "");
+    g_free(stamp);
+}
+
+/* own process group, so a timeout also takes anything it started */
+static void dev_child_setup(gpointer data)
+{
+    setpgid(0, 0);
+}
+
+static gboolean dev_probe_spawn(dev_probe *p, gboolean read_stdout)
+{
+    gchar **argv;
+    gint in_fd, out_fd, err_fd, n = g_strv_length(p->argv), i;
+    gboolean spawned;
+
+    /* run what was found, but keep argv[0] as typed */
+    argv = g_new0(gchar *, n + 2);
+    argv[0] = p->path;
+    for (i = 0; i < n; i++)
+        argv[i + 1] = p->argv[i];
+
+    p->ev = scan_profile_begin(SCAN_PROFILE_SPAWN, p->path);
+    spawned = g_spawn_async_with_pipes(NULL, argv, NULL,
+                                       G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_FILE_AND_ARGV_ZERO |
+                                       (read_stdout ? G_SPAWN_STDERR_TO_DEV_NULL : G_SPAWN_STDOUT_TO_DEV_NULL),
+                                       dev_child_setup, NULL, &p->pid, &in_fd,
+                                       read_stdout ? &out_fd : NULL,
+                                       read_stdout ? NULL : &err_fd, NULL);
+    g_free(argv);
+    if (!spawned) {
+        scan_profile_end(p->ev);
+        p->ev = NULL;
+        return FALSE;
+    }
+
+    close(in_fd);
+    p->fd = read_stdout ? out_fd : err_fd;
+    p->output = g_string_new(NULL);
+    return TRUE;
+}
+
+/* a probe can close its end and keep running, so reaping is held to the
+ * same deadline; what is left then is killed */
+static void dev_probes_reap(dev_probe *probes, guint n, gint64 deadline)
+{
+    guint i, running;
+
+    for (;;) {
+        gboolean expired = now_ms() >= deadline;
+
+        for (i = 0, running = 0; i < n; i++) {
+            pid_t r;
+
+            if (!probes[i].pid)
+                continue;
+            r = waitpid(probes[i].pid, NULL, WNOHANG);
+            if (r == 0 || (r < 0 && errno == EINTR)) {
+                if (!expired) {
+                    running++;
+                    continue;
+                }
+                kill(-probes[i].pid, SIGKILL);
+                probes[i].timed_out = TRUE;
+                while (waitpid(probes[i].pid, NULL, 0) < 0 && errno == EINTR)
+                    ;
+            }
+            g_spawn_close_pid(probes[i].pid);
+            probes[i].pid = 0;
+            scan_profile_end(probes[i].ev);
+            probes[i].ev = NULL;
+        }
+        if (!running)
+            break;
+        g_usleep(10000);
+    }
+}
+
+/* reads every running probe until it closes its end or time runs out */
+static void dev_probes_collect(dev_probe *probes, guint n)
+{
+    struct pollfd *fds = g_new(struct pollfd, n);
+    dev_probe **owner = g_new(dev_probe *, n);
+    gint64 deadline = now_ms() + DEV_TIMEOUT_MS;
+    gchar buf[4096];
+    guint i, nfds;
+
+    for (;;) {
+        gint64 left = deadline - now_ms();
+
+        for (i = 0, nfds = 0; i < n; i++) {
+            if (probes[i].fd < 0)
+                continue;
+            fds[nfds].fd = probes[i].fd;
+            fds[nfds].events = POLLIN;
+            fds[nfds].revents = 0;
+            owner[nfds++] = &probes[i];
+        }
+        if (!nfds || left <= 0)
+            break;
+
+        if (poll(fds, nfds, (int)left) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (i = 0; i < nfds; i++) {
+            dev_probe *p = owner[i];
+            ssize_t r;
+
+            if (!fds[i].revents)
+                continue;
+            r = read(p->fd, buf, sizeof(buf));
+            if (r > 0 && p->output->len < DEV_MAX_OUTPUT) {
+                g_string_append_len(p->output, buf, r);
+            } else if (r == 0 || (r < 0 && errno != EINTR && errno != EAGAIN)) {
+                close(p->fd);
+                p->fd = -1;
+            }
+        }
+    }
+
+    /* whatever is still writing has had its chance */
+    for (i = 0; i < n; i++) {
+        if (probes[i].pid && probes[i].fd >= 0) {
+            kill(-probes[i].pid, SIGKILL);
+            probes[i].timed_out = TRUE;
+            close(probes[i].fd);
+            probes[i].fd = -1;
+        }
+    }
+
+    dev_probes_reap(probes, n, deadline);
+
+    g_free(owner);
+    g_free(fds);
+}
+
+static gchar *dev_match_version(guint i, const gchar *output)
+{
+    GMatchInfo *match_info;
+    gchar *version = NULL;
+
+    if (!dev_regex[i])
+        dev_regex[i] = g_regex_new(detect_lang[i].regex, 0, 0, NULL);
+    if (!dev_regex[i])
+        return NULL;
+
+    g_regex_match(dev_regex[i], output, 0, &match_info);
+    if (g_match_info_matches(match_info))
+        version = g_match_info_fetch(match_info, 0);
+    g_match_info_free(match_info);
+
+    return version;
+}
+
+void scan_dev(gboolean reload)
+{
+    SCAN_START();
+
+    dev_probe probes[G_N_ELEMENTS(detect_lang)];
+    GKeyFile *cache = g_key_file_new();
+    gchar *cache_path = dev_cache_path();
+    gboolean cache_dirty = FALSE;
+    guint i;
+
+    memset(probes, 0, sizeof(probes));
+    g_key_file_load_from_file(cache, cache_path, G_KEY_FILE_NONE, NULL);
+
+    shell_status_update(_("Detecting versions..."));
+
+    for (i = 0; i < G_N_ELEMENTS(detect_lang); i++) {
+        dev_probe *p = &probes[i];
+        char *real_path;
+
+        p->fd = -1;
+        if (!detect_lang[i].regex)
+            continue;
+        if (!g_shell_parse_argv(detect_lang[i].version_command, NULL, &p->argv, NULL))
+            continue;
+        if (!(p->path = g_find_program_in_path(p->argv[0])))
+            continue;
+
+        if ((real_path = realpath(p->path, NULL))) {
+            p->real_path = g_strdup(real_path);
+            free(real_path);
+        }
+        if (!p->real_path || stat(p->real_path, &p->st) != 0)
+            continue;
+
+        if (!dev_cache_lookup(cache, detect_lang[i].version_command, p))
+            dev_probe_spawn(p, detect_lang[i].read_stdout);
+    }
+
+    dev_probes_collect(probes, G_N_ELEMENTS(probes));
+
+    g_free(dev_list);
+    dev_list = g_strdup("");
+
+    for (i = 0; i < G_N_ELEMENTS(detect_lang); i++) {
+        dev_probe *p = &probes[i];
+
+        if (!detect_lang[i].regex) {
+            dev_list = h_strdup_cprintf("[%s]\n", dev_list, _(detect_lang[i].compiler_name));
+            continue;
+        }
+
+        if (p->output) {
+            p->version = dev_match_version(i, p->output->str);
+            if (!p->timed_out) {
+                dev_cache_store(cache, detect_lang[i].version_command, p);
+                cache_dirty = TRUE;
+            }
+            g_string_free(p->output, TRUE);
+        }
+
+        dev_list = h_strdup_cprintf("%s=%s\n", dev_list, detect_lang[i].compiler_name,
+                                    p->version ? p->version : _("Not found"));
+
+        g_free(p->version);
+        g_free(p->real_path);
+        g_free(p->path);
+        g_strfreev(p->argv);
+    }
+
+    if (cache_dirty) {
+        gchar *data = g_key_file_to_data(cache, NULL, NULL);
+
+        g_file_set_contents(cache_path, data, -1, NULL);
+        g_free(data);
+    }
+    g_key_file_free(cache);
+    g_free(cache_path);
+
+    SCAN_END();
+}
+
+gchar *callback_dev(void)
+{
+    return g_strdup_printf(
+                "[$ShellParam$]\n"
+                "ViewType=5\n"
+                "ColumnTitle$TextValue=%s\n" /* Program */
+                "ColumnTitle$Value=%s\n" /* Version */
+                "ShowColumnHeaders=true\n"
+                "%s",
+                _("Program"), _("Version"),
+                dev_list);
+}
+#endif /* GLIB_CHECK_VERSION(2,14,0) */
@@ -17,11 +17,19 @@
  */
 
 #include <string.h>
+#include <locale.h>
 
 #include "hardinfo.h"
 #include "computer.h"
 #include "cpu_util.h" /* for UNKIFNULL() */
 
+#if defined(__GLIBC__) && !defined(__UCLIBC__)
+/* glibc's compiled locales can be read directly, elsewhere
+ * `locale -va` is used */
+#define LOCALE_NATIVE 1
+#include <langinfo.h>
+#endif
+
 typedef struct {
     gchar name[32];
     gchar *title,
@@ -114,6 +122,284 @@ gchar *locale_info_section(locale_info *s) {
     return ret;
 }
 
+#ifdef LOCALE_NATIVE
+
+#ifndef LOCALE_DIR
+#define LOCALE_DIR "/usr/lib/locale"
+#endif
+#define LOCALE_ARCHIVE_MAGIC 0xde020109
+#define LOCALE_ARCHIVE_CATEGORIES 13 /* __LC_LAST */
+
+/* the parts of glibc's locarchive.h that are needed */
+struct locarhead {
+    guint32 magic;
+    guint32 serial;
+    guint32 namehash_offset;
+    guint32 namehash_used;
+    guint32 namehash_size;
+    guint32 string_offset;
+    guint32 string_used;
+    guint32 string_size;
+    guint32 locrectab_offset;
+    guint32 locrectab_used;
+    guint32 locrectab_size;
+    guint32 sumhash_offset;
+    guint32 sumhash_used;
+    guint32 sumhash_size;
+};
+
+struct namehashent {
+    guint32 hashval;
+    guint32 name_offset;
+    guint32 locrec_offset;
+};
+
+struct locrecent {
+    guint32 refs;
+    struct {
+        guint32 offset;
+        guint32 len;
+    } record[LOCALE_ARCHIVE_CATEGORIES];
+};
+
+/* locale names found by the last scan, so a selected row is only
+ * looked up if it really is a locale */
+static GHashTable *native_locales = NULL;
+
+/* a category's data, as in an LC_* file: magic, string count, offsets
+ * from its start, then the strings */
+static const gchar *locale_record_string(const guchar *rec, gsize len, guint idx)
+{
+    guint32 n, off;
+
+    if (!rec || len < 8)
+        return NULL;
+    memcpy(&n, rec + 4, 4);
+    if (idx >= n || 8 + (gsize)idx * 4 + 4 > len)
+        return NULL;
+    memcpy(&off, rec + 8 + idx * 4, 4);
+    /* empty fields are left out, as `locale -va` does */
+    if (off >= len || !rec[off] || !memchr(rec + off, 0, len - off))
+        return NULL;
+    return (const gchar *)rec + off;
+}
+
+static GMappedFile *locale_archive_open(void)
+{
+    gchar *path = g_build_filename(LOCALE_DIR, "locale-archive", NULL);
+    GMappedFile *mf = g_mapped_file_new(path, FALSE, NULL);
+    struct locarhead head;
+
+    g_free(path);
+    if (!mf)
+        return NULL;
+    if (g_mapped_file_get_length(mf) < sizeof(head))
+        goto bad;
+    memcpy(&head, g_mapped_file_get_contents(mf), sizeof(head));
+    if (head.magic != LOCALE_ARCHIVE_MAGIC
+        || head.namehash_offset > g_mapped_file_get_length(mf)
+        || head.namehash_size > (g_mapped_file_get_length(mf) - head.namehash_offset)
+                                    / sizeof(struct namehashent))
+        goto bad;
+    return mf;
+
+bad:
+    g_mapped_file_unref(mf);
+    return NULL;
+}
+
+static void archive_record(const guchar *data, gsize size, const struct locrecent *rec,
+                           int category, const guchar **ptr, gsize *len)
+{
+    if (rec->record[category].offset <= size
+        && rec->record[category].len <= size - rec->record[category].offset) {
+        *ptr = data + rec->record[category].offset;
+        *len = rec->record[category].len;
+    } else {
+        *ptr = NULL;
+        *len = 0;
+    }
+}
+
+/* name and LC_IDENTIFICATION/LC_CTYPE records of slot i of the name
+ * table; FALSE for empty or damaged slots */
+static gboolean locale_archive_entry(GMappedFile *mf, guint32 i, const gchar **name,
+                                     const guchar **id, gsize *id_len,
+                                     const guchar **ctype, gsize *ctype_len)
+{
+    const guchar *data = (const guchar *)g_mapped_file_get_contents(mf);
+    gsize size = g_mapped_file_get_length(mf);
+    struct locarhead head;
+    struct namehashent ent;
+    struct locrecent rec;
+
+    memcpy(&head, data, sizeof(head));
+    memcpy(&ent, data + head.namehash_offset + i * sizeof(ent), sizeof(ent));
+    if (!ent.locrec_offset || ent.name_offset >= size || size < sizeof(rec)
+        || !memchr(data + ent.name_offset, 0, size - ent.name_offset)
+        || ent.locrec_offset > size - sizeof(rec))
+        return FALSE;
+    memcpy(&rec, data + ent.locrec_offset, sizeof(rec));
+
+    *name = (const gchar *)data + ent.name_offset;
+    archive_record(data, size, &rec, LC_IDENTIFICATION, id, id_len);
+    archive_record(data, size, &rec, LC_CTYPE, ctype, ctype_len);
+
+    return TRUE;
+}
+
+static GMappedFile *locale_dir_file(const gchar *name, const gchar *category)
+{
+    gchar *path = g_build_filename(LOCALE_DIR, name, category, NULL);
+    GMappedFile *mf = g_mapped_file_new(path, FALSE, NULL);
+
+    g_free(path);
+    return mf;
+}
+
+#define LOCALE_STR(rec, len, item) \
+    g_strdup(locale_record_string(rec, len, _NL_ITEM_INDEX(item)))
+
+static void locale_info_fill(locale_info *li, const guchar *id, gsize id_len,
+                             const guchar *ctype, gsize ctype_len)
+{
+    li->title = LOCALE_STR(id, id_len, _NL_IDENTIFICATION_TITLE);
+    li->source = LOCALE_STR(id, id_len, _NL_IDENTIFICATION_SOURCE);
+    li->address = LOCALE_STR(id, id_len, _NL_IDENTIFICATION_ADDRESS);
+    li->email = LOCALE_STR(id, id_len, _NL_IDENTIFICATION_EMAIL);
+    li->language = LOCALE_STR(id, id_len, _NL_IDENTIFICATION_LANGUAGE);
+    li->territory = LOCALE_STR(id, id_len, _NL_IDENTIFICATION_TERRITORY);
+    li->revision = LOCALE_STR(id, id_len, _NL_IDENTIFICATION_REVISION);
+    li->date = LOCALE_STR(id, id_len, _NL_IDENTIFICATION_DATE);
+    li->codeset = LOCALE_STR(ctype, ctype_len, _NL_CTYPE_CODESET_NAME);
+}
+
+/* full details of one locale, built the first time its row is
+ * selected; NULL if name is not a locale found by the last scan */
+gchar *locale_get_info(const gchar *name)
+{
+    GMappedFile *mf, *ctf;
+    locale_info *li;
+    gchar *section;
+    gboolean found = FALSE;
+    guint32 i, n;
+
+    if (!native_locales || !g_hash_table_lookup_extended(native_locales, name, NULL, NULL))
+        return NULL;
+
+    li = g_new0(locale_info, 1);
+    g_strlcpy(li->name, name, sizeof(li->name));
+
+    if ((mf = locale_archive_open())) {
+        const struct locarhead *head = (const void *)g_mapped_file_get_contents(mf);
+
+        n = head->namehash_size;
+        for (i = 0; i < n && !found; i++) {
+            const gchar *ename;
+            const guchar *id, *ctype;
+            gsize id_len, ctype_len;
+
+            if (locale_archive_entry(mf, i, &ename, &id, &id_len, &ctype, &ctype_len)
+                && g_str_equal(ename, name)) {
+                locale_info_fill(li, id, id_len, ctype, ctype_len);
+                found = TRUE;
+            }
+        }
+        g_mapped_file_unref(mf);
+    }
+
+    if (!found && (mf = locale_dir_file(name, "LC_IDENTIFICATION"))) {
+        ctf = locale_dir_file(name, "LC_CTYPE");
+        locale_info_fill(li,
+            (const guchar *)g_mapped_file_get_contents(mf), g_mapped_file_get_length(mf),
+            ctf ? (const guchar *)g_mapped_file_get_contents(ctf) : NULL,
+            ctf ? g_mapped_file_get_length(ctf) : 0);
+        if (ctf)
+            g_mapped_file_unref(ctf);
+        g_mapped_file_unref(mf);
+    }
+
+    section = locale_info_section(li);
+    locale_info_free(li);
+    moreinfo_add_with_prefix("COMP", (gchar *)name, section); /* section becomes owned by moreinfo */
+    return section;
+}
+
+/* only the names and titles are needed for the list, and in the archive
+ * only the name table and each LC_IDENTIFICATION record are touched */
+static gchar *scan_languages_native(void)
+{
+    GHashTable *titles = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    GMappedFile *mf;
+    GDir *dir;
+    GList *names, *l;
+    const gchar *dname;
+    gchar *ret = NULL;
+    guint32 i;
+
+    if ((mf = locale_archive_open())) {
+        const struct locarhead *head = (const void *)g_mapped_file_get_contents(mf);
+
+        for (i = 0; i < head->namehash_size; i++) {
+            const gchar *name;
+            const guchar *id, *ctype;
+            gsize id_len, ctype_len;
+
+            if (locale_archive_entry(mf, i, &name, &id, &id_len, &ctype, &ctype_len))
+                g_hash_table_replace(titles, g_strdup(name),
+                    LOCALE_STR(id, id_len, _NL_IDENTIFICATION_TITLE));
+        }
+        g_mapped_file_unref(mf);
+    }
+
+    if ((dir = g_dir_open(LOCALE_DIR, 0, NULL))) {
+        while ((dname = g_dir_read_name(dir))) {
+            if (g_hash_table_lookup_extended(titles, dname, NULL, NULL))
+                continue;
+            if ((mf = locale_dir_file(dname, "LC_IDENTIFICATION"))) {
+                g_hash_table_insert(titles, g_strdup(dname),
+                    LOCALE_STR((const guchar *)g_mapped_file_get_contents(mf),
+                               g_mapped_file_get_length(mf), _NL_IDENTIFICATION_TITLE));
+                g_mapped_file_unref(mf);
+            }
+        }
+        g_dir_close(dir);
+    }
+
+    if (g_hash_table_size(titles) == 0) {
+        g_hash_table_destroy(titles);
+        return NULL;
+    }
+
+    ret = g_strdup("");
+    names = g_list_sort(g_hash_table_get_keys(titles), (GCompareFunc)strcmp);
+    for (l = names; l; l = l->next) {
+        const gchar *title = g_hash_table_lookup(titles, l->data);
+        gchar *clean_title = hardinfo_clean_value(title ? title : _("(Unknown)"), 0); /* may contain & */
+
+        ret = h_strdup_cprintf("$%s$%s=%s\n", ret, (gchar *)l->data, (gchar *)l->data, clean_title);
+        g_free(clean_title);
+    }
+    g_list_free(names);
+
+    if (native_locales)
+        g_hash_table_destroy(native_locales);
+    native_locales = titles;
+
+    return ret;
+}
+
+#undef LOCALE_STR
+
+#else
+
+gchar *locale_get_info(const gchar *name)
+{
+    return NULL;
+}
+
+#endif /* LOCALE_NATIVE */
+
 void scan_languages(OperatingSystem * os)
 {
     gboolean spawned;
@@ -125,6 +411,11 @@ void scan_languages(OperatingSystem * os)
 
     if(os->languages) g_free(os->languages);
 
+#ifdef LOCALE_NATIVE
+    if ((os->languages = scan_languages_native()))
+        return;
+#endif
+
     spawned = hardinfo_spawn_command_line_sync("locale -va", &out, &err, NULL, NULL);
     if (spawned) {
         ret = g_strdup("");
@@ -24,6 +24,7 @@
 #include "computer.h"
 #include "cpu_util.h" /* for STRIFNULL() */
 #include "hardinfo.h"
+#include "scan_profile.h"
 
 GHashTable *_module_hash_table = NULL;
 static gchar *kernel_modules_dir = NULL;
@@ -235,6 +236,7 @@ gint compar (gpointer a, gpointer b) {return strcmp( (char*)a, (char*)b );}
 
 void scan_modules_do(void) {
     FILE *lsmod;
+    ScanProfileEvent *ev;
     gchar buffer[1024];
     gchar *lsmod_path;
     gchar *module_icons;
@@ -252,18 +254,23 @@ void scan_modules_do(void) {
 
     lsmod_path = find_program("lsmod");
     if (!lsmod_path) return;
+    ev = scan_profile_begin(SCAN_PROFILE_SPAWN, lsmod_path);
     lsmod = popen(lsmod_path, "r");
     if (!lsmod) {
+        scan_profile_end(ev);
         g_free(lsmod_path);
         return;
     }
 
     char *c=fgets(buffer, 1024, lsmod); /* Discards the first line */
-    if(!c) return;
     //Sort modules
-    while (fgets(buffer, 1024, lsmod)) {
+    while (c && fgets(buffer, 1024, lsmod)) {
         list=g_list_prepend(list,g_strdup(buffer));
     }
+    pclose(lsmod);
+    scan_profile_end(ev);
+    g_free(lsmod_path);
+    if(!c) return;
     list=g_list_sort(list,(GCompareFunc)compar);
 
     while (list) {
@@ -281,8 +288,9 @@ void scan_modules_do(void) {
         hashkey = g_strdup_printf("MOD%s", modname);
         buf = g_strdup_printf("/sbin/modinfo %s 2>/dev/null", modname);
 
+        ev = scan_profile_begin(SCAN_PROFILE_SPAWN, buf);
         modi = popen(buf, "r");
-        while (fgets(buffer, 1024, modi)) {
+        while (modi && fgets(buffer, 1024, modi)) {
             gchar **tmp = g_strsplit(buffer, ":", 2);
 
 	    if (!author && strstr(tmp[0], "author")) author = g_markup_escape_text(g_strstrip(tmp[1]), strlen(tmp[1]));
@@ -298,7 +306,8 @@ void scan_modules_do(void) {
 
             g_strfreev(tmp);
         }
-        pclose(modi);
+        if (modi) pclose(modi);
+        scan_profile_end(ev);
         g_free(buf);
 
         /* old modutils includes quotes in some strings; strip them */
@@ -395,9 +404,6 @@ void scan_modules_do(void) {
         g_list_free_1(a);
     }
 
-    pclose(lsmod);
-
-    g_free(lsmod_path);
     g_free(kernel_modules_dir);
 
     if (module_list != NULL && module_icons != NULL) {
@@ -20,6 +20,10 @@
 #include <string.h>
 #include <ctype.h>
 #include <sys/utsname.h>
+#include <sys/klog.h>
+#if defined(__GLIBC__) && !defined(__UCLIBC__)
+#include <gnu/libc-version.h>
+#endif
 #include "hardinfo.h"
 #include "computer.h"
 #include "util_sysobj.h" /* for appfsp() */
@@ -144,6 +148,70 @@ void apt_flavors_scan(gchar **pretty_name, gchar **codename, gchar **id, gchar *
 }
 
 
+/* musl has no version call, but its loader carries the bare version
+ * string ("1.2.4") in .rodata */
+static gchar *musl_loader_version(const gchar *loader)
+{
+    GMappedFile *mf = g_mapped_file_new(loader, FALSE, NULL);
+    const gchar *data, *p, *end;
+    gchar *ret = NULL;
+
+    if (!mf)
+        return NULL;
+    data = g_mapped_file_get_contents(mf);
+    end = data + g_mapped_file_get_length(mf);
+
+    for (p = data; p < end && !ret; p++) {
+        const gchar *q = p;
+        int dots = 0;
+
+        if (p > data && p[-1] != 0)
+            continue;
+        while (q < end && (isdigit((guchar)*q) || *q == '.')) {
+            dots += *q == '.';
+            q++;
+        }
+        if (q < end && *q == 0 && dots == 2 && q - p >= 5 && isdigit((guchar)p[0]) && isdigit((guchar)q[-1]))
+            ret = g_strndup(p, q - p);
+    }
+
+    g_mapped_file_unref(mf);
+    return ret;
+}
+
+/* the C library this process runs on is the system one, so ask it or
+ * look at the loader before resorting to running tools */
+static gchar *get_libc_version_probe(void)
+{
+#if defined(__GLIBC__) && !defined(__UCLIBC__)
+    return g_strdup_printf("%s / %s", _("GNU C Library"), gnu_get_libc_version());
+#else
+    gchar *ret = NULL;
+    GDir *dir;
+    const gchar *name;
+
+    if (!(dir = g_dir_open("/lib", 0, NULL)))
+        return NULL;
+
+    while (!ret && (name = g_dir_read_name(dir))) {
+        if (g_str_has_prefix(name, "ld-musl-") && g_str_has_suffix(name, ".so.1")) {
+            gchar *loader = g_build_filename("/lib", name, NULL);
+            gchar *ver = musl_loader_version(loader);
+
+            ret = ver ? g_strdup_printf("%s / %s", _("musl C Library"), ver)
+                      : g_strdup(_("musl C Library"));
+            g_free(ver);
+            g_free(loader);
+        } else if (g_str_has_prefix(name, "ld-uClibc")) {
+            ret = g_strdup(_("uClibc or uClibc-ng"));
+        }
+    }
+    g_dir_close(dir);
+
+    return ret;
+#endif
+}
+
 static gchar *get_libc_version(void)
 {
     static const struct {
@@ -166,6 +234,8 @@ static gchar *get_libc_version(void)
     gboolean spawned;
     gchar *out, *err, *p, *ret=NULL,*ver_str;
 
+    ret = get_libc_version_probe();
+
     while (!ret && libs[i].test_cmd) {
         out=(err=NULL);
         spawned = hardinfo_spawn_command_line_sync(libs[i].test_cmd, &out, &err, NULL, NULL);
@@ -199,87 +269,93 @@ static gchar *get_libc_version(void)
     return ret;
 }
 
-static gchar *detect_kde_version(void)
+/* <platform>, <minor> and <micro> of the gnome-version.xml style files
+ * that GNOME and MATE install for their about dialogs */
+static gchar *read_version_xml(const gchar *file)
 {
-  gchar *cmd,*ret=NULL;
-    const gchar *tmp = g_getenv("KDE_SESSION_VERSION");
-    gchar *out=NULL;
-    gboolean spawned;
-
-    if (tmp && tmp[0] == '4') {
-        cmd = "kwin --version";
-    } else {
-        cmd = "kcontrol --version";
+    const gchar * const *dirs = g_get_system_data_dirs();
+    const gchar *tags[] = { "platform", "minor", "micro" };
+    gchar *ret = NULL;
+    int i, t;
+
+    for (i = 0; dirs[i] && !ret; i++) {
+        gchar *path = g_build_filename(dirs[i], file, NULL);
+        gchar *xml = NULL;
+
+        if (g_file_get_contents(path, &xml, NULL, NULL)) {
+            for (t = 0; t < (int)G_N_ELEMENTS(tags); t++) {
+                gchar *tag = g_strdup_printf("<%s>", tags[t]);
+                gchar *v = strstr(xml, tag), *e;
+
+                if (v && (e = strchr(v += strlen(tag), '<')) && e > v) {
+                    gchar *part = g_strndup(v, e - v);
+
+                    ret = ret ? h_strdup_cprintf(".%s", ret, g_strstrip(part))
+                              : g_strdup(g_strstrip(part));
+                    g_free(part);
+                }
+                g_free(tag);
+                if (!ret)
+                    break;
+            }
+            g_free(xml);
+        }
+        g_free(path);
     }
 
-    spawned = hardinfo_spawn_command_line_sync(cmd, &out, NULL, NULL, NULL);
-    if (!spawned) return NULL;
-
-    tmp = strstr(out, "KDE: ");
-    if(tmp) ret=g_strdup(tmp + strlen("KDE: "));
-
-    g_free(out);
-
     return ret;
 }
 
-
-static gchar *detect_gnome_version(void)
+static gchar *detect_kde_version(void)
 {
-    gchar *tmp;
-    gchar *out,*ret=NULL;
-    gboolean spawned;
-
-    spawned = hardinfo_spawn_command_line_sync("gnome-shell --version", &out, NULL, NULL, NULL);
-    if (spawned) {
-        tmp = strstr(out, _("GNOME Shell "));
-
-        if (tmp) {
-            tmp += strlen(_("GNOME Shell "));
-            ret=g_strdup_printf("GNOME %s", strend(tmp, '\n'));
-	    g_free(out);
-	    return ret;
+    static const gchar *sessions[] = {
+        "wayland-sessions/plasma.desktop", "xsessions/plasma.desktop",
+        "wayland-sessions/plasmawayland.desktop", "xsessions/plasmax11.desktop",
+        "xsessions/kde-plasma.desktop", NULL
+    };
+    const gchar * const *dirs = g_get_system_data_dirs();
+    gchar *ret = NULL;
+    int i, d;
+
+    /* Plasma puts its version in its session files */
+    for (d = 0; dirs[d] && !ret; d++) {
+        for (i = 0; sessions[i] && !ret; i++) {
+            gchar *path = g_build_filename(dirs[d], sessions[i], NULL);
+            GKeyFile *kf = g_key_file_new();
+
+            if (g_key_file_load_from_file(kf, path, G_KEY_FILE_NONE, NULL)) {
+                gchar *ver = g_key_file_get_string(kf, G_KEY_FILE_DESKTOP_GROUP,
+                                                   "X-KDE-PluginInfo-Version", NULL);
+                if (ver && *ver)
+                    ret = g_strdup_printf("KDE Plasma %s", ver);
+                g_free(ver);
+            }
+            g_key_file_free(kf);
+            g_free(path);
         }
-        g_free(out);
     }
 
-    spawned = hardinfo_spawn_command_line_sync("gnome-about --gnome-version", &out, NULL, NULL, NULL);
-    if (spawned) {
-        tmp = strstr(out, _("Version: "));
+    return ret;
+}
+
 
-        if (tmp) {
-            tmp += strlen(_("Version: "));
-            ret=g_strdup_printf("GNOME %s", strend(tmp, '\n'));
-            g_free(out);
-	    return ret;
-        }
-        g_free(out);
-    }
+static gchar *detect_gnome_version(void)
+{
+    gchar *ver = read_version_xml("gnome/gnome-version.xml");
+    gchar *ret = ver ? g_strdup_printf("GNOME %s", ver) : NULL;
 
-    return NULL;
+    g_free(ver);
+    return ret;
 }
 
 
 static gchar *detect_mate_version(void)
 {
-    gchar *tmp;
-    gchar *out,*ret=NULL;
-    gboolean spawned;
+    gchar *ver = read_version_xml("mate-about/mate-version.xml");
+    gchar *ret = ver ? g_strdup_printf("MATE %s", ver) : NULL;
 
-    spawned = hardinfo_spawn_command_line_sync("mate-about --version", &out, NULL, NULL, NULL);
-    if (spawned) {
-        tmp = strstr(out, _("MATE Desktop Environment "));
-
-        if (tmp) {
-            tmp += strlen(_("MATE Desktop Environment "));
-	    ret=g_strdup_printf("MATE %s", strend(tmp, '\n'));
-	    g_free(out);
-            return ret;
-        }
-        g_free(out);
-    }
-
-    return NULL;
+    g_free(ver);
+    return ret;
 }
 
 static gchar *detect_window_manager(void)
@@ -389,15 +465,17 @@ static gchar *detect_desktop_environment(void)
     return g_strdup(_("Unknown"));
 }
 
+#ifndef SYSLOG_ACTION_SIZE_BUFFER
+#define SYSLOG_ACTION_SIZE_BUFFER 10
+#endif
+
 gchar *computer_get_dmesg_status(void)
 {
-    gchar *out = NULL, *err = NULL;
-    int ex = 1, result = 0;
-    hardinfo_spawn_command_line_sync("dmesg", &out, &err, &ex, NULL);
-    g_free(out);
-    g_free(err);
+    int result = 0;
+    /* same check dmesg_restrict applies to reading the log, without
+     * reading it */
     result += (getuid() == 0) ? 2 : 0;
-    result += ex ? 1 : 0;
+    result += (klogctl(SYSLOG_ACTION_SIZE_BUFFER, NULL, 0) < 0) ? 1 : 0;
     switch(result) {
         case 0: /* readable, user */
             return g_strdup(_("User access allowed"));
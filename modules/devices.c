@@ -23,11 +23,13 @@
 #include <gtk/gtk.h>
 #include <config.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <hardinfo.h>
 #include <shell.h>
 #include <iconcache.h>
 #include <syncmanager.h>
+#include <inventory.h>
 
 #include <expr.h>
 #include <socket.h>
@@ -55,6 +57,7 @@ gchar *callback_dmi_mem();
 gchar *callback_firmware();
 gchar *callback_dtree();
 gchar *callback_device_resources();
+gchar *callback_interrupts();
 
 void scan_processors(gboolean reload);
 void scan_gpu(gboolean reload);
@@ -71,8 +74,10 @@ void scan_dmi_mem(gboolean reload);
 void scan_firmware(gboolean reload);
 void scan_dtree(gboolean reload);
 void scan_device_resources(gboolean reload);
+void scan_interrupts(gboolean reload);
 
 gboolean root_required_for_resources(void);
+gboolean interrupts_since_boot(void);
 gboolean spd_decode_show_hinote(const char**);
 
 gchar *hi_more_info(gchar *entry);
@@ -92,7 +97,8 @@ enum {
     ENTRY_SENSORS,
     ENTRY_INPUT,
     ENTRY_STORAGE,
-    ENTRY_RESOURCES
+    ENTRY_RESOURCES,
+    ENTRY_INTERRUPTS
 };
 
 static ModuleEntry entries[] = {
@@ -115,6 +121,7 @@ static ModuleEntry entries[] = {
     [ENTRY_DTREE] = {N_("Device Tree"), "devicetree.svg", callback_dtree, scan_dtree, MODULE_FLAG_NONE},
 #endif	/* x86 or x86_64 */
     [ENTRY_RESOURCES] = {N_("Resources"), "resources.svg", callback_device_resources, scan_device_resources, MODULE_FLAG_NONE},
+    [ENTRY_INTERRUPTS] = {N_("Interrupts"), "resources.svg", callback_interrupts, scan_interrupts, MODULE_FLAG_NONE},
     { NULL }
 };
 
@@ -143,7 +150,7 @@ gboolean firmware_hinote(const char **msg);
 gchar *firmware_info = NULL;
 
 /* in monitors.c */
-gchar *monitors_get_info();
+gchar *monitors_get_info(gboolean reload);
 gboolean monitors_hinote(const char **msg);
 gchar *monitors_info = NULL;
 
@@ -270,13 +277,13 @@ gchar *ldlinux_hwcaps() {
 
     if(PTR_BITS==64){//64bit
         cmd_line=g_strdup("sh -c 'LC_ALL=C /usr/lib64/ld-linux-x86-64.so.2 --help'");
-	spawned = g_spawn_command_line_sync(cmd_line, &out, &err, NULL, NULL);
+	spawned = hardinfo_spawn_command_line_sync(cmd_line, &out, &err, NULL, NULL);
 	g_free(cmd_line);
 	if (!spawned || strlen(out)<100) {
 	   if(out) {g_free(out);out=NULL;}
 	   if(err) {g_free(err);err=NULL;}
 	   cmd_line=g_strdup("sh -c 'LC_ALL=C /lib64/ld-linux-x86-64.so.2 --help'");
-	   spawned = g_spawn_command_line_sync(cmd_line, &out, &err, NULL, NULL);
+	   spawned = hardinfo_spawn_command_line_sync(cmd_line, &out, &err, NULL, NULL);
 	   g_free(cmd_line);
 	}
 	if (spawned && strlen(out)>=100) {
@@ -291,7 +298,7 @@ gchar *ldlinux_hwcaps() {
 	}
     } else {//32bit and others
         cmd_line=g_strdup("sh -c 'LC_ALL=C uname -m'");
-	spawned = g_spawn_command_line_sync(cmd_line, &out, &err, NULL, NULL);
+	spawned = hardinfo_spawn_command_line_sync(cmd_line, &out, &err, NULL, NULL);
 	g_free(cmd_line);
 	if (spawned && strlen(out)>=1) {
 	    supported=g_strconcat(supported, " ",out," ", NULL);
@@ -336,6 +343,20 @@ gchar *get_processor_desc(void)
     return processor_describe(processors);
 }
 
+/* space separated flags of the first processor, for picking code paths */
+gchar *get_processor_flags(void)
+{
+    scan_processors(FALSE);
+#if defined(ARCH_x86) || defined(ARCH_x86_64) || defined(ARCH_arm) || defined(ARCH_riscv) || defined(ARCH_parisc)
+    if (processors) {
+        Processor *p = (Processor *)processors->data;
+        if (p->flags)
+            return g_strdup(p->flags);
+    }
+#endif
+    return NULL;
+}
+
 gchar *get_processor_name_and_desc(void)
 {
     scan_processors(FALSE);
@@ -401,7 +422,7 @@ gchar *get_storage_home_models(void)
     char cmd_lineblk[100];
 
     //lookup home disk by df - only works on newer machines
-    spawned = g_spawn_command_line_sync(cmd_line, &out, &err, NULL, NULL);
+    spawned = hardinfo_spawn_command_line_sync(cmd_line, &out, &err, NULL, NULL);
     if(spawned && out){
         if(strstr(out,"/dev/") && !strstr(out,"mapper") && !strstr(out,"/dev/root") ) homepath=strdup(out+5);
 	if(strstr(out,"mapper")) {
@@ -410,7 +431,7 @@ gchar *get_storage_home_models(void)
 	    sprintf(cmd_lineblk,"sh -c 'lsblk -l -s %s|tail -1'",out);
 	    g_free(out);
 	    g_free(err);
-            spawned = g_spawn_command_line_sync(cmd_lineblk, &out, &err, NULL, NULL);
+            spawned = hardinfo_spawn_command_line_sync(cmd_lineblk, &out, &err, NULL, NULL);
 	    if(spawned && out){
 	        p=strstr(out," ")+1;//note: field 4 is size
 	        *p=0;
@@ -422,7 +443,7 @@ gchar *get_storage_home_models(void)
     g_free(err);
 
     if(!homepath) {  //simple systems - only 1 disk
-        spawned = g_spawn_command_line_sync(cmd_line1disk, &out, &err, NULL, NULL);
+        spawned = hardinfo_spawn_command_line_sync(cmd_line1disk, &out, &err, NULL, NULL);
         if(spawned && out){
 	    if(strstr(out,"disk") && (strstr(out,"\n")==(out+strlen(out)-1)) ) {
 	        p=strstr(out," ")+1;//note: field 4 is size
@@ -779,6 +800,7 @@ const ShellModuleMethod *hi_exported_methods(void)
         {"getProcessorName", get_processor_name},
         {"getProcessorDesc", get_processor_desc},
         {"getProcessorNameAndDesc", get_processor_name_and_desc},
+        {"getProcessorFlags", get_processor_flags},
         {"getProcessorFrequency", get_processor_max_frequency},
         {"getProcessorFrequencyDesc", get_processor_frequency_desc},
         {"getProcessorHwCaps", ldlinux_hwcaps},
@@ -811,7 +833,11 @@ gchar *hi_more_info(gchar * entry)
 
 gchar *hi_get_field(gchar * field)
 {
-    gchar *info = moreinfo_lookup_with_prefix("DEV", field);
+    gchar *info = gpu_sensor_field(field);
+    if (info)
+        return info;
+
+    info = moreinfo_lookup_with_prefix("DEV", field);
     if (info)
         return g_strdup(info);
 
@@ -847,7 +873,7 @@ void scan_monitors(gboolean reload)
     SCAN_START();
     if (monitors_info)
         g_free(monitors_info);
-    monitors_info = monitors_get_info();
+    monitors_info = monitors_get_info(reload);
     SCAN_END();
 }
 
@@ -975,6 +1001,15 @@ gchar *callback_dtree()
 
 gchar *callback_battery()
 {
+    /* UPS values and battery power draw go to the load graph; with
+     * nothing charted the page stays in the detail view */
+    if (battery_lginterval)
+        return g_strdup_printf("%s\n"
+                               "[$ShellParam$]\n"
+                               "ViewType=2\n"
+                               "LoadGraphSuffix=\n"
+                               "ReloadInterval=4000\n"
+                               "%s", battery_list, battery_lginterval);
     return g_strdup_printf("%s\n"
 			   "[$ShellParam$]\n"
 			   "ViewType=5\n"
@@ -1114,7 +1149,6 @@ void hi_module_init(void)
     for (i = 0; i < G_N_ELEMENTS(entries); i++)
         sync_manager_add_entry(&entries[i]);
 
-    init_cups();
     sensor_init();
     udisks2_init();
 
@@ -1130,7 +1164,7 @@ void hi_module_deinit(void)
     sensor_shutdown();
     storage_shutdown();
     udisks2_shutdown();
-    if(cups) g_module_close(cups);
+    printers_shutdown();
 }
 
 const ModuleAbout *hi_module_get_about(void)
@@ -1169,6 +1203,11 @@ const gchar *hi_note_func(gint entry)
             return g_strdup(_("Ensure hardinfo2 service is enabled+started: sudo systemctl enable hardinfo2 --now (SystemD distro)\nAdd yourself to hardinfo2 group: sudo usermod -a -G hardinfo2 YOUR_LOGIN\nAnd Logout/Reboot for groups to be updated..."));
         }
     }
+    else if (entry == ENTRY_INTERRUPTS) {
+        if (interrupts_since_boot()) {
+            return g_strdup(_("Rates are averaged since boot until the next sample."));
+        }
+    }
     else if (entry == ENTRY_STORAGE){
         if (storage_no_nvme) {
             return g_strdup(
@@ -1190,3 +1229,36 @@ const gchar *hi_note_func(gint entry)
     }
     return NULL;
 }
+
+gchar *hi_inventory_token(gint entry)
+{
+    gchar *a, *b, *ret;
+
+    switch (entry) {
+    case ENTRY_PCI:
+        a = inventory_dir_token("/sys/bus/pci/devices", "uevent");
+        b = inventory_ids_token("pci.ids");
+        break;
+    case ENTRY_USB:
+        a = inventory_dir_token("/sys/bus/usb/devices", "uevent");
+        b = inventory_ids_token("usb.ids");
+        break;
+    case ENTRY_MONITORS:
+        a = inventory_dir_token("/sys/class/drm", "edid");
+        b = inventory_ids_token("edid.ids");
+        break;
+    case ENTRY_DMI:
+    case ENTRY_DMI_MEM:
+    case ENTRY_DTREE:
+        /* firmware tables only change across a reboot, root sees more */
+        return g_strdup_printf("%s:%d", inventory_boot_id(), getuid() == 0);
+    default:
+        return NULL;
+    }
+
+    ret = g_strdup_printf("%s:%d:%s:%s", inventory_boot_id(), getuid() == 0, a, b);
+    g_free(a);
+    g_free(b);
+
+    return ret;
+}
@@ -18,9 +18,17 @@
 
 #include <string.h>
 #include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
 
 #include "hardinfo.h"
 #include "devices.h"
+#include "timeseries.h"
 
 const struct {
   gchar *key, *name;
@@ -51,50 +59,247 @@ const struct {
 };
 
 
+/* seconds on a clock that doesn't jump */
+static gdouble battery_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* samples of the charted fields: UPS values and battery power draw */
+static TimeSeriesStore *battery_history = NULL;
+
+gchar *battery_lginterval = NULL;
+
+/* record a sample for the load graph and return the range seen so far */
+static void battery_chart(const gchar *tag, const gchar *value, gdouble v,
+                          gdouble *lo, gdouble *hi)
+{
+    TimeSeries *ts;
+    guint n;
+
+    if (!battery_history)
+        battery_history = time_series_store_new(TIME_SERIES_DEFAULT_SIZE);
+    time_series_store_append(battery_history, tag, v);
+    ts = time_series_store_lookup(battery_history, tag);
+    *lo = *hi = v;
+    for (n = 0; n < ts->len; n++) {
+        *lo = MIN(*lo, time_series_get(ts, n));
+        *hi = MAX(*hi, time_series_get(ts, n));
+    }
+
+    moreinfo_add_with_prefix("DEV", (gchar *)tag, g_strdup(value));
+    battery_lginterval = h_strdup_cprintf("UpdateInterval$%s=4000\n",
+                                          battery_lginterval ? battery_lginterval : g_strdup(""), tag);
+}
+
+/* apcupsd's Network Information Server: each message is a 16-bit big
+ * endian length and that many bytes. A "status" request is answered with
+ * one message per "KEY      : value" line and a zero length message.
+ * The server keeps serving requests on a connection, so it is kept. */
+#define APCUPSD_DEFAULT_HOST "localhost"
+#define APCUPSD_DEFAULT_PORT "3551"
+#ifndef APCUPSD_TIMEOUT
+#define APCUPSD_TIMEOUT 2         /* seconds for a whole scan's exchange */
+#endif
+#define APCUPSD_RETRY_AFTER 30    /* seconds after a failed exchange */
+
+static int ups_fd = -1;
+static gdouble ups_retry_at = 0;
+static gchar *ups_values[G_N_ELEMENTS(ups_fields)];
+static const gchar *ups_charted[] = { "LINEV", "LOADPCT", "BCHARGE" };
+
+
+static void nis_close(void)
+{
+    if (ups_fd >= 0)
+        close(ups_fd);
+    ups_fd = -1;
+}
+
+/* the socket is non-blocking, so every wait is bounded by the
+ * deadline of the scan */
+static gboolean nis_wait(short events, gdouble deadline)
+{
+    struct pollfd pfd = { ups_fd, events, 0 };
+    int r;
+
+    do {
+        gdouble left = deadline - battery_now();
+
+        if (left <= 0)
+            return FALSE;
+        r = poll(&pfd, 1, (int)(left * 1000) + 1);
+    } while (r < 0 && errno == EINTR);
+    return r > 0;
+}
+
+static gboolean nis_connect(gdouble deadline)
+{
+    GKeyFile *key_file = g_key_file_new();
+    gchar *conf_path = g_build_filename(g_get_user_config_dir(), "hardinfo2", "settings.ini", NULL);
+    gchar *host, *port;
+    struct addrinfo hints, *res = NULL, *ai;
+
+    g_key_file_load_from_file(key_file, conf_path, G_KEY_FILE_NONE, NULL);
+    host = g_key_file_get_string(key_file, "Devices", "ApcupsdHost", NULL);
+    port = g_key_file_get_string(key_file, "Devices", "ApcupsdPort", NULL);
+    g_free(conf_path);
+    g_key_file_free(key_file);
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host ? host : APCUPSD_DEFAULT_HOST,
+                    port ? port : APCUPSD_DEFAULT_PORT, &hints, &res) == 0) {
+        for (ai = res; ai && ups_fd < 0; ai = ai->ai_next) {
+            int err = 0;
+            socklen_t err_len = sizeof(err);
+
+            ups_fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                            ai->ai_protocol);
+            if (ups_fd < 0)
+                continue;
+            if (connect(ups_fd, ai->ai_addr, ai->ai_addrlen) < 0
+                && (errno != EINPROGRESS || !nis_wait(POLLOUT, deadline)
+                    || getsockopt(ups_fd, SOL_SOCKET, SO_ERROR, &err, &err_len) < 0 || err))
+                nis_close();
+        }
+        freeaddrinfo(res);
+    }
+
+    g_free(host);
+    g_free(port);
+    return ups_fd >= 0;
+}
+
+static gboolean nis_io(gboolean sending, gchar *buf, gsize len, gdouble deadline)
+{
+    while (len) {
+        ssize_t n = sending ? send(ups_fd, buf, len, MSG_NOSIGNAL)
+                            : recv(ups_fd, buf, len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!nis_wait(sending ? POLLOUT : POLLIN, deadline))
+                return FALSE;
+            continue;
+        }
+        if (n <= 0)
+            return FALSE;
+        buf += n;
+        len -= n;
+    }
+    return TRUE;
+}
+
+/* one full status into ups_values[]; FALSE if the connection failed */
+static gboolean nis_status(gdouble deadline)
+{
+    gchar msg[2 + 6] = { 0, 6, 's', 't', 'a', 't', 'u', 's' };
+    gchar buf[512];
+    guint16 len;
+    guint i;
+
+    if (!nis_io(TRUE, msg, sizeof(msg), deadline))
+        return FALSE;
+
+    for (i = 0; i < G_N_ELEMENTS(ups_values); i++) {
+        g_free(ups_values[i]);
+        ups_values[i] = NULL;
+    }
+
+    for (;;) {
+        gchar *sep;
+
+        if (!nis_io(FALSE, (gchar *)&len, 2, deadline))
+            return FALSE;
+        len = ntohs(len);
+        if (len == 0)
+            return TRUE;
+        if (len >= sizeof(buf))
+            return FALSE;
+        if (!nis_io(FALSE, buf, len, deadline))
+            return FALSE;
+        buf[len] = 0;
+
+        if (!(sep = strchr(buf, ':')))
+            continue;
+        *sep = 0;
+        g_strstrip(buf);
+        for (i = 0; i < G_N_ELEMENTS(ups_fields); i++) {
+            if (ups_fields[i].name && g_str_equal(ups_fields[i].key, buf)) {
+                g_free(ups_values[i]);
+                ups_values[i] = g_strdup(g_strstrip(sep + 1));
+                break;
+            }
+        }
+    }
+}
+
+static gboolean ups_is_charted(const gchar *key)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(ups_charted); i++)
+        if (g_str_equal(ups_charted[i], key))
+            return TRUE;
+    return FALSE;
+}
+
 static void
 __scan_battery_apcupsd(void)
 {
-    GHashTable  *ups_data;
-    FILE	*apcaccess;
-    char	buffer[512], *apcaccess_path;
-    guint		i;
-
-    apcaccess_path = find_program("apcaccess");
-    if (apcaccess_path && (apcaccess = popen(apcaccess_path, "r"))) {
-      /* first line isn't important */
-      if (fgets(buffer, 512, apcaccess)) {
-        /* allocate the key, value hash table */
-        ups_data = g_hash_table_new(g_str_hash, g_str_equal);
-
-        /* read up all the apcaccess' output, saving it in the key, value hash table */
-        while (fgets(buffer, 512, apcaccess)) {
-          buffer[9] = '\0';
-
-          g_hash_table_insert(ups_data,
-                              g_strdup(g_strstrip(buffer)),
-                              g_strdup(g_strstrip(buffer + 10)));
+    /* connecting, the request and a reconnect all share one deadline */
+    gdouble deadline = battery_now() + APCUPSD_TIMEOUT;
+    gboolean ok;
+    guint i;
+
+    if (ups_fd < 0) {
+        /* backing off since the last failure */
+        if (battery_now() < ups_retry_at)
+            return;
+        ok = nis_connect(deadline) && nis_status(deadline);
+    } else {
+        /* the kept connection may have been dropped by apcupsd */
+        ok = nis_status(deadline);
+        if (!ok) {
+            nis_close();
+            ok = nis_connect(deadline) && nis_status(deadline);
         }
+    }
+    if (!ok) {
+        /* whatever failed: refused, timed out or cut off mid-status */
+        nis_close();
+        ups_retry_at = battery_now() + APCUPSD_RETRY_AFTER;
+        return;
+    }
 
-        /* builds the ups info string, respecting the field order as found in ups_fields */
-        for (i = 0; i < G_N_ELEMENTS(ups_fields); i++) {
-          if (!ups_fields[i].name) {
+    /* builds the ups info string, respecting the field order as found in ups_fields */
+    for (i = 0; i < G_N_ELEMENTS(ups_fields); i++) {
+        const gchar *key = ups_fields[i].key, *value = ups_values[i];
+
+        if (!ups_fields[i].name) {
             /* there's no name: make a group with the key as its name */
-            battery_list = h_strdup_cprintf("[%s]\n", battery_list, ups_fields[i].key);
-          } else {
+            battery_list = h_strdup_cprintf("[%s]\n", battery_list, key);
+        } else if (value && ups_is_charted(key)) {
+            /* "230.0 Volts": charted by the load graph through
+             * hi_get_field(), with the recorded range alongside */
+            gchar *tag = g_strdup_printf("UPS_%s", key);
+            gdouble lo, hi;
+
+            battery_chart(tag, value, g_ascii_strtod(value, NULL), &lo, &hi);
+            battery_list = h_strdup_cprintf("$%s$%s=%s|%.1f - %.1f\n", battery_list,
+                                            tag, ups_fields[i].name, value, lo, hi);
+            g_free(tag);
+        } else {
             /* there's a name: adds a line */
-            const gchar *name = g_hash_table_lookup(ups_data, ups_fields[i].key);
             battery_list = h_strdup_cprintf("%s=%s\n", battery_list,
-                                            ups_fields[i].name, name);
-          }
+                                            ups_fields[i].name, value ? value : _("(Unknown)"));
         }
-
-        g_hash_table_destroy(ups_data);
-      }
-
-      pclose(apcaccess);
     }
-    
-    g_free(apcaccess_path);
 }
 
 static void
@@ -234,72 +439,266 @@ read_contents(const gchar *base, const gchar *key)
     return g_strchomp(value);
 }
 
+/* Supplies under /sys/class/power_supply are kept between scans: the
+ * attributes that change are read through open descriptors with pread(),
+ * the rest once when the supply appears. The list is rebuilt when a
+ * power_supply uevent adds or removes one. */
+#ifndef POWER_SUPPLY_DIR
+#define POWER_SUPPLY_DIR "/sys/class/power_supply"
+#endif
+#define PS_RATE_TAU 60.0 /* seconds, smoothing of the discharge rate */
+
+enum {
+    PS_STATUS,
+    PS_ONLINE,
+    PS_CAPACITY,
+    PS_CAPACITY_LEVEL,
+    PS_POWER_NOW,
+    PS_CURRENT_NOW,
+    PS_VOLTAGE_NOW,
+    PS_ENERGY_NOW,
+    PS_CHARGE_NOW,
+    PS_N_HOT
+};
+
+static const gchar *ps_hot_attrs[PS_N_HOT] = {
+    "status", "online", "capacity", "capacity_level", "power_now",
+    "current_now", "voltage_now", "energy_now", "charge_now"
+};
+
+typedef struct {
+    gchar *name;
+    gboolean is_ac, is_battery;
+    int fd[PS_N_HOT];
+    gchar *type, *technology, *manufacturer, *model_name, *serial_number;
+    gchar *energy_full_design, *charge_full_design, *charge_full, *voltage_min_design;
+    /* discharge estimate */
+    gdouble rate;        /* smoothed W, < 0 while unknown */
+    gdouble last_energy; /* Wh, < 0 while unknown */
+    gdouble last_t;
+} power_supply;
+
+static GSList *power_supplies = NULL;
+static int ps_uevent_fd = -2;
+
+static void power_supply_free(power_supply *ps)
+{
+    int i;
+
+    for (i = 0; i < PS_N_HOT; i++)
+        if (ps->fd[i] >= 0)
+            close(ps->fd[i]);
+    g_free(ps->name);
+    g_free(ps->type);
+    g_free(ps->technology);
+    g_free(ps->manufacturer);
+    g_free(ps->model_name);
+    g_free(ps->serial_number);
+    g_free(ps->energy_full_design);
+    g_free(ps->charge_full_design);
+    g_free(ps->charge_full);
+    g_free(ps->voltage_min_design);
+    g_free(ps);
+}
+
+static power_supply *power_supply_new(const gchar *name)
+{
+    power_supply *ps;
+    gchar *path;
+    int i;
+
+    ps = g_new0(power_supply, 1);
+    ps->name = g_strdup(name);
+    ps->is_ac = name[0] == 'A' || strstr(name, "macsmc-ac");
+    ps->is_battery = name[0] == 'B' || strstr(name, "CMB") || strstr(name, "macsmc-battery");
+    ps->rate = ps->last_energy = -1;
+
+    path = g_build_filename(POWER_SUPPLY_DIR, name, NULL);
+    for (i = 0; i < PS_N_HOT; i++) {
+        gchar *attr = g_build_filename(path, ps_hot_attrs[i], NULL);
+        ps->fd[i] = open(attr, O_RDONLY | O_CLOEXEC);
+        g_free(attr);
+    }
+    ps->type = read_contents(path, "type");
+    ps->technology = read_contents(path, "technology");
+    ps->manufacturer = read_contents(path, "manufacturer");
+    ps->model_name = read_contents(path, "model_name");
+    ps->serial_number = read_contents(path, "serial_number");
+    ps->energy_full_design = read_contents(path, "energy_full_design");
+    ps->charge_full_design = read_contents(path, "charge_full_design");
+    ps->charge_full = read_contents(path, "charge_full");
+    ps->voltage_min_design = read_contents(path, "voltage_min_design");
+    g_free(path);
+
+    return ps;
+}
+
+/* a hot attribute into buf, or NULL */
+static gchar *power_supply_read(power_supply *ps, int attr, gchar *buf, gsize size)
+{
+    ssize_t n;
+
+    if (ps->fd[attr] < 0)
+        return NULL;
+    n = pread(ps->fd[attr], buf, size - 1, 0);
+    if (n <= 0)
+        return NULL;
+    buf[n] = 0;
+    return g_strchomp(buf);
+}
+
+/* a hot attribute in base units (the files hold micro units), or -1 */
+static gdouble power_supply_read_micro(power_supply *ps, int attr)
+{
+    gchar buf[32];
+    long long l;
+
+    if (!power_supply_read(ps, attr, buf, sizeof(buf)) || sscanf(buf, "%lld", &l) != 1)
+        return -1;
+    return llabs(l) / 1000000.0;
+}
+
+static void power_supply_enumerate(void)
+{
+    GSList *old = power_supplies, *l;
+    GDir *dir;
+    const gchar *entry;
+
+    power_supplies = NULL;
+    if ((dir = g_dir_open(POWER_SUPPLY_DIR, 0, NULL))) {
+        while ((entry = g_dir_read_name(dir))) {
+            power_supply *ps = power_supply_new(entry);
+
+            /* a supply that stays keeps its discharge estimate */
+            for (l = old; l; l = l->next) {
+                power_supply *prev = l->data;
+                if (g_str_equal(prev->name, entry)) {
+                    ps->rate = prev->rate;
+                    ps->last_energy = prev->last_energy;
+                    ps->last_t = prev->last_t;
+                }
+            }
+            power_supplies = g_slist_prepend(power_supplies, ps);
+        }
+        g_dir_close(dir);
+    }
+    power_supplies = g_slist_reverse(power_supplies);
+    g_slist_free_full(old, (GDestroyNotify)power_supply_free);
+}
+
+/* Power drawn from the battery while discharging: power_now, else
+ * current_now * voltage_now, else the fall of energy_now (or charge_now *
+ * voltage) since the previous scan. Smoothed with an exponential moving
+ * average weighted by dt / (PS_RATE_TAU + dt), as scans are not evenly
+ * spaced. Returns the instantaneous value. */
+static gdouble power_supply_update_rate(power_supply *ps, gboolean discharging,
+                                        gdouble *energy)
+{
+    gdouble now = battery_now(), dt = now - ps->last_t;
+    gdouble voltage = power_supply_read_micro(ps, PS_VOLTAGE_NOW);
+    gdouble power = power_supply_read_micro(ps, PS_POWER_NOW);
+    gdouble current, charge;
+
+    *energy = power_supply_read_micro(ps, PS_ENERGY_NOW);
+    if (*energy < 0 && voltage > 0 && (charge = power_supply_read_micro(ps, PS_CHARGE_NOW)) >= 0)
+        *energy = charge * voltage;
+
+    if (power < 0 && voltage > 0 && (current = power_supply_read_micro(ps, PS_CURRENT_NOW)) >= 0)
+        power = current * voltage;
+    if (power < 0 && *energy >= 0 && ps->last_energy >= 0 && dt > 0)
+        power = MAX(ps->last_energy - *energy, 0) / dt * 3600.0;
+
+    if (!discharging)
+        ps->rate = -1;
+    else if (power >= 0)
+        ps->rate = (ps->rate < 0 || dt <= 0) ? power
+                 : ps->rate + (power - ps->rate) * dt / (PS_RATE_TAU + dt);
+
+    ps->last_energy = *energy;
+    ps->last_t = now;
+    return power;
+}
+
 static void
-__scan_battery_sysfs_add_battery(const gchar *name)
+__scan_battery_sysfs_add_battery(power_supply *ps)
 {
-    gchar *path = g_strdup_printf("/sys/class/power_supply/%s", name);
-    gchar *status, *capacity, *capacity_level, *technology, *manufacturer;
-    gchar *model_name, *serial_number, *charge_full_design=NULL, *charge_full=NULL;
-    gchar *voltage_min_design=NULL,*energy_full_design=NULL;
-    gchar *voltage_now_txt=NULL,*current_now_txt=NULL;
+    gchar status_buf[64], online_buf[8], capacity_buf[8], level_buf[32];
+    gchar *status, *capacity, *capacity_level;
     float full_design=-1.0,full_current=-1.0,voltage=-1.0;
-    float voltage_now=-1.0,current_now=0.0;
+    gdouble power, energy;
     unsigned long l;
 
-    if (!path)
-        return;
-
-    if(name[0]=='A' || strstr(name,"macsmc-ac")){//AC Supply
-        status=read_contents(path, "online");
-	if(status==NULL) status=g_strdup("1");
-	if(!strcmp(status,"1")) {
-	    g_free(status);
-	    status=g_strdup("Attached");
+    if(ps->is_ac){//AC Supply
+        const gchar *online = power_supply_read(ps, PS_ONLINE, online_buf, sizeof(online_buf));
+	if(!online || !strcmp(online,"1")) {
+	    status=_("Attached");
 	}else{
 	    g_free(powerstate);powerstate=g_strdup("BAT");
-	    g_free(status);status=g_strdup("Not attached");
+	    status=_("Not attached");
 	}
         battery_list = h_strdup_cprintf(_("\n[AC Power Supply: %s]\n"
             "Online=%s\n"
             "AC Power Type=%s\n"
 	    ),
             battery_list,
-            name,
+            ps->name,
             status,
-	    read_contents(path, "type")
+	    ps->type
             );
-	g_free(status);
     }
 
-    if((name[0]=='B') || strstr(name,"CMB") || strstr(name,"macsmc-battery")){//Battery
-
-    status = read_contents(path, "status");
-    capacity = read_contents(path, "capacity");
-    capacity_level = read_contents(path, "capacity_level");
-    technology = read_contents(path, "technology");
-    manufacturer = read_contents(path, "manufacturer");
-    model_name = read_contents(path, "model_name");
-    serial_number = read_contents(path, "serial_number");
-    energy_full_design = read_contents(path, "energy_full_design");
-    charge_full_design = read_contents(path, "charge_full_design");
-    charge_full = read_contents(path, "charge_full");
-    voltage_min_design = read_contents(path, "voltage_min_design");
-    //Current usage
-    voltage_now_txt=read_contents(path,"voltage_now");
-    current_now_txt=read_contents(path,"current_now");
-    if(voltage_now_txt) if(sscanf(voltage_now_txt, "%lu", &l)==1) voltage_now=(float)l/1000000.0;
-    if(current_now_txt) if(sscanf(current_now_txt, "%lu", &l)==1) current_now=(float)l/1000000.0;
-    if(!strcmp(status,"Discharging")) {current_now*=-1;}
-
-    if(voltage_min_design) if(sscanf(voltage_min_design, "%lu", &l)==1) voltage=(float)l/1000000.0;//uV->V
-    if(!charge_full_design && energy_full_design) if(sscanf(energy_full_design, "%lu", &l)==1) full_design=(float)l/(voltage>0?voltage*1000000.0:-1.0);//uWh->Ah
-    if(charge_full_design) if(sscanf(charge_full_design, "%lu", &l)==1) full_design=(float)l/1000000.0;//uAh->Ah
-    if(charge_full) if(sscanf(charge_full, "%lu", &l)==1) full_current=(float)l/1000000.0;//uAh->Ah
+    if(ps->is_battery){//Battery
+
+    status = power_supply_read(ps, PS_STATUS, status_buf, sizeof(status_buf));
+    capacity = power_supply_read(ps, PS_CAPACITY, capacity_buf, sizeof(capacity_buf));
+    capacity_level = power_supply_read(ps, PS_CAPACITY_LEVEL, level_buf, sizeof(level_buf));
+    if (!status) status = _("(Unknown)");
+    gboolean discharging = !strcmp(status, "Discharging");
+
+    //Current usage, W drawn or taken in
+    power = power_supply_update_rate(ps, discharging, &energy);
+    gboolean power_known = power >= 0;
+
+    if(ps->voltage_min_design) if(sscanf(ps->voltage_min_design, "%lu", &l)==1) voltage=(float)l/1000000.0;//uV->V
+    if(!ps->charge_full_design && ps->energy_full_design) if(sscanf(ps->energy_full_design, "%lu", &l)==1) full_design=(float)l/(voltage>0?voltage*1000000.0:-1.0);//uWh->Ah
+    if(ps->charge_full_design) if(sscanf(ps->charge_full_design, "%lu", &l)==1) full_design=(float)l/1000000.0;//uAh->Ah
+    if(ps->charge_full) if(sscanf(ps->charge_full, "%lu", &l)==1) full_current=(float)l/1000000.0;//uAh->Ah
 
     battery_list = h_strdup_cprintf(_("\n[Battery: %s]\n"
         "State=%s\n"
-        "Capacity=%s %% / %s\n"
-	"Battery Usage=%.0f W\n"
+        "Capacity=%s %% / %s\n"),
+        battery_list,
+        ps->name,
+        status,
+        capacity, capacity_level);
+
+    if (power_known) {
+        /* the load graph reads the number at the start of the text, so
+         * the direction is given after it: charted and ranged as the
+         * unsigned power either way */
+        gchar *tag = g_strdup_printf("BAT_%s", ps->name);
+        gchar *value = g_strdup_printf("%.1f W (%s)", power, status);
+        gdouble lo, hi;
+
+        battery_chart(tag, value, power, &lo, &hi);
+        battery_list = h_strdup_cprintf(_("$%s$Battery Usage=%s|%.1f - %.1f\n"),
+                                        battery_list, tag, value, lo, hi);
+        g_free(value);
+        g_free(tag);
+    } else {
+        battery_list = h_strdup_cprintf(_("Battery Usage=%.0f W\n"), battery_list, -1.0);
+    }
+
+    if (ps->rate > 0) {
+        battery_list = h_strdup_cprintf(_("Discharge Rate=%.1f W\n"), battery_list, ps->rate);
+        if (energy > 0) {
+            int minutes = (int)(energy / ps->rate * 60.0);
+            battery_list = h_strdup_cprintf(_("Time to Empty=%d h %02d min\n"), battery_list,
+                                            minutes / 60, minutes % 60);
+        }
+    }
+
+    battery_list = h_strdup_cprintf(_(
         "Battery Health=%.0f %%\n"
         "Design Full Energy=%.3f Wh\n"
         "Current Full Energy=%.3f Wh\n"
@@ -311,56 +710,38 @@ __scan_battery_sysfs_add_battery(const gchar *name)
         "Model Number=%s\n"
         "Serial Number=%s\n"),
         battery_list,
-        name,
-        status,
-        capacity, capacity_level,
-	voltage_now*current_now!=0?(voltage_now*current_now):-1,
 	full_design>0?(full_current*100.0)/full_design:-1,
 	voltage>0?full_design*voltage:-1,
         voltage>0?full_current*voltage:-1,
 	full_design,
         full_current,
 	voltage,
-        technology,
-        manufacturer,
-        model_name,
-        serial_number);
+        ps->technology,
+        ps->manufacturer,
+        ps->model_name,
+        ps->serial_number);
 
-    if(!strcmp(status,"Discharging")) {
+    if(discharging) {
         g_free(powerstate);powerstate=g_strdup("BAT");
     }
-
-    g_free(voltage_now_txt);
-    g_free(current_now_txt);
-    g_free(voltage_min_design);
-    g_free(energy_full_design);
-    g_free(charge_full_design);
-    g_free(charge_full);
-    g_free(status);
-    g_free(capacity);
-    g_free(capacity_level);
-    g_free(technology);
-    g_free(manufacturer);
-    g_free(model_name);
-    g_free(serial_number);
     }
 }
 
 static void
 __scan_battery_sysfs(void)
 {
-    GDir *dir;
-    const gchar *entry;
-
-    dir = g_dir_open("/sys/class/power_supply", 0, NULL);
-    if (!dir)
-        return;
-
-    while ((entry = g_dir_read_name(dir))) {
-        __scan_battery_sysfs_add_battery(entry);
+    GSList *l;
+
+    /* without the socket, supplies are looked up on every scan */
+    if (ps_uevent_fd == -2) {
+        ps_uevent_fd = uevent_open();
+        power_supply_enumerate();
+    } else if (uevent_drain(ps_uevent_fd, "power_supply") & (UEVENT_ADD_REMOVE | UEVENT_LOST)) {
+        power_supply_enumerate();
     }
 
-    g_dir_close(dir);
+    for (l = power_supplies; l; l = l->next)
+        __scan_battery_sysfs_add_battery(l->data);
 }
 
 static void
@@ -440,6 +821,8 @@ scan_battery_do(void)
     g_free(powerstate);powerstate=g_strdup("AC");
     g_free(battery_list);
     battery_list = g_strdup("");
+    g_free(battery_lginterval);
+    battery_lginterval = NULL;
 
     __scan_battery_sysfs();
     __scan_battery_acpi();
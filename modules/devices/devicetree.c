@@ -43,40 +43,35 @@ const char *dtree_mem_str = NULL; /* used by memory devices when nothing else is
 static gchar *get_node(dtr *dt, char *np) {
     gchar *nodes = NULL, *props = NULL, *ret = NULL;
     gchar *tmp = NULL, *pstr = NULL, *lstr = NULL;
-    gchar *dir_path;
-    const gchar *fn;
-    GDir *dir;
+    gchar **names;
+    int i;
     dtr_obj *node, *child;
 
     props = g_strdup_printf("[%s]\n", _("Properties") );
     nodes = g_strdup_printf("[%s]\n", _("Children") );
     node = dtr_obj_read(dt, np);
-    dir_path = dtr_obj_full_path(node);
-
-    dir = g_dir_open(dir_path, 0 , NULL);
-    if (dir) {
-        while((fn = g_dir_read_name(dir)) != NULL) {
-            child = dtr_get_prop_obj(dt, node, fn);
-            pstr = hardinfo_clean_value(dtr_str(child), 1);
-            lstr = hardinfo_clean_label(fn, 0);
-            if (dtr_obj_type(child) == DT_NODE) {
-                tmp = g_strdup_printf("%s%s=%s\n",
-                    nodes, lstr, pstr);
-                g_free(nodes);
-                nodes = tmp;
-            } else {
-                tmp = g_strdup_printf("%s%s=%s\n",
-                    props, lstr, pstr);
-                g_free(props);
-                props = tmp;
-            }
-            dtr_obj_free(child);
-            g_free(pstr);
-            g_free(lstr);
+
+    names = dtr_children(dt, dtr_obj_path(node), 0);
+    for (i = 0; names && names[i] != NULL; i++) {
+        child = dtr_get_prop_obj(dt, node, names[i]);
+        pstr = hardinfo_clean_value(dtr_str(child), 1);
+        lstr = hardinfo_clean_label(names[i], 0);
+        if (dtr_obj_type(child) == DT_NODE) {
+            tmp = g_strdup_printf("%s%s=%s\n",
+                nodes, lstr, pstr);
+            g_free(nodes);
+            nodes = tmp;
+        } else {
+            tmp = g_strdup_printf("%s%s=%s\n",
+                props, lstr, pstr);
+            g_free(props);
+            props = tmp;
         }
+        dtr_obj_free(child);
+        g_free(pstr);
+        g_free(lstr);
     }
-    g_dir_close(dir);
-    g_free(dir_path);
+    g_strfreev(names);
 
     lstr = dtr_obj_alias(node);
     pstr = dtr_obj_symbol(node);
@@ -232,36 +227,30 @@ static void mi_add(const char *key, const char *value, int report_details) {
 }
 
 static void add_keys(dtr *dt, char *np) {
-    gchar *dir_path, *dt_path;
-    gchar *ftmp, *ntmp;
+    gchar *dt_path;
+    gchar *ntmp;
     gchar *n_info;
-    const gchar *fn;
-    GDir *dir;
+    gchar **names;
+    int i;
     dtr_obj *obj;
 
-    dir_path = g_strdup_printf("%s/%s", dtr_base_path(dt), np);
-    dir = g_dir_open(dir_path, 0 , NULL);
-    if(!dir){ /* add self */
+    names = dtr_children(dt, np, 1);
+    if(!names){ /* add self */
         obj = dtr_obj_read(dt, np);
         dt_path = dtr_obj_path(obj);
         n_info = get_node(dt, dt_path);
         mi_add(dt_path, n_info, 0);
-    }else { //dir
-        while((fn = g_dir_read_name(dir)) != NULL) {
-            ftmp = g_strdup_printf("%s/%s", dir_path, fn);
-            if ( g_file_test(ftmp, G_FILE_TEST_IS_DIR) ) {
-                if (strcmp(np, "/") == 0)
-                    ntmp = g_strdup_printf("/%s", fn);
-                else
-                    ntmp = g_strdup_printf("%s/%s", np, fn);
-                if(strlen(ntmp)>0) add_keys(dt, ntmp);
-                g_free(ntmp);
-            }
-            g_free(ftmp);
+    }else { //node
+        for (i = 0; names[i] != NULL; i++) {
+            if (strcmp(np, "/") == 0)
+                ntmp = g_strdup_printf("/%s", names[i]);
+            else
+                ntmp = g_strdup_printf("%s/%s", np, names[i]);
+            if(strlen(ntmp)>0) add_keys(dt, ntmp);
+            g_free(ntmp);
         }
-        g_dir_close(dir);
+        g_strfreev(names);
     }
-    g_free(dir_path);
 }
 
 static char *msg_section(dtr *dt, int dump) {
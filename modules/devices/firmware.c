@@ -27,9 +27,28 @@
 #define fw_msg(msg, ...) fprintf (stderr, "[%s] " msg "\n", __FUNCTION__, ##__VA_ARGS__) /**/
 
 #define FWUPT_INTERFACE  "org.freedesktop.fwupd"
+#ifndef FW_TIMEOUT
+#define FW_TIMEOUT 5000     /* ms for each call to fwupd */
+#endif
+#ifndef FW_FIRST_WAIT
+#define FW_FIRST_WAIT 1500  /* ms a first scan waits for an answer */
+#endif
+#define FW_RELOAD 5000      /* ms between page reloads, served from the cache */
 
 gboolean fail_no_fwupd = TRUE;
 
+/* The device list is fetched asynchronously and cached until fwupd says
+ * something changed or restarts, so a slow or activating daemon never
+ * stalls the page or a report. */
+static GDBusConnection *fw_conn = NULL;
+static gboolean fw_bus_failed = FALSE;
+static gboolean fw_pending = FALSE;
+static gboolean fw_valid = FALSE;
+static guint fw_generation = 0;  /* bumped on each invalidation */
+static guint fw_call_generation = 0;
+static gchar *fw_cache = NULL;
+static GMainLoop *fw_wait_loop = NULL;
+
 char *decode_flags(guint64 flags) {
     /* https://github.com/hughsie/fwupd/blob/master/libfwupd/fwupd-enums.{h,c} */
     static const struct { guint64 b; char *flag, *def; } flag_defs[] = {
@@ -114,7 +133,13 @@ const char *find_icon(const char *lvfs_name) {
     return imap[i].hi;
 }
 
-gchar *fwupdmgr_get_devices_info() {
+static gchar *fwupd_not_available(void) {
+    return g_strdup_printf("[%s]\n%s=%s\n" "[$ShellParam$]\nViewType=0\nReloadInterval=%d\n",
+                _("Firmware List"),
+                _("Result"), _("(Not available)"), FW_RELOAD);
+}
+
+static gchar *fwupd_devices_info(GVariant *devices) {
     struct Info *info = info_new();
     struct InfoGroup *this_group = NULL;
     gboolean has_vendor_field = FALSE;
@@ -122,28 +147,10 @@ gchar *fwupdmgr_get_devices_info() {
     const Vendor *gv = NULL;
     int gc = 0;
 
-    GDBusConnection *conn;
-    GDBusProxy *proxy;
-    GVariant *devices, *value;
+    GVariant *value;
     GVariantIter *deviter, *dictiter, *iter;
     const gchar *key, *tmpstr;
 
-    conn = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, NULL);
-    if (!conn) {g_free(info); return g_strdup("");}
-
-    proxy = g_dbus_proxy_new_sync(conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                  FWUPT_INTERFACE, "/", FWUPT_INTERFACE,
-                                  NULL, NULL);
-    if (!proxy) {
-        g_object_unref(conn);
-	g_free(info);
-        return g_strdup("");
-    }
-
-    fail_no_fwupd = FALSE;
-    devices = g_dbus_proxy_call_sync(proxy, "GetDevices", NULL,
-                                     G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
-
     if (devices) {
         g_variant_get(devices, "(aa{sv})", &deviter);
         while(g_variant_iter_loop(deviter, "a{sv}", &dictiter)){
@@ -229,25 +236,135 @@ gchar *fwupdmgr_get_devices_info() {
             }
         }
         g_variant_iter_free(deviter);
-        g_variant_unref(devices);
     }
 
-    g_object_unref(proxy);
-    g_object_unref(conn);
-
     gchar *ret = NULL;
     if (info->groups->len) {
         info_set_view_type(info, SHELL_VIEW_DETAIL);
+        info_set_reload_interval(info, FW_RELOAD);
         ret = info_flatten(info);
     } else {
         g_free(info);
-        ret = g_strdup_printf("[%s]\n%s=%s\n" "[$ShellParam$]\nViewType=0\n",
-                _("Firmware List"),
-                _("Result"), _("(Not available)") );
+        ret = fwupd_not_available();
     }
     return ret;
 }
 
+static void fwupd_done(GVariant *devices) {
+    fw_pending = FALSE;
+    if (devices) {
+        g_free(fw_cache);
+        fw_cache = fwupd_devices_info(devices);
+        g_variant_unref(devices);
+    } else if (!fw_cache || fail_no_fwupd) {
+        g_free(fw_cache);
+        fw_cache = fwupd_not_available();
+    }
+    /* an answer holds until fwupd signals a change, which may have come
+     * while the call was out; a slow or broken daemon is asked again on
+     * the next scan, keeping the last list meanwhile */
+    fw_valid = (devices || fail_no_fwupd) && fw_call_generation == fw_generation;
+
+    if (fw_wait_loop)
+        g_main_loop_quit(fw_wait_loop);
+}
+
+static void fwupd_devices_ready(GObject *source, GAsyncResult *res, gpointer data) {
+    GError *error = NULL;
+    GVariant *devices;
+
+    devices = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+    if (error) {
+        /* no daemon installed, as opposed to one that is slow or broken */
+        fail_no_fwupd = g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_SERVICE_UNKNOWN)
+                     || g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_NAME_HAS_NO_OWNER);
+        DEBUG("firmware.c - GetDevices failed: %s", error->message);
+        g_error_free(error);
+    } else {
+        fail_no_fwupd = FALSE;
+    }
+    fwupd_done(devices);
+}
+
+static void fwupd_get_devices(void) {
+    fw_call_generation = fw_generation;
+    g_dbus_connection_call(fw_conn, FWUPT_INTERFACE, "/", FWUPT_INTERFACE,
+                           "GetDevices", NULL, G_VARIANT_TYPE("(aa{sv})"),
+                           G_DBUS_CALL_FLAGS_NONE, FW_TIMEOUT, NULL,
+                           fwupd_devices_ready, NULL);
+}
+
+static void fwupd_invalidate(GDBusConnection *conn, const gchar *sender,
+                             const gchar *path, const gchar *interface,
+                             const gchar *signal, GVariant *parameters, gpointer data) {
+    /* fwupd: Changed, DeviceAdded, DeviceRemoved, DeviceChanged;
+     * the bus: NameOwnerChanged when fwupd starts or exits */
+    if (SEQ(signal, "DeviceRequest"))
+        return;
+    fw_generation++;
+    fw_valid = FALSE;
+}
+
+static void fwupd_bus_ready(GObject *source, GAsyncResult *res, gpointer data) {
+    fw_conn = g_bus_get_finish(res, NULL);
+    if (!fw_conn) {
+        fw_bus_failed = TRUE;
+        fwupd_done(NULL);
+        return;
+    }
+
+    g_dbus_connection_signal_subscribe(fw_conn, FWUPT_INTERFACE, FWUPT_INTERFACE,
+                                       NULL, "/", NULL, G_DBUS_SIGNAL_FLAGS_NONE,
+                                       fwupd_invalidate, NULL, NULL);
+    g_dbus_connection_signal_subscribe(fw_conn, "org.freedesktop.DBus",
+                                       "org.freedesktop.DBus", "NameOwnerChanged",
+                                       "/org/freedesktop/DBus", FWUPT_INTERFACE,
+                                       G_DBUS_SIGNAL_FLAGS_NONE,
+                                       fwupd_invalidate, NULL, NULL);
+    fwupd_get_devices();
+}
+
+static gboolean fwupd_wait_expired(gpointer data) {
+    *(guint *)data = 0;
+    g_main_loop_quit(fw_wait_loop);
+    return FALSE;
+}
+
+gchar *fwupdmgr_get_devices_info() {
+    if (fw_bus_failed)
+        return g_strdup("");
+
+    if (!fw_valid && !fw_pending) {
+        fw_pending = TRUE;
+        if (fw_conn)
+            fwupd_get_devices();
+        else
+            g_bus_get(G_BUS_TYPE_SYSTEM, NULL, fwupd_bus_ready, NULL);
+    }
+
+    /* nothing to show yet: wait a little, the whole call for a report */
+    if (!fw_cache && fw_pending && !fw_wait_loop) {
+        guint timeout;
+
+        fw_wait_loop = g_main_loop_new(NULL, FALSE);
+        timeout = g_timeout_add(params.create_report ? FW_TIMEOUT + 500 : FW_FIRST_WAIT,
+                                fwupd_wait_expired, &timeout);
+        g_main_loop_run(fw_wait_loop);
+        if (timeout)
+            g_source_remove(timeout);
+        g_main_loop_unref(fw_wait_loop);
+        fw_wait_loop = NULL;
+    }
+
+    if (fw_bus_failed)
+        return g_strdup("");
+    if (!fw_cache)
+        return g_strdup_printf("[%s]\n%s=%s\n" "[$ShellParam$]\nViewType=0\nReloadInterval=1000\n",
+                _("Firmware List"),
+                _("Result"), _("(Waiting for fwupd)") );
+    return g_strdup(fw_cache);
+}
+
 gchar *firmware_get_info() {
     return fwupdmgr_get_devices_info();
 }
@@ -0,0 +1,496 @@
+/*
+ *    HardInfo - Displays System Information
+ *    Copyright (C) 2003-2008 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/* Interrupt rates per IRQ and per CPU, from the difference between two
+ * samples of /proc/interrupts taken one page reload apart. */
+
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "devices.h"
+
+#define IRQ_NAME_LEN 16
+#define IRQ_DESC_LEN 64
+#define IRQ_TOP_N 10
+#define IRQ_DEFAULT_INTERVAL 1000
+
+typedef struct {
+    gchar    name[IRQ_NAME_LEN];
+    gchar    desc[IRQ_DESC_LEN];
+    gboolean total_only;    /* ERR, MIS: one system wide count, kept in CPU 0 */
+} irq_row;
+
+typedef struct {
+    guint    ncpu, nirq;
+    guint    cpu_cap, irq_cap;
+    guint   *cpu_id;        /* from the CPUn header, offline CPUs are left out */
+    irq_row *rows;
+    guint64 *counts;        /* nirq rows of cpu_cap counts */
+    gdouble  time;          /* seconds, CLOCK_MONOTONIC */
+} irq_snapshot;
+
+/* both samples and all scratch space persist between reloads, so once
+ * sized for the machine sampling doesn't allocate */
+static irq_snapshot irq_samples[2];
+static irq_snapshot *irq_prev = NULL, *irq_cur = NULL;
+static gchar   *irq_buf = NULL;
+static gsize    irq_buf_size = 0;
+static gdouble *irq_rates = NULL;      /* nirq x ncpu of irq_cur */
+static gdouble *irq_cpu_rates = NULL;  /* ncpu */
+static gint    *irq_cpu_map = NULL;    /* irq_cur column -> irq_prev column */
+static guint    irq_rates_cap = 0, irq_cpu_cap = 0;
+
+static gchar *irq_list = NULL;
+static gboolean irq_since_boot = TRUE;
+
+static gdouble monotonic_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* whole file into irq_buf, NUL terminated; proc files have no size */
+static gssize read_proc_file(const gchar *path)
+{
+    gsize len = 0;
+    gssize n;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return -1;
+    for (;;) {
+        if (irq_buf_size - len < 4096) {
+            irq_buf_size = irq_buf_size ? irq_buf_size * 2 : 65536;
+            irq_buf = g_realloc(irq_buf, irq_buf_size);
+        }
+        n = read(fd, irq_buf + len, irq_buf_size - len - 1);
+        if (n <= 0)
+            break;
+        len += n;
+    }
+    close(fd);
+    irq_buf[len] = 0;
+    return n < 0 ? -1 : (gssize)len;
+}
+
+static void snapshot_reserve(irq_snapshot *s, guint ncpu, guint nirq)
+{
+    if (ncpu > s->cpu_cap) {
+        guint cap = MAX(ncpu, s->cpu_cap * 2);
+        guint64 *counts = g_new0(guint64, (gsize)cap * MAX(s->irq_cap, 1));
+        guint i;
+
+        /* rows keep their stride, so move them over */
+        for (i = 0; i < s->nirq; i++)
+            memcpy(counts + (gsize)i * cap, s->counts + (gsize)i * s->cpu_cap,
+                   s->cpu_cap * sizeof(guint64));
+        g_free(s->counts);
+        s->counts = counts;
+        s->cpu_id = g_renew(guint, s->cpu_id, cap);
+        s->cpu_cap = cap;
+    }
+    if (nirq > s->irq_cap) {
+        guint cap = MAX(nirq, MAX(s->irq_cap * 2, 64));
+
+        s->rows = g_renew(irq_row, s->rows, cap);
+        s->counts = g_renew(guint64, s->counts, (gsize)cap * s->cpu_cap);
+        s->irq_cap = cap;
+    }
+}
+
+static const gchar *skip_blanks(const gchar *p)
+{
+    while (*p == ' ' || *p == '\t')
+        p++;
+    return p;
+}
+
+/* tokenizes buf in place; fixed size names and descriptions, counts go
+ * straight into the snapshot arrays */
+static gboolean snapshot_parse(irq_snapshot *s, const gchar *buf)
+{
+    const gchar *p = buf, *eol;
+    guint ncpu = 0;
+
+    s->nirq = 0;
+
+    /* header: CPU0 CPU1 ... */
+    eol = strchr(p, '\n');
+    if (!eol)
+        return FALSE;
+    for (p = skip_blanks(p); p < eol; p = skip_blanks(p)) {
+        if (strncmp(p, "CPU", 3) != 0)
+            return FALSE;
+        snapshot_reserve(s, ncpu + 1, 0);
+        s->cpu_id[ncpu++] = (guint)strtoul(p + 3, (char **)&p, 10);
+    }
+    s->ncpu = ncpu;
+    if (!ncpu)
+        return FALSE;
+
+    for (p = eol + 1; *p; p = *eol ? eol + 1 : eol) {
+        const gchar *colon;
+        guint64 *counts;
+        irq_row *row;
+        gchar *d;
+        guint n, c;
+
+        eol = strchr(p, '\n');
+        if (!eol)
+            eol = p + strlen(p);
+
+        p = skip_blanks(p);
+        colon = memchr(p, ':', eol - p);
+        if (!colon || colon == p)
+            continue;
+
+        snapshot_reserve(s, ncpu, s->nirq + 1);
+        row = &s->rows[s->nirq];
+        counts = s->counts + (gsize)s->nirq * s->cpu_cap;
+
+        n = MIN((guint)(colon - p), IRQ_NAME_LEN - 1);
+        memcpy(row->name, p, n);
+        row->name[n] = 0;
+
+        for (p = skip_blanks(colon + 1), c = 0; c < ncpu && p < eol && g_ascii_isdigit(*p);
+             p = skip_blanks(p), c++) {
+            guint64 v = 0;
+
+            while (g_ascii_isdigit(*p))
+                v = v * 10 + (*p++ - '0');
+            counts[c] = v;
+        }
+        row->total_only = c < ncpu;
+        for (; c < ncpu; c++)
+            counts[c] = 0;
+
+        /* the rest is chip, hwirq, trigger and action names */
+        for (d = row->desc; p < eol && d < row->desc + IRQ_DESC_LEN - 1; p++) {
+            if (*p == ' ' || *p == '\t') {
+                if (d > row->desc && d[-1] != ' ')
+                    *d++ = ' ';
+            } else if (*p != '|' && *p != '=') {
+                *d++ = *p;
+            }
+        }
+        while (d > row->desc && d[-1] == ' ')
+            d--;
+        *d = 0;
+
+        s->nirq++;
+    }
+
+    return s->nirq > 0;
+}
+
+/* /proc/interrupts prints per CPU counters as unsigned int, so a smaller
+ * value after a 32-bit one is a wrap; anything else is a reset */
+static guint64 counter_delta(guint64 prev, guint64 cur)
+{
+    if (cur >= prev)
+        return cur - prev;
+    if (prev <= G_MAXUINT32)
+        return cur + ((guint64)G_MAXUINT32 + 1) - prev;
+    return 0;
+}
+
+/* rates[nirq x ncpu] of cur per second since prev; rows and CPUs are
+ * matched by name and number as IRQs and CPUs come and go, a CPU that
+ * wasn't in prev reads 0 until the next sample. With no prev the counts
+ * are averaged over uptime, as everything started at zero. */
+static void snapshot_rates(const irq_snapshot *prev, const irq_snapshot *cur,
+                           gdouble seconds, gdouble *rates, gint *cpu_map)
+{
+    guint i, j, c, pi = 0;
+
+    for (c = 0; c < cur->ncpu; c++) {
+        cpu_map[c] = -1;
+        if (!prev)
+            continue;
+        if (c < prev->ncpu && prev->cpu_id[c] == cur->cpu_id[c]) {
+            cpu_map[c] = c;
+            continue;
+        }
+        for (j = 0; j < prev->ncpu; j++)
+            if (prev->cpu_id[j] == cur->cpu_id[c]) {
+                cpu_map[c] = j;
+                break;
+            }
+    }
+
+    if (seconds <= 0)
+        seconds = 1;
+
+    for (i = 0; i < cur->nirq; i++) {
+        const guint64 *cc = cur->counts + (gsize)i * cur->cpu_cap;
+        const guint64 *pc = NULL;
+        gdouble *r = rates + (gsize)i * cur->ncpu;
+
+        if (prev) {
+            /* same layout as last time is the usual case */
+            if (pi < prev->nirq && g_str_equal(prev->rows[pi].name, cur->rows[i].name)) {
+                pc = prev->counts + (gsize)pi * prev->cpu_cap;
+            } else {
+                for (j = 0; j < prev->nirq; j++)
+                    if (g_str_equal(prev->rows[j].name, cur->rows[i].name)) {
+                        pc = prev->counts + (gsize)j * prev->cpu_cap;
+                        pi = j;
+                        break;
+                    }
+            }
+            pi++;
+        }
+
+        for (c = 0; c < cur->ncpu; c++) {
+            guint64 p = (pc && cpu_map[c] >= 0) ? pc[cpu_map[c]] : 0;
+
+            /* a CPU back online keeps the counters it went down with */
+            if (prev && cpu_map[c] < 0)
+                r[c] = 0;
+            else
+                r[c] = counter_delta(p, cc[c]) / seconds;
+        }
+    }
+}
+
+static gdouble uptime_seconds(void)
+{
+    gdouble up = 0;
+    FILE *f = fopen("/proc/uptime", "r");
+
+    if (f) {
+        if (fscanf(f, "%lf", &up) != 1)
+            up = 0;
+        fclose(f);
+    }
+    return up;
+}
+
+static gint interrupts_interval(void)
+{
+    static gint interval = 0;
+
+    if (!interval) {
+        GKeyFile *key_file = g_key_file_new();
+        gchar *conf_path = g_build_filename(g_get_user_config_dir(), "hardinfo2", "settings.ini", NULL);
+
+        g_key_file_load_from_file(key_file, conf_path, G_KEY_FILE_NONE, NULL);
+        interval = g_key_file_get_integer(key_file, "Devices", "InterruptsInterval", NULL);
+        if (interval <= 0)
+            interval = IRQ_DEFAULT_INTERVAL;
+        interval = CLAMP(interval, 250, 60000);
+
+        g_free(conf_path);
+        g_key_file_free(key_file);
+    }
+    return interval;
+}
+
+/* one character per CPU, scaled to the busiest CPU of the row */
+static gchar *heat_strip(const gdouble *r, guint ncpu)
+{
+    static const gchar *levels[] = { "\xc2\xb7", "\xe2\x96\x81", "\xe2\x96\x82", "\xe2\x96\x83",
+                                     "\xe2\x96\x84", "\xe2\x96\x85", "\xe2\x96\x86", "\xe2\x96\x87",
+                                     "\xe2\x96\x88" };
+    GString *strip = g_string_sized_new(ncpu * 3 + 16);
+    gdouble max = 0;
+    guint c;
+
+    for (c = 0; c < ncpu; c++)
+        max = MAX(max, r[c]);
+
+    if (params.markup_ok)
+        g_string_append(strip, "<tt>");
+    for (c = 0; c < ncpu; c++) {
+        guint l = 0;
+
+        if (r[c] > 0 && max > 0)
+            l = 1 + (guint)(r[c] / max * (G_N_ELEMENTS(levels) - 2) + 0.5);
+        g_string_append(strip, levels[MIN(l, G_N_ELEMENTS(levels) - 1)]);
+    }
+    if (params.markup_ok)
+        g_string_append(strip, "</tt>");
+
+    return g_string_free(strip, FALSE);
+}
+
+static gdouble row_total(guint i)
+{
+    const gdouble *r = irq_rates + (gsize)i * irq_cur->ncpu;
+    gdouble t = 0;
+    guint c;
+
+    for (c = 0; c < irq_cur->ncpu; c++)
+        t += r[c];
+    return t;
+}
+
+static void build_irq_list(void)
+{
+    guint top[IRQ_TOP_N], ntop = 0, i, c, n;
+    gchar *top_list, *heat_list, *cpu_list;
+    gdouble cpu_total = 0;
+
+    moreinfo_del_with_prefix("DEV:IRQ");
+
+    top_list = g_strdup_printf("[%s]\n", _("Top Interrupt Sources"));
+    heat_list = g_strdup_printf("[%s]\n", _("Interrupts by CPU"));
+    cpu_list = g_strdup_printf("[%s]\n", _("CPU Totals"));
+
+    for (c = 0; c < irq_cur->ncpu; c++)
+        irq_cpu_rates[c] = 0;
+
+    for (i = 0; i < irq_cur->nirq; i++) {
+        const irq_row *row = &irq_cur->rows[i];
+        const gdouble *r = irq_rates + (gsize)i * irq_cur->ncpu;
+        gdouble total = row_total(i);
+        gchar *strip, *details, *tag;
+
+        /* insertion into the top list, busiest first */
+        if (total > 0 && (ntop < IRQ_TOP_N || total > row_total(top[ntop - 1]))) {
+            for (n = MIN(ntop, IRQ_TOP_N - 1); n > 0 && row_total(top[n - 1]) < total; n--)
+                top[n] = top[n - 1];
+            top[n] = i;
+            if (ntop < IRQ_TOP_N)
+                ntop++;
+        }
+
+        if (row->total_only)
+            continue;
+
+        for (c = 0; c < irq_cur->ncpu; c++)
+            irq_cpu_rates[c] += r[c];
+        if (total <= 0)
+            continue;
+
+        tag = g_strdup_printf("IRQ%s", row->name);
+        strip = heat_strip(r, irq_cur->ncpu);
+        heat_list = h_strdup_cprintf("$%s$%s=%.1f/s|%s|%s\n", heat_list,
+                                     tag, row->name, total, strip, row->desc);
+
+        details = g_strdup_printf("[%s]\n%s=%s\n%s=%s\n%s=%.1f/s\n[%s]\n",
+                                  _("Interrupt"),
+                                  _("IRQ"), row->name,
+                                  _("Description"), row->desc,
+                                  _("Rate"), total,
+                                  _("Rate per CPU"));
+        for (c = 0; c < irq_cur->ncpu; c++) {
+            if (r[c] > 0)
+                details = h_strdup_cprintf("CPU%u=%.1f/s (%.1f%%)\n", details,
+                                           irq_cur->cpu_id[c], r[c], r[c] * 100 / total);
+        }
+        moreinfo_add_with_prefix("DEV", tag, details);
+        g_free(strip);
+        g_free(tag);
+    }
+
+    for (n = 0; n < ntop; n++) {
+        const irq_row *row = &irq_cur->rows[top[n]];
+        const gdouble *r = irq_rates + (gsize)top[n] * irq_cur->ncpu;
+        gdouble total = row_total(top[n]);
+        guint busiest = 0;
+
+        for (c = 1; c < irq_cur->ncpu; c++)
+            if (r[c] > r[busiest])
+                busiest = c;
+
+        if (row->total_only)
+            top_list = h_strdup_cprintf("%s=%.1f/s||%s\n", top_list,
+                                        row->name, total, row->desc);
+        else
+            top_list = h_strdup_cprintf("%s=%.1f/s|CPU%u (%.0f%%)|%s\n", top_list,
+                                        row->name, total, irq_cur->cpu_id[busiest],
+                                        r[busiest] * 100 / total, row->desc);
+    }
+    if (!ntop)
+        top_list = h_strdup_cprintf("%s=\n", top_list, _("(None)"));
+
+    for (c = 0; c < irq_cur->ncpu; c++)
+        cpu_total += irq_cpu_rates[c];
+    for (c = 0; c < irq_cur->ncpu; c++)
+        cpu_list = h_strdup_cprintf("CPU%u=%.1f/s|%.1f%%\n", cpu_list,
+                                    irq_cur->cpu_id[c], irq_cpu_rates[c],
+                                    cpu_total > 0 ? irq_cpu_rates[c] * 100 / cpu_total : 0.0);
+
+    g_free(irq_list);
+    irq_list = g_strconcat(top_list, heat_list, cpu_list, NULL);
+    g_free(top_list);
+    g_free(heat_list);
+    g_free(cpu_list);
+}
+
+void scan_interrupts(gboolean reload)
+{
+    irq_snapshot *next;
+    gdouble seconds;
+    gssize len;
+
+    SCAN_START();
+
+    next = irq_cur == &irq_samples[0] ? &irq_samples[1] : &irq_samples[0];
+    if ((len = read_proc_file("/proc/interrupts")) <= 0 || !snapshot_parse(next, irq_buf)) {
+        g_free(irq_list);
+        irq_list = g_strdup_printf("[%s]\n%s=\n", _("Interrupts"), _("(Not available)"));
+        SCAN_END();
+        return;
+    }
+    next->time = monotonic_seconds();
+
+    irq_prev = irq_cur;
+    irq_cur = next;
+    irq_since_boot = irq_prev == NULL;
+    seconds = irq_prev ? irq_cur->time - irq_prev->time : uptime_seconds();
+
+    if ((gsize)irq_cur->nirq * irq_cur->ncpu > irq_rates_cap) {
+        irq_rates_cap = irq_cur->nirq * irq_cur->ncpu;
+        irq_rates = g_renew(gdouble, irq_rates, irq_rates_cap);
+    }
+    if (irq_cur->ncpu > irq_cpu_cap) {
+        irq_cpu_cap = irq_cur->ncpu;
+        irq_cpu_rates = g_renew(gdouble, irq_cpu_rates, irq_cpu_cap);
+        irq_cpu_map = g_renew(gint, irq_cpu_map, irq_cpu_cap);
+    }
+    snapshot_rates(irq_prev, irq_cur, seconds, irq_rates, irq_cpu_map);
+
+    build_irq_list();
+
+    SCAN_END();
+}
+
+gchar *callback_interrupts(void)
+{
+    return g_strdup_printf("%s"
+                           "[$ShellParam$]\n"
+                           "ViewType=1\n"
+                           "ColumnTitle$TextValue=%s\n"
+                           "ColumnTitle$Value=%s\n"
+                           "ColumnTitle$Extra1=%s\n"
+                           "ColumnTitle$Extra2=%s\n"
+                           "ShowColumnHeaders=true\n"
+                           "ReloadInterval=%d\n",
+                           irq_list, _("IRQ"), _("Rate"), _("CPUs"), _("Description"),
+                           interrupts_interval());
+}
+
+gboolean interrupts_since_boot(void)
+{
+    return irq_since_boot;
+}
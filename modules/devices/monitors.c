@@ -29,6 +29,10 @@ static const char monitor_icon[] = "monitor.svg";
 #define UNKIFEMPTY2(f) ((*f) ? f : _("(Unknown)"))
 #define UNSPECIFNULL2(f) ((f) ? f : _("(Unspecified)"))
 
+#ifndef DRM_CLASS_DIR
+#define DRM_CLASS_DIR "/sys/class/drm"
+#endif
+
 gboolean no_monitors = FALSE;
 
 gchar *find_edid_ids_file() {
@@ -68,14 +72,16 @@ typedef struct {
     gchar *drm_connection;
     gchar *drm_status;
     gchar *drm_enabled;
+    gchar *edid_bin;
+    gsize edid_len;
     edid *e;
     gchar *_vstr; /* use monitor_vendor_str() */
 } monitor;
 #define monitor_new() g_new0(monitor, 1)
 
+/* status and enabled only; the EDID is read by monitor_load_edid() when
+ * the decode kept for the connector can't be used */
 monitor *monitor_new_from_sysfs(const gchar *sysfs_edid_file) {
-    gchar *edid_bin = NULL;
-    gsize edid_len = 0;
     if (!sysfs_edid_file || !*sysfs_edid_file) return NULL;
     monitor *m = monitor_new();
     m->drm_path = g_path_get_dirname(sysfs_edid_file);
@@ -86,14 +92,25 @@ monitor *monitor_new_from_sysfs(const gchar *sysfs_edid_file) {
     if (m->drm_enabled) g_strstrip(m->drm_enabled);
     g_file_get_contents(drm_status_file, &m->drm_status, NULL, NULL);
     if (m->drm_status) g_strstrip(m->drm_status);
-    g_file_get_contents(sysfs_edid_file, &edid_bin, &edid_len, NULL);
-    if (edid_len)
-        m->e = edid_new(edid_bin, edid_len);
     g_free(drm_enabled_file);
     g_free(drm_status_file);
     return m;
 }
 
+static void monitor_load_edid(monitor *m) {
+    gchar *edid_file = g_strdup_printf("%s/%s", m->drm_path, "edid");
+    gchar *edid_bin = NULL;
+    gsize edid_len = 0;
+
+    g_file_get_contents(edid_file, &edid_bin, &edid_len, NULL);
+    if (edid_len) {
+        m->edid_bin = edid_bin;
+        m->edid_len = edid_len;
+    } else
+        g_free(edid_bin);
+    g_free(edid_file);
+}
+
 void monitor_free(monitor *m) {
     if (m) {
         g_free(m->_vstr);
@@ -101,6 +118,7 @@ void monitor_free(monitor *m) {
         g_free(m->drm_enabled);
         g_free(m->drm_status);
         g_free(m->drm_path);
+        g_free(m->edid_bin);
         edid_free(m->e);
         g_free(m);
     }
@@ -187,7 +205,7 @@ gchar **get_output_lines(const char *cmd_line) {
     gchar *out, *err;
     gchar **ret = NULL;
 
-    spawned = g_spawn_command_line_sync(cmd_line,
+    spawned = hardinfo_spawn_command_line_sync(cmd_line,
             &out, &err, NULL, NULL);
     if (spawned) {
         ret = g_strsplit(out, "\n", -1);
@@ -441,27 +459,115 @@ static gchar *make_edid_section(monitor *m) {
         return g_strdup("");
 }
 
-gchar *monitors_get_info() {
-    gchar *icons = g_strdup("");
-    gchar *ret = g_strdup_printf("[%s]\n", _("Monitors"));
-    gchar tag_prefix[] = "DEV";
+/* Decoding an EDID and resolving its vendor through edid.ids or
+ * ieee_oui.ids is the expensive part of a scan, so each connector keeps
+ * the decode of the EDID it had at the last scan. The EDID itself is
+ * only read again after a drm uevent or on reload; status and enabled
+ * are read at every scan. Connectors not seen by a scan are dropped. */
+typedef struct {
+    gchar *sum;     /* of the EDID that was decoded */
+    gchar *name;    /* monitor_name() */
+    gchar *section; /* make_edid_section(), NULL if the checksum failed */
+} monitor_edid;
+
+static GHashTable *monitor_edid_cache = NULL; /* by connector */
+
+static void monitor_edid_free(monitor_edid *me) {
+    if (me) {
+        g_free(me->sum);
+        g_free(me->name);
+        g_free(me->section);
+        g_free(me);
+    }
+}
+
+static const monitor_edid *monitor_edid_lookup(GHashTable *prev, monitor *m, gboolean changed) {
+    monitor_edid *me = NULL;
+    gpointer key;
+    gchar *sum;
 
-    gchar **edid_files = get_output_lines("find /sys/devices -name edid");
-    //gchar **edid_files = get_output_lines("find /home/pburt/github/verbose-spork/junk/testing/.testing/edid2/ -name edid.*");
-    int i, found = 0;
-    for(i = 0; edid_files[i]; i++) {
-        monitor *m = monitor_new_from_sysfs(edid_files[i]);
-        //if (m && m->e->std < STD_DISPLAYID) continue;
-        //if (m && !m->e->interface) continue;
-        //if (m && m->e->interface != 1) continue;
+    if (!monitor_edid_cache)
+        monitor_edid_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                g_free, (GDestroyNotify)monitor_edid_free);
+
+    /* take the connector's entry from the previous scan's cache */
+    if (prev && g_hash_table_lookup_extended(prev, m->drm_connection, &key, (gpointer *)&me)) {
+        g_hash_table_steal(prev, m->drm_connection);
+        g_free(key);
+    }
+    if (me && !changed)
+        goto keep;
+
+    monitor_load_edid(m);
+    if (!m->edid_bin) {
+        monitor_edid_free(me);
+        return NULL;
+    }
+    sum = g_compute_checksum_for_data(G_CHECKSUM_SHA1, (guchar *)m->edid_bin, m->edid_len);
+    if (me && SEQ(me->sum, sum)) {
+        g_free(sum);
+        goto keep;
+    }
+
+    monitor_edid_free(me);
+    me = g_new0(monitor_edid, 1);
+    me->sum = sum;
+    m->e = edid_new(m->edid_bin, m->edid_len);
+    me->name = monitor_name(m, TRUE);
+    if (m->e && m->e->checksum_ok)
+        me->section = make_edid_section(m);
+
+keep:
+    g_hash_table_insert(monitor_edid_cache, g_strdup(m->drm_connection), me);
+    return me;
+}
+
+/* a drm uevent since the last scan means EDIDs may have changed;
+ * without the socket that can't be known, so they are always read */
+static int drm_uevent_fd = -2;
+
+static gboolean drm_uevent_pending(void) {
+    if (drm_uevent_fd == -2) {
+        drm_uevent_fd = uevent_open();
+        return TRUE;
+    }
+    if (drm_uevent_fd < 0)
+        return TRUE;
+    return uevent_drain(drm_uevent_fd, "drm") != 0;
+}
+
+gchar *monitors_get_info(gboolean reload) {
+    gchar *icons, *ret;
+    gchar tag_prefix[] = "DEV";
+    GHashTable *prev_cache;
+    GList *conns = NULL, *l;
+    GDir *dir;
+    const gchar *name;
+    /* always asked, so the socket is drained at every scan */
+    gboolean changed = drm_uevent_pending() || reload;
+
+    prev_cache = monitor_edid_cache;
+    monitor_edid_cache = NULL;
+
+    if ((dir = g_dir_open(DRM_CLASS_DIR, 0, NULL))) {
+        while ((name = g_dir_read_name(dir)))
+            conns = g_list_prepend(conns, g_build_filename(DRM_CLASS_DIR, name, "edid", NULL));
+        g_dir_close(dir);
+    }
+    conns = g_list_sort(conns, (GCompareFunc)strcmp);
+
+    icons = g_strdup("");
+    ret = g_strdup_printf("[%s]\n", _("Monitors"));
+    int found = 0;
+    for(l = conns; l; l = l->next) {
+        if (access(l->data, R_OK)) continue;
+        monitor *m = monitor_new_from_sysfs(l->data);
         if (m && !SEQ(m->drm_status, "disconnected")) {
             gchar *tag = g_strdup_printf("%d-%s", found, m->drm_connection);
             tag_make_safe_inplace(tag);
-            gchar *desc = monitor_name(m, TRUE);
-            gchar *edid_section = NULL;
-            edid *e = m->e;
-            if (e && e->checksum_ok)
-                 edid_section = make_edid_section(m);
+            const monitor_edid *me = monitor_edid_lookup(prev_cache, m, changed);
+            gchar *desc = me ? g_strdup(me->name) : g_strdup(_("(Unknown)"));
+            gchar *edid_section = me ? g_strdup(me->section) : NULL;
 
             gchar *details = g_strdup_printf("[%s]\n"
                                 "%s=%s\n"
@@ -482,7 +588,9 @@ gchar *monitors_get_info() {
         }
         monitor_free(m);
     }
-    g_strfreev(edid_files);
+    g_list_free_full(conns, g_free);
+    if (prev_cache)
+        g_hash_table_destroy(prev_cache);
 
     no_monitors = FALSE;
     if(!found) {
@@ -148,6 +148,14 @@ static gchar *_pci_dev(const pcid *p, gchar *icons) {
     } else
         pcie_str = strdup("");
 
+    gchar *power_str;
+    if (p->power_state && p->runtime_status)
+        power_str = g_strdup_printf("%s (%s)", p->power_state, p->runtime_status);
+    else if (p->power_state || p->runtime_status)
+        power_str = g_strdup(p->power_state ? p->power_state : p->runtime_status);
+    else
+        power_str = g_strdup(_("(Unknown)"));
+
     str = g_strdup_printf("[%s]\n"
              /* Class */     "%s=[%04x] %s\n"
                              "%s"
@@ -156,6 +164,7 @@ static gchar *_pci_dev(const pcid *p, gchar *icons) {
                              "[%s]\n"
             /* Driver */     "%s=%s\n"
             /* Modules */    "%s=%s\n"
+            /* Power */      "%s=%s\n"
                              "[%s]\n"
             /* Domain */     "%s=%04x\n"
             /* Bus */        "%s=%02x\n"
@@ -169,6 +178,7 @@ static gchar *_pci_dev(const pcid *p, gchar *icons) {
                 _("Driver"),
                 _("In Use"), (p->driver) ? p->driver : _("(Unknown)"),
                 _("Kernel Modules"), (p->driver_list) ? p->driver_list : _("(Unknown)"),
+                _("Power State"), power_str,
                 _("Connection"),
                 _("Domain"), p->domain,
                 _("Bus"), p->bus,
@@ -177,6 +187,7 @@ static gchar *_pci_dev(const pcid *p, gchar *icons) {
                 );
 
     g_free(pcie_str);
+    g_free(power_str);
 
     moreinfo_add_with_prefix("DEV", key, str); /* str now owned by morinfo */
 
@@ -16,66 +16,445 @@
  *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
  */
 
-#ifndef _XOPEN_SOURCE
-  #define _XOPEN_SOURCE
+#ifndef _GNU_SOURCE
+  #define _GNU_SOURCE
 #endif
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 #include "devices.h"
 
-typedef struct _CUPSDest	CUPSDest;
-typedef struct _CUPSOption	CUPSOption;
+/* Printers come from cupsd with a native IPP CUPS-Get-Printers request.
+ * It runs on a worker thread with a hard deadline, so a wedged cupsd or a
+ * server with many queues can't hold up the page or a report; the page is
+ * built from the last answer received. */
+#define IPP_HOST "127.0.0.1"  /* only our own cups, by ip for a faster answer */
+#ifndef IPP_PORT
+#define IPP_PORT 631
+#endif
+#ifndef IPP_DEADLINE
+#define IPP_DEADLINE 5000     /* ms for the whole request */
+#endif
+#ifndef IPP_FIRST_WAIT
+#define IPP_FIRST_WAIT 1500   /* ms a first scan waits for an answer */
+#endif
+#define IPP_MAX_RESPONSE (16 * 1024 * 1024)
+#ifndef CUPS_SERVERROOT
+#define CUPS_SERVERROOT "/etc/cups"
+#endif
 
-struct _CUPSOption {
-    char *name, *value;
+enum {
+    IPP_STATE_NONE,      /* no answer yet */
+    IPP_STATE_OK,
+    IPP_STATE_FAILED,    /* no cupsd, or an error */
+    IPP_STATE_TIMEOUT,
 };
 
-struct _CUPSDest {
-    char *name, *instance;
-    int is_default;
-    int num_options;
-    CUPSOption *options;
+typedef struct {
+    gchar *name;
+    GHashTable *attrs; /* attribute name, without any -default suffix, to value */
+} IppPrinter;
+
+static const char *ipp_requested[] = {
+    "printer-name", "printer-info", "printer-make-and-model", "printer-type",
+    "printer-state", "printer-state-change-time", "printer-state-reasons",
+    "printer-is-shared", "printer-location", "auth-info-required",
+    "printer-is-accepting-jobs", "job-hold-until-default",
+    "job-priority-default", "media-default", "finishings-default",
+    "copies-default",
 };
 
-static int (*cups_dests_get) (CUPSDest **dests) = NULL;
-static int (*cups_dests_free) (int num_dests, CUPSDest *dests) = NULL;
-static void (*cups_set_server)(const char *server) = NULL;
-static volatile gboolean cups_init = FALSE;
+G_LOCK_DEFINE_STATIC(ipp);
+static GThread *ipp_worker = NULL;
+static gboolean ipp_worker_done = FALSE;
+static GPtrArray *ipp_printers = NULL; /* last good answer */
+static int ipp_state = IPP_STATE_NONE;
 
-GModule *cups;
+/* tag -> moreinfo published for it, to only replace what changed */
+static GHashTable *prn_published = NULL;
 
-void
-init_cups(void)
+static void ipp_printer_free(IppPrinter *p)
+{
+    g_free(p->name);
+    g_hash_table_destroy(p->attrs);
+    g_free(p);
+}
+
+static gint64 ipp_now_ms(void)
 {
-    const char *libcups[] = { "libcups", "libcups.so", "libcups.so.1", "libcups.so.2", NULL };
+    struct timespec ts;
 
-    if (!(cups_dests_get && cups_dests_free)) {
-        int i;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (gint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-        for (i = 0; libcups[i] != NULL; i++) {
-            cups = g_module_open(libcups[i], G_MODULE_BIND_LAZY);
-            if (cups)
-                break;
+/* poll() until the deadline; FALSE once it passed */
+static gboolean ipp_wait(int fd, short events, gint64 deadline)
+{
+    struct pollfd pfd = { fd, events, 0 };
+    gint64 left;
+    int r;
+
+    do {
+        left = deadline - ipp_now_ms();
+        if (left <= 0)
+            return FALSE;
+        r = poll(&pfd, 1, (int)left);
+    } while (r < 0 && errno == EINTR);
+    return r > 0;
+}
+
+static void ipp_add_attr(GByteArray *req, guint8 tag, const char *name, const char *value)
+{
+    guint16 nlen = htons(name ? strlen(name) : 0), vlen = htons(strlen(value));
+
+    g_byte_array_append(req, &tag, 1);
+    g_byte_array_append(req, (guint8 *)&nlen, 2);
+    if (name)
+        g_byte_array_append(req, (const guint8 *)name, strlen(name));
+    g_byte_array_append(req, (guint8 *)&vlen, 2);
+    g_byte_array_append(req, (const guint8 *)value, strlen(value));
+}
+
+static GByteArray *ipp_get_printers_request(void)
+{
+    /* IPP 2.0, CUPS-Get-Printers, request-id 1, operation attributes */
+    static const guint8 head[] = { 2, 0, 0x40, 0x02, 0, 0, 0, 1, 0x01 };
+    GByteArray *req = g_byte_array_new();
+    guint8 end = 0x03;
+    guint i;
+
+    g_byte_array_append(req, head, sizeof(head));
+    ipp_add_attr(req, 0x47, "attributes-charset", "utf-8");
+    ipp_add_attr(req, 0x48, "attributes-natural-language", "en");
+    for (i = 0; i < G_N_ELEMENTS(ipp_requested); i++)
+        ipp_add_attr(req, 0x44, i ? NULL : "requested-attributes", ipp_requested[i]);
+    g_byte_array_append(req, &end, 1);
+
+    return req;
+}
+
+/* the text of a value, or NULL for types that aren't shown */
+static gchar *ipp_value_str(guint8 tag, const guint8 *v, guint16 len)
+{
+    switch (tag) {
+    case 0x21: /* integer */
+    case 0x23: /* enum */
+        if (len != 4)
+            return NULL;
+        return g_strdup_printf("%d", (gint32)((guint32)v[0] << 24 | v[1] << 16 | v[2] << 8 | v[3]));
+    case 0x22: /* boolean */
+        return len == 1 ? g_strdup(v[0] ? "true" : "false") : NULL;
+    case 0x35: /* textWithLanguage */
+    case 0x36: /* nameWithLanguage */
+        if (len >= 4) {
+            guint16 l = v[0] << 8 | v[1];
+            if (2 + l + 2 <= len) {
+                guint16 t = v[2 + l] << 8 | v[3 + l];
+                if (4 + l + t <= len)
+                    return g_strndup((const gchar *)v + 4 + l, t);
+            }
         }
+        return NULL;
+    default:
+        /* text, name, keyword, uri, charset, language, mime type */
+        if (tag >= 0x41 && tag <= 0x49)
+            return g_strndup((const gchar *)v, len);
+        return NULL;
+    }
+}
 
-        if (!cups) {
-	    cups_init = FALSE;
-	    return;
-	}
+/* printers from an IPP response body, NULL if it is not a good one */
+static GPtrArray *ipp_parse_printers(const guint8 *b, gsize len)
+{
+    GPtrArray *printers;
+    IppPrinter *cur = NULL;
+    gchar *attr = NULL;
+    gsize pos = 8;
+    guint16 status;
+    guint i;
+
+    if (len < 9)
+        return NULL;
+    status = b[2] << 8 | b[3];
+    printers = g_ptr_array_new_with_free_func((GDestroyNotify)ipp_printer_free);
+    /* client-error-not-found: no printers */
+    if (status == 0x0406)
+        return printers;
+    if (status > 0x00ff)
+        goto bad;
+
+    while (pos < len) {
+        guint8 tag = b[pos++];
+        guint16 nlen, vlen;
+        gchar *value;
+
+        if (tag == 0x03) /* end-of-attributes */
+            break;
+        if (tag < 0x10) {
+            /* a printer-attributes group starts the next printer */
+            cur = NULL;
+            if (tag == 0x04) {
+                cur = g_new0(IppPrinter, 1);
+                cur->attrs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+                g_ptr_array_add(printers, cur);
+            }
+            continue;
+        }
 
-	if (!g_module_symbol(cups, "cupsGetDests", (gpointer) & cups_dests_get)
-	    || !g_module_symbol(cups, "cupsFreeDests", (gpointer) & cups_dests_free)
-	    || !g_module_symbol(cups, "cupsSetServer", (gpointer) & cups_set_server)) {
-	    g_module_close(cups);
-	    cups_init = FALSE;
-	    return;
-	}
+        if (pos + 2 > len)
+            goto bad;
+        nlen = b[pos] << 8 | b[pos + 1];
+        pos += 2;
+        if (pos + nlen + 2 > len)
+            goto bad;
+        if (nlen) {
+            g_free(attr);
+            attr = g_strndup((const gchar *)b + pos, nlen);
+            if (g_str_has_suffix(attr, "-default"))
+                attr[nlen - strlen("-default")] = 0;
+        }
+        pos += nlen;
+        vlen = b[pos] << 8 | b[pos + 1];
+        pos += 2;
+        if (pos + vlen > len)
+            goto bad;
+
+        value = (cur && attr) ? ipp_value_str(tag, b + pos, vlen) : NULL;
+        pos += vlen;
+        if (!value)
+            continue;
+
+        if (g_str_equal(attr, "printer-name") && !cur->name) {
+            cur->name = value;
+        } else {
+            /* a value with an empty name belongs to the previous attribute */
+            const gchar *prev = nlen ? NULL : g_hash_table_lookup(cur->attrs, attr);
+            if (prev) {
+                gchar *joined = g_strdup_printf("%s,%s", prev, value);
+                g_free(value);
+                value = joined;
+            }
+            g_hash_table_replace(cur->attrs, g_strdup(attr), value);
+        }
+    }
+
+    g_free(attr);
+    /* printers without a name can't be shown */
+    for (i = printers->len; i > 0; i--) {
+        IppPrinter *p = g_ptr_array_index(printers, i - 1);
+        if (!p->name)
+            g_ptr_array_remove_index(printers, i - 1);
+    }
+    return printers;
+
+bad:
+    g_free(attr);
+    g_ptr_array_free(printers, TRUE);
+    return NULL;
+}
+
+/* the body of an HTTP/1.1 response, undoing chunked transfer encoding */
+static gboolean ipp_http_body(GByteArray *resp, const guint8 **body, gsize *len)
+{
+    gchar *hdr_end, *hdrs, *end, *eol;
+    gboolean chunked;
+    gsize hlen, in, out, size;
+
+    g_byte_array_append(resp, (const guint8 *)"", 1); /* terminate for str* */
+    resp->len--;
+    if (!g_str_has_prefix((gchar *)resp->data, "HTTP/1.") || strncmp((gchar *)resp->data + 8, " 200", 4))
+        return FALSE;
+    if (!(hdr_end = strstr((gchar *)resp->data, "\r\n\r\n")))
+        return FALSE;
+
+    hlen = hdr_end + 4 - (gchar *)resp->data;
+    hdrs = g_ascii_strdown((gchar *)resp->data, hlen);
+    chunked = strstr(hdrs, "\r\ntransfer-encoding: chunked") != NULL;
+    g_free(hdrs);
+
+    if (!chunked) {
+        *body = resp->data + hlen;
+        *len = resp->len - hlen;
+        return TRUE;
+    }
+
+    /* chunks are joined in place */
+    for (in = out = hlen;;) {
+        if (in >= resp->len)
+            return FALSE;
+        size = strtoul((gchar *)resp->data + in, &end, 16);
+        eol = strstr((gchar *)resp->data + in, "\r\n");
+
+        if (!eol || end == (gchar *)resp->data + in)
+            return FALSE;
+        in = eol + 2 - (gchar *)resp->data;
+        if (size == 0)
+            break;
+        if (size > resp->len - in)
+            return FALSE;
+        memmove(resp->data + out, resp->data + in, size);
+        out += size;
+        in += size + 2;
+    }
+    *body = resp->data + hlen;
+    *len = out - hlen;
+    return TRUE;
+}
+
+/* one CUPS-Get-Printers round trip; state is IPP_STATE_* */
+static GPtrArray *ipp_get_printers(int *state)
+{
+    gint64 deadline = ipp_now_ms() + IPP_DEADLINE;
+    struct sockaddr_in addr;
+    GByteArray *req = ipp_get_printers_request(), *resp = g_byte_array_new();
+    GPtrArray *printers = NULL;
+    const guint8 *body;
+    gchar *http;
+    gsize sent = 0, body_len;
+    int fd, err = 0;
+    socklen_t errlen = sizeof(err);
+    guint8 buf[16384];
+
+    *state = IPP_STATE_FAILED;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(IPP_PORT);
+    addr.sin_addr.s_addr = inet_addr(IPP_HOST);
+
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        goto out;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        if (errno != EINPROGRESS)
+            goto out;
+        if (!ipp_wait(fd, POLLOUT, deadline)) {
+            *state = IPP_STATE_TIMEOUT;
+            goto out;
+        }
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errlen) < 0 || err)
+            goto out;
+    }
+
+    http = g_strdup_printf("POST / HTTP/1.1\r\n"
+                           "Host: localhost:%d\r\n"
+                           "Content-Type: application/ipp\r\n"
+                           "Content-Length: %u\r\n"
+                           "Connection: close\r\n\r\n", IPP_PORT, req->len);
+    g_byte_array_prepend(req, (guint8 *)http, strlen(http));
+    g_free(http);
+
+    while (sent < req->len) {
+        ssize_t n;
+
+        if (!ipp_wait(fd, POLLOUT, deadline)) {
+            *state = IPP_STATE_TIMEOUT;
+            goto out;
+        }
+        n = send(fd, req->data + sent, req->len - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno != EAGAIN && errno != EINTR)
+            goto out;
+        if (n > 0)
+            sent += n;
+    }
+
+    for (;;) {
+        ssize_t n;
+
+        if (!ipp_wait(fd, POLLIN, deadline)) {
+            *state = IPP_STATE_TIMEOUT;
+            goto out;
+        }
+        n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+            continue;
+        if (n < 0)
+            goto out;
+        if (n == 0)
+            break;
+        g_byte_array_append(resp, buf, n);
+        if (resp->len > IPP_MAX_RESPONSE)
+            goto out;
     }
 
-    cups_init = TRUE;
+    if (ipp_http_body(resp, &body, &body_len)
+        && (printers = ipp_parse_printers(body, body_len)))
+        *state = IPP_STATE_OK;
+
+out:
+    if (fd >= 0)
+        close(fd);
+    g_byte_array_free(req, TRUE);
+    g_byte_array_free(resp, TRUE);
+    return printers;
+}
+
+static gpointer ipp_worker_func(gpointer data)
+{
+    int state;
+    GPtrArray *printers = ipp_get_printers(&state);
+
+    G_LOCK(ipp);
+    /* a slow answer keeps the last list, no cupsd drops it */
+    if (printers || state == IPP_STATE_FAILED) {
+        if (ipp_printers)
+            g_ptr_array_free(ipp_printers, TRUE);
+        ipp_printers = printers;
+    }
+    ipp_state = state;
+    ipp_worker_done = TRUE;
+    G_UNLOCK(ipp);
+
+    return NULL;
+}
+
+/* join a finished worker and start the next one */
+static void ipp_refresh(void)
+{
+    gboolean done;
+
+    G_LOCK(ipp);
+    done = ipp_worker_done;
+    G_UNLOCK(ipp);
+
+    if (ipp_worker && done) {
+        g_thread_join(ipp_worker);
+        ipp_worker = NULL;
+    }
+    if (!ipp_worker) {
+        G_LOCK(ipp);
+        ipp_worker_done = FALSE;
+        G_UNLOCK(ipp);
+#if GLIB_CHECK_VERSION(2,32,0)
+        ipp_worker = g_thread_new("ipp", ipp_worker_func, NULL);
+#else
+        ipp_worker = g_thread_create(ipp_worker_func, NULL, TRUE, NULL);
+#endif
+    }
+}
+
+void printers_shutdown(void)
+{
+    /* the worker is bounded by IPP_DEADLINE */
+    if (ipp_worker)
+        g_thread_join(ipp_worker);
+    ipp_worker = NULL;
+    if (ipp_printers)
+        g_ptr_array_free(ipp_printers, TRUE);
+    ipp_printers = NULL;
+    if (prn_published)
+        g_hash_table_destroy(prn_published);
+    prn_published = NULL;
 }
 
 gchar *__cups_callback_ptype(gchar *strvalue)
@@ -142,7 +521,7 @@ gchar *__cups_callback_state_change_time(gchar *value)
 gchar *__cups_callback_boolean(gchar *value)
 {
   if (value) {
-    return g_strdup(g_str_equal(value, "1") ? _("Yes") : _("No"));
+    return g_strdup((g_str_equal(value, "1") || g_str_equal(value, "true")) ? _("Yes") : _("No"));
   } else {
     return g_strdup(_("Unknown"));
   }
@@ -168,7 +547,7 @@ const struct {
   { "Sharing Information", NULL, NULL },
   { "printer-is-shared", "Shared?", __cups_callback_boolean },
   { "printer-location", "Physical Location" },
-  { "auth-info-required", "Authentication Required", __cups_callback_boolean },
+  { "auth-info-required", "Authentication Required", NULL },
 
   { "Jobs", NULL, NULL },
   { "job-hold-until", "Hold Until", NULL },
@@ -181,100 +560,200 @@ const struct {
   { "copies", "Copies", NULL },
 };
 
-void
-scan_printers_do(void)
+static gchar *printer_moreinfo(IppPrinter *p)
 {
-    guint num_dests, j, i;
-    CUPSDest *dests;
-    gchar *prn_id, *prn_moreinfo;
+    gchar *prn_moreinfo = g_strdup("");
+    guint j;
+
+    for (j = 0; j < G_N_ELEMENTS(cups_fields); j++) {
+      if (!cups_fields[j].name) {
+        prn_moreinfo = h_strdup_cprintf("[%s]\n",
+                                        prn_moreinfo,
+                                        cups_fields[j].key);
+      } else {
+        gchar *temp;
+
+        temp = g_hash_table_lookup(p->attrs, cups_fields[j].key);
+
+        if (cups_fields[j].callback) {
+          temp = cups_fields[j].callback(temp);
+        } else {
+          if (temp) {
+            /* FIXME Do proper escaping */
+            temp = strreplacechr(g_strdup(temp), "&=", ' ');
+          } else {
+            temp = g_strdup(_("Unknown"));
+          }
+        }
 
-    g_free(printer_list);
-    g_free(printer_icons);
+        prn_moreinfo = h_strdup_cprintf("%s%s=%s\n",
+                                        prn_moreinfo,
+                                        cups_fields[j].maybe_vendor ? "$^$" : "",
+                                        cups_fields[j].name,
+                                        temp);
 
-    if (!cups_init) {
-        init_cups();
+        g_free(temp);
+      }
     }
 
-    if(!cups_init) {
-        printer_icons = g_strdup("");
-        printer_list = g_strdup(_("[Printers]\n"
-                                "No suitable CUPS library found="));
-        return;
-    }else{
-      //only list from our own cups, use ip for faster/secure answer
-      cups_set_server("127.0.0.1");
+    return prn_moreinfo;
+}
+
+/* the printer lp and lpr use when none is given, as libcups picks it:
+ * the Default line of ~/.cups/lpoptions, else of the system lpoptions;
+ * NULL leaves it to cupsd */
+static gchar *lpoptions_default(void)
+{
+    gchar *files[] = {
+        g_build_filename(g_get_home_dir(), ".cups", "lpoptions", NULL),
+        g_build_filename(CUPS_SERVERROOT, "lpoptions", NULL),
+    };
+    gchar *name = NULL;
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(files); i++) {
+        gchar *contents, **lines, **line;
+
+        if (!name && g_file_get_contents(files[i], &contents, NULL, NULL)) {
+            lines = g_strsplit(contents, "\n", -1);
+            for (line = lines; *line && !name; line++) {
+                /* Default name[/instance] [option=value ...] */
+                gchar **words = g_strsplit_set(g_strstrip(*line), " \t", 3);
+
+                if (words[0] && words[1] && *words[1]
+                    && !g_ascii_strcasecmp(words[0], "Default")) {
+                    name = g_strdup(words[1]);
+                    strend(name, '/');
+                }
+                g_strfreev(words);
+            }
+            g_strfreev(lines);
+            g_free(contents);
+        }
+        g_free(files[i]);
     }
+    return name;
+}
 
-    /* remove old devices from global device table */
-    moreinfo_del_with_prefix("DEV:PRN");
+static gboolean prn_gone(gpointer key, gpointer value, gpointer current)
+{
+    gchar *prefix;
 
-    num_dests = cups_dests_get(&dests);
-    if (num_dests > 0) {
-	printer_list = g_strdup_printf(_("[Printers (CUPS)]\n"));
-        printer_icons = g_strdup("");
-	for (i = 0; i < num_dests; i++) {
-	    GHashTable *options;
+    if (g_hash_table_lookup(current, key))
+        return FALSE;
+
+    prefix = g_strdup_printf("DEV:%s", (gchar *)key);
+    moreinfo_del_with_prefix(prefix);
+    g_free(prefix);
+    return TRUE;
+}
+
+void
+scan_printers_do(void)
+{
+    GHashTable *current;
+    GHashTableIter iter;
+    gpointer key, value;
+    gint64 wait_until;
+    gchar *lp_default;
+    guint i;
+    int state;
+
+    g_free(printer_list);
+    g_free(printer_icons);
+    printer_icons = g_strdup("");
+
+    ipp_refresh();
+    lp_default = lpoptions_default();
+
+    /* a first scan waits a little for an answer, later ones show the last */
+    wait_until = ipp_now_ms() + IPP_FIRST_WAIT;
+    G_LOCK(ipp);
+    while (ipp_state == IPP_STATE_NONE && !ipp_worker_done && ipp_now_ms() < wait_until) {
+        G_UNLOCK(ipp);
+        g_usleep(10000);
+        G_LOCK(ipp);
+    }
+    state = ipp_state;
 
-	    options = g_hash_table_new(g_str_hash, g_str_equal);
+    if (!prn_published)
+        prn_published = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    current = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
 
-	    for (j = 0; (int)j < dests[i].num_options; j++) {
-	      g_hash_table_insert(options,
-	                          g_strdup(dests[i].options[j].name),
-	                          g_strdup(dests[i].options[j].value));
-	    }
+    if (ipp_printers && ipp_printers->len > 0) {
+        gboolean lp_known = FALSE;
 
-            prn_id = g_strdup_printf("PRN%d", i);
+        /* an lpoptions default naming a printer that is gone is ignored */
+        for (i = 0; lp_default && i < ipp_printers->len; i++) {
+            IppPrinter *p = g_ptr_array_index(ipp_printers, i);
+            if (!g_ascii_strcasecmp(p->name, lp_default))
+                lp_known = TRUE;
+        }
+
+	printer_list = g_strdup_printf(_("[Printers (CUPS)]\n"));
+	for (i = 0; i < ipp_printers->len; i++) {
+            IppPrinter *p = g_ptr_array_index(ipp_printers, i);
+            const gchar *ptype = g_hash_table_lookup(p->attrs, "printer-type");
+            gboolean is_default;
+            gchar *prn_id = g_strdup_printf("PRN_%s", p->name);
+
+            if (lp_known)
+                is_default = !g_ascii_strcasecmp(p->name, lp_default);
+            else /* CUPS_PRINTER_DEFAULT */
+                is_default = ptype && (atoi(ptype) & 0x20000);
+
+            g_strcanon(prn_id, G_CSET_A_2_Z G_CSET_a_2_z G_CSET_DIGITS "_-", '_');
+            /* names that only differ in the characters replaced above */
+            if (g_hash_table_lookup(current, prn_id)) {
+                gchar *base = prn_id;
+                guint n = 2;
+
+                prn_id = NULL;
+                do {
+                    g_free(prn_id);
+                    prn_id = g_strdup_printf("%s_%u", base, n++);
+                } while (g_hash_table_lookup(current, prn_id));
+                g_free(base);
+            }
 
 	    printer_list = h_strdup_cprintf("\n$%s$%s=%s\n",
 					    printer_list,
 					    prn_id,
-					    dests[i].name,
-					    dests[i].is_default ? ((params.markup_ok) ? "<i>Default</i>" : "(Default)") : "");
+					    p->name,
+					    is_default ? ((params.markup_ok) ? "<i>Default</i>" : "(Default)") : "");
             printer_icons = h_strdup_cprintf("\nIcon$%s$%s=printer.svg",
                                              printer_icons,
                                              prn_id,
-                                             dests[i].name);
-
-            prn_moreinfo = g_strdup("");
-            for (j = 0; j < G_N_ELEMENTS(cups_fields); j++) {
-              if (!cups_fields[j].name) {
-                prn_moreinfo = h_strdup_cprintf("[%s]\n",
-                                                prn_moreinfo,
-                                                cups_fields[j].key);
-              } else {
-                gchar *temp;
-
-                temp = g_hash_table_lookup(options, cups_fields[j].key);
-
-                if (cups_fields[j].callback) {
-                  temp = cups_fields[j].callback(temp);
-                } else {
-                  if (temp) {
-                    /* FIXME Do proper escaping */
-                    temp = strreplacechr(temp, "&=", ' ');
-                  } else {
-                    temp = g_strdup(_("Unknown"));
-                  }
-                }
-
-                prn_moreinfo = h_strdup_cprintf("%s%s=%s\n",
-                                                prn_moreinfo,
-                                                cups_fields[j].maybe_vendor ? "$^$" : "",
-                                                cups_fields[j].name,
-                                                temp);
+                                             p->name);
 
-                g_free(temp);
-              }
-            }
-
-            moreinfo_add_with_prefix("DEV", prn_id, prn_moreinfo);
-            g_free(prn_id);
-            g_hash_table_destroy(options);
+            g_hash_table_replace(current, prn_id, printer_moreinfo(p));
 	}
-
-	cups_dests_free(num_dests, dests);
+    } else if (!ipp_printers && (state == IPP_STATE_TIMEOUT || state == IPP_STATE_NONE)) {
+	printer_list = g_strdup(_("[Printers]\n"
+	                        "CUPS did not answer in time=\n"));
     } else {
 	printer_list = g_strdup(_("[Printers]\n"
 	                        "No printers found=\n"));
     }
+    G_UNLOCK(ipp);
+    g_free(lp_default);
+
+    /* only touch the moreinfo of printers that changed or went away;
+     * a prefix delete may take others along, which are then put back */
+    g_hash_table_foreach_remove(prn_published, prn_gone, current);
+    g_hash_table_iter_init(&iter, current);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        if (!g_strcmp0(g_hash_table_lookup(prn_published, key), value))
+            continue;
+        moreinfo_add_with_prefix("DEV", key, g_strdup(value));
+        g_hash_table_replace(prn_published, g_strdup(key), g_strdup(value));
+    }
+    g_hash_table_iter_init(&iter, prn_published);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        gchar *prefix = g_strdup_printf("DEV:%s", (gchar *)key);
+        if (!moreinfo_lookup(prefix))
+            moreinfo_add_with_prefix("DEV", key, g_strdup(value));
+        g_free(prefix);
+    }
+    g_hash_table_destroy(current);
 }
@@ -17,9 +17,12 @@
  */
 
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "devices.h"
 #include "expr.h"
+#include "gpu_util.h"
 #include "hardinfo.h"
 #include "socket.h"
 #include "udisks2_util.h"
@@ -134,12 +137,13 @@ static void read_sensor_labels(gchar *devname) {
     fclose(conf);
 }
 
-static void add_sensor(const char *type,
-                       const char *sensor,
-                       const char *parent,
-                       double value,
-                       const char *unit,
-                       const char *icon) {
+static void add_sensor_sampled(const char *type,
+                               const char *sensor,
+                               const char *parent,
+                               double value,
+                               const char *unit,
+                               const char *icon,
+                               int interval) {
     char key[64];
 
     snprintf(key, sizeof(key), "%s/%s", parent, sensor);
@@ -171,7 +175,16 @@ static void add_sensor(const char *type,
 
     moreinfo_add_with_prefix("DEV", key, g_strdup_printf("%.2f%s", value, unit));
 
-    lginterval = h_strdup_cprintf("UpdateInterval$%s=1000\n", lginterval, key);
+    lginterval = h_strdup_cprintf("UpdateInterval$%s=%d\n", lginterval, key, interval);
+}
+
+static void add_sensor(const char *type,
+                       const char *sensor,
+                       const char *parent,
+                       double value,
+                       const char *unit,
+                       const char *icon) {
+    add_sensor_sampled(type, sensor, parent, value, unit, icon, 1000);
 }
 
 static gchar *get_sensor_label_from_conf(gchar *key) {
@@ -606,6 +619,202 @@ static void read_sensors_cpufreq(void) {
     }
 }
 
+/* GPU clocks, load, power and VRAM use come from the DRM cards' sysfs
+ * files. Unlike the other sensors they are sampled again each time the
+ * load graph asks for them (see gpu_sensor_field()), at the rate set by
+ * GpuSampleInterval in settings.ini. The samplers keep the files open and
+ * are rebuilt when a drm uevent adds or removes a card. */
+#define GPU_DRM_DIR "/sys/class/drm"
+#define GPU_DEFAULT_INTERVAL 1000
+
+enum {
+    GPU_BUSY,
+    GPU_CORE_CLOCK,
+    GPU_MEM_CLOCK,
+    GPU_POWER,
+    GPU_VRAM_USED,
+    GPU_N_MEASURES
+};
+
+/* hwmon power1_input is read with the other hwmon sensors already,
+ * power1_average and energy1_input are not */
+static const struct {
+    const char *type, *name, *unit, *icon;
+} gpu_measures[GPU_N_MEASURES] = {
+    [GPU_BUSY] = { "GPU Load", "Utilization", "%", "gpu" },
+    [GPU_CORE_CLOCK] = { "GPU Frequency", "Core", " MHz", "gpu" },
+    [GPU_MEM_CLOCK] = { "GPU Frequency", "Memory", " MHz", "gpu" },
+    [GPU_POWER] = { "Power", "GPU", " W", "bolt" },
+    [GPU_VRAM_USED] = { "GPU Memory", "VRAM Used", " MiB", "memory" },
+};
+
+typedef struct {
+    gchar *card;
+    gpu_sampler *sampler;
+    gpu_sample last;
+    gint64 last_ms;
+} gpu_sensor;
+
+typedef struct {
+    gpu_sensor *gpu;
+    int measure;
+} gpu_sensor_key;
+
+static GSList *gpu_sensors = NULL;
+static GHashTable *gpu_sensor_keys = NULL; /* sensor key -> gpu_sensor_key */
+static gboolean gpu_sensors_found = FALSE;
+static int gpu_uevent_fd = -2;
+
+static gint gpu_sample_interval(void)
+{
+    static gint interval = 0;
+
+    if (!interval) {
+        GKeyFile *key_file = g_key_file_new();
+        gchar *conf_path = g_build_filename(g_get_user_config_dir(), "hardinfo2", "settings.ini", NULL);
+
+        g_key_file_load_from_file(key_file, conf_path, G_KEY_FILE_NONE, NULL);
+        interval = g_key_file_get_integer(key_file, "Devices", "GpuSampleInterval", NULL);
+        if (interval <= 0)
+            interval = GPU_DEFAULT_INTERVAL;
+        interval = CLAMP(interval, 100, 60000);
+
+        g_free(conf_path);
+        g_key_file_free(key_file);
+    }
+    return interval;
+}
+
+static gint64 gpu_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (gint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void gpu_sensor_free(gpu_sensor *gpu)
+{
+    gpu_sampler_free(gpu->sampler);
+    g_free(gpu->card);
+    g_free(gpu);
+}
+
+static void gpu_sensors_free(void)
+{
+    if (gpu_sensor_keys)
+        g_hash_table_remove_all(gpu_sensor_keys);
+    g_slist_free_full(gpu_sensors, (GDestroyNotify)gpu_sensor_free);
+    gpu_sensors = NULL;
+}
+
+static void gpu_sensors_enumerate(void)
+{
+    GDir *dir;
+    const gchar *entry;
+    GSList *names = NULL, *l;
+
+    gpu_sensors_free();
+
+    dir = g_dir_open(GPU_DRM_DIR, 0, NULL);
+    if (!dir)
+        return;
+    while ((entry = g_dir_read_name(dir))) {
+        /* cards only, not their connectors (card0-DP-1) */
+        if (g_str_has_prefix(entry, "card") && entry[4] && strspn(entry + 4, "0123456789") == strlen(entry + 4))
+            names = g_slist_insert_sorted(names, g_strdup(entry), (GCompareFunc)g_strcmp0);
+    }
+    g_dir_close(dir);
+
+    for (l = names; l; l = l->next) {
+        gchar *path = g_build_filename(GPU_DRM_DIR, l->data, NULL);
+        gpu_sampler *sampler = gpu_sampler_new(path);
+
+        if (sampler) {
+            gpu_sensor *gpu = g_new0(gpu_sensor, 1);
+            gpu->card = g_strdup(l->data);
+            gpu->sampler = sampler;
+            gpu_sensors = g_slist_append(gpu_sensors, gpu);
+        }
+        g_free(path);
+    }
+    g_slist_free_full(names, g_free);
+}
+
+/* a fresh sample, unless the last one is recent enough for this interval */
+static const gpu_sample *gpu_sensor_sample(gpu_sensor *gpu)
+{
+    gint64 now = gpu_now_ms();
+
+    if (!gpu->last_ms || now - gpu->last_ms >= gpu_sample_interval() / 2) {
+        gpu_sampler_read(gpu->sampler, &gpu->last);
+        gpu->last_ms = now;
+    }
+    return &gpu->last;
+}
+
+/* the measure in its unit, or < 0 when the card doesn't report it */
+static double gpu_measure_value(const gpu_sample *s, int measure)
+{
+    switch (measure) {
+    case GPU_BUSY: return s->busy_percent;
+    case GPU_CORE_CLOCK: return s->core_mhz;
+    case GPU_MEM_CLOCK: return s->mem_mhz;
+    case GPU_POWER: return s->power_w;
+    case GPU_VRAM_USED: return s->vram_used < 0 ? -1 : s->vram_used / (1024.0 * 1024.0);
+    }
+    return -1;
+}
+
+static void read_sensors_gpu(void) {
+    GSList *l;
+    int m;
+
+    /* without a uevent socket the cards found first are kept, so the
+     * power computed from energy keeps its previous reading */
+    if (gpu_uevent_fd == -2)
+        gpu_uevent_fd = uevent_open();
+    if (!gpu_sensors_found
+        || (gpu_uevent_fd >= 0 && uevent_drain(gpu_uevent_fd, "drm") & (UEVENT_ADD_REMOVE | UEVENT_LOST))) {
+        gpu_sensors_enumerate();
+        gpu_sensors_found = TRUE;
+    }
+    if (!gpu_sensor_keys)
+        gpu_sensor_keys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    for (m = 0; m < GPU_N_MEASURES; m++) {
+        for (l = gpu_sensors; l; l = l->next) {
+            gpu_sensor *gpu = l->data;
+            double v = gpu_measure_value(gpu_sensor_sample(gpu), m);
+            gpu_sensor_key *k;
+
+            if (v < 0)
+                continue;
+            add_sensor_sampled(gpu_measures[m].type, gpu_measures[m].name, gpu->card, v,
+                               gpu_measures[m].unit, gpu_measures[m].icon, gpu_sample_interval());
+
+            k = g_new0(gpu_sensor_key, 1);
+            k->gpu = gpu;
+            k->measure = m;
+            g_hash_table_replace(gpu_sensor_keys,
+                                 g_strdup_printf("%s/%s", gpu->card, gpu_measures[m].name), k);
+        }
+    }
+}
+
+/* a live value for a GPU sensor's load graph, NULL for other fields */
+gchar *gpu_sensor_field(const gchar *field) {
+    gpu_sensor_key *k;
+    double v;
+
+    if (!gpu_sensor_keys || !(k = g_hash_table_lookup(gpu_sensor_keys, field)))
+        return NULL;
+    v = gpu_measure_value(gpu_sensor_sample(k->gpu), k->measure);
+    if (v < 0)
+        return NULL;
+    return g_strdup_printf("%.2f%s", v, gpu_measures[k->measure].unit);
+}
+
 static void read_sensors_omnibook(void) {
     const gchar *path_ob = "/proc/omnibook/temperature";
     gchar *contents;
@@ -745,6 +954,7 @@ void scan_sensors_do(void) {
     }
 
     read_sensors_cpufreq();
+    read_sensors_gpu();
     read_sensors_windfarm();
     read_sensors_udisks2();
 }
@@ -766,4 +976,12 @@ void sensor_shutdown(void) {
 
     g_hash_table_destroy(sensor_labels);
     g_hash_table_destroy(sensor_compute);
+
+    gpu_sensors_free();
+    if (gpu_sensor_keys)
+        g_hash_table_destroy(gpu_sensor_keys);
+    gpu_sensor_keys = NULL;
+    if (gpu_uevent_fd >= 0)
+        close(gpu_uevent_fd);
+    gpu_uevent_fd = -2;
 }
@@ -20,6 +20,7 @@
 #include <string.h>
 
 #include "hardinfo.h"
+#include "scan_profile.h"
 #include "devices.h"
 #include "udisks2_util.h"
 #include "storage_util.h"
@@ -662,6 +663,7 @@ void __scan_ide_devices(void)
 		GTimer *timer;
 		gchar *tmp = g_strdup_printf("cdrecord dev=/dev/hd%c -prcap 2>/dev/stdout", iface);
 		FILE *prcap;
+		ScanProfileEvent *ev = scan_profile_begin(SCAN_PROFILE_SPAWN, tmp);
 
 		if ((prcap = popen(tmp, "r"))) {
 		    /* we need a timeout so cdrecord does not try to get information on cd drives
@@ -712,6 +714,7 @@ void __scan_ide_devices(void)
 		    pclose(prcap);
 		    g_timer_destroy(timer);
 		}
+		scan_profile_end(ev);
 
 		g_free(tmp);
 	    }
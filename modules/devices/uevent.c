@@ -0,0 +1,91 @@
+/*
+ *    HardInfo - Displays System Information
+ *    Copyright (C) 2003-2008 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/* Kernel uevent sockets that are only drained at scan time, so a page
+ * can tell whether its devices changed since the last scan without a
+ * main loop watch (report and CLI modes have none). Each user keeps its
+ * own socket, as draining consumes the events. */
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include "devices.h"
+
+int uevent_open(void)
+{
+    struct sockaddr_nl addr;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1; /* kernel events, not udev's */
+    fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                NETLINK_KOBJECT_UEVENT);
+    if (fd >= 0 && bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+guint uevent_drain(int fd, const gchar *subsystem)
+{
+    gchar buf[8192];
+    gchar *match = g_strdup_printf("SUBSYSTEM=%s", subsystem);
+    guint found = 0;
+    ssize_t len;
+
+    if (fd < 0) {
+        g_free(match);
+        return UEVENT_LOST;
+    }
+
+    for (;;) {
+        gchar *p, *end;
+        guint action = 0;
+        gboolean ours = FALSE;
+
+        len = recv(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            /* ENOBUFS: events were dropped, so assume some were ours */
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                found |= UEVENT_LOST;
+            break;
+        }
+        buf[len] = 0;
+
+        /* "ACTION@DEVPATH\0KEY=VALUE\0..." */
+        for (p = buf, end = buf + len; p < end; p += strlen(p) + 1) {
+            if (g_str_equal(p, match))
+                ours = TRUE;
+            else if (g_str_equal(p, "ACTION=add") || g_str_equal(p, "ACTION=remove"))
+                action = UEVENT_ADD_REMOVE;
+            else if (g_str_has_prefix(p, "ACTION="))
+                action = UEVENT_CHANGE;
+        }
+        if (ours)
+            found |= action ? action : UEVENT_CHANGE;
+    }
+
+    g_free(match);
+    return found;
+}
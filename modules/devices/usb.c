@@ -163,6 +163,8 @@ static void _usb_dev(const usbd *u) {
              /* Protocol */    "%s=[%d] %s\n"
              /* Dev Version */ "%s=%s\n"
              /* Serial */      "%s=%s\n"
+             /* Driver */      "%s=%s\n"
+             /* Power */       "%s=%s\n"
                             "[%s]\n"
              /* Bus */         "%s=%03d\n"
              /* Device */      "%s=%03d\n"
@@ -180,6 +182,8 @@ static void _usb_dev(const usbd *u) {
                 _("Protocol"), u->dev_protocol, UNKIFNULL_AC(u->dev_protocol_str),
                 _("Device Version"), UNKIFNULL_AC(u->device_version),
                 _("Serial Number"), UNKIFNULL_AC(u->serial),
+                _("Driver"), UNKIFNULL_AC(u->driver),
+                _("Power State"), UNKIFNULL_AC(u->power_state),
                 _("Connection"),
                 _("Bus"), u->bus,
                 _("Device"), u->dev,
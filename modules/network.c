@@ -32,6 +32,7 @@
 #include <netdb.h>
 
 #include <hardinfo.h>
+#include <scan_profile.h>
 #include <iconcache.h>
 #include <shell.h>
 
@@ -91,6 +92,7 @@ void scan_statistics(gboolean reload)
 
     if ((netstat_path = find_program("netstat"))) {
       gchar *command_line = g_strdup_printf("%s -s", netstat_path);
+      ScanProfileEvent *ev = scan_profile_begin(SCAN_PROFILE_SPAWN, command_line);
 
       if ((netstat = popen(command_line, "r"))) {
         while (fgets(buffer, 256, netstat)) {
@@ -122,6 +124,7 @@ void scan_statistics(gboolean reload)
 
         pclose(netstat);
       }
+      scan_profile_end(ev);
 
       g_free(command_line);
       g_free(netstat_path);
@@ -193,6 +196,7 @@ void scan_route(gboolean reload)
 
     if ((route_path = find_program("route"))) {
       gchar *command_line = g_strdup_printf("%s -n", route_path);
+      ScanProfileEvent *ev = scan_profile_begin(SCAN_PROFILE_SPAWN, command_line);
 
       if ((route = popen(command_line, "r"))) {
         /* eat first two lines */
@@ -216,6 +220,7 @@ void scan_route(gboolean reload)
 
         pclose(route);
       }
+      scan_profile_end(ev);
 
       g_free(command_line);
       g_free(route_path);
@@ -270,8 +275,9 @@ void scan_connections(gboolean reload)
 
     if ((netstat_path = find_program("netstat"))) {
       gchar *command_line = g_strdup_printf("%s -an", netstat_path);
+      ScanProfileEvent *ev = scan_profile_begin(SCAN_PROFILE_SPAWN, command_line);
 
-      if ((netstat = popen("netstat -an", "r"))) {
+      if ((netstat = popen(command_line, "r"))) {
         while (fgets(buffer, 256, netstat)) {
           buffer[6] = '\0';
           buffer[43] = '\0';
@@ -289,6 +295,7 @@ void scan_connections(gboolean reload)
 
         pclose(netstat);
       }
+      scan_profile_end(ev);
 
       g_free(command_line);
       g_free(netstat_path);
@@ -278,7 +278,7 @@ void cb_open_updates_page()
     gboolean spawned;
 
     cmd_line=g_strdup("sh -c 'LC_ALL=C uname -m'");
-    spawned = g_spawn_command_line_sync(cmd_line, &arch, &err, NULL, NULL);
+    spawned = hardinfo_spawn_command_line_sync(cmd_line, &arch, &err, NULL, NULL);
     g_free(cmd_line);
     if (!spawned || strlen(arch)<1) {
       if(arch) g_free(arch);
@@ -323,7 +323,7 @@ void cb_refresh()
 	report_table(ctx, data);
 	report_footer(ctx);
 
-	gtk_clipboard_set_text(clip, ctx->output, -1);
+	gtk_clipboard_set_text(clip, ctx->output->str, -1);
 
 	g_free(data);
 	report_context_free(ctx);
@@ -8,8 +8,6 @@
 #include "loadgraph.h"
 #include "uber.h"
 
-#define LG_MAX_LINES 9
-
 static const gchar *default_colors[] = { "#73d216",
                                          "#f57900",
      /*colors from simple.c sample */    "#3465a4",
@@ -120,6 +118,16 @@ void load_graph_update_ex(LoadGraph *lg, guint line, gdouble value)
         lg->cur_value[line] = value;
 }
 
+void load_graph_set_history(LoadGraph *lg, guint line, const gdouble *values, guint n)
+{
+    if (lg == NULL || line >= LG_MAX_LINES)
+        return;
+
+    lg->cur_value[line] = n ? values[n - 1] : UBER_LINE_GRAPH_NO_VALUE;
+    uber_line_graph_set_line_data(UBER_LINE_GRAPH(lg->uber_widget), line + 1, values, n);
+    uber_graph_scale_changed(UBER_GRAPH(lg->uber_widget));
+}
+
 void load_graph_update(LoadGraph * lg, gdouble value)
 {
     load_graph_update_ex(lg, 0, value);
@@ -276,11 +276,36 @@ static void _draw(LoadGraph * lg)
 
 void load_graph_update_ex(LoadGraph *lg, guint line, gdouble value)
 {
-    /* not implemented */
+    /* only line 0, see LG_MAX_LINES */
     if (line == 0)
         load_graph_update(lg, value);
 }
 
+void load_graph_set_history(LoadGraph *lg, guint line, const gdouble *values, guint n)
+{
+    gint i, first;
+
+    /* only line 0, see LG_MAX_LINES */
+    if (line != 0)
+        return;
+
+    for (i = 0; i < lg->size; i++)
+        lg->data[i] = 0;
+
+    /* right align the newest samples */
+    first = MAX(0, (gint)n - lg->size);
+    for (i = first; i < (gint)n; i++)
+        lg->data[lg->size - (gint)n + i] = MAX(0, (gint)values[i]);
+
+    lg->max_value = 1;
+    for (i = 0; i < lg->size; i++)
+        lg->max_value = MAX(lg->max_value, lg->data[i]);
+    lg->remax_count = 0;
+    lg->scale = 0.90 * ((gfloat) lg->height / (gfloat) lg->max_value);
+
+    _draw(lg);
+}
+
 void load_graph_update(LoadGraph * lg, gdouble v)
 {
     gint i;
@@ -17,12 +17,16 @@
  */
 
 #include <report.h>
+#include <locale.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <stdarg.h>
 #include <shell.h>
 #include <iconcache.h>
 #include <hardinfo.h>
+#include <inventory.h>
 #include <config.h>
 #include "uri_handler.h"
 
@@ -41,6 +45,29 @@ static FileTypes file_types[] = {
 };
 
 /* virtual functions */
+/* writes go straight to ctx->stream when there is one, so a report
+ * never has to be held in memory as a whole */
+static void report_printf(ReportContext *ctx, const gchar *format, ...) G_GNUC_PRINTF(2, 3);
+static void report_printf(ReportContext *ctx, const gchar *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    if (ctx->stream)
+        vfprintf(ctx->stream, format, args);
+    else
+        g_string_append_vprintf(ctx->output, format, args);
+    va_end(args);
+}
+
+static void report_puts(ReportContext *ctx, const gchar *text)
+{
+    if (ctx->stream)
+        fputs(text, ctx->stream);
+    else
+        g_string_append(ctx->output, text);
+}
+
 void report_header(ReportContext * ctx)
 { ctx->header(ctx); }
 
@@ -129,10 +156,12 @@ gchar *make_icon_css(const gchar *file) {
     return ret ? ret : g_strdup("");
 }
 
+/* remembers the icon so the footer emits its rule once; the data itself
+ * is only read when the footer is written */
 void cache_icon(ReportContext *ctx, const gchar *file) {
-    if (!ctx->icon_data) return;
+    if (!ctx->icon_data || !file || !*file) return;
     if (!g_hash_table_lookup(ctx->icon_data, file) )
-        g_hash_table_insert(ctx->icon_data, g_strdup(file), make_icon_css(file));
+        g_hash_table_insert(ctx->icon_data, g_strdup(file), GINT_TO_POINTER(1));
 }
 
 void report_context_configure(ReportContext * ctx, GKeyFile * keyfile)
@@ -207,11 +236,11 @@ static void report_html_details_start(ReportContext *ctx, gchar *key, gchar *val
     report_key_value(ctx, key, value, longest_key);
     ctx->parent_columns = ctx->columns;
     ctx->columns = REPORT_COL_VALUE;
-    ctx->output = h_strdup_cprintf("<tr><td colspan=\"%d\"><table class=\"details\">\n", ctx->output, columns+1);//above
+    report_printf(ctx, "<tr><td colspan=\"%d\"><table class=\"details\">\n", columns+1);//above
 }
 
 static void report_html_details_end(ReportContext *ctx) {
-    ctx->output = h_strdup_cprintf("</table></td></tr>\n", ctx->output);
+    report_printf(ctx, "</table></td></tr>\n");
     ctx->columns = ctx->parent_columns;
     ctx->parent_columns = 0;
 }
@@ -290,6 +319,22 @@ void report_details(ReportContext *ctx, gchar *key, gchar *value, gchar *details
     report_details_end(ctx);
 }
 
+/* moreinfo from the inventory cache when the entry wasn't rescanned;
+ * returns a copy, the module keeps ownership of its own strings */
+static gchar *report_more_info(ReportContext *ctx, gchar *tag)
+{
+    gchar *data;
+
+    if (ctx->inventory_hit)
+        return inventory_get_moreinfo(ctx->inventory_id, tag);
+
+    data = module_entry_get_moreinfo(ctx->entry, tag);
+    if (data && ctx->inventory_id)
+        inventory_put_moreinfo(ctx->inventory_id, tag, data);
+
+    return g_strdup(data);
+}
+
 static void report_table_shell_dump(ReportContext *ctx, gchar *key_file_str, int level)
 {
     gchar *text=NULL, *p, *next_nl, *eq, *indent;
@@ -306,19 +351,20 @@ static void report_table_shell_dump(ReportContext *ctx, gchar *key_file_str, int
                 *eq = 0;
                 key = p; value = eq + 1;
 
-                ctx->output = h_strdup_cprintf("%s%s=%s\n", ctx->output, indent, key, value);
+                report_printf(ctx, "%s%s=%s\n", indent, key, value);
                 if (key_wants_details(key) || params.force_all_details) {
                     gchar *mi_tag = key_mi_tag(key);
-                    gchar *mi_data = ctx->entry->morefunc(mi_tag); /*const*/
+                    gchar *mi_data = report_more_info(ctx, mi_tag);
 
                     if (mi_data)
                         report_table_shell_dump(ctx, mi_data, level + 1);
 
+                    g_free(mi_data);
                     g_free(mi_tag);
                 }
 
             } else
-                ctx->output = h_strdup_cprintf("%s%s\n", ctx->output, indent, p);
+                report_printf(ctx, "%s%s\n", indent, p);
             p = next_nl + 1;
         }
     }
@@ -400,16 +446,17 @@ void report_table(ReportContext * ctx, gchar * text)
 
                 if ( key_is_flagged(key) ) {
                     gchar *mi_tag = key_mi_tag(key);
-                    gchar *mi_data = NULL; /*const*/
+                    gchar *mi_data = NULL;
 
                     if (key_wants_details(key) || params.force_all_details)
-                        mi_data = ctx->entry->morefunc(mi_tag);
+                        mi_data = report_more_info(ctx, mi_tag);
 
                     if (mi_data)
                         report_details(ctx, key, value, mi_data, longest_key);
                     else
                         report_key_value(ctx, key, value, longest_key);
 
+                    g_free(mi_data);
                     g_free(mi_tag);
                 } else {
                     report_key_value(ctx, key, value, longest_key);
@@ -432,10 +479,8 @@ void report_table(ReportContext * ctx, gchar * text)
 
 static void report_html_header(ReportContext * ctx)
 {
-    g_free(ctx->output);
-
-    ctx->output = g_strdup_printf
-        ("<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.0 Final//EN\">\n"
+    report_printf
+        (ctx, "<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.0 Final//EN\">\n"
 	 "<html><head>\n" "<title>HardInfo (%s) System Report</title>\n"
 	 "<meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\">\n"
 	 "<style>\n"
@@ -472,28 +517,29 @@ static void report_html_header(ReportContext * ctx)
 
 static void report_html_footer(ReportContext * ctx)
 {
-    ctx->output = h_strconcat(ctx->output, "</table>", NULL);
-    ctx->output = h_strconcat(ctx->output, "<style>\n", NULL);
+    report_puts(ctx, "</table>");
+    report_puts(ctx, "<style>\n");
+    /* one rule per distinct icon, encoded one at a time */
     GList *l = NULL, *keys = g_hash_table_get_keys(ctx->icon_data);
     for(l = keys; l; l = l->next) {
-        gchar *data = g_hash_table_lookup(ctx->icon_data, (gchar*)l->data);
-        if (data)
-            ctx->output = h_strconcat(ctx->output, data, NULL);
+        gchar *data = make_icon_css((gchar*)l->data);
+        report_puts(ctx, data);
+        g_free(data);
     }
     g_list_free(keys);
-    ctx->output = h_strconcat(ctx->output, "</style>\n", NULL);
-    ctx->output = h_strconcat(ctx->output, "</html>", NULL);
+    report_puts(ctx, "</style>\n");
+    report_puts(ctx, "</html>");
 }
 
 static void report_html_title(ReportContext * ctx, gchar * text)
 {
     if (!ctx->first_table) {
-        ctx->output = h_strdup_cprintf("</table>", ctx->output);
+        report_printf(ctx, "</table>");
     } else {
         ctx->first_table = FALSE;
     }
 
-    ctx->output = h_strdup_cprintf("<h1 class=\"title\">%s</h1>", ctx->output, text);
+    report_printf(ctx, "<h1 class=\"title\">%s</h1>", text);
 }
 
 static void report_html_subtitle(ReportContext * ctx, gchar * text)
@@ -501,7 +547,7 @@ static void report_html_subtitle(ReportContext * ctx, gchar * text)
     columns = strstr(text,"GPUs")?2:strstr(text,"Memory Device List")?4:(strstr(text,"Processor")?4:report_get_visible_columns(ctx));
 
     if (!ctx->first_sub_table) {
-      ctx->output = h_strdup_cprintf("</table>", ctx->output);
+      report_printf(ctx, "</table>");
     } else {
       ctx->first_sub_table = FALSE;
     }
@@ -515,8 +561,7 @@ static void report_html_subtitle(ReportContext * ctx, gchar * text)
         icon = g_strdup("");
     }
 
-    ctx->output = h_strdup_cprintf("<table><tr><td class=\"icon_subtitle\">%s</td><td colspan=\"%d\" class=\"stitle\">%s</td></tr>\n",
-				   ctx->output,
+    report_printf(ctx, "<table><tr><td class=\"icon_subtitle\">%s</td><td colspan=\"%d\" class=\"stitle\">%s</td></tr>\n",
 				   icon,
 				   columns,
 				   text);
@@ -525,16 +570,14 @@ static void report_html_subtitle(ReportContext * ctx, gchar * text)
 
 static void report_html_subsubtitle(ReportContext * ctx, gchar * text)
 {
-    ctx->output = h_strdup_cprintf("<tr><td colspan=\"%d\" class=\"sstitle\">%s</td></tr>\n",
-				  ctx->output,
+    report_printf(ctx, "<tr><td colspan=\"%d\" class=\"sstitle\">%s</td></tr>\n",
 				  columns+1,
 				  text);
 }
 
 static void report_html_details_subsubtitle(ReportContext * ctx, gchar * text)
 {
-    ctx->output = h_strdup_cprintf("<tr><td colspan=\"%d\" class=\"sstitle\">%s</td></tr>\n",
-				  ctx->output,
+    report_printf(ctx, "<tr><td colspan=\"%d\" class=\"sstitle\">%s</td></tr>\n",
 				  cols+1,
 				  text);
 }
@@ -559,9 +602,8 @@ static void report_html_key_value(ReportContext * ctx, gchar *key, gchar *value,
     gchar *name = (gchar*)key_get_name(key);
 
     if (columns == 2) {
-      ctx->output = h_strdup_cprintf("<tr><td class=\"icon\">%s</td><td class=\"%s\">%s</td>"
+      report_printf(ctx, "<tr><td class=\"icon\">%s</td><td class=\"%s\">%s</td>"
 				     "<td class=\"%s\">%s</td></tr>\n",
-				     ctx->output,
 				     icon,
 				     highlight ? "hilight" : "field",
 				     name,
@@ -571,15 +613,14 @@ static void report_html_key_value(ReportContext * ctx, gchar *key, gchar *value,
       values = g_strsplit(value, "|", columns);
       mc = g_strv_length(values) - 1;
 
-      ctx->output = h_strdup_cprintf("\n<tr>\n<td class=\"icon\">%s</td><td class=\"%s\">%s</td>", ctx->output, icon, highlight ? "hilight" : "field", name);
+      report_printf(ctx, "\n<tr>\n<td class=\"icon\">%s</td><td class=\"%s\">%s</td>", icon, highlight ? "hilight" : "field", name);
 
       for (i = columns-2; i >= 0; i--) {
-        ctx->output = h_strdup_cprintf("<td class=\"value\">%s</td>",
-                                       ctx->output,
+        report_printf(ctx, "<td class=\"value\">%s</td>",
                                        (i<=mc)?values[i]:"");
       }
 
-      ctx->output = h_strdup_cprintf("</tr>\n", ctx->output);
+      report_printf(ctx, "</tr>\n");
 
       g_strfreev(values);
     }
@@ -606,24 +647,22 @@ static void report_html_details_key_value(ReportContext * ctx, gchar *key, gchar
     gchar *name = (gchar*)key_get_name(key);
 
     if (columns == 2) {
-      ctx->output = h_strdup_cprintf("<tr%s><td class=\"icon\">%s</td><td class=\"field\">%s</td>"
+      report_printf(ctx, "<tr%s><td class=\"icon\">%s</td><td class=\"field\">%s</td>"
                                     "<td class=\"value\">%s</td></tr>\n",
-                                    ctx->output,
                                     highlight ? " class=\"hilight\"" : "",
                                     icon, name, value);
     } else {
       values = g_strsplit(value, "|", cols);
       mc = g_strv_length(values) - 1;
 
-      ctx->output = h_strdup_cprintf("\n<tr%s>\n<td class=\"icon\">%s</td><td class=\"field\">%s</td>", ctx->output, highlight ? " class=\"hilight\"" : "", icon, name);
+      report_printf(ctx, "\n<tr%s>\n<td class=\"icon\">%s</td><td class=\"field\">%s</td>", highlight ? " class=\"hilight\"" : "", icon, name);
 
       for (i = cols-2; i >= 0; i--) {
-        ctx->output = h_strdup_cprintf("<td class=\"value\">%s</td>",
-                                       ctx->output,
+        report_printf(ctx, "<td class=\"value\">%s</td>",
                                        (i<=mc)?values[i]:"");
       }
 
-      ctx->output = h_strdup_cprintf("</tr>\n", ctx->output);
+      report_printf(ctx, "</tr>\n");
 
       g_strfreev(values);
     }
@@ -632,9 +671,6 @@ static void report_html_details_key_value(ReportContext * ctx, gchar *key, gchar
 
 static void report_text_header(ReportContext * ctx)
 {
-    g_free(ctx->output);
-
-    ctx->output = g_strdup("");
 }
 
 static void report_text_footer(ReportContext * ctx)
@@ -643,28 +679,18 @@ static void report_text_footer(ReportContext * ctx)
 
 static void report_text_title(ReportContext * ctx, gchar * text)
 {
-    gchar *str = (gchar *) ctx->output;
-    int i = strlen(text);
-
-    str = h_strdup_cprintf("\n%s\n", str, text);
-    for (; i; i--)
-	str = h_strconcat(str, "*", NULL);
+    gchar *line = g_strnfill(strlen(text), '*');
 
-    str = h_strconcat(str, "\n\n", NULL);
-    ctx->output = str;
+    report_printf(ctx, "\n%s\n%s\n\n", text, line);
+    g_free(line);
 }
 
 static void report_text_subtitle(ReportContext * ctx, gchar * text)
 {
-    gchar *str = ctx->output;
-    int i = strlen(text);
+    gchar *line = g_strnfill(strlen(text), '-');
 
-    str = h_strdup_cprintf("\n%s\n", str, text);
-    for (; i; i--)
-	str = h_strconcat(str, "-", NULL);
-
-    str = h_strconcat(str, "\n\n", NULL);
-    ctx->output = str;
+    report_printf(ctx, "\n%s\n%s\n\n", text, line);
+    g_free(line);
 }
 
 static void report_text_subsubtitle(ReportContext * ctx, gchar * text)
@@ -672,7 +698,7 @@ static void report_text_subsubtitle(ReportContext * ctx, gchar * text)
     gchar indent[10] = "   ";
     if (!ctx->in_details)
         indent[0] = 0;
-    ctx->output = h_strdup_cprintf("%s-%s-\n", ctx->output, indent, text);
+    report_printf(ctx, "%s-%s-\n", indent, text);
 }
 
 static void report_text_key_value(ReportContext * ctx, gchar *key, gchar *value, gsize longest_key)
@@ -704,29 +730,28 @@ static void report_text_key_value(ReportContext * ctx, gchar *key, gchar *value,
               gchar **lines = g_strsplit(value, "\n", 0);
               for(i=0; lines[i]; i++) {
                   if (i == 0)
-                      ctx->output = h_strdup_cprintf("%s%s : %s\n", ctx->output, pf, rjname, lines[i]);
+                      report_printf(ctx, "%s%s : %s\n", pf, rjname, lines[i]);
                   else
-                      ctx->output = h_strdup_cprintf("%s%s   %s\n", ctx->output, pf, field_spacer, lines[i]);
+                      report_printf(ctx, "%s%s   %s\n", pf, field_spacer, lines[i]);
               }
               g_strfreev(lines);
           } else {
-              ctx->output = h_strdup_cprintf("%s%s : %s\n", ctx->output, pf, rjname, value);
+              report_printf(ctx, "%s%s : %s\n", pf, rjname, value);
           }
       } else
-          ctx->output = h_strdup_cprintf("%s%s\n", ctx->output, pf, rjname);
+          report_printf(ctx, "%s%s\n", pf, rjname);
     } else {
       values = g_strsplit(value, "|", columns);
       mc = g_strv_length(values) - 1;
 
-      ctx->output = h_strdup_cprintf("%s%s", ctx->output, pf, rjname);
+      report_printf(ctx, "%s%s", pf, rjname);
 
       for (i = mc; i >= 0; i--) {
-        ctx->output = h_strdup_cprintf("\t%s",
-                                       ctx->output,
+        report_printf(ctx, "\t%s",
                                        values[i]);
       }
 
-      ctx->output = h_strdup_cprintf("\n", ctx->output);
+      report_printf(ctx, "\n");
 
       g_strfreev(values);
     }
@@ -783,6 +808,49 @@ static GSList *report_create_module_list_from_dialog(ReportDialog * rd)
     return modules;
 }
 
+/* scans an entry the way reports want it and returns its page; on an
+ * inventory hit the page and its details come from the cache instead */
+static gchar *report_entry_data(ReportContext *ctx, ShellModule *module,
+                                ShellModuleEntry *entry)
+{
+    gchar *token, *data;
+
+    //Rescan Boots - filter for reports
+    if (strstr(entry->icon_file,"boot")) {
+        module_entry_reload(entry);
+        return module_entry_function(entry);
+    }
+    //Filter benchmarkresults for reports
+    if (!params.force_all_details && (entry->flags & MODULE_FLAG_BENCHMARK)) {
+        int i=params.max_bench_results;
+        params.max_bench_results=25;
+        module_entry_scan(entry);
+        data = module_entry_function(entry);
+        params.max_bench_results=i;
+        return data;
+    }
+
+    ctx->inventory_id = inventory_entry_id(module, entry);
+    token = ctx->inventory_id ? inventory_entry_token(entry) : NULL;
+    data = inventory_get(ctx->inventory_id, token);
+    ctx->inventory_hit = data != NULL;
+    if (!data) {
+        module_entry_scan(entry);
+        data = module_entry_function(entry);
+        inventory_put(ctx->inventory_id, token, data);
+    }
+    g_free(token);
+
+    return data;
+}
+
+static void report_entry_done(ReportContext *ctx)
+{
+    g_free(ctx->inventory_id);
+    ctx->inventory_id = NULL;
+    ctx->inventory_hit = FALSE;
+}
+
 static void
 report_create_inner_from_module_list(ReportContext * ctx, GSList * modules)
 {
@@ -800,6 +868,7 @@ report_create_inner_from_module_list(ReportContext * ctx, GSList * modules)
 
 	for (entries = module->entries; entries; entries = entries->next) {
 	    ShellModuleEntry *entry = (ShellModuleEntry *) entries->data;
+	    gchar *data;
             if (entry->flags & MODULE_FLAG_HIDE) continue;
 
 	    if (!params.gui_running && !params.quiet)
@@ -811,21 +880,10 @@ report_create_inner_from_module_list(ReportContext * ctx, GSList * modules)
 
 	    ctx->entry = entry;
 	    report_subtitle(ctx, entry->name);
-	    //Rescan Boots - filter for reports
-            if (strstr(entry->icon_file,"boot")) {
-		entry->scan_func(TRUE);
-	        report_table(ctx, module_entry_function(entry));
-	    //Filter benchmarkresults for reports
-	    } else if (!params.force_all_details && (entry->flags & MODULE_FLAG_BENCHMARK)) {
-	        int i=params.max_bench_results;
-	        params.max_bench_results=25;
-		entry->scan_func(FALSE);
-	        report_table(ctx, module_entry_function(entry));
-		params.max_bench_results=i;
-	    } else {
-	        module_entry_scan(entry);
-	        report_table(ctx, module_entry_function(entry));
-	    }
+	    data = report_entry_data(ctx, module, entry);
+	    report_table(ctx, data);
+	    g_free(data);
+	    report_entry_done(ctx);
 	}
     }
 
@@ -899,7 +957,7 @@ ReportContext *report_context_html_new()
     ctx->details_keyvalue = report_html_details_key_value;
     ctx->details_end = report_html_details_end;
 
-    ctx->output = g_strdup("");
+    ctx->output = g_string_new(NULL);
     ctx->format = REPORT_FORMAT_HTML;
 
     ctx->column_titles = g_hash_table_new_full(g_str_hash, g_str_equal,
@@ -907,7 +965,7 @@ ReportContext *report_context_html_new()
     ctx->first_sub_table = TRUE;
     ctx->first_table = TRUE;
 
-    ctx->icon_data = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    ctx->icon_data = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
     return ctx;
 }
@@ -929,7 +987,7 @@ ReportContext *report_context_text_new()
     ctx->details_keyvalue = report_text_key_value;
     ctx->details_end = report_text_footer; /* nothing */
 
-    ctx->output = g_strdup("");
+    ctx->output = g_string_new(NULL);
     ctx->format = REPORT_FORMAT_TEXT;
 
     ctx->column_titles = g_hash_table_new_full(g_str_hash, g_str_equal,
@@ -953,7 +1011,7 @@ ReportContext *report_context_shell_new()
     /* special format handled in report_table(),
      * doesn't need the others. */
 
-    ctx->output = g_strdup("");
+    ctx->output = g_string_new(NULL);
     ctx->format = REPORT_FORMAT_SHELL;
 
     ctx->column_titles = g_hash_table_new_full(g_str_hash, g_str_equal,
@@ -971,7 +1029,8 @@ void report_context_free(ReportContext * ctx)
         g_hash_table_destroy(ctx->icon_refs);
     if(ctx->icon_data)
         g_hash_table_destroy(ctx->icon_data);
-    g_free(ctx->output);
+    if (ctx->output)
+        g_string_free(ctx->output, TRUE);
     g_free(ctx);
 }
 
@@ -995,7 +1054,8 @@ gchar *report_create_from_module_list_format(GSList * modules,
     ReportContext *ctx;
     gchar *retval;
 
-    if (format >= N_REPORT_FORMAT)
+    /* structured formats have no ReportContext */
+    if (format >= G_N_ELEMENTS(file_types) - 1)
 	return NULL;
 
     create_context = file_types[format].data;
@@ -1005,13 +1065,498 @@ gchar *report_create_from_module_list_format(GSList * modules,
     ctx = create_context();
 
     report_create_from_module_list(ctx, modules);
-    retval = g_strdup(ctx->output);
+    retval = g_string_free(ctx->output, FALSE);
+    ctx->output = NULL;
 
     report_context_free(ctx);
 
     return retval;
 }
 
+gboolean report_create_to_stream(FILE *out, GSList * modules, ReportFormat format)
+{
+    ReportContext *(*create_context) ();
+    ReportContext *ctx;
+
+    if (format == REPORT_FORMAT_JSON || format == REPORT_FORMAT_CBOR) {
+        report_create_structured(out, modules, format, NULL);
+        return TRUE;
+    }
+    if (format >= G_N_ELEMENTS(file_types) - 1)
+	return FALSE;
+
+    create_context = file_types[format].data;
+    if (!create_context)
+	return FALSE;
+
+    ctx = create_context();
+    ctx->stream = out;
+
+    report_create_from_module_list(ctx, modules);
+    fflush(out);
+
+    report_context_free(ctx);
+
+    return TRUE;
+}
+
+/*
+ * Structured (JSON/CBOR) reports
+ *
+ * {"version": ..., "modules": {"<module>": {"name": ..., "entries":
+ *     {"<entry>": [{"group": ..., "label": ..., "value": ..., <details>}]}}}}
+ *
+ * Module keys are the module file name, entry and detail keys the label in
+ * lowercase with other characters turned into '_'. Each key of a page is
+ * one record; the details of flagged keys (PCI vendor, etc.) are merged
+ * into the record.
+ */
+
+typedef struct {
+    gboolean map, first;
+} StructLevel;
+
+typedef struct {
+    FILE *out;
+    gboolean cbor;
+    GArray *levels;
+} StructWriter;
+
+/* one "module.entry[index].key" path, NULL or -1 matching anything */
+typedef struct {
+    gchar *module, *entry, *key;
+    gint index;
+} StructSelector;
+
+static void cbor_head(FILE *out, guint8 major, guint64 n)
+{
+    gint bytes, i;
+
+    major <<= 5;
+    if (n < 24) {
+        fputc(major | n, out);
+        return;
+    }
+    if (n <= 0xff) {
+        fputc(major | 24, out); bytes = 1;
+    } else if (n <= 0xffff) {
+        fputc(major | 25, out); bytes = 2;
+    } else if (n <= 0xffffffff) {
+        fputc(major | 26, out); bytes = 4;
+    } else {
+        fputc(major | 27, out); bytes = 8;
+    }
+    for (i = bytes - 1; i >= 0; i--)
+        fputc((n >> (i * 8)) & 0xff, out);
+}
+
+/* comma before the next array element or map key */
+static void sw_item(StructWriter *w, gboolean key)
+{
+    StructLevel *level;
+
+    if (!w->levels->len)
+        return;
+
+    level = &g_array_index(w->levels, StructLevel, w->levels->len - 1);
+    if (level->map && !key)
+        return;
+    if (!w->cbor && !level->first)
+        fputc(',', w->out);
+    level->first = FALSE;
+}
+
+static void sw_begin(StructWriter *w, gboolean map)
+{
+    StructLevel level = { map, TRUE };
+
+    sw_item(w, FALSE);
+    if (w->cbor)
+        fputc(map ? 0xbf : 0x9f, w->out);       /* indefinite length */
+    else
+        fputc(map ? '{' : '[', w->out);
+    g_array_append_val(w->levels, level);
+}
+
+static void sw_end(StructWriter *w)
+{
+    StructLevel *level = &g_array_index(w->levels, StructLevel, w->levels->len - 1);
+
+    if (w->cbor)
+        fputc(0xff, w->out);
+    else
+        fputc(level->map ? '}' : ']', w->out);
+    g_array_set_size(w->levels, w->levels->len - 1);
+}
+
+static void sw_text(StructWriter *w, const gchar *text)
+{
+    const guchar *p;
+
+    if (w->cbor) {
+        gsize len = strlen(text);
+
+        cbor_head(w->out, 3, len);
+        fwrite(text, 1, len, w->out);
+        return;
+    }
+
+    fputc('"', w->out);
+    for (p = (const guchar *)text; *p; p++) {
+        switch (*p) {
+        case '"':  fputs("\\\"", w->out); break;
+        case '\\': fputs("\\\\", w->out); break;
+        case '\n': fputs("\\n", w->out); break;
+        case '\t': fputs("\\t", w->out); break;
+        default:
+            if (*p < 0x20)
+                fprintf(w->out, "\\u%04x", *p);
+            else
+                fputc(*p, w->out);
+        }
+    }
+    fputc('"', w->out);
+}
+
+static void sw_key(StructWriter *w, const gchar *key)
+{
+    sw_item(w, TRUE);
+    sw_text(w, key);
+    if (!w->cbor)
+        fputc(':', w->out);
+}
+
+static void sw_string(StructWriter *w, const gchar *value)
+{
+    sw_item(w, FALSE);
+    sw_text(w, value ? value : "");
+}
+
+static gchar *struct_key_name(const gchar *label)
+{
+    gchar *key = g_utf8_strdown(label, -1);
+    gchar *p, *q;
+
+    for (p = q = key; *p; p++) {
+        if (g_ascii_isalnum(*p) || (guchar)*p >= 0x80)
+            *q++ = *p;
+        else if (q > key && q[-1] != '_')
+            *q++ = '_';
+    }
+    while (q > key && q[-1] == '_')
+        q--;
+    *q = '\0';
+
+    return key;
+}
+
+static GSList *struct_selectors_new(const gchar *select)
+{
+    GSList *selectors = NULL;
+    gchar **paths;
+    gint i;
+
+    if (!select || !*select)
+        return NULL;
+
+    paths = g_strsplit(select, ",", -1);
+    for (i = 0; paths[i]; i++) {
+        gchar **parts = g_strsplit(g_strstrip(paths[i]), ".", 3);
+        StructSelector *sel = g_new0(StructSelector, 1);
+        gchar *bracket;
+
+        sel->index = -1;
+        if (parts[0] && *parts[0] && !g_str_equal(parts[0], "*"))
+            sel->module = g_strdup(parts[0]);
+        if (parts[0] && parts[1]) {
+            if ((bracket = strchr(parts[1], '['))) {
+                *bracket++ = '\0';
+                if (*bracket != '*')
+                    sel->index = atoi(bracket);
+            }
+            if (*parts[1] && !g_str_equal(parts[1], "*"))
+                sel->entry = g_strdup(parts[1]);
+            if (parts[2] && *parts[2] && !g_str_equal(parts[2], "*"))
+                sel->key = g_strdup(parts[2]);
+        }
+        selectors = g_slist_append(selectors, sel);
+        g_strfreev(parts);
+    }
+    g_strfreev(paths);
+
+    return selectors;
+}
+
+static void struct_selector_free(StructSelector *sel)
+{
+    g_free(sel->module);
+    g_free(sel->entry);
+    g_free(sel->key);
+    g_free(sel);
+}
+
+/* any NULL argument is not checked; no selectors selects everything */
+static gboolean struct_selected(GSList *selectors, const gchar *module,
+                                const gchar *entry, gint index, const gchar *key)
+{
+    GSList *l;
+
+    if (!selectors)
+        return TRUE;
+
+    for (l = selectors; l; l = l->next) {
+        StructSelector *sel = l->data;
+
+        if (module && sel->module && !g_str_equal(module, sel->module))
+            continue;
+        if (entry && sel->entry && !g_str_equal(entry, sel->entry))
+            continue;
+        if (index >= 0 && sel->index >= 0 && index != sel->index)
+            continue;
+        if (key && sel->key && !g_str_equal(key, sel->key))
+            continue;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* some selector matching the record asks for more than group/label/value */
+static gboolean struct_wants_details(GSList *selectors, const gchar *module,
+                                     const gchar *entry, gint index)
+{
+    GSList *l;
+
+    if (!selectors)
+        return TRUE;
+
+    for (l = selectors; l; l = l->next) {
+        StructSelector *sel = l->data;
+
+        if ((sel->module && !g_str_equal(module, sel->module))
+            || (sel->entry && !g_str_equal(entry, sel->entry))
+            || (sel->index >= 0 && index != sel->index))
+            continue;
+        if (!sel->key || (!g_str_equal(sel->key, "group")
+                          && !g_str_equal(sel->key, "label")
+                          && !g_str_equal(sel->key, "value")))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static void struct_field(StructWriter *w, GHashTable *seen, GSList *selectors,
+                         const gchar *module, const gchar *entry, gint index,
+                         const gchar *key, const gchar *value)
+{
+    if (g_hash_table_lookup(seen, key)
+        || !struct_selected(selectors, module, entry, index, key))
+        return;
+
+    g_hash_table_insert(seen, g_strdup(key), GINT_TO_POINTER(1));
+    sw_key(w, key);
+    sw_string(w, value);
+}
+
+static void struct_details(StructWriter *w, GHashTable *seen, GSList *selectors,
+                           const gchar *module, const gchar *entry, gint index,
+                           gchar *details)
+{
+    GKeyFile *key_file = g_key_file_new();
+    gchar **groups, **keys;
+    gint i, j;
+
+    g_key_file_load_from_data(key_file, details, strlen(details), 0, NULL);
+    groups = g_key_file_get_groups(key_file, NULL);
+    for (i = 0; groups[i]; i++) {
+        if (groups[i][0] == '$')
+            continue;
+
+        keys = g_key_file_get_keys(key_file, groups[i], NULL, NULL);
+        for (j = 0; keys[j]; j++) {
+            gchar *value = g_key_file_get_string(key_file, groups[i], keys[j], NULL);
+            gchar *label = NULL, *key;
+
+            key_get_components(keys[j], NULL, NULL, NULL, &label, NULL);
+            if (value && label && g_utf8_validate(value, -1, NULL)) {
+                key = struct_key_name(label);
+                if (*key)
+                    struct_field(w, seen, selectors, module, entry, index, key, value);
+                g_free(key);
+            }
+            g_free(label);
+            g_free(value);
+        }
+        g_strfreev(keys);
+    }
+    g_strfreev(groups);
+    g_key_file_free(key_file);
+}
+
+static void struct_entry(StructWriter *w, ReportContext *ctx, GSList *selectors,
+                         const gchar *module, const gchar *entry, gchar *text)
+{
+    GKeyFile *key_file = g_key_file_new();
+    gchar **groups, **keys;
+    gint i, j, index = 0;
+
+    if (text)
+        g_key_file_load_from_data(key_file, text, strlen(text), 0, NULL);
+
+    sw_begin(w, FALSE);
+    groups = g_key_file_get_groups(key_file, NULL);
+    for (i = 0; groups[i]; i++) {
+        gchar *group;
+
+        if (groups[i][0] == '$')
+            continue;
+        group = g_strdup(groups[i]);
+        strend(group, '#');
+
+        keys = g_key_file_get_keys(key_file, groups[i], NULL, NULL);
+        for (j = 0; keys[j]; j++, index++) {
+            GHashTable *seen;
+            gchar *value, *label = NULL;
+
+            if (!struct_selected(selectors, module, entry, index, NULL))
+                continue;
+
+            value = g_key_file_get_string(key_file, groups[i], keys[j], NULL);
+            if (!value || !g_utf8_validate(keys[j], -1, NULL)
+                || !g_utf8_validate(value, -1, NULL)) {
+                g_free(value);
+                continue;
+            }
+            strend(keys[j], '#');
+            if (g_str_equal(value, "...") && ctx->entry->fieldfunc) {
+                gchar *live = ctx->entry->fieldfunc(keys[j]);
+
+                if (live) {
+                    g_free(value);
+                    value = live;
+                }
+            }
+            key_get_components(keys[j], NULL, NULL, NULL, &label, NULL);
+
+            seen = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+            sw_begin(w, TRUE);
+            struct_field(w, seen, selectors, module, entry, index, "group", group);
+            struct_field(w, seen, selectors, module, entry, index, "label", label);
+            struct_field(w, seen, selectors, module, entry, index, "value", value);
+            if (key_is_flagged(keys[j])
+                && struct_wants_details(selectors, module, entry, index)) {
+                gchar *mi_tag = key_mi_tag(keys[j]);
+                gchar *mi_data = report_more_info(ctx, mi_tag);
+
+                if (mi_data)
+                    struct_details(w, seen, selectors, module, entry, index, mi_data);
+                g_free(mi_data);
+                g_free(mi_tag);
+            }
+            sw_end(w);
+            g_hash_table_destroy(seen);
+
+            g_free(label);
+            g_free(value);
+        }
+        g_strfreev(keys);
+        g_free(group);
+    }
+    sw_end(w);
+
+    g_strfreev(groups);
+    g_key_file_free(key_file);
+}
+
+void report_create_structured(FILE *out, GSList *modules, ReportFormat format,
+                              const gchar *select)
+{
+    StructWriter w = { out, format == REPORT_FORMAT_CBOR, NULL };
+    ReportContext *ctx = g_new0(ReportContext, 1);
+    GSList *selectors = struct_selectors_new(select);
+    gchar *messages = g_strdup(setlocale(LC_MESSAGES, NULL));
+    int t = params.create_report;
+
+    /* field keys are made from the page labels, so pages are produced
+     * untranslated: keys, and values with them, are English in any locale */
+    setlocale(LC_MESSAGES, "C");
+    params.create_report = 1;
+    w.levels = g_array_new(FALSE, FALSE, sizeof(StructLevel));
+
+    if (w.cbor)
+        cbor_head(out, 6, 55799);       /* self-describe tag, d9 d9 f7 */
+
+    sw_begin(&w, TRUE);
+    sw_key(&w, "version");
+    sw_string(&w, VERSION);
+    sw_key(&w, "modules");
+    sw_begin(&w, TRUE);
+
+    for (; modules; modules = modules->next) {
+        ShellModule *module = (ShellModule *) modules->data;
+        gchar *module_key = g_path_get_basename(g_module_name(module->dll));
+        GSList *entries;
+
+        strend(module_key, '.');
+        if (!struct_selected(selectors, module_key, NULL, -1, NULL)) {
+            g_free(module_key);
+            continue;
+        }
+
+        sw_key(&w, module_key);
+        sw_begin(&w, TRUE);
+        sw_key(&w, "name");
+        sw_string(&w, module->name);
+        sw_key(&w, "entries");
+        sw_begin(&w, TRUE);
+
+        for (entries = module->entries; entries; entries = entries->next) {
+            ShellModuleEntry *entry = (ShellModuleEntry *) entries->data;
+            gchar *entry_key, *data;
+
+            if (entry->flags & MODULE_FLAG_HIDE)
+                continue;
+
+            /* unselected entries aren't even scanned */
+            /* keys must not change with the locale */
+            entry_key = struct_key_name(entry->msgid ? entry->msgid : entry->name);
+            if (!struct_selected(selectors, module_key, entry_key, -1, NULL)) {
+                g_free(entry_key);
+                continue;
+            }
+
+            if (!params.quiet)
+                fprintf(stderr, "\033[2K\033[40;32;1m %s\033[0m\n", entry->name);
+
+            ctx->entry = entry;
+            data = report_entry_data(ctx, module, entry);
+            sw_key(&w, entry_key);
+            struct_entry(&w, ctx, selectors, module_key, entry_key, data);
+            g_free(data);
+            report_entry_done(ctx);
+            g_free(entry_key);
+        }
+
+        sw_end(&w);
+        sw_end(&w);
+        g_free(module_key);
+    }
+
+    sw_end(&w);
+    sw_end(&w);
+    if (!w.cbor)
+        fputc('\n', out);
+    fflush(out);
+
+    params.create_report = t;
+    setlocale(LC_MESSAGES, messages);
+    g_free(messages);
+    g_slist_free_full(selectors, (GDestroyNotify)struct_selector_free);
+    g_array_free(w.levels, TRUE);
+    g_free(ctx);
+}
+
 static gboolean report_generate(ReportDialog * rd)
 {
     GSList *modules;
@@ -1042,10 +1587,10 @@ static gboolean report_generate(ReportDialog * rd)
     }
 
     ctx = create_context();
+    ctx->stream = stream;
     modules = report_create_module_list_from_dialog(rd);
 
     report_create_from_module_list(ctx, modules);
-    fputs(ctx->output, stream);
     fclose(stream);
 
     if (ctx->format == REPORT_FORMAT_HTML) {
@@ -36,6 +36,7 @@
 #include "menu.h"
 #include "stock.h"
 #include "uri_handler.h"
+#include "timeseries.h"
 
 #include "callbacks.h"
 
@@ -66,6 +67,8 @@ static void info_selected_show_extra(const gchar *tag);
 static gboolean reload_section(gpointer data);
 static gboolean rescan_section(gpointer data);
 static gboolean update_field(gpointer data);
+static gboolean module_selected_update_info(ShellModuleEntry *entry);
+static void info_refresh_extra(void);
 static GSettings *settings=NULL;
 /*
  * Globals ********************************************************************
@@ -75,6 +78,22 @@ static Shell *shell = NULL;
 static GHashTable *update_tbl = NULL;
 static GSList *update_sfusrc = NULL;
 
+/* samples of every UpdateInterval field since the page was opened */
+static TimeSeriesStore *lg_history = NULL;
+/* fields overlaid on the load graph; line 0 always follows the selection */
+static gchar *lg_pinned[LG_MAX_LINES];
+
+/* rows on screen keyed by "group\nkey", and the data they were built from;
+ * used by reload_section() to only touch rows whose values changed */
+static GHashTable *info_rows = NULL;
+static gchar *info_rows_data = NULL;
+static gchar *shown_extra_data = NULL;
+/* the ReloadInterval timeout of the page on screen; older ones drop out */
+static guint reload_source = 0;
+/* scroll positions to put back once a rebuilt page has been laid out */
+static guint restore_source = 0;
+static double restore_info_scroll, restore_detail_scroll;
+
 gchar *lginterval = NULL;
 
 /*
@@ -931,11 +950,14 @@ void shell_init(GSList * modules)
     shell->tree = tree_new();
     shell->info_tree = info_tree_new();
     shell->loadgraph = load_graph_new(75);
+    lg_history = time_series_store_new(TIME_SERIES_DEFAULT_SIZE);
     shell->detail_view = detail_view_new();
     shell_set_transient_dialog(NULL);
 
     update_tbl = g_hash_table_new_full(g_str_hash, g_str_equal,
                                        g_free, destroy_update_tbl_value);
+    info_rows = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                      g_free, destroy_update_tbl_value);
 
     gtk_box_pack_start(GTK_BOX(shell->hbox), shell->tree->scroll,
                        FALSE, FALSE, 0);
@@ -968,6 +990,89 @@ void shell_init(GSList * modules)
     g_idle_add(select_first_tree_item, NULL);
 }
 
+static const gchar *load_graph_selected_field(void)
+{
+    GSList *l;
+
+    for (l = update_sfusrc; l; l = l->next) {
+        ShellFieldUpdateSource *src = (ShellFieldUpdateSource *)l->data;
+        struct UpdateTableItem *item = g_hash_table_lookup(update_tbl, src->sfu->field_name);
+
+        if (item && item->is_iter &&
+            gtk_tree_selection_iter_is_selected(shell->info_tree->selection, item->iter))
+            return src->sfu->field_name;
+    }
+
+    return NULL;
+}
+
+static void load_graph_show_line(guint line, const gchar *field)
+{
+    gdouble values[TIME_SERIES_DEFAULT_SIZE];
+    guint n;
+
+    n = time_series_copy(time_series_store_lookup(lg_history, field),
+                         values, G_N_ELEMENTS(values));
+    load_graph_set_history(shell->loadgraph, line, values, n);
+}
+
+static void load_graph_show_history(void)
+{
+    const gchar *field = load_graph_selected_field();
+    guint i;
+
+    load_graph_clear(shell->loadgraph);
+    if (field) {
+        load_graph_set_title(shell->loadgraph, field);
+        load_graph_show_line(0, field);
+    }
+    for (i = 1; i < LG_MAX_LINES; i++) {
+        if (lg_pinned[i])
+            load_graph_show_line(i, lg_pinned[i]);
+    }
+}
+
+static void load_graph_unpin_all(void)
+{
+    guint i;
+
+    for (i = 0; i < LG_MAX_LINES; i++) {
+        g_free(lg_pinned[i]);
+        lg_pinned[i] = NULL;
+    }
+}
+
+/* activating a row pins its field to a free graph line, or unpins it again */
+static void info_tree_row_activated(GtkTreeView *tree_view, GtkTreePath *path,
+                                    GtkTreeViewColumn *column, gpointer data)
+{
+    const gchar *field;
+    guint i, free_line = 0;
+
+    if (shell->view_type != SHELL_VIEW_LOAD_GRAPH)
+        return;
+
+    field = load_graph_selected_field();
+    if (!field)
+        return;
+
+    for (i = 1; i < LG_MAX_LINES; i++) {
+        if (lg_pinned[i] && g_str_equal(lg_pinned[i], field)) {
+            g_free(lg_pinned[i]);
+            lg_pinned[i] = NULL;
+            load_graph_set_history(shell->loadgraph, i, NULL, 0);
+            return;
+        }
+        if (!lg_pinned[i] && !free_line)
+            free_line = i;
+    }
+
+    if (free_line) {
+        lg_pinned[free_line] = g_strdup(field);
+        load_graph_show_line(free_line, field);
+    }
+}
+
 static gboolean update_field(gpointer data)
 {
     ShellFieldUpdate *fu;
@@ -986,24 +1091,33 @@ static gboolean update_field(gpointer data)
     /* if the entry is still selected, update it */
     if (fu->entry->selected && fu->entry->fieldfunc) {
         gchar *value = fu->entry->fieldfunc(fu->field_name);
-	gdouble v;
+	gdouble v = 0;
+        guint i;
+
+        if (value) {
+            v=atof(value);
+	    //fix KiB->Bytes for UberGraph (GTK3)
+#if GTK_CHECK_VERSION(3, 0, 0)
+            if(strstr(value,"KiB")) v*=1024;
+#endif
+            time_series_store_append(lg_history, fu->field_name, v);
+        }
 
         if (item->is_iter) {
             /*
              * this function is also used to feed the load graph when ViewType
              * is SHELL_VIEW_LOAD_GRAPH
              */
-            if (shell->view_type == SHELL_VIEW_LOAD_GRAPH &&
-                gtk_tree_selection_iter_is_selected(shell->info_tree->selection,
-                                                    item->iter)) {
-
-                load_graph_set_title(shell->loadgraph, fu->field_name);
-                v=atof(value);
-		//fix KiB->Bytes for UberGraph (GTK3)
-#if GTK_CHECK_VERSION(3, 0, 0)
-                if(strstr(value,"KiB")) v*=1024;
-#endif
-                load_graph_update(shell->loadgraph, v);
+            if (shell->view_type == SHELL_VIEW_LOAD_GRAPH && value) {
+                if (gtk_tree_selection_iter_is_selected(shell->info_tree->selection,
+                                                        item->iter)) {
+                    load_graph_set_title(shell->loadgraph, fu->field_name);
+                    load_graph_update(shell->loadgraph, v);
+                }
+                for (i = 1; i < LG_MAX_LINES; i++) {
+                    if (lg_pinned[i] && g_str_equal(lg_pinned[i], fu->field_name))
+                        load_graph_update_ex(shell->loadgraph, i, v);
+                }
             }
 
             GtkTreeStore *store = GTK_TREE_STORE(shell->info_tree->model);
@@ -1067,23 +1181,54 @@ static void detail_view_clear(DetailView *detail_view)
                          destroy_widget, NULL);
 }
 
+/* runs after GTK has sized the rebuilt page, so the adjustments already
+ * span the new content and the old positions can be set again */
+static gboolean restore_scroll(gpointer data)
+{
+    ShellModuleEntry *entry = (ShellModuleEntry *)data;
+
+    if (entry->selected) {
+        if (restore_info_scroll)
+            RANGE_SET_VALUE(info_tree, vscrollbar, restore_info_scroll);
+        if (restore_detail_scroll)
+            RANGE_SET_VALUE(detail_view, vscrollbar, restore_detail_scroll);
+    }
+
+    /*UnFreeze widget updates*/
+    gdk_window_thaw_updates(gtk_widget_get_window(shell->window));
+    restore_source = 0;
+    return FALSE;
+}
+
 static gboolean reload_section(gpointer data)
 {
     ShellModuleEntry *entry = (ShellModuleEntry *)data;
+    GSource *source = g_main_current_source();
+
+    /* superseded by a newer timeout for this or another page */
+    if (!source || g_source_get_id(source) != reload_source)
+        return FALSE;
 
     /* if the entry is still selected, update it */
     if (entry->selected) {
         GtkTreePath *path = NULL;
         GtkTreeIter iter;
-        double pos_info_scroll;
-        double pos_detail_scroll;
 
-	/*Freeze window updates*/
-	gdk_window_freeze_updates(gtk_widget_get_window(shell->window));
+        module_entry_reload(entry);
+
+        /* same layout: values are updated in place, keeping selection
+         * and scroll position, and the timeout is kept */
+        if (module_selected_update_info(entry))
+            return TRUE;
+
+        /* save current position, unless a restore is still pending */
+        if (!restore_source) {
+            /*Freeze window updates*/
+            gdk_window_freeze_updates(gtk_widget_get_window(shell->window));
 
-        /* save current position */
-        pos_info_scroll = RANGE_GET_VALUE(info_tree, vscrollbar);
-        pos_detail_scroll = RANGE_GET_VALUE(detail_view, vscrollbar);
+            restore_info_scroll = RANGE_GET_VALUE(info_tree, vscrollbar);
+            restore_detail_scroll = RANGE_GET_VALUE(detail_view, vscrollbar);
+        }
 
         /* gets the current selected path */
         if (gtk_tree_selection_get_selected(shell->info_tree->selection,
@@ -1091,8 +1236,7 @@ static gboolean reload_section(gpointer data)
             path = gtk_tree_model_get_path(shell->info_tree->model, &iter);
         }
 
-        /* update the information, clear the treeview and populate it again */
-        module_entry_reload(entry);
+        /* layout changed, clear the treeview and populate it again */
         module_selected_show_info(entry, TRUE);
 
         /* if there was a selection, reselect it */
@@ -1103,21 +1247,15 @@ static gboolean reload_section(gpointer data)
             gtk_tree_path_free(path);
         }
 
-        /* restore position */
-        if(pos_info_scroll) {
-	    if(strcmp(shell->selected_module->name,_("Network"))==0) {
-	      int ii=5;while(ii-- && gtk_events_pending() && !gtk_main_iteration_do(FALSE)) {;}
-	    }
-	    RANGE_SET_VALUE(info_tree, vscrollbar, pos_info_scroll);
-	}
-        if(pos_detail_scroll) RANGE_SET_VALUE(detail_view, vscrollbar, pos_detail_scroll);
-
-	/*UnFreeze widget updates*/
-        gdk_window_thaw_updates(gtk_widget_get_window(shell->window));
+        /* restore position once the resize and redraw handlers ran */
+        if (!restore_source)
+            restore_source = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE,
+                                             restore_scroll, entry, NULL);
     }
 
-
     /* destroy the timeout: it'll be set up again */
+    if (reload_source == g_source_get_id(source))
+        reload_source = 0;
     return FALSE;
 }
 
@@ -1321,11 +1459,16 @@ static void group_handle_special(GKeyFile *key_file,
             load_graph_set_data_suffix(shell->loadgraph, suffix);
             g_free(suffix);
         } else if (g_str_equal(key, "ReloadInterval")) {
+            GSource *current = g_main_current_source();
             gint ms;
 
             ms = g_key_file_get_integer(key_file, group, key, NULL);
 
-            g_timeout_add(ms, reload_section, entry);
+            /* the running reload_section() drops its own source */
+            if (reload_source &&
+                (!current || g_source_get_id(current) != reload_source))
+                g_source_remove(reload_source);
+            reload_source = g_timeout_add(ms, reload_section, entry);
         } else if (g_str_equal(key, "RescanInterval")) {
             gint ms;
 
@@ -1413,6 +1556,21 @@ static void group_handle_special(GKeyFile *key_file,
                                       headers_visible);
 }
 
+static void info_rows_add(const gchar *group, const gchar *key,
+                          GtkTreeIter *iter, GtkWidget *widget)
+{
+    struct UpdateTableItem *row = g_new0(struct UpdateTableItem, 1);
+
+    if (iter) {
+        row->is_iter = TRUE;
+        row->iter = gtk_tree_iter_copy(iter);
+    } else {
+        row->widget = g_object_ref(widget);
+    }
+
+    g_hash_table_replace(info_rows, g_strconcat(group, "\n", key, NULL), row);
+}
+
 static void group_handle_normal(GKeyFile *key_file,
                                 ShellModuleEntry *entry,
                                 const gchar *group,
@@ -1474,6 +1632,8 @@ static void group_handle_normal(GKeyFile *key_file,
             gtk_tree_store_set(store, &child, INFO_TREE_COL_EXTRA2,
                                values[2], -1);
 
+        info_rows_add(group, key, &child, NULL);
+
         struct UpdateTableItem *item = g_new0(struct UpdateTableItem, 1);
         item->is_iter = TRUE;
         item->iter = gtk_tree_iter_copy(&child);
@@ -1807,6 +1967,9 @@ static void module_selected_show_info_detail(GKeyFile *key_file,
                     g_free(vendor_markup);
                 }
 
+                if (entry)
+                    info_rows_add(groups[i], keys[j], NULL, value_box);
+
                 struct UpdateTableItem *item = g_new0(struct UpdateTableItem, 1);
                 item->is_iter = FALSE;
                 item->widget = g_object_ref(value_box);
@@ -1847,12 +2010,19 @@ module_selected_show_info(ShellModuleEntry *entry, gboolean reload)
     if (!reload) {
         /* recreate the iter hash table */
         h_hash_table_remove_all(update_tbl);
+        /* a newly opened page starts its own history */
+        time_series_store_clear(lg_history);
+        load_graph_unpin_all();
     }
     shell_clear_field_updates();
 
     GKeyFile *key_file = g_key_file_new();
     gchar *key_data = module_entry_function(entry);
 
+    h_hash_table_remove_all(info_rows);
+    g_free(info_rows_data);
+    info_rows_data = g_strdup(key_data);
+
     g_key_file_load_from_data(key_file, key_data, strlen(key_data), 0, NULL);
     set_view_type(g_key_file_get_integer(key_file, "$ShellParam$",
                                          "ViewType", NULL), reload);
@@ -1913,7 +2083,189 @@ static void info_selected_show_extra(const gchar *tag)
 
     g_strfreev(groups);
     g_key_file_free(key_file);
+    g_free(shown_extra_data);
+    shown_extra_data = key_data;
+}
+
+/* re-show the selected row's moreinfo, but only if it changed */
+static void info_refresh_extra(void)
+{
+    GtkTreeModel *model = shell->info_tree->model;
+    GtkTreeIter iter;
+    gchar *datacol, *mi_tag, *key_data;
+
+    if (shell->view_type != SHELL_VIEW_DUAL || !shell->selected->morefunc)
+        return;
+    if (!gtk_tree_selection_get_selected(shell->info_tree->selection, &model, &iter))
+        return;
+
+    gtk_tree_model_get(model, &iter, INFO_TREE_COL_DATA, &datacol, -1);
+    mi_tag = key_mi_tag(datacol);
+    g_free(datacol);
+    if (!mi_tag)
+        return;
+
+    key_data = shell->selected->morefunc(mi_tag);
+    if (!shown_extra_data || !key_data || !g_str_equal(key_data, shown_extra_data))
+        info_selected_show_extra(mi_tag);
     g_free(key_data);
+    g_free(mi_tag);
+}
+
+static void info_row_update(GKeyFile *key_file, ShellModuleEntry *entry,
+                            const gchar *group, const gchar *key,
+                            struct UpdateTableItem *row)
+{
+    if (row->is_iter) {
+        GtkTreeStore *store = GTK_TREE_STORE(shell->info_tree->model);
+        gchar **values;
+        gsize vcount = 0;
+
+        values = g_key_file_get_string_list(key_file, group, key, &vcount, NULL);
+        if (!vcount) {
+            g_strfreev(values);
+            values = g_new0(gchar*, 2);
+            values[0] = g_key_file_get_string(key_file, group, key, NULL);
+            vcount = values[0] ? 1 : 0;
+        }
+
+        if (entry->fieldfunc && values[0] && g_str_equal(values[0], "...")) {
+            g_free(values[0]);
+            values[0] = entry->fieldfunc((gchar *)key);
+        }
+
+        gtk_tree_store_set(store, row->iter,
+                           INFO_TREE_COL_VALUE, vcount > 0 ? values[0] : NULL,
+                           INFO_TREE_COL_EXTRA1, vcount > 1 ? values[1] : NULL,
+                           INFO_TREE_COL_EXTRA2, vcount > 2 ? values[2] : NULL,
+                           -1);
+        g_strfreev(values);
+    } else {
+        gchar *value = g_key_file_get_string(key_file, group, key, NULL);
+
+        if (entry->fieldfunc && value && g_str_equal(value, "...")) {
+            g_free(value);
+            value = entry->fieldfunc((gchar *)key);
+        }
+
+        GList *children = gtk_container_get_children(GTK_CONTAINER(row->widget));
+        if (children && children->next && value)
+            gtk_label_set_markup(GTK_LABEL(children->next->data), value);
+        g_list_free(children);
+        g_free(value);
+    }
+}
+
+/*
+ * Compares a fresh snapshot of the entry against the one on screen by
+ * group/key and only touches the rows whose values changed.
+ * Returns FALSE if the layout changed and the page must be rebuilt.
+ */
+static gboolean module_selected_update_info(ShellModuleEntry *entry)
+{
+    GKeyFile *old_kf, *new_kf;
+    gchar **old_groups = NULL, **groups = NULL;
+    gchar *key_data;
+    gboolean ok = TRUE;
+    gint i, j;
+
+    if (!info_rows_data)
+        return FALSE;
+    /* progress views sort and renormalize the whole store */
+    if (shell->view_type != SHELL_VIEW_NORMAL &&
+        shell->view_type != SHELL_VIEW_DUAL &&
+        shell->view_type != SHELL_VIEW_DETAIL)
+        return FALSE;
+
+    key_data = module_entry_function(entry);
+    if (!key_data)
+        return FALSE;
+    if (g_str_equal(key_data, info_rows_data)) {
+        g_free(key_data);
+        return TRUE;
+    }
+
+    old_kf = g_key_file_new();
+    new_kf = g_key_file_new();
+    g_key_file_load_from_data(old_kf, info_rows_data, strlen(info_rows_data), 0, NULL);
+    g_key_file_load_from_data(new_kf, key_data, strlen(key_data), 0, NULL);
+    g_key_file_set_list_separator(new_kf, '|');
+
+    old_groups = g_key_file_get_groups(old_kf, NULL);
+    groups = g_key_file_get_groups(new_kf, NULL);
+    if (g_strv_length(old_groups) != g_strv_length(groups))
+        ok = FALSE;
+
+    for (i = 0; ok && groups[i]; i++) {
+        gchar **old_keys, **keys;
+
+        if (!g_str_equal(groups[i], old_groups[i])) {
+            ok = FALSE;
+            break;
+        }
+
+        old_keys = g_key_file_get_keys(old_kf, old_groups[i], NULL, NULL);
+        keys = g_key_file_get_keys(new_kf, groups[i], NULL, NULL);
+        if (g_strv_length(old_keys) != g_strv_length(keys))
+            ok = FALSE;
+
+        for (j = 0; ok && keys[j]; j++) {
+            gchar *old_value, *value, *row_key;
+            struct UpdateTableItem *row;
+
+            if (!g_str_equal(keys[j], old_keys[j])) {
+                ok = FALSE;
+                break;
+            }
+
+            old_value = g_key_file_get_value(old_kf, groups[i], keys[j], NULL);
+            value = g_key_file_get_value(new_kf, groups[i], keys[j], NULL);
+            if (g_strcmp0(old_value, value) == 0) {
+                g_free(old_value);
+                g_free(value);
+                continue;
+            }
+            g_free(old_value);
+            g_free(value);
+
+            /* shell parameters (timeouts, icons, columns) cannot be
+             * updated in place */
+            if (groups[i][0] == '$') {
+                ok = FALSE;
+                break;
+            }
+
+            row_key = g_strconcat(groups[i], "\n", keys[j], NULL);
+            row = g_hash_table_lookup(info_rows, row_key);
+            g_free(row_key);
+            /* the detail view adds an extra vendor row for these */
+            if (!row || (!row->is_iter && key_value_has_vendor_string(keys[j]))) {
+                ok = FALSE;
+                break;
+            }
+
+            info_row_update(new_kf, entry, groups[i], keys[j], row);
+        }
+
+        g_strfreev(old_keys);
+        g_strfreev(keys);
+    }
+
+    g_strfreev(old_groups);
+    g_strfreev(groups);
+    g_key_file_free(old_kf);
+    g_key_file_free(new_kf);
+
+    if (ok) {
+        g_free(info_rows_data);
+        info_rows_data = key_data;
+        shell_set_note_from_entry(entry);
+        info_refresh_extra();
+    } else {
+        g_free(key_data);
+    }
+
+    return ok;
 }
 
 static gchar *detail_view_clear_value(gchar *value)
@@ -2191,6 +2543,9 @@ static void info_selected(GtkTreeSelection * ts, gpointer data)
     if (!gtk_tree_selection_get_selected(ts, &model, &parent))
 	return;
 
+    if (shell->view_type == SHELL_VIEW_LOAD_GRAPH)
+        load_graph_show_history();
+
     if (shell->view_type == SHELL_VIEW_NORMAL ||
         shell->view_type == SHELL_VIEW_PROGRESS) {
         gtk_tree_selection_unselect_all(ts);
@@ -2293,6 +2648,8 @@ static ShellInfoTree *info_tree_new(void)
     sel = gtk_tree_view_get_selection(GTK_TREE_VIEW(treeview));
 
     g_signal_connect(G_OBJECT(sel), "changed", (GCallback)info_selected, info);
+    g_signal_connect(G_OBJECT(treeview), "row-activated",
+                     (GCallback)info_tree_row_activated, info);
 
     gtk_container_add(GTK_CONTAINER(scroll), treeview);
 
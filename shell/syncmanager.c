@@ -20,6 +20,7 @@
 #include "hardinfo.h"
 #include "iconcache.h"
 #include "syncmanager.h"
+#include "sync_util.h"
 
 #include <libsoup/soup.h>
 
@@ -30,12 +31,23 @@
 #include <string.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <sys/stat.h>
 
 
 #ifndef SOUP_CHECK_VERSION
     #define SOUP_CHECK_VERSION(a,b,c) 0
 #endif
 
+#if SOUP_CHECK_VERSION(3,0,0)
+#define SYNC_MSG_STATUS(msg) soup_message_get_status(msg)
+#define SYNC_REQUEST_HEADERS(msg) soup_message_get_request_headers(msg)
+#define SYNC_RESPONSE_HEADERS(msg) soup_message_get_response_headers(msg)
+#else
+#define SYNC_MSG_STATUS(msg) ((msg)->status_code)
+#define SYNC_REQUEST_HEADERS(msg) ((msg)->request_headers)
+#define SYNC_RESPONSE_HEADERS(msg) ((msg)->response_headers)
+#endif
+
 typedef struct _SyncDialog SyncDialog;
 typedef struct _SyncNetArea SyncNetArea;
 typedef struct _SyncNetAction SyncNetAction;
@@ -47,6 +59,8 @@ struct _SyncNetArea {
 struct _SyncNetAction {
     SyncEntry *entry;
     GError *error;
+    SoupMessage *msg;
+    gchar *uri;
 };
 
 struct _SyncDialog {
@@ -81,6 +95,15 @@ static guint our_blobs_update_version = 0;
 #define API_SERVER_URI "https://api.hardinfo2.org"
 #endif
 
+/* HARDINFO2_SYNC_SERVER points sync somewhere else, eg. at the stand-in
+ * server in tests/ */
+static const gchar *sync_server_uri(void)
+{
+    const gchar *uri = g_getenv("HARDINFO2_SYNC_SERVER");
+
+    return (uri && *uri) ? uri : API_SERVER_URI;
+}
+
 #define LABEL_SYNC_DEFAULT                                                     \
     _("<big><b>Synchronize with Central Database</b></big>\n"                  \
       "The following information may be synchronized\n"                         \
@@ -217,6 +240,8 @@ static SoupURI *sync_manager_get_proxy(void)
 
 static void ensure_soup_session(void)
 {
+    if (!err_quark)
+        err_quark = g_quark_from_static_string("syncmanager");
     if (!session) {
 #if SOUP_CHECK_VERSION(3,0,0)
       GProxyResolver *resolver=sync_manager_get_proxy();
@@ -233,6 +258,8 @@ static void ensure_soup_session(void)
             SOUP_SESSION_TIMEOUT, 10, SOUP_SESSION_PROXY_URI, proxy, NULL);
 #endif
 #endif
+        /* see SYNC_ACCEPT_ENCODING */
+        soup_session_remove_feature_by_type(session, SOUP_TYPE_CONTENT_DECODER);
     }
 }
 
@@ -288,49 +315,120 @@ static void sync_dialog_start_sync(SyncDialog *sd)
 }
 
 
-static void got_msg(const guint8 *buf,int len, gpointer user_data)
+/* ETag, Last-Modified, url and size of each synced file, by file name */
+static GKeyFile *sync_meta = NULL;
+
+static gchar *sync_entry_path(const gchar *file_name)
 {
-    SyncNetAction *sna = user_data;
+    gchar *dir = g_build_filename(g_get_user_config_dir(), "hardinfo2", NULL);
     gchar *path;
-    int fd,updateversion=0;
-    gchar buffer[101];
-    gsize datawritten;
-
-    if (sna->entry->file_name != NULL) {
-        //check for missing config dirs
-        g_mkdir(g_get_user_config_dir(), 0766);
-        g_mkdir(g_build_filename(g_get_user_config_dir(),"hardinfo2",NULL), 0766);
-	if(strncmp(sna->entry->file_name,"blobs-update-version.json",25)==0){
-	    updateversion=1;
-	}
-        path = g_build_filename(g_get_user_config_dir(), "hardinfo2",
-                                       sna->entry->file_name, NULL);
-        GFile *file = g_file_new_for_path(path);
-        GFileOutputStream *output = g_file_replace(file, NULL, FALSE, G_FILE_CREATE_REPLACE_DESTINATION,
-                                                   NULL, &sna->error);
-
-        if(buf){
-            DEBUG("got file with len: %u", (unsigned int)len);
-            if(len>0){
-                g_output_stream_write_all(G_OUTPUT_STREAM(output),buf,len,&datawritten,NULL,&sna->error);
-            }
-        }
 
-	if(updateversion){
-            fd = open(path,O_RDONLY);
-            if(fd){
-	        if(read(fd,buffer,100)) {
-                   sscanf(buffer,"{\"update-version\":\"%u\",",&server_blobs_update_version);
-		   DEBUG("SERVER_BLOBS_UPDATE_VERSION=%u",server_blobs_update_version);
-	        }
-                close(fd);
-            }
-	}
+    //check for missing config dirs
+    g_mkdir(g_get_user_config_dir(), 0766);
+    g_mkdir(dir, 0766);
+    path = g_build_filename(dir, file_name, NULL);
+    g_free(dir);
+    return path;
+}
+
+static GKeyFile *sync_meta_get(void)
+{
+    gchar *path;
 
+    if (!sync_meta) {
+        sync_meta = g_key_file_new();
+        path = sync_entry_path("sync-cache.conf");
+        g_key_file_load_from_file(sync_meta, path, G_KEY_FILE_NONE, NULL);
         g_free(path);
-        g_object_unref(file);
     }
+    return sync_meta;
+}
+
+static void sync_cache_file_init(SyncCacheFile *f, SyncNetAction *sna)
+{
+    f->meta = sync_meta_get();
+    f->meta_path = sync_entry_path("sync-cache.conf");
+    f->name = sna->entry->file_name;
+    f->uri = sna->uri;
+    f->path = f->name ? sync_entry_path(f->name) : NULL;
+    f->upload = sna->entry->generate_contents_for_upload || !f->name;
+}
+
+static void sync_cache_file_clear(SyncCacheFile *f)
+{
+    g_free((gchar *)f->meta_path);
+    g_free((gchar *)f->path);
+}
+
+static void sync_set_request_header(const gchar *name, const gchar *value, gpointer data)
+{
+    soup_message_headers_replace(data, name, value);
+}
+
+static void sync_add_request_headers(SyncNetAction *sna)
+{
+    SyncCacheFile f;
+
+    sync_cache_file_init(&f, sna);
+    sync_cache_request_headers(&f, sync_set_request_header, SYNC_REQUEST_HEADERS(sna->msg));
+    sync_cache_file_clear(&f);
+}
+
+static void sync_read_server_blobs_version(const gchar *path)
+{
+    gchar buffer[101];
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        memset(buffer, 0, sizeof(buffer));
+        if (read(fd, buffer, 100) > 0)
+            sscanf(buffer, "{\"update-version\":\"%u\",", &server_blobs_update_version);
+        DEBUG("SERVER_BLOBS_UPDATE_VERSION=%u", server_blobs_update_version);
+        close(fd);
+    }
+}
 
+/* store the response for sna, see sync_cache_store() */
+static void got_msg(const guint8 *buf, gsize len, gpointer user_data)
+{
+    SyncNetAction *sna = user_data;
+    SoupMessageHeaders *hdrs;
+    SyncCacheFile f;
+    SyncResponse r;
+
+    if (sna->entry->file_name == NULL || sna->error)
+        return;
+
+    hdrs = SYNC_RESPONSE_HEADERS(sna->msg);
+    r.status = SYNC_MSG_STATUS(sna->msg);
+    r.content_encoding = soup_message_headers_get_one(hdrs, "Content-Encoding");
+    r.im = soup_message_headers_get_one(hdrs, "IM");
+    r.etag = soup_message_headers_get_one(hdrs, "ETag");
+    r.last_modified = soup_message_headers_get_one(hdrs, "Last-Modified");
+
+    sync_cache_file_init(&f, sna);
+    switch (sync_cache_store(&f, &r, buf, len, &sna->error)) {
+    case SYNC_STORE_NOT_MODIFIED:
+        DEBUG("%s not modified", f.name);
+        /* fall through */
+    case SYNC_STORE_STORED:
+        if (strncmp(f.name, "blobs-update-version.json", 25) == 0)
+            sync_read_server_blobs_version(f.path);
+        break;
+    case SYNC_STORE_BAD_STATUS:
+        SNA_ERROR(r.status, _("Server returned status %u"), r.status);
+        break;
+    case SYNC_STORE_UNEXPECTED_DELTA:
+        SNA_ERROR(r.status, _("Unexpected delta for %s"), f.name);
+        break;
+    case SYNC_STORE_INVALID_DELTA:
+        SNA_ERROR(r.status, _("Invalid delta for %s"), f.name);
+        break;
+    case SYNC_STORE_FAILED:
+        break;
+    }
+    sync_cache_file_clear(&f);
 }
 
 
@@ -343,75 +441,36 @@ static void got_response(SoupSession *source, SoupMessage *res, gpointer user_da
     SyncNetAction *sna = user_data;
 #if SOUP_CHECK_VERSION(2,42,0)
     GInputStream *is;
-#endif
-    gchar *path;
-    int fd,updateversion=0;
-    gchar buffer[101];
-#if SOUP_CHECK_VERSION(2,42,0)
-#else
-    const guint8 *buf=NULL;
-    gsize len,datawritten;
-    SoupBuffer *soupmsg=NULL;
-#endif
+    GOutputStream *body;
 
-#if SOUP_CHECK_VERSION(2,42,0)
     is = soup_session_send_finish(session, res, &sna->error);
     if (is == NULL)
         goto out;
-    if (sna->error != NULL)
-        goto out;
-#endif
-
-    if (sna->entry->file_name != NULL) {
-        //check for missing config dirs
-        g_mkdir(g_get_user_config_dir(), 0766);
-        g_mkdir(g_build_filename(g_get_user_config_dir(),"hardinfo2",NULL), 0766);
-	if(strncmp(sna->entry->file_name,"blobs-update-version.json",25)==0){
-	    updateversion=1;
-	}
-        path = g_build_filename(g_get_user_config_dir(), "hardinfo2",
-                                       sna->entry->file_name, NULL);
-        GFile *file = g_file_new_for_path(path);
-        GFileOutputStream *output = g_file_replace(file, NULL, FALSE, G_FILE_CREATE_REPLACE_DESTINATION,
-                                                   NULL, &sna->error);
 
-        if (output != NULL) {
-#if SOUP_CHECK_VERSION(2,42,0)
-            g_output_stream_splice(G_OUTPUT_STREAM(output), is,
-                                   G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET, NULL,
-                                   &sna->error);
+    body = g_memory_output_stream_new(NULL, 0, g_realloc, g_free);
+    if (g_output_stream_splice(body, is,
+            G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+            NULL, &sna->error) >= 0)
+        got_msg(g_memory_output_stream_get_data(G_MEMORY_OUTPUT_STREAM(body)),
+                g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(body)), sna);
+    g_object_unref(body);
+    g_object_unref(is);
 #else
-            soupmsg=soup_message_body_flatten(res->response_body);
-            if(soupmsg){
-                soup_buffer_get_data(soupmsg,&buf,&len);
-                DEBUG("got file with len: %u", (unsigned int)len);
-                if(len>0){
-                    g_output_stream_write_all(G_OUTPUT_STREAM(output),buf,len,&datawritten,NULL,&sna->error);
-                    soup_buffer_free(soupmsg);
-	        }
-	    }
+    const guint8 *buf = NULL;
+    gsize len = 0;
+    SoupBuffer *soupmsg = soup_message_body_flatten(res->response_body);
+
+    if (soupmsg)
+        soup_buffer_get_data(soupmsg, &buf, &len);
+    got_msg(buf, len, sna);
+    if (soupmsg)
+        soup_buffer_free(soupmsg);
 #endif
-        }
-
-	if(updateversion){
-            fd = open(path,O_RDONLY);
-            if(fd){
-	        if(read(fd,buffer,100))
-                    sscanf(buffer,"{\"update-version\":\"%u\",",&server_blobs_update_version);
-		DEBUG("SERVER_BLOBS_UPDATE_VERSION=%u",server_blobs_update_version);
-                close(fd);
-            }
-	}
 
-        g_free(path);
-        g_object_unref(file);
-    }
-
-out:
-    g_main_loop_quit(loop);
 #if SOUP_CHECK_VERSION(2,42,0)
-    g_object_unref(is);
+out:
 #endif
+    g_main_loop_quit(loop);
 }
 
 static gboolean send_request_for_net_action(SyncNetAction *sna)
@@ -419,29 +478,31 @@ static gboolean send_request_for_net_action(SyncNetAction *sna)
     gchar *uri;
     SoupMessage *msg;
     const guint8 *buf=NULL;
-    gsize len;
+    gsize len=0;
     gchar *contents=NULL;
     gsize size;
-#if !SOUP_CHECK_VERSION(3, 0, 0)
+#if SOUP_CHECK_VERSION(3, 0, 0)
+    GBytes *body;
+#else
     SoupBuffer *soupmsg=NULL;
 #endif
 
     if(!sna->entry->optional || (our_blobs_update_version<server_blobs_update_version)){
         if(strncmp(sna->entry->file_name,"blobs-update-version.json",25)==0){
-          uri = g_strdup_printf("%s/%s?ver=%s&blobver=%d&rel=%d", API_SERVER_URI, sna->entry->file_name,VERSION,our_blobs_update_version,RELEASE);
+          uri = g_strdup_printf("%s/%s?ver=%s&blobver=%d&rel=%d", sync_server_uri(), sna->entry->file_name,VERSION,our_blobs_update_version,RELEASE);
 	} else if(strncmp(sna->entry->file_name,"benchmark.json",14)==0){
 	    if (sna->entry->generate_contents_for_upload == NULL) {//GET/Fetch
 	        gchar *cpuname=module_call_method("devices::getProcessorName");
 		gchar *machinetype=module_call_method("computer::getMachineTypeEnglish");
 	        if(params.bench_user_note){
-		  uri = g_strdup_printf("%s/%s?ver=%s&L=%d&rel=%d&MT=%s&CPU=%s&BUN=%s", API_SERVER_URI,
+		  uri = g_strdup_printf("%s/%s?ver=%s&L=%d&rel=%d&MT=%s&CPU=%s&BUN=%s", sync_server_uri(),
 				        sna->entry->file_name, VERSION,
 		                        params.max_bench_results,RELEASE,
 					machinetype,
 					cpuname,
 					params.bench_user_note);
 		} else {
-		  uri = g_strdup_printf("%s/%s?ver=%s&L=%d&rel=%d&&MT=%s&CPU=%s", API_SERVER_URI,
+		  uri = g_strdup_printf("%s/%s?ver=%s&L=%d&rel=%d&&MT=%s&CPU=%s", sync_server_uri(),
 					sna->entry->file_name, VERSION,
 		                        params.max_bench_results, RELEASE,
 					machinetype,
@@ -450,11 +511,11 @@ static gboolean send_request_for_net_action(SyncNetAction *sna)
 		g_free(cpuname);
 		g_free(machinetype);
 	    } else {//POST/Send
-	      uri = g_strdup_printf("%s/%s?ver=%s&rel=%d", API_SERVER_URI,
+	      uri = g_strdup_printf("%s/%s?ver=%s&rel=%d", sync_server_uri(),
 				    sna->entry->file_name, VERSION, RELEASE);
 	    }
 	} else {
-            uri = g_strdup_printf("%s/%s", API_SERVER_URI, sna->entry->file_name);
+            uri = g_strdup_printf("%s/%s", sync_server_uri(), sna->entry->file_name);
 	}
     if (sna->entry->generate_contents_for_upload == NULL) {
         msg = soup_message_new("GET", uri);
@@ -470,6 +531,10 @@ static gboolean send_request_for_net_action(SyncNetAction *sna)
                                  SOUP_MEMORY_TAKE, contents, size);
 #endif
     }
+    sna->msg = msg;
+    sna->uri = uri;
+    sync_add_request_headers(sna);
+
     if(params.gui_running){
 #if SOUP_CHECK_VERSION(3, 0, 0)
       soup_session_send_async(session, msg, G_PRIORITY_DEFAULT, NULL, got_response, sna);
@@ -484,20 +549,27 @@ static gboolean send_request_for_net_action(SyncNetAction *sna)
     } else {//Blocking/Sync sending when no gui
 
 #if SOUP_CHECK_VERSION(3, 0, 0)
-    buf=g_bytes_unref_to_data(soup_session_send_and_read(session, msg, NULL, NULL), &len);
-    got_msg(buf,len,sna);
+        body = soup_session_send_and_read(session, msg, NULL, &sna->error);
+        if(body){
+            buf = g_bytes_get_data(body, &len);
+            got_msg(buf,len,sna);
+            g_bytes_unref(body);
+        }
 #else
         soup_session_send_message(session, msg);
         soupmsg=soup_message_body_flatten(msg->response_body);
-        if(soupmsg){
+        if(soupmsg)
             soup_buffer_get_data(soupmsg,&buf,&len);
-            got_msg(buf,len,sna);
-	}
+        got_msg(buf,len,sna);
+        if(soupmsg)
+            soup_buffer_free(soupmsg);
 #endif
     }
     if(params.gui_running)
         g_main_loop_run(loop);
 
+    sna->msg = NULL;
+    sna->uri = NULL;
     g_object_unref(msg);
     g_free(uri);
 
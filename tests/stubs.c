@@ -0,0 +1,154 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/* The parts of the hardinfo2 binary that module tests link against. */
+
+#include <stdarg.h>
+#include <string.h>
+#include "hardinfo.h"
+
+ProgramParameters params = { 0 };
+
+gchar *h_strdup_cprintf(const gchar *format, gchar *source, ...)
+{
+    gchar *buffer, *ret;
+    va_list args;
+
+    va_start(args, source);
+    buffer = g_strdup_vprintf(format, args);
+    va_end(args);
+    ret = g_strconcat(source ? source : "", buffer, NULL);
+    g_free(buffer);
+    g_free(source);
+    return ret;
+}
+
+char *strend(gchar *str, gchar chr)
+{
+    gchar *p;
+
+    if (str && (p = strchr(str, chr)))
+        *p = 0;
+    return str;
+}
+
+gchar *strreplacechr(gchar *string, gchar *replace, gchar new_char)
+{
+    gchar *s;
+
+    for (s = string; *s; s++)
+        if (strchr(replace, *s))
+            *s = new_char;
+    return string;
+}
+
+gchar *hardinfo_clean_value(const gchar *v, int replacing)
+{
+    GString *clean;
+    const gchar *p;
+
+    if (v == NULL)
+        return NULL;
+
+    clean = g_string_new(NULL);
+    for (p = v; *p; p++) {
+        switch (*p) {
+        case '&': g_string_append(clean, "&amp;"); break;
+        case '<': g_string_append(clean, "&lt;"); break;
+        case '>': g_string_append(clean, "&gt;"); break;
+        default: g_string_append_c(clean, *p);
+        }
+    }
+    if (replacing)
+        g_free((gpointer)v);
+    return g_string_free(clean, FALSE);
+}
+
+gchar *hardinfo_clean_grpname(const gchar *v, int replacing)
+{
+    gchar *clean, *p;
+
+    p = clean = g_strdup(v);
+    for (; *p; p++) {
+        if (*p == '[')
+            *p = '(';
+        else if (*p == ']')
+            *p = ')';
+    }
+    if (replacing)
+        g_free((gpointer)v);
+    return clean;
+}
+
+gboolean hardinfo_spawn_command_line_sync(const gchar *command_line,
+                                          gchar **standard_output,
+                                          gchar **standard_error,
+                                          gint *exit_status,
+                                          GError **error)
+{
+    return g_spawn_command_line_sync(command_line, standard_output,
+                                     standard_error, exit_status, error);
+}
+
+/* moreinfo keeps what modules hand it, as util.c does, so tests can look
+ * it up */
+static GHashTable *moreinfo;
+
+void moreinfo_add_with_prefix(gchar *prefix, gchar *key, gchar *value)
+{
+    if (!moreinfo)
+        moreinfo = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    if (prefix)
+        g_hash_table_insert(moreinfo, g_strconcat(prefix, ":", key, NULL), value);
+    else
+        g_hash_table_insert(moreinfo, g_strdup(key), value);
+}
+
+static gboolean moreinfo_del_cb(gpointer key, gpointer value, gpointer data)
+{
+    return g_str_has_prefix(key, data);
+}
+
+void moreinfo_del_with_prefix(gchar *prefix)
+{
+    if (moreinfo)
+        g_hash_table_foreach_remove(moreinfo, moreinfo_del_cb, prefix);
+}
+
+gchar *moreinfo_lookup_with_prefix(gchar *prefix, gchar *key)
+{
+    gchar *lookup_key, *result;
+
+    if (!moreinfo)
+        return NULL;
+    if (!prefix)
+        return g_hash_table_lookup(moreinfo, key);
+    lookup_key = g_strconcat(prefix, ":", key, NULL);
+    result = g_hash_table_lookup(moreinfo, lookup_key);
+    g_free(lookup_key);
+    return result;
+}
+
+gchar *moreinfo_lookup(gchar *key)
+{
+    return moreinfo_lookup_with_prefix(NULL, key);
+}
+
+void shell_status_update(const gchar *message)
+{
+}
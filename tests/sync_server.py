@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+#
+#    HardInfo2 - System Information and Benchmark
+#
+#    This program is free software; you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation, version 2 or later.
+#
+# Stand-in for api.hardinfo2.org, serving the .ids files hardinfo2 syncs
+# (sample.ids is an extra one for tests) with the validators and encodings
+# the sync code uses:
+#
+#   200   full file, gzip when accepted, with ETag and Last-Modified
+#   304   If-None-Match or If-Modified-Since matches the current version
+#   226   IM: rcsdiff, a diff -n delta against the version in If-None-Match
+#   404   any other file
+#
+# GET /bump makes a new version of every file, GET /reset goes back to the
+# first one.
+#
+#   sync_server.py [--port N]          serve until interrupted; point
+#                                      hardinfo2 at it with
+#                                      HARDINFO2_SYNC_SERVER=http://127.0.0.1:N
+#   sync_server.py --run CMD [ARGS]    serve on a free port, run
+#                                      CMD ARGS --server <url> and exit
+#                                      with its status
+
+import difflib
+import email.utils
+import gzip
+import http.server
+import subprocess
+import sys
+import threading
+
+VERSIONS = []
+FILES = ("/arm.ids", "/edid.ids", "/ieee_oui.ids", "/pci.ids", "/sdcard.ids",
+         "/usb.ids", "/vendor.ids", "/sample.ids")
+
+
+def make_version(n):
+    lines = ["# sample.ids, version %d\n" % n]
+    for vendor in range(1, 40):
+        lines.append("%04x  Vendor %d\n" % (vendor, vendor))
+        for device in range(1, 8):
+            # every version renames some devices, adds and drops others
+            if (vendor * device + n) % 11 == 0:
+                continue
+            name = "Device %d" % device
+            if (vendor + device + n) % 7 == 0:
+                name += " rev %d" % n
+            lines.append("\t%04x  %s\n" % (device, name))
+    return lines
+
+
+def reset():
+    del VERSIONS[:]
+    VERSIONS.append(make_version(0))
+
+
+def rcsdiff(old, new):
+    out = []
+    matcher = difflib.SequenceMatcher(None, old, new, autojunk=False)
+    for tag, i1, i2, j1, j2 in matcher.get_opcodes():
+        if tag in ("delete", "replace"):
+            out.append("d%d %d\n" % (i1 + 1, i2 - i1))
+        if tag in ("insert", "replace"):
+            out.append("a%d %d\n" % (i2, j2 - j1))
+            out.extend(new[j1:j2])
+    return "".join(out)
+
+
+def etag(n):
+    return '"v%d"' % n
+
+
+def last_modified(n):
+    return email.utils.formatdate(1700000000 + n * 86400, usegmt=True)
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    def log_message(self, fmt, *args):
+        pass
+
+    def reply(self, status, body=b"", headers=()):
+        self.send_response(status)
+        for name, value in headers:
+            self.send_header(name, value)
+        if status != 304:
+            self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        if status != 304:
+            self.wfile.write(body)
+
+    def do_GET(self):
+        path = self.path.split("?")[0]
+        if path == "/bump":
+            VERSIONS.append(make_version(len(VERSIONS)))
+            return self.reply(200, b"%d\n" % (len(VERSIONS) - 1))
+        if path == "/reset":
+            reset()
+            return self.reply(200, b"0\n")
+        if path not in FILES:
+            return self.reply(404, b"not found\n")
+
+        current = len(VERSIONS) - 1
+        headers = [("ETag", etag(current)),
+                   ("Last-Modified", last_modified(current))]
+        inm = self.headers.get("If-None-Match")
+        ims = self.headers.get("If-Modified-Since")
+        if inm == etag(current) or (not inm and ims == last_modified(current)):
+            return self.reply(304, headers=headers)
+
+        base = None
+        if inm and "rcsdiff" in (self.headers.get("A-IM") or ""):
+            for n in range(current):
+                if inm == etag(n):
+                    base = n
+        if base is not None:
+            body = rcsdiff(VERSIONS[base], VERSIONS[current])
+            status = 226
+            headers.append(("IM", "rcsdiff"))
+        else:
+            body = "".join(VERSIONS[current])
+            status = 200
+
+        body = body.encode()
+        if "gzip" in (self.headers.get("Accept-Encoding") or ""):
+            body = gzip.compress(body)
+            headers.append(("Content-Encoding", "gzip"))
+        self.reply(status, body, headers)
+
+
+def main(argv):
+    reset()
+    port = 0
+    if len(argv) > 2 and argv[1] == "--port":
+        port = int(argv[2])
+    server = http.server.HTTPServer(("127.0.0.1", port), Handler)
+    url = "http://127.0.0.1:%d" % server.server_address[1]
+
+    if len(argv) > 2 and argv[1] == "--run":
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+        status = subprocess.call(argv[2:] + ["--server", url])
+        server.shutdown()
+        return status
+
+    print("serving on %s" % url, flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,517 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * The apcupsd NIS client against a fake server in a thread: message
+ * framing, answers split into single bytes, a connection dropped between
+ * scans, and servers that refuse, stall or send garbage, which must all
+ * fail within one deadline and back off.
+ *
+ * The power supply tracker against a fake /sys/class/power_supply, with
+ * the uevent socket replaced by one end of a socketpair: attributes read
+ * again through kept descriptors, the discharge estimate, and the list
+ * rebuilt only on add and remove events.
+ */
+
+static char *ps_dir;
+#define APCUPSD_TIMEOUT 1
+#define POWER_SUPPLY_DIR ps_dir
+/* the socket battery.c opens; uevent_drain() is the real one */
+#define uevent_open test_uevent_open
+#include "../modules/devices/battery.c"
+#undef uevent_open
+#include <glib/gstdio.h>
+
+gchar *battery_list = NULL;
+gchar *powerstate = NULL;
+
+gchar *seconds_to_string(unsigned int seconds) { return g_strdup_printf("%u s", seconds); }
+gchar *vendor_get_link(const gchar *v_str) { return g_strdup(v_str); }
+
+static gchar *tmp_dir;
+static int events[2] = { -1, -1 };
+static gboolean no_socket;
+
+int test_uevent_open(void)
+{
+    return no_socket ? -1 : events[0];
+}
+
+typedef enum {
+    NIS_SERVE,    /* answer every request */
+    NIS_TRICKLE,  /* answer a byte at a time */
+    NIS_DROP,     /* close the connection on the next request, then serve */
+    NIS_STALL,    /* read requests, never answer */
+    NIS_OVERSIZE, /* a message longer than any status line */
+} NisMode;
+
+static const gchar *nis_answer[] = {
+    "APC      : 001,036,0887\n",
+    "STATUS   : ONLINE \n",
+    "LINEV    : 230.0 Volts\n",
+    "LOADPCT  : 12.0 Percent\n",
+    "BCHARGE  : 100.0 Percent\n",
+    "a line without a separator\n",
+    "APCMODEL : Back-UPS ES 700\n",
+    "TIMELEFT :   41.0 Minutes  \n",
+};
+
+static int nis_listen_fd = -1;
+static volatile gint nis_mode = NIS_SERVE, nis_accepts, nis_requests;
+
+static gboolean send_all(int fd, const gchar *buf, gsize len, gboolean trickle)
+{
+    while (len) {
+        ssize_t n = send(fd, buf, trickle ? 1 : len, MSG_NOSIGNAL);
+
+        if (n <= 0)
+            return FALSE;
+        buf += n;
+        len -= n;
+        if (trickle)
+            g_usleep(200);
+    }
+    return TRUE;
+}
+
+static gboolean send_message(int fd, const gchar *s, gsize len, gboolean trickle)
+{
+    guint16 be = htons(len);
+
+    return send_all(fd, (gchar *)&be, 2, trickle) && send_all(fd, s, len, trickle);
+}
+
+static gpointer nis_server(gpointer data)
+{
+    int fd;
+
+    while ((fd = accept(nis_listen_fd, NULL, NULL)) >= 0) {
+        gchar req[64];
+        guint16 len;
+
+        g_atomic_int_inc(&nis_accepts);
+        while (recv(fd, &len, 2, MSG_WAITALL) == 2
+               && ntohs(len) < sizeof(req)
+               && recv(fd, req, ntohs(len), MSG_WAITALL) == ntohs(len)) {
+            NisMode mode = g_atomic_int_get(&nis_mode);
+            gboolean trickle = mode == NIS_TRICKLE;
+            guint i;
+
+            g_atomic_int_inc(&nis_requests);
+            g_assert_cmpint(ntohs(len), ==, 6);
+            g_assert(memcmp(req, "status", 6) == 0);
+
+            if (mode == NIS_DROP) {
+                g_atomic_int_set(&nis_mode, NIS_SERVE);
+                break;
+            }
+            if (mode == NIS_STALL)
+                continue;
+            if (mode == NIS_OVERSIZE) {
+                gchar big[600];
+
+                memset(big, 'x', sizeof(big));
+                send_message(fd, big, sizeof(big), FALSE);
+                continue;
+            }
+            for (i = 0; i < G_N_ELEMENTS(nis_answer); i++)
+                send_message(fd, nis_answer[i], strlen(nis_answer[i]), trickle);
+            send_message(fd, "", 0, trickle);
+        }
+        close(fd);
+    }
+
+    return NULL;
+}
+
+static void nis_settings(guint16 port)
+{
+    gchar *path = g_build_filename(tmp_dir, "hardinfo2", "settings.ini", NULL);
+    gchar *ini = g_strdup_printf("[Devices]\nApcupsdHost=127.0.0.1\nApcupsdPort=%u\n", port);
+
+    g_assert_true(g_file_set_contents(path, ini, -1, NULL));
+    g_free(ini);
+    g_free(path);
+}
+
+static void nis_server_start(void)
+{
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    nis_listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    g_assert_cmpint(nis_listen_fd, >=, 0);
+    g_assert_cmpint(bind(nis_listen_fd, (struct sockaddr *)&addr, sizeof(addr)), ==, 0);
+    g_assert_cmpint(listen(nis_listen_fd, 4), ==, 0);
+    g_assert_cmpint(getsockname(nis_listen_fd, (struct sockaddr *)&addr, &addr_len), ==, 0);
+    nis_settings(ntohs(addr.sin_port));
+
+    g_thread_new("nis", nis_server, NULL);
+}
+
+/* one scan of the UPS, as scan_battery_do() makes it */
+static gboolean ups_scan(void)
+{
+    g_free(battery_list);
+    battery_list = g_strdup("");
+    __scan_battery_apcupsd();
+    return *battery_list != 0;
+}
+
+static void test_nis_status(void)
+{
+    g_assert_true(ups_scan());
+    g_assert(strstr(battery_list, "[UPS Status]\nStatus=ONLINE\n") != NULL);
+    g_assert(strstr(battery_list, "Time Left=41.0 Minutes\n") != NULL);
+    g_assert(strstr(battery_list, "$UPS_LINEV$Line Voltage=230.0 Volts|230.0 - 230.0\n") != NULL);
+    g_assert(strstr(battery_list, "$UPS_BCHARGE$Battery Charge=100.0 Percent|") != NULL);
+    g_assert(strstr(battery_list, "Model=Back-UPS ES 700\n") != NULL);
+    /* asked for but not sent */
+    g_assert(strstr(battery_list, "Serial Number=(Unknown)\n") != NULL);
+
+    /* the connection is kept for the next scan */
+    g_assert_true(ups_scan());
+    g_assert_cmpint(g_atomic_int_get(&nis_accepts), ==, 1);
+    g_assert_cmpint(g_atomic_int_get(&nis_requests), ==, 2);
+}
+
+static void test_nis_trickle(void)
+{
+    g_atomic_int_set(&nis_mode, NIS_TRICKLE);
+    g_assert_true(ups_scan());
+    g_assert(strstr(battery_list, "Status=ONLINE\n") != NULL);
+    g_assert(strstr(battery_list, "Model=Back-UPS ES 700\n") != NULL);
+    g_atomic_int_set(&nis_mode, NIS_SERVE);
+}
+
+static void test_nis_dropped(void)
+{
+    gint accepts = g_atomic_int_get(&nis_accepts);
+
+    /* apcupsd went away between scans: reconnected within the scan */
+    g_atomic_int_set(&nis_mode, NIS_DROP);
+    g_assert_true(ups_scan());
+    g_assert(strstr(battery_list, "Status=ONLINE\n") != NULL);
+    g_assert_cmpint(g_atomic_int_get(&nis_accepts), ==, accepts + 1);
+}
+
+/* a failed scan shows nothing, and the next ones don't try again
+ * until the back off is over, nor make it longer */
+static void check_backoff(gint accepts)
+{
+    gdouble retry_at = ups_retry_at;
+
+    g_assert_cmpint(ups_fd, ==, -1);
+    g_assert_cmpfloat(retry_at, >, battery_now() + APCUPSD_RETRY_AFTER - 5);
+    g_assert_false(ups_scan());
+    g_assert_false(ups_scan());
+    g_assert_cmpint(g_atomic_int_get(&nis_accepts), ==, accepts);
+    g_assert_cmpfloat(ups_retry_at, ==, retry_at);
+
+    /* once it is over, a working server is used again */
+    g_atomic_int_set(&nis_mode, NIS_SERVE);
+    ups_retry_at = 0;
+    g_assert_true(ups_scan());
+}
+
+static void test_nis_oversize(void)
+{
+    gint accepts;
+
+    /* start from a new connection */
+    nis_close();
+    ups_retry_at = 0;
+    g_atomic_int_set(&nis_mode, NIS_OVERSIZE);
+    g_assert_false(ups_scan());
+    accepts = g_atomic_int_get(&nis_accepts);
+    check_backoff(accepts);
+}
+
+static void test_nis_stall(void)
+{
+    gdouble start;
+    gint accepts;
+
+    g_atomic_int_set(&nis_mode, NIS_STALL);
+    start = battery_now();
+    /* the kept connection stalls, then so does the reconnect: both
+     * within the one deadline */
+    g_assert_false(ups_scan());
+    g_assert_cmpfloat(battery_now() - start, >=, APCUPSD_TIMEOUT * 0.9);
+    g_assert_cmpfloat(battery_now() - start, <, APCUPSD_TIMEOUT + 0.5);
+    accepts = g_atomic_int_get(&nis_accepts);
+    check_backoff(accepts);
+}
+
+static void test_nis_refused(void)
+{
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    gdouble start;
+    int fd;
+
+    /* a port nothing listens on */
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    g_assert_cmpint(bind(fd, (struct sockaddr *)&addr, sizeof(addr)), ==, 0);
+    g_assert_cmpint(getsockname(fd, (struct sockaddr *)&addr, &addr_len), ==, 0);
+    close(fd);
+    nis_settings(ntohs(addr.sin_port));
+
+    nis_close();
+    ups_retry_at = 0;
+    start = battery_now();
+    g_assert_false(ups_scan());
+    g_assert_cmpfloat(battery_now() - start, <, APCUPSD_TIMEOUT);
+    g_assert_cmpint(ups_fd, ==, -1);
+    g_assert_cmpfloat(ups_retry_at, >, battery_now() + APCUPSD_RETRY_AFTER - 5);
+}
+
+static void rm_rf(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+
+    if (dir) {
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+
+            rm_rf(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+        g_rmdir(path);
+    } else {
+        g_unlink(path);
+    }
+}
+
+/* in place, as sysfs does: the tracker keeps the files open */
+static void ps_write(const gchar *supply, const gchar *attr, const gchar *value)
+{
+    gchar *path = g_build_filename(ps_dir, supply, attr, NULL);
+    int fd;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    g_assert_cmpint(fd, >=, 0);
+    g_assert_cmpint(write(fd, value, strlen(value)), ==, strlen(value));
+    close(fd);
+    g_free(path);
+}
+
+static void ps_add(const gchar *supply)
+{
+    gchar *path = g_build_filename(ps_dir, supply, NULL);
+
+    g_assert_cmpint(g_mkdir_with_parents(path, 0755), ==, 0);
+    g_free(path);
+}
+
+static void send_uevent(const gchar *action, const gchar *subsystem)
+{
+    gchar buf[256];
+    gint len;
+
+    len = g_snprintf(buf, sizeof(buf), "%s@/devices/test", action);
+    len += g_snprintf(buf + len + 1, sizeof(buf) - len - 1, "ACTION=%s", action) + 1;
+    len += g_snprintf(buf + len + 1, sizeof(buf) - len - 1, "SUBSYSTEM=%s", subsystem) + 1;
+    g_assert_cmpint(send(events[1], buf, len + 1, 0), ==, len + 1);
+}
+
+/* the last sample charted for tag */
+static gdouble charted(const gchar *tag)
+{
+    TimeSeries *ts = time_series_store_lookup(battery_history, tag);
+
+    g_assert(ts != NULL && ts->len > 0);
+    return time_series_get(ts, ts->len - 1);
+}
+
+static void test_sysfs_discharging(void)
+{
+    /* no UPS for these */
+    nis_close();
+    ups_retry_at = battery_now() + 3600;
+
+    ps_add("AC");
+    ps_write("AC", "type", "Mains\n");
+    ps_write("AC", "online", "0\n");
+    ps_add("BAT0");
+    ps_write("BAT0", "type", "Battery\n");
+    ps_write("BAT0", "status", "Discharging\n");
+    ps_write("BAT0", "capacity", "80\n");
+    ps_write("BAT0", "capacity_level", "Normal\n");
+    ps_write("BAT0", "power_now", "12000000\n");
+    ps_write("BAT0", "voltage_now", "12000000\n");
+    ps_write("BAT0", "energy_now", "40000000\n");
+    ps_write("BAT0", "technology", "Li-ion\n");
+    ps_write("BAT0", "model_name", "Test Pack\n");
+
+    scan_battery_do();
+    g_assert(strstr(battery_list, "Power State=BAT\n") != NULL);
+    g_assert(strstr(battery_list, "[AC Power Supply: AC]\nOnline=Not attached\n") != NULL);
+    g_assert(strstr(battery_list, "[Battery: BAT0]\nState=Discharging\nCapacity=80 % / Normal\n") != NULL);
+    /* unsigned in the chart and its range, the direction in the text */
+    g_assert(strstr(battery_list, "$BAT_BAT0$Battery Usage=12.0 W (Discharging)|12.0 - 12.0\n") != NULL);
+    g_assert_cmpfloat(charted("BAT_BAT0"), ==, 12.0);
+    g_assert_cmpfloat(atof(moreinfo_lookup_with_prefix("DEV", "BAT_BAT0")), ==, 12.0);
+    g_assert(strstr(battery_lginterval, "UpdateInterval$BAT_BAT0=4000\n") != NULL);
+    /* 40 Wh at 12 W */
+    g_assert(strstr(battery_list, "Discharge Rate=12.0 W\nTime to Empty=3 h 20 min\n") != NULL);
+    g_assert(strstr(battery_list, "Model Number=Test Pack\n") != NULL);
+}
+
+static void test_sysfs_pread(void)
+{
+    /* read again through the kept descriptors, no event needed */
+    ps_write("BAT0", "power_now", "6000000\n");
+    ps_write("BAT0", "capacity", "79\n");
+    scan_battery_do();
+    g_assert(strstr(battery_list, "Capacity=79 % / Normal\n") != NULL);
+    g_assert(strstr(battery_list, "Battery Usage=6.0 W (Discharging)|6.0 - 12.0\n") != NULL);
+    g_assert_cmpfloat(charted("BAT_BAT0"), ==, 6.0);
+
+    /* charging: still charted as a positive power, no discharge rows */
+    ps_write("AC", "online", "1\n");
+    ps_write("BAT0", "status", "Charging\n");
+    ps_write("BAT0", "power_now", "20000000\n");
+    scan_battery_do();
+    g_assert(strstr(battery_list, "Power State=AC\n") != NULL);
+    g_assert(strstr(battery_list, "Battery Usage=20.0 W (Charging)|6.0 - 20.0\n") != NULL);
+    g_assert_cmpfloat(charted("BAT_BAT0"), ==, 20.0);
+    g_assert(strstr(battery_list, "Discharge Rate=") == NULL);
+}
+
+static void test_sysfs_energy_only(void)
+{
+    gdouble start;
+
+    /* a supply that appears without an event isn't seen */
+    ps_add("BAT1");
+    ps_write("BAT1", "status", "Discharging\n");
+    ps_write("BAT1", "capacity", "50\n");
+    ps_write("BAT1", "capacity_level", "Normal\n");
+    ps_write("BAT1", "energy_now", "30000000\n");
+    scan_battery_do();
+    g_assert(strstr(battery_list, "[Battery: BAT1]") == NULL);
+
+    /* until one comes; events from other subsystems don't count */
+    send_uevent("add", "drm");
+    scan_battery_do();
+    g_assert(strstr(battery_list, "[Battery: BAT1]") == NULL);
+    send_uevent("add", "power_supply");
+    start = battery_now();
+    scan_battery_do();
+    g_assert(strstr(battery_list, "[Battery: BAT1]") != NULL);
+    /* one energy_now sample: no draw yet */
+    g_assert(strstr(battery_list, "[Battery: BAT1]\nState=Discharging\nCapacity=50 % / Normal\n"
+                                  "Battery Usage=-1 W\n") != NULL);
+
+    /* the fall of energy_now over the time between scans */
+    g_usleep(200000);
+    ps_write("BAT1", "energy_now", "29999000\n");
+    scan_battery_do();
+    g_assert(strstr(battery_list, "$BAT_BAT1$Battery Usage=") != NULL);
+    /* 1 mWh in about 0.2 s */
+    g_assert_cmpfloat(charted("BAT_BAT1"), >, 0.001 / (battery_now() - start + 0.05) * 3600);
+    g_assert_cmpfloat(charted("BAT_BAT1"), <, 0.001 / 0.2 * 3600);
+    g_assert(strstr(battery_list, "Discharge Rate=") != NULL);
+}
+
+static void test_sysfs_removed(void)
+{
+    gchar *path = g_build_filename(ps_dir, "BAT1", NULL);
+
+    rm_rf(path);
+    g_free(path);
+    send_uevent("remove", "power_supply");
+    scan_battery_do();
+    g_assert(strstr(battery_list, "[Battery: BAT1]") == NULL);
+    g_assert(strstr(battery_list, "[Battery: BAT0]") != NULL);
+}
+
+static void test_sysfs_no_socket(void)
+{
+    /* as if the first scan had failed to open the socket: the list is
+     * made again at every scan */
+    ps_uevent_fd = -2;
+    no_socket = TRUE;
+    scan_battery_do();
+    ps_add("BAT2");
+    ps_write("BAT2", "status", "Unknown\n");
+    scan_battery_do();
+    g_assert(strstr(battery_list, "[Battery: BAT2]\nState=Unknown\n") != NULL);
+}
+
+static void test_sysfs_nothing_charted(void)
+{
+    gchar *path = g_build_filename(ps_dir, "BAT0", NULL);
+
+    /* no power, current or energy to chart: the page keeps the detail view */
+    rm_rf(path);
+    g_free(path);
+    scan_battery_do();
+    g_assert(strstr(battery_list, "[Battery: BAT2]") != NULL);
+    g_assert_null(battery_lginterval);
+}
+
+int main(int argc, char **argv)
+{
+    gchar *config;
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    tmp_dir = g_dir_make_tmp("test_battery-XXXXXX", NULL);
+    g_assert(tmp_dir != NULL);
+    config = g_build_filename(tmp_dir, "hardinfo2", NULL);
+    g_mkdir_with_parents(config, 0755);
+    g_free(config);
+    g_setenv("XDG_CONFIG_HOME", tmp_dir, TRUE);
+    nis_server_start();
+    ps_dir = g_build_filename(tmp_dir, "power_supply", NULL);
+    g_mkdir_with_parents(ps_dir, 0755);
+    g_assert_cmpint(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, events), ==, 0);
+
+    g_test_add_func("/battery/nis/status", test_nis_status);
+    g_test_add_func("/battery/nis/trickle", test_nis_trickle);
+    g_test_add_func("/battery/nis/dropped", test_nis_dropped);
+    g_test_add_func("/battery/nis/oversize", test_nis_oversize);
+    g_test_add_func("/battery/nis/stall", test_nis_stall);
+    g_test_add_func("/battery/nis/refused", test_nis_refused);
+    g_test_add_func("/battery/sysfs/discharging", test_sysfs_discharging);
+    g_test_add_func("/battery/sysfs/pread", test_sysfs_pread);
+    g_test_add_func("/battery/sysfs/energy-only", test_sysfs_energy_only);
+    g_test_add_func("/battery/sysfs/removed", test_sysfs_removed);
+    g_test_add_func("/battery/sysfs/no-socket", test_sysfs_no_socket);
+    g_test_add_func("/battery/sysfs/nothing-charted", test_sysfs_nothing_charted);
+    ret = g_test_run();
+
+    nis_close();
+    close(events[0]);
+    close(events[1]);
+    rm_rf(tmp_dir);
+    g_free(ps_dir);
+    g_free(tmp_dir);
+    return ret;
+}
@@ -0,0 +1,297 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * The Boots list from a generated wtmp and minimal journal files: a boot
+ * only wtmp still has, a boot only the journal still has, and the current
+ * boot in both, whose journal was vacuumed so its first entry is days after
+ * the boot.
+ */
+
+#include <glib/gstdio.h>
+
+static gchar *fake_wtmp, *fake_machine_id, *fake_journal;
+#define BOOTS_WTMP fake_wtmp
+#define BOOTS_MACHINE_ID fake_machine_id
+#define BOOTS_JOURNAL_PERSISTENT fake_journal
+#define BOOTS_JOURNAL_VOLATILE "/nonexistent"
+
+#include "../modules/computer/boots.c"
+
+/* not reached: only scan_boots_real() uses these */
+Computer *computer = NULL;
+void scan_os(gboolean reload) {}
+gchar *strreplace(gchar *string, gchar *replace, gchar *replacement) { return string; }
+
+static gchar *tmp_dir;
+
+#define MACHINE_ID "5d1c0a7e3f2b4c6d8e9f0a1b2c3d4e5f"
+#define OTHER_MACHINE_ID "0f0e0d0c0b0a09080706050403020100"
+
+#define T_JOURNAL_ONLY 1700000000 /* wtmp was rotated away */
+#define T_WTMP_ONLY 1700500000    /* journal was vacuumed */
+#define T_CURRENT 1701000000      /* in both */
+#define T_OTHER_MACHINE 1702000000
+#define DAY 86400
+
+typedef struct {
+    guchar boot;        /* boot id is 16 of these */
+    guint64 realtime;   /* usec */
+    guint64 monotonic;  /* usec since that boot */
+} jentry;
+
+static void put_u64(GByteArray *a, gsize off, guint64 v)
+{
+    v = GUINT64_TO_LE(v);
+    memcpy(a->data + off, &v, 8);
+}
+
+static void put_u32(GByteArray *a, gsize off, guint32 v)
+{
+    v = GUINT32_TO_LE(v);
+    memcpy(a->data + off, &v, 4);
+}
+
+static gsize grow(GByteArray *a, gsize size)
+{
+    gsize off = a->len;
+
+    g_byte_array_set_size(a, off + ((size + 7) & ~(gsize)7));
+    memset(a->data + off, 0, a->len - off);
+    return off;
+}
+
+/* header, the entries, then a chain of entry arrays of 4, 8, 16, ... items */
+static void write_journal(const gchar *path, gboolean compact, const jentry *e, guint n)
+{
+    GByteArray *a = g_byte_array_new();
+    gsize *offs = g_new(gsize, n), off, prev = 0;
+    guint i = 0, cap = 4, k, item = compact ? 4 : 8;
+
+    grow(a, 256);
+    memcpy(a->data, "LPKSHHRH", 8);
+    put_u32(a, 12, compact ? JOURNAL_INCOMPAT_COMPACT : 0);
+    put_u64(a, 152, n);
+
+    for (k = 0; k < n; k++) {
+        offs[k] = off = grow(a, 64);
+        a->data[off] = JOURNAL_OBJECT_ENTRY;
+        put_u64(a, off + 8, 64);
+        put_u64(a, off + 16, k + 1);
+        put_u64(a, off + 24, e[k].realtime);
+        put_u64(a, off + 32, e[k].monotonic);
+        memset(a->data + off + 40, e[k].boot, 16);
+    }
+
+    while (i < n) {
+        off = grow(a, 24 + cap * item);
+        a->data[off] = JOURNAL_OBJECT_ENTRY_ARRAY;
+        put_u64(a, off + 8, 24 + cap * item);
+        for (k = 0; k < cap && i < n; k++, i++) {
+            if (compact)
+                put_u32(a, off + 24 + k * 4, offs[i]);
+            else
+                put_u64(a, off + 24 + k * 8, offs[i]);
+        }
+        if (prev)
+            put_u64(a, prev + 16, off);
+        else
+            put_u64(a, 176, off);
+        prev = off;
+        cap *= 2;
+    }
+
+    g_assert_true(g_file_set_contents(path, (gchar *)a->data, a->len, NULL));
+    g_byte_array_free(a, TRUE);
+    g_free(offs);
+}
+
+/* a boot's entries, the first one after some seconds of uptime */
+static guint add_boot(jentry *e, guchar boot, time_t booted, guint64 first, guint n)
+{
+    guint k;
+
+    for (k = 0; k < n; k++) {
+        e[k].boot = boot;
+        e[k].monotonic = (first + k * 60) * G_USEC_PER_SEC + 250000;
+        e[k].realtime = (guint64)booted * G_USEC_PER_SEC + e[k].monotonic;
+    }
+    return n;
+}
+
+static void write_wtmp(const gchar *path)
+{
+    static const struct {
+        short type;
+        time_t t;
+        const gchar *user, *host;
+    } rec[] = {
+        { BOOT_TIME, T_WTMP_ONLY, "reboot", "6.5.0-14-generic" },
+        { RUN_LVL, T_WTMP_ONLY + 20, "runlevel", "6.5.0-14-generic" },
+        { USER_PROCESS, T_WTMP_ONLY + 60, "user", ":0" },
+        { BOOT_TIME, T_CURRENT, "reboot", "6.5.0-15-generic" },
+        { USER_PROCESS, T_CURRENT + 60, "user", ":0" },
+    };
+    struct utmp u[G_N_ELEMENTS(rec)];
+    guint i;
+
+    memset(u, 0, sizeof(u));
+    for (i = 0; i < G_N_ELEMENTS(rec); i++) {
+        u[i].ut_type = rec[i].type;
+        u[i].ut_tv.tv_sec = rec[i].t;
+        strncpy(u[i].ut_user, rec[i].user, sizeof(u[i].ut_user));
+        strncpy(u[i].ut_host, rec[i].host, sizeof(u[i].ut_host));
+    }
+    g_assert_true(g_file_set_contents(path, (gchar *)u, sizeof(u), NULL));
+}
+
+static void write_journals(void)
+{
+    gchar *dir = g_build_filename(fake_journal, MACHINE_ID, NULL), *path;
+    jentry e[64];
+    guint n;
+
+    g_mkdir_with_parents(dir, 0755);
+
+    /* archived: an older boot, and the start of what is left of this one */
+    n = add_boot(e, 0xa0, T_JOURNAL_ONLY, 5, 7);
+    n += add_boot(e + n, 0xc0, T_CURRENT, 3 * DAY, 3);
+    path = g_build_filename(dir, "system@0123456789abcdef-0000000000000001-00060a1b2c3d4e5f.journal", NULL);
+    write_journal(path, TRUE, e, n);
+    g_free(path);
+
+    /* active: the rest of this boot, over a few entry arrays */
+    n = add_boot(e, 0xc0, T_CURRENT, 3 * DAY + 600, 40);
+    path = g_build_filename(dir, "system.journal", NULL);
+    write_journal(path, FALSE, e, n);
+    g_free(path);
+    g_free(dir);
+
+    /* another installation's journal in the same root */
+    dir = g_build_filename(fake_journal, OTHER_MACHINE_ID, NULL);
+    g_mkdir_with_parents(dir, 0755);
+    n = add_boot(e, 0xf0, T_OTHER_MACHINE, 5, 3);
+    path = g_build_filename(dir, "system.journal", NULL);
+    write_journal(path, FALSE, e, n);
+    g_free(path);
+    g_free(dir);
+}
+
+static void free_boots(GArray *boots)
+{
+    guint i;
+
+    for (i = 0; i < boots->len; i++)
+        g_free(g_array_index(boots, boot_entry, i).kernel);
+    g_array_free(boots, TRUE);
+}
+
+/* the current boot is found in both and listed once, at its wtmp time */
+static void test_vacuumed(void)
+{
+    GArray *boots = boots_collect(0);
+    boot_entry *b;
+
+    g_assert_cmpuint(boots->len, ==, 3);
+    b = &g_array_index(boots, boot_entry, 0);
+    g_assert_cmpint(b->time, ==, T_CURRENT);
+    g_assert_cmpstr(b->kernel, ==, "6.5.0-15-generic");
+    b = &g_array_index(boots, boot_entry, 1);
+    g_assert_cmpint(b->time, ==, T_WTMP_ONLY);
+    g_assert_cmpstr(b->kernel, ==, "6.5.0-14-generic");
+    b = &g_array_index(boots, boot_entry, 2);
+    g_assert_cmpint(b->time, ==, T_JOURNAL_ONLY);
+    g_assert_null(b->kernel);
+
+    free_boots(boots);
+}
+
+static void test_max(void)
+{
+    GArray *boots = boots_collect(2);
+
+    g_assert_cmpuint(boots->len, ==, 2);
+    g_assert_cmpint(g_array_index(boots, boot_entry, 0).time, ==, T_CURRENT);
+    g_assert_cmpint(g_array_index(boots, boot_entry, 1).time, ==, T_WTMP_ONLY);
+    free_boots(boots);
+}
+
+/* without wtmp the journal alone has the boot times, not the first entries' */
+static void test_journal_only(void)
+{
+    gchar *wtmp = fake_wtmp;
+    GArray *boots;
+
+    fake_wtmp = g_build_filename(tmp_dir, "no-wtmp", NULL);
+    boots = boots_collect(0);
+    g_assert_cmpuint(boots->len, ==, 2);
+    g_assert_cmpint(g_array_index(boots, boot_entry, 0).time, ==, T_CURRENT);
+    g_assert_cmpint(g_array_index(boots, boot_entry, 1).time, ==, T_JOURNAL_ONLY);
+    free_boots(boots);
+
+    g_free(fake_wtmp);
+    fake_wtmp = wtmp;
+}
+
+static void rm_rf(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+
+    if (dir) {
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+
+            rm_rf(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+        g_rmdir(path);
+    } else {
+        g_unlink(path);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    tmp_dir = g_dir_make_tmp("test_boots-XXXXXX", NULL);
+    g_assert(tmp_dir != NULL);
+    fake_wtmp = g_build_filename(tmp_dir, "wtmp", NULL);
+    fake_machine_id = g_build_filename(tmp_dir, "machine-id", NULL);
+    fake_journal = g_build_filename(tmp_dir, "journal", NULL);
+
+    write_wtmp(fake_wtmp);
+    g_file_set_contents(fake_machine_id, MACHINE_ID "\n", -1, NULL);
+    write_journals();
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/boots/vacuumed", test_vacuumed);
+    g_test_add_func("/boots/max", test_max);
+    g_test_add_func("/boots/journal-only", test_journal_only);
+    ret = g_test_run();
+
+    rm_rf(tmp_dir);
+    g_free(tmp_dir);
+    g_free(fake_wtmp);
+    g_free(fake_machine_id);
+    g_free(fake_journal);
+    return ret;
+}
@@ -0,0 +1,358 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * The daemon on its own thread, serving a synthetic module on a socket in
+ * a temporary XDG_RUNTIME_DIR: requests and replies round trip, reports
+ * come from the pages as held, and clients that don't read, hang up early
+ * or send endless lines don't hold up the others.
+ */
+
+/* short enough for the stalled client test to be quick */
+#define DAEMON_IO_TIMEOUT 1000
+
+#include "../hardinfo2/daemon.c"
+#include <iconcache.h>
+#include <inventory.h>
+#include "uri_handler.h"
+
+/* what report.c and daemon.c need from the rest of hardinfo2; pages here
+ * only use plain keys, so the key helpers never see flags */
+gboolean key_is_flagged(const gchar *key) { return FALSE; }
+gboolean key_is_highlighted(const gchar *key) { return FALSE; }
+gboolean key_wants_details(const gchar *key) { return FALSE; }
+gchar *key_mi_tag(const gchar *key) { return NULL; }
+const gchar *key_get_name(const gchar *key) { return key; }
+void key_get_components(const gchar *key, gchar **flags, gchar **tag,
+                        gchar **name, gchar **label, gchar **dis)
+{
+    if (name)
+        *name = g_strdup(key);
+    if (label) {
+        *label = g_strdup(key);
+        strend(*label, '#');
+    }
+}
+
+void module_entry_reload(ShellModuleEntry *entry) { entry->scan_func(TRUE); }
+void module_entry_scan(ShellModuleEntry *entry) { entry->scan_func(FALSE); }
+gchar *module_entry_function(ShellModuleEntry *entry) { return entry->func(); }
+gchar *module_entry_get_moreinfo(ShellModuleEntry *entry, gchar *field) { return NULL; }
+
+gchar *inventory_entry_id(ShellModule *module, ShellModuleEntry *entry) { return NULL; }
+gchar *inventory_entry_token(ShellModuleEntry *entry) { return NULL; }
+gchar *inventory_get(const gchar *id, const gchar *token) { return NULL; }
+gchar *inventory_get_moreinfo(const gchar *id, const gchar *tag) { return NULL; }
+void inventory_put(const gchar *id, const gchar *token, const gchar *data) { }
+void inventory_put_moreinfo(const gchar *id, const gchar *tag, const gchar *data) { }
+
+void file_chooser_open_expander(GtkWidget *chooser) { }
+void file_chooser_add_filters(GtkWidget *chooser, FileTypes *filters) { }
+gchar *file_chooser_get_extension(GtkWidget *chooser, FileTypes *filters) { return NULL; }
+gchar *file_chooser_build_filename(GtkWidget *chooser, gchar *extension) { return NULL; }
+gpointer file_types_get_data_by_name(FileTypes *file_types, gchar *name) { return NULL; }
+GdkPixbuf *icon_cache_get_pixbuf(const gchar *file) { return NULL; }
+GtkWidget *icon_cache_get_image_at_size(const gchar *file, gint wid, gint hei) { return NULL; }
+Shell *shell_get_main_shell() { return NULL; }
+void shell_status_set_enabled(gboolean setting) { }
+void shell_view_set_enabled(gboolean setting) { }
+gboolean uri_open(const gchar *uri) { return FALSE; }
+
+/* rows on the static page, so that a few reports outgrow the socket buffers */
+#define FILLER_ROWS 1024
+
+static gint static_scans, live_reloads;
+
+static void static_scan(gboolean reload)
+{
+    SCAN_START();
+    g_atomic_int_inc(&static_scans);
+    scanned = TRUE;
+}
+
+static gchar *static_page(void)
+{
+    GString *page = g_string_new(NULL);
+    gint row;
+
+    g_string_append_printf(page, "[Info]\nScans=%d\n[Filler]\n",
+                           g_atomic_int_get(&static_scans));
+    for (row = 0; row < FILLER_ROWS; row++)
+        g_string_append_printf(page, "Row %d=value %d, padded to look like a device\n",
+                               row, row * 7);
+
+    return g_string_free(page, FALSE);
+}
+
+static void live_scan(gboolean reload)
+{
+    g_atomic_int_inc(&live_reloads);
+}
+
+static gchar *live_page(void)
+{
+    return g_strdup_printf("[$ShellParam$]\nReloadInterval=50\n[Load]\nReloads=%d\n",
+                           g_atomic_int_get(&live_reloads));
+}
+
+static GSList *synthetic_modules(void)
+{
+    ShellModule *module = g_new0(ShellModule, 1);
+    ShellModuleEntry *entry;
+
+    module->name = "Synthetic";
+    /* named "main" by g_module_name() */
+    module->dll = g_module_open(NULL, 0);
+
+    entry = g_new0(ShellModuleEntry, 1);
+    entry->name = "Static";
+    entry->icon_file = "";
+    entry->func = static_page;
+    entry->scan_func = static_scan;
+    module->entries = g_slist_append(module->entries, entry);
+
+    entry = g_new0(ShellModuleEntry, 1);
+    entry->name = "Live";
+    entry->icon_file = "";
+    entry->number = 1;
+    entry->func = live_page;
+    entry->scan_func = live_scan;
+    module->entries = g_slist_append(module->entries, entry);
+
+    return g_slist_append(NULL, module);
+}
+
+static int client_connect(void)
+{
+    gchar *path = daemon_socket_path();
+    Socket *s = sock_connect_unix(path);
+    int fd;
+
+    /* a plain blocking fd; sock_close() would shut it down */
+    g_assert(s != NULL);
+    fd = s->sock;
+    g_free(s);
+    g_free(path);
+
+    return fd;
+}
+
+/* everything the daemon sends until it hangs up */
+static GString *read_to_eof(int fd)
+{
+    GString *got = g_string_new(NULL);
+    gchar buf[4096];
+    ssize_t n;
+
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+        g_string_append_len(got, buf, n);
+
+    return got;
+}
+
+static void test_list(void)
+{
+    gchar *list = daemon_request("LIST");
+
+    g_assert_cmpstr(list, ==, "main/0\tStatic\nmain/1\tLive\n");
+    g_free(list);
+
+    g_assert_null(daemon_request("GET main/7"));
+    g_assert_null(daemon_request("FROB main/0"));
+}
+
+static void test_get(void)
+{
+    gchar *page = daemon_request("GET main/0"), *value;
+
+    g_assert(page != NULL);
+    g_assert(strstr(page, "Row 1023=value 7161") != NULL);
+    g_free(page);
+
+    value = daemon_request("FIELD main/0 Row 3");
+    g_assert_cmpstr(value, ==, "value 21, padded to look like a device");
+    g_free(value);
+}
+
+static void test_report_held(void)
+{
+    gint scans = g_atomic_int_get(&static_scans);
+    gchar *report;
+    gint i;
+
+    /* scanned once at start, and not again for every report */
+    g_assert_cmpint(scans, ==, 1);
+    for (i = 0; i < 3; i++) {
+        report = daemon_request("REPORT text");
+        g_assert(report != NULL);
+        g_assert(strstr(report, "Static") != NULL);
+        g_assert(strstr(report, "Row 1023") != NULL);
+        g_free(report);
+    }
+    report = daemon_request("REPORT shell all");
+    g_assert(report != NULL);
+    g_free(report);
+    g_assert_cmpint(g_atomic_int_get(&static_scans), ==, scans);
+
+    /* unless asked to */
+    report = daemon_request("REPORT text reload");
+    g_assert(report != NULL);
+    g_free(report);
+    g_assert_cmpint(g_atomic_int_get(&static_scans), ==, scans + 1);
+
+    g_assert_null(daemon_request("REPORT text fresh"));
+}
+
+static void test_sampling(void)
+{
+    gint reloads = g_atomic_int_get(&live_reloads);
+
+    /* the ReloadInterval page keeps being rescanned on its own */
+    g_usleep(300 * 1000);
+    g_assert_cmpint(g_atomic_int_get(&live_reloads), >, reloads + 2);
+}
+
+static void test_hangup(void)
+{
+    int fd = client_connect();
+    GString *got;
+
+    /* a request and a hang up in one go still gets its reply */
+    g_assert_cmpint(write(fd, "REPORT\n", 7), ==, 7);
+    shutdown(fd, SHUT_WR);
+    got = read_to_eof(fd);
+    g_assert(g_str_has_prefix(got->str, "OK "));
+    g_assert(strstr(got->str, "Row 1023") != NULL);
+    g_string_free(got, TRUE);
+    close(fd);
+}
+
+static void test_long_line(void)
+{
+    int fd = client_connect();
+    gchar *line = g_strnfill(3 * DAEMON_MAX_LINE, 'x');
+    GString *got;
+
+    g_assert_cmpint(write(fd, line, strlen(line)), ==, strlen(line));
+    got = read_to_eof(fd);
+    g_assert_cmpstr(got->str, ==, "ERR request too long\n");
+    g_string_free(got, TRUE);
+    g_free(line);
+    close(fd);
+}
+
+static void test_slow_client(void)
+{
+    static const gchar requests[] = "REPORT\nREPORT\nREPORT\nREPORT\nREPORT\nREPORT\nREPORT\nREPORT\n";
+    gchar *report = daemon_request("REPORT");
+    int fd = client_connect(), rcvbuf = 4096;
+    gsize all;
+    gint64 start;
+    gchar *list;
+    GString *got;
+
+    g_assert(report != NULL);
+    all = 8 * strlen(report);
+    g_free(report);
+
+    /* asks for far more than the socket buffers hold, and reads nothing */
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    g_assert_cmpint(write(fd, requests, strlen(requests)), ==, strlen(requests));
+    g_usleep(100 * 1000);
+
+    /* others are served without waiting on it */
+    start = daemon_now_ms();
+    list = daemon_request("LIST");
+    g_assert(list != NULL);
+    g_assert_cmpint(daemon_now_ms() - start, <, DAEMON_IO_TIMEOUT / 2);
+    g_free(list);
+
+    /* and once it has taken nothing for a while, it is dropped */
+    g_usleep(DAEMON_IO_TIMEOUT * 2500);
+    got = read_to_eof(fd);
+    g_assert(g_str_has_prefix(got->str, "OK "));
+    g_assert_cmpint(got->len, >, 0);
+    g_assert_cmpint(got->len, <, all);
+    g_string_free(got, TRUE);
+    close(fd);
+
+    list = daemon_request("LIST");
+    g_assert(list != NULL);
+    g_free(list);
+}
+
+static gpointer daemon_thread(gpointer data)
+{
+    return GINT_TO_POINTER(daemon_run(data));
+}
+
+static void rm_rf(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+
+    if (dir) {
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+
+            rm_rf(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+        g_rmdir(path);
+    } else {
+        g_unlink(path);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    gchar *tmp_dir, *list = NULL;
+    GThread *thread;
+    gint tries, ret;
+
+    tmp_dir = g_dir_make_tmp("test_daemon-XXXXXX", NULL);
+    g_assert(tmp_dir != NULL);
+    /* before anything asks GLib for the runtime dir */
+    g_setenv("XDG_RUNTIME_DIR", tmp_dir, TRUE);
+
+    g_test_init(&argc, &argv, NULL);
+    params.quiet = TRUE;
+
+    thread = g_thread_new("daemon", daemon_thread, synthetic_modules());
+    for (tries = 0; tries < 100 && !(list = daemon_request("LIST")); tries++)
+        g_usleep(50 * 1000);
+    g_assert(list != NULL);
+    g_free(list);
+
+    g_test_add_func("/daemon/list", test_list);
+    g_test_add_func("/daemon/get", test_get);
+    g_test_add_func("/daemon/report/held", test_report_held);
+    g_test_add_func("/daemon/sampling", test_sampling);
+    g_test_add_func("/daemon/client/hangup", test_hangup);
+    g_test_add_func("/daemon/client/long-line", test_long_line);
+    g_test_add_func("/daemon/client/slow", test_slow_client);
+    ret = g_test_run();
+
+    g_idle_add(daemon_quit, NULL);
+    g_assert_cmpint(GPOINTER_TO_INT(g_thread_join(thread)), ==, 0);
+
+    rm_rf(tmp_dir);
+    g_free(tmp_dir);
+    return ret;
+}
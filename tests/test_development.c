@@ -0,0 +1,158 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Toolchain probes, run against stub scripts on PATH: one that answers and
+ * exits, one that closes its output and keeps running, one that never
+ * stops writing. The scan has to finish on its deadline either way, with
+ * nothing left running and only the clean answers cached.
+ */
+
+#define DEV_TIMEOUT_MS 1000
+#include "../modules/computer/development.c"
+#include <glib/gstdio.h>
+
+static gchar *tmp_dir;
+
+static void write_script(const gchar *name, const gchar *body)
+{
+    gchar *path = g_build_filename(tmp_dir, "bin", name, NULL);
+    gchar *script = g_strdup_printf("#!/bin/sh\necho $$ > \"$0.pid\"\n%s", body);
+
+    g_assert_true(g_file_set_contents(path, script, -1, NULL));
+    g_assert_cmpint(chmod(path, 0755), ==, 0);
+    g_free(script);
+    g_free(path);
+}
+
+static pid_t script_pid(const gchar *name)
+{
+    gchar *path = g_strdup_printf("%s/bin/%s.pid", tmp_dir, name);
+    gchar *buf = NULL;
+    pid_t pid = 0;
+
+    if (g_file_get_contents(path, &buf, NULL, NULL))
+        pid = atoi(buf);
+    g_free(buf);
+    g_free(path);
+    return pid;
+}
+
+static void rm_rf(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+
+    if (dir) {
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+
+            rm_rf(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+        g_rmdir(path);
+    } else {
+        g_unlink(path);
+    }
+}
+
+static void test_reap(void)
+{
+    gchar *sleep_cmd = g_find_program_in_path("sleep");
+    gchar *body, *cache_path, *cache = NULL, *bin, *pid_file;
+    gint64 start;
+    pid_t pid;
+
+    g_assert(sleep_cmd != NULL);
+
+    bin = g_build_filename(tmp_dir, "bin", NULL);
+    g_assert_cmpint(g_mkdir_with_parents(bin, 0755), ==, 0);
+    g_setenv("PATH", bin, TRUE);
+
+    write_script("gcc", "echo 'gcc (GCC) 12.3.0'\n");
+    /* version, then stdout closed while it goes on running */
+    body = g_strdup_printf("echo 'Python 3.11.2'\nexec >&-\nexec %s 60\n", sleep_cmd);
+    write_script("python3", body);
+    g_free(body);
+    /* version, then stdout held open */
+    body = g_strdup_printf("echo 'GNU Make 4.3'\nexec %s 60\n", sleep_cmd);
+    write_script("make", body);
+    g_free(body);
+
+    start = now_ms();
+    scan_dev(TRUE);
+    g_assert_cmpint(now_ms() - start, <, DEV_TIMEOUT_MS + 2000);
+
+    g_assert(strstr(dev_list, "C (GCC)=12.3.0\n") != NULL);
+    g_assert(strstr(dev_list, "Python3=3.11.2\n") != NULL);
+    g_assert(strstr(dev_list, "make=4.3\n") != NULL);
+
+    /* killed and reaped, not left behind */
+    pid = script_pid("python3");
+    g_assert_cmpint(pid, >, 0);
+    g_assert_cmpint(kill(pid, 0), ==, -1);
+    pid = script_pid("make");
+    g_assert_cmpint(pid, >, 0);
+    g_assert_cmpint(kill(pid, 0), ==, -1);
+
+    /* only the probe that finished on its own is cached */
+    cache_path = dev_cache_path();
+    g_assert_true(g_file_get_contents(cache_path, &cache, NULL, NULL));
+    g_assert(strstr(cache, "[gcc --version]") != NULL);
+    g_assert(strstr(cache, "[python3 -V]") == NULL);
+    g_assert(strstr(cache, "[make --version]") == NULL);
+
+    /* and answers the next scan without running it */
+    pid_file = g_strdup_printf("%s/bin/gcc.pid", tmp_dir);
+    g_unlink(pid_file);
+    g_free(pid_file);
+    scan_dev(TRUE);
+    g_assert(strstr(dev_list, "C (GCC)=12.3.0\n") != NULL);
+    g_assert_cmpint(script_pid("gcc"), ==, 0);
+
+    g_free(cache);
+    g_free(cache_path);
+    g_free(bin);
+    g_free(sleep_cmd);
+}
+
+int main(int argc, char **argv)
+{
+    gchar *config;
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    tmp_dir = g_dir_make_tmp("test_development-XXXXXX", NULL);
+    g_assert(tmp_dir != NULL);
+    config = g_build_filename(tmp_dir, "config", NULL);
+    g_setenv("XDG_CONFIG_HOME", config, TRUE);
+    g_mkdir_with_parents(config, 0755);
+    g_free(config);
+    config = g_build_filename(tmp_dir, "config", "hardinfo2", NULL);
+    g_mkdir_with_parents(config, 0755);
+    g_free(config);
+
+    g_test_add_func("/development/reap", test_reap);
+    ret = g_test_run();
+
+    rm_rf(tmp_dir);
+    g_free(tmp_dir);
+    return ret;
+}
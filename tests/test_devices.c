@@ -0,0 +1,284 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * The PCI and USB enumerators run against fixtures/sysfs/desktop, a copy of
+ * /sys as --sysfs would be given one, trimmed to a Coffee Lake desktop's host
+ * bridge, PCIe port, audio and a runtime-suspended GeForce, a root hub, a
+ * Logitech receiver and a suspended SanDisk stick. fixtures/sysfs/modules is
+ * its --modules directory, fixtures/sysfs/ids has the matching pci.ids and
+ * usb.ids lines.
+ */
+
+#include <glib/gstdio.h>
+
+/* for the static alias cache, reset between --modules settings */
+#include "../hardinfo2/pci_util.c"
+#include "usb_util.h"
+
+/* the same as util.c */
+gchar *h_sysfs_path(const gchar *path)
+{
+    return g_build_filename(params.path_sysfs ? params.path_sysfs : "/sys", path, NULL);
+}
+
+gint h_sysfs_read_int(const gchar *endpoint, const gchar *entry)
+{
+    gchar *tmp = g_build_filename(endpoint, entry, NULL), *buffer = NULL;
+    gint ret = 0;
+
+    if (g_file_get_contents(tmp, &buffer, NULL, NULL))
+        ret = atoi(buffer);
+    g_free(tmp);
+    g_free(buffer);
+    return ret;
+}
+
+gint h_sysfs_read_hex(const gchar *endpoint, const gchar *entry)
+{
+    gchar *tmp = g_build_filename(endpoint, entry, NULL), *buffer = NULL;
+    gint ret = 0;
+
+    if (g_file_get_contents(tmp, &buffer, NULL, NULL))
+        ret = (gint)strtoll(buffer, NULL, 16);
+    g_free(tmp);
+    g_free(buffer);
+    return ret;
+}
+
+gchar *h_sysfs_read_string(const gchar *endpoint, const gchar *entry)
+{
+    gchar *tmp = g_build_filename(endpoint, entry, NULL), *ret = NULL;
+
+    if (g_file_get_contents(tmp, &ret, NULL, NULL))
+        g_strstrip(ret);
+    g_free(tmp);
+    return ret;
+}
+
+/* what vendor.c would find without vendor.ids: nothing */
+vendor_list vendors_match(const gchar *id_str, ...) { return NULL; }
+vendor_list vendor_list_remove_duplicates_deep(vendor_list vl) { return vl; }
+
+static gchar *tmp_dir;
+
+static void reset_aliases(void)
+{
+    if (pci_aliases)
+        g_ptr_array_free(pci_aliases, TRUE);
+    if (pci_alias_modules)
+        g_hash_table_destroy(pci_alias_modules);
+    pci_aliases = NULL;
+    pci_alias_modules = NULL;
+}
+
+static pcid *find_pcid(pcid_list list, const gchar *slot)
+{
+    for (; list; list = list->next) {
+        pcid *d = list->data;
+        if (SEQ(d->slot_str, slot))
+            return d;
+    }
+    return NULL;
+}
+
+static void test_pci_list(void)
+{
+    pcid_list list, gpus;
+    pcid *d;
+
+    reset_aliases();
+    list = pci_get_device_list(0, 0);
+    g_assert_cmpuint(g_slist_length(list), ==, 4);
+
+    d = find_pcid(list, "0000:00:00.0");
+    g_assert_nonnull(d);
+    g_assert_cmphex(d->vendor_id, ==, 0x8086);
+    g_assert_cmphex(d->device_id, ==, 0x3e30);
+    g_assert_cmphex(d->sub_vendor_id, ==, 0x1462);
+    g_assert_cmphex(d->sub_device_id, ==, 0x7b17);
+    g_assert_cmphex(d->class, ==, 0x0600);
+    g_assert_cmphex(d->revision, ==, 0x0d);
+    g_assert_cmpstr(d->vendor_id_str, ==, "Intel Corporation");
+    g_assert_cmpstr(d->sub_device_id_str, ==, "MPG Z390 GAMING PLUS");
+    g_assert_cmpstr(d->class_str, ==, "Host bridge");
+    g_assert_cmpstr(d->driver, ==, "skl_uncore");
+    g_assert_cmpstr(d->driver_list, ==, "skl_uncore");
+    g_assert_cmpstr(d->runtime_status, ==, "active");
+
+    /* a bridge: subsystem ids aren't in the header */
+    d = find_pcid(list, "0000:00:01.0");
+    g_assert_nonnull(d);
+    g_assert_cmphex(d->class, ==, 0x0604);
+    g_assert_cmphex(d->sub_vendor_id, ==, 0x1462);
+    g_assert_cmphex(d->sub_device_id, ==, 0x7b17);
+    g_assert_cmpstr(d->driver, ==, "pcieport");
+    g_assert_cmpstr(d->driver_list, ==, "shpchp");
+    g_assert_cmpfloat(d->pcie_speed_max, ==, 8.0);
+    g_assert_cmpuint(d->pcie_width_curr, ==, 16);
+
+    /* every module whose pattern matches, once, in modules.alias order */
+    d = find_pcid(list, "0000:00:1f.3");
+    g_assert_nonnull(d);
+    g_assert_cmpstr(d->class_str, ==, "Audio device");
+    g_assert_cmpstr(d->driver, ==, "snd_hda_intel");
+    g_assert_cmpstr(d->driver_list, ==, "snd_hda_intel, snd_sof_pci_intel_cnl");
+
+    /* suspended: ids come from the attribute files, config isn't read */
+    d = find_pcid(list, "0000:01:00.0");
+    g_assert_nonnull(d);
+    g_assert_cmphex(d->vendor_id, ==, 0x10de);
+    g_assert_cmphex(d->device_id, ==, 0x1c82);
+    g_assert_cmphex(d->class, ==, 0x0300);
+    g_assert_cmphex(d->revision, ==, 0xa1);
+    g_assert_cmpstr(d->device_id_str, ==, "GP107 [GeForce GTX 1050 Ti]");
+    g_assert_cmpstr(d->runtime_status, ==, "suspended");
+    g_assert_cmpstr(d->power_state, ==, "D3cold");
+    g_assert_cmpstr(d->driver, ==, "nouveau");
+    g_assert_cmpstr(d->driver_list, ==, "nouveau, nvidiafb");
+    g_assert_cmpfloat(d->pcie_speed_curr, ==, 2.5);
+    g_assert_cmpuint(d->pcie_width_curr, ==, 8);
+
+    gpus = pci_get_device_list(0x300, 0x3ff);
+    g_assert_cmpuint(g_slist_length(gpus), ==, 1);
+    g_assert_cmpstr(((pcid *)gpus->data)->slot_str, ==, "0000:01:00.0");
+
+    pcid_list_free(gpus);
+    pcid_list_free(list);
+}
+
+/* a --sysfs copy without --modules must not be matched against
+ * this machine's modules.alias */
+static void test_pci_no_modules(void)
+{
+    gchar *modules = params.path_modules;
+    pcid *d;
+
+    reset_aliases();
+    params.path_modules = NULL;
+    d = pci_get_device_str("0000:00:1f.3");
+    g_assert_nonnull(d);
+    g_assert_cmpstr(d->driver, ==, "snd_hda_intel");
+    g_assert_null(d->driver_list);
+    pcid_free(d);
+
+    params.path_modules = modules;
+    reset_aliases();
+}
+
+static void test_usb_list(void)
+{
+    usbd *list = usb_get_device_list(), *u;
+    usbi *i;
+
+    g_assert_cmpint(usbd_list_count(list), ==, 3);
+
+    /* sorted by bus and device */
+    u = list;
+    g_assert_cmpint(u->bus, ==, 1);
+    g_assert_cmpint(u->dev, ==, 1);
+    g_assert_cmphex(u->vendor_id, ==, 0x1d6b);
+    g_assert_cmpstr(u->product, ==, "2.0 root hub");
+    g_assert_cmpstr(u->dev_class_str, ==, "Hub");
+    g_assert_cmpstr(u->device_version, ==, "6.08");
+    g_assert_cmpstr(u->driver, ==, "usb");
+
+    u = u->next;
+    g_assert_cmpint(u->bus, ==, 1);
+    g_assert_cmpint(u->dev, ==, 2);
+    g_assert_cmphex(u->product_id, ==, 0xc52b);
+    g_assert_cmpstr(u->vendor, ==, "Logitech, Inc.");
+    g_assert_cmpstr(u->product, ==, "Unifying Receiver");
+    g_assert_cmpstr(u->manufacturer, ==, "Logitech");
+    g_assert_cmpstr(u->device, ==, "USB Receiver");
+    g_assert_cmpstr(u->usb_version, ==, "2.00");
+    g_assert_cmpstr(u->device_version, ==, "12.11");
+    g_assert_cmpint(u->speed_mbs, ==, 12);
+    g_assert_cmpint(u->max_curr_ma, ==, 98);
+    g_assert_cmpstr(u->power_state, ==, "active");
+    i = u->if_list;
+    g_assert_nonnull(i);
+    g_assert_cmpint(i->if_number, ==, 0);
+    g_assert_cmpstr(i->driver, ==, "usbhid");
+    g_assert_cmpstr(i->if_class_str, ==, "Human Interface Device");
+    g_assert_cmpstr(i->if_protocol_str, ==, "Keyboard");
+    i = i->next;
+    g_assert_nonnull(i);
+    g_assert_cmpstr(i->if_protocol_str, ==, "Mouse");
+    i = i->next;
+    g_assert_nonnull(i);
+    g_assert_cmpint(i->if_number, ==, 2);
+    g_assert_null(i->next);
+
+    u = u->next;
+    g_assert_cmpint(u->bus, ==, 2);
+    g_assert_cmpint(u->dev, ==, 3);
+    g_assert_cmpstr(u->product, ==, "Ultra Fit");
+    g_assert_cmpstr(u->serial, ==, "4C530001130825117332");
+    g_assert_cmpint(u->speed_mbs, ==, 5000);
+    g_assert_cmpstr(u->power_state, ==, "suspended");
+    g_assert_cmpstr(u->if_list->driver, ==, "usb-storage");
+    g_assert_cmpstr(u->if_list->if_protocol_str, ==, "Bulk-Only");
+    g_assert_null(u->next);
+
+    usbd_list_free(list);
+}
+
+static void rm_rf(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+
+    if (dir) {
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+
+            rm_rf(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+        g_rmdir(path);
+    } else {
+        g_unlink(path);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    tmp_dir = g_dir_make_tmp("test_devices-XXXXXX", NULL);
+    g_assert(tmp_dir != NULL);
+    /* no user pci.ids or usb.ids */
+    g_setenv("XDG_CONFIG_HOME", tmp_dir, TRUE);
+
+    params.path_sysfs = FIXTURES_DIR "/sysfs/desktop";
+    params.path_modules = FIXTURES_DIR "/sysfs/modules";
+    params.path_data = FIXTURES_DIR "/sysfs/ids";
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/devices/pci/list", test_pci_list);
+    g_test_add_func("/devices/pci/no-modules", test_pci_no_modules);
+    g_test_add_func("/devices/usb/list", test_usb_list);
+    ret = g_test_run();
+
+    rm_rf(tmp_dir);
+    g_free(tmp_dir);
+    return ret;
+}
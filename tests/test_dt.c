@@ -0,0 +1,271 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * The flattened device tree parser against the directory tree the kernel
+ * unpacks from the same blob. fixtures/dt/<board>.dtb and fixtures/dt/<board>/
+ * hold both forms, <board>.dts is the source they were built from: a
+ * Raspberry Pi 4 (64-bit cells, operating-points-v2, __symbols__) and an
+ * i.MX6 Wandboard (operating-points v1, no __symbols__).
+ */
+
+#include <glib/gstdio.h>
+
+/* where dtr_find_device_tree_root() looks, moved under tmp_dir */
+static gchar *fake_fdt, *fake_proc, *fake_sysfs;
+#define DTR_FDT_PATH fake_fdt
+#define DTR_PROC_PATH fake_proc
+#define DTR_SYSFS_PATH fake_sysfs
+
+#include "../hardinfo2/dt_util.c"
+
+static gchar *tmp_dir;
+
+static const gchar *boards[] = { "rpi4", "imx6q-wandboard" };
+
+static gint cmp_names(gconstpointer a, gconstpointer b)
+{
+    return strcmp(*(const gchar **)a, *(const gchar **)b);
+}
+
+static gchar *child_path(const gchar *np, const gchar *name)
+{
+    if (strcmp(np, "/") == 0)
+        return g_strdup_printf("/%s", name);
+    return g_strdup_printf("%s/%s", np, name);
+}
+
+/* walk both trees from np, everything must read back the same */
+static guint compare_node(dtr *fdt, dtr *dir, const gchar *np)
+{
+    gchar **fc = dtr_children(fdt, np, 0);
+    gchar **dc = dtr_children(dir, np, 0);
+    guint i, n = 0;
+
+    g_assert_nonnull(fc);
+    g_assert_nonnull(dc);
+    g_assert_cmpuint(g_strv_length(fc), ==, g_strv_length(dc));
+    qsort(fc, g_strv_length(fc), sizeof(gchar *), cmp_names);
+    qsort(dc, g_strv_length(dc), sizeof(gchar *), cmp_names);
+
+    for (i = 0; fc[i]; i++) {
+        gchar *path = child_path(np, fc[i]);
+        dtr_obj *fo, *doj;
+        gchar *fs, *ds;
+
+        g_assert_cmpstr(fc[i], ==, dc[i]);
+        fo = dtr_obj_read(fdt, path);
+        doj = dtr_obj_read(dir, path);
+        g_assert_nonnull(fo);
+        g_assert_nonnull(doj);
+
+        g_assert_cmpint(dtr_obj_type(fo), ==, dtr_obj_type(doj));
+        g_assert_cmpstr(dtr_obj_alias(fo), ==, dtr_obj_alias(doj));
+        g_assert_cmpstr(dtr_obj_symbol(fo), ==, dtr_obj_symbol(doj));
+        if (dtr_obj_type(fo) == DT_NODE) {
+            n += compare_node(fdt, dir, path);
+        } else {
+            g_assert_cmpuint(fo->length, ==, doj->length);
+            g_assert_true(memcmp(fo->data, doj->data, fo->length) == 0);
+            fs = dtr_str(fo);
+            ds = dtr_str(doj);
+            g_assert_cmpstr(fs, ==, ds);
+            g_free(fs);
+            g_free(ds);
+        }
+        n++;
+
+        dtr_obj_free(fo);
+        dtr_obj_free(doj);
+        g_free(path);
+    }
+
+    g_strfreev(fc);
+    g_strfreev(dc);
+    return n;
+}
+
+static void open_board(const gchar *board, dtr **fdt, dtr **dir)
+{
+    gchar *blob = g_strdup_printf("%s/dt/%s.dtb", FIXTURES_DIR, board);
+    gchar *tree = g_strdup_printf("%s/dt/%s", FIXTURES_DIR, board);
+
+    *fdt = dtr_new(blob);
+    *dir = dtr_new(tree);
+    g_assert_true(dtr_was_found(*fdt));
+    g_assert_true(dtr_was_found(*dir));
+    g_assert_nonnull((*fdt)->fdt);
+    g_assert_null((*dir)->fdt);
+
+    g_free(blob);
+    g_free(tree);
+}
+
+static void test_compare(void)
+{
+    guint b;
+
+    for (b = 0; b < G_N_ELEMENTS(boards); b++) {
+        dtr *fdt, *dir;
+        gchar *fm, *dm;
+
+        open_board(boards[b], &fdt, &dir);
+        g_assert_cmpuint(compare_node(fdt, dir, "/"), >, 50);
+
+        fm = dtr_maps_info(fdt);
+        dm = dtr_maps_info(dir);
+        g_assert_cmpstr(fm, ==, dm);
+        g_free(fm);
+        g_free(dm);
+
+        dtr_free(fdt);
+        dtr_free(dir);
+    }
+}
+
+/* the values the Device Tree page and the processor list pick out */
+static void test_values(void)
+{
+    guint b;
+
+    for (b = 0; b < G_N_ELEMENTS(boards); b++) {
+        dtr *dts[2];
+        int i;
+
+        open_board(boards[b], &dts[0], &dts[1]);
+        for (i = 0; i < 2; i++) {
+            dtr *dt = dts[i];
+            dt_opp_range *opp = dtr_get_opp_range(dt, "/cpus/cpu@0");
+            dtr_obj *obj;
+            gchar *model = dtr_get_prop_str(dt, NULL, "model");
+
+            g_assert_nonnull(opp);
+            if (b == 0) {
+                g_assert_cmpstr(model, ==, "Raspberry Pi 4 Model B Rev 1.4");
+                g_assert_cmpuint(opp->version, ==, 2);
+                g_assert_cmpuint(opp->phandle, ==, 0x10);
+                g_assert_cmpuint(opp->khz_min, ==, 600000);
+                g_assert_cmpuint(opp->khz_max, ==, 1500000);
+                g_assert_cmpuint(opp->clock_latency_ns, ==, 355000);
+                g_assert_cmpuint(dtr_get_prop_u32(dt, NULL, "#address-cells"), ==, 2);
+                g_assert_cmpuint(dtr_get_prop_u64(dt, NULL, "cpus/cpu@2/cpu-release-addr"), ==, 0xe8);
+
+                obj = dtr_obj_read(dt, "serial0");
+                g_assert_nonnull(obj);
+                g_assert_cmpstr(dtr_obj_path(obj), ==, "/soc/serial@7e201000");
+                g_assert_cmpstr(dtr_obj_symbol(obj), ==, "uart0");
+                dtr_obj_free(obj);
+                g_assert_cmpstr(dtr_phandle_lookup(dt, 0x5), ==, "/soc/cprman@7e101000");
+            } else {
+                g_assert_cmpstr(model, ==, "Wandboard i.MX6 Quad Board rev B1");
+                g_assert_cmpuint(opp->version, ==, 1);
+                g_assert_cmpuint(opp->khz_min, ==, 396000);
+                g_assert_cmpuint(opp->khz_max, ==, 1200000);
+                g_assert_cmpuint(opp->clock_latency_ns, ==, 61036);
+
+                obj = dtr_obj_read(dt, "mmc0");
+                g_assert_nonnull(obj);
+                g_assert_cmpstr(dtr_obj_path(obj), ==, "/soc/bus@2100000/mmc@2190000");
+                g_assert_null(dtr_obj_symbol(obj));
+                dtr_obj_free(obj);
+            }
+            g_free(model);
+            g_free(opp);
+        }
+        dtr_free(dts[0]);
+        dtr_free(dts[1]);
+    }
+}
+
+static void test_root(void)
+{
+    gchar *blob = g_strdup_printf("%s/dt/rpi4.dtb", FIXTURES_DIR), *contents;
+    gsize len;
+
+    /* nothing there: no device tree */
+    g_assert_null(dtr_find_device_tree_root());
+
+    /* only the directory tree */
+    g_assert_cmpint(g_mkdir(fake_sysfs, 0755), ==, 0);
+    g_assert_cmpstr(dtr_find_device_tree_root(), ==, fake_sysfs);
+    g_assert_cmpint(g_mkdir(fake_proc, 0755), ==, 0);
+    g_assert_cmpstr(dtr_find_device_tree_root(), ==, fake_proc);
+
+    /* the blob wins over both when it can be read */
+    g_assert_true(g_file_get_contents(blob, &contents, &len, NULL));
+    g_assert_true(g_file_set_contents(fake_fdt, contents, len, NULL));
+    g_assert_cmpstr(dtr_find_device_tree_root(), ==, fake_fdt);
+    {
+        dtr *dt = dtr_new(NULL);
+
+        g_assert_nonnull(dt->fdt);
+        dtr_free(dt);
+    }
+
+    /* and --dtb wins over everything */
+    params.path_dtb = blob;
+    g_assert_cmpstr(dtr_find_device_tree_root(), ==, blob);
+    params.path_dtb = NULL;
+
+    g_free(contents);
+    g_free(blob);
+}
+
+static void rm_rf(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+
+    if (dir) {
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+
+            rm_rf(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+        g_rmdir(path);
+    } else {
+        g_unlink(path);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    tmp_dir = g_dir_make_tmp("test_dt-XXXXXX", NULL);
+    g_assert(tmp_dir != NULL);
+    fake_fdt = g_build_filename(tmp_dir, "fdt", NULL);
+    fake_proc = g_build_filename(tmp_dir, "device-tree", NULL);
+    fake_sysfs = g_build_filename(tmp_dir, "base", NULL);
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/dt/fdt/compare", test_compare);
+    g_test_add_func("/dt/fdt/values", test_values);
+    g_test_add_func("/dt/root", test_root);
+    ret = g_test_run();
+
+    rm_rf(tmp_dir);
+    g_free(tmp_dir);
+    g_free(fake_fdt);
+    g_free(fake_proc);
+    g_free(fake_sysfs);
+    return ret;
+}
@@ -0,0 +1,363 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * The fwupd device list, fetched and cached against a fake fwupd that
+ * owns org.freedesktop.fwupd on a private bus. Run under dbus-run-session;
+ * the session bus stands in for the system bus. The fake answers
+ * GetDevices on its own connection and thread, late or not at all, emits
+ * Changed, and comes and goes.
+ */
+
+#define FW_TIMEOUT 400
+#define FW_FIRST_WAIT 150
+#include "../modules/devices/firmware.c"
+
+/* not reached: only info.c's parser uses these from shell.c */
+gboolean key_is_flagged(const gchar *key) { return FALSE; }
+gboolean key_is_highlighted(const gchar *key) { return FALSE; }
+gboolean key_wants_details(const gchar *key) { return FALSE; }
+gboolean key_value_has_vendor_string(const gchar *key) { return FALSE; }
+gboolean key_label_is_escaped(const gchar *key) { return FALSE; }
+gchar *key_mi_tag(const gchar *key) { return NULL; }
+const gchar *key_get_name(const gchar *key) { return key; }
+void key_get_components(const gchar *key, gchar **flags, gchar **tag, gchar **name,
+                        gchar **label, gchar **dis) { }
+
+/* what vendor.c would find: nothing */
+const Vendor *vendor_match(const gchar *id_str, ...) { return NULL; }
+
+/* two updatable devices and one that is not */
+static const gchar *all_devices =
+    "[{'Name': <'UEFI dbx'>, 'Vendor': <'Acme'>, 'Version': <'217'>,"
+    "  'Flags': <uint64 2>, 'Guid': <['0d1a2b3c-0000-4000-8000-000000000001']>},"
+    " {'Name': <'SSD [NVMe]'>, 'Flags': <uint64 3>},"
+    " {'Name': <'Keyboard'>, 'Flags': <uint64 1>}]";
+static const gchar *one_device = "[{'Name': <'UEFI dbx'>, 'Flags': <uint64 2>}]";
+
+static GThread *fake_thread;
+static GMainLoop *fake_loop;
+static GDBusConnection *fake_conn;
+static volatile gint fake_ready;
+static volatile gint fake_calls;
+static const gchar *fake_devices;
+static guint fake_delay; /* ms before GetDevices answers */
+
+static gboolean fake_answer(gpointer data)
+{
+    GVariant *devices = g_variant_parse(G_VARIANT_TYPE("aa{sv}"), fake_devices, NULL, NULL, NULL);
+
+    g_assert(devices != NULL);
+    g_dbus_method_invocation_return_value(data, g_variant_new_tuple(&devices, 1));
+    return FALSE;
+}
+
+static void fake_method(GDBusConnection *conn, const gchar *sender, const gchar *path,
+                        const gchar *interface, const gchar *method, GVariant *parameters,
+                        GDBusMethodInvocation *invocation, gpointer data)
+{
+    GSource *later;
+
+    g_assert_cmpstr(method, ==, "GetDevices");
+    g_atomic_int_inc(&fake_calls);
+    if (!fake_delay) {
+        fake_answer(invocation);
+        return;
+    }
+    later = g_timeout_source_new(fake_delay);
+    g_source_set_callback(later, fake_answer, invocation, NULL);
+    g_source_attach(later, g_main_context_get_thread_default());
+    g_source_unref(later);
+}
+
+static gpointer fake_func(gpointer data)
+{
+    static const gchar xml[] =
+        "<node><interface name='" FWUPT_INTERFACE "'>"
+        "<method name='GetDevices'><arg type='aa{sv}' direction='out'/></method>"
+        "<signal name='Changed'/>"
+        "</interface></node>";
+    GDBusInterfaceVTable vtable = { fake_method };
+    GMainContext *ctx = g_main_context_new();
+    GDBusNodeInfo *node = g_dbus_node_info_new_for_xml(xml, NULL);
+    gchar *address = g_dbus_address_get_for_bus_sync(G_BUS_TYPE_SESSION, NULL, NULL);
+    GVariant *reply;
+
+    /* method calls are dispatched to the context that registers */
+    g_main_context_push_thread_default(ctx);
+    fake_loop = g_main_loop_new(ctx, FALSE);
+    fake_conn = g_dbus_connection_new_for_address_sync(address,
+                    G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                    G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION, NULL, NULL, NULL);
+    g_assert(fake_conn != NULL);
+    g_assert_cmpuint(g_dbus_connection_register_object(fake_conn, "/", node->interfaces[0],
+                                                       &vtable, NULL, NULL, NULL), >, 0);
+    /* DBUS_NAME_FLAG_DO_NOT_QUEUE */
+    reply = g_dbus_connection_call_sync(fake_conn, "org.freedesktop.DBus", "/org/freedesktop/DBus",
+                                        "org.freedesktop.DBus", "RequestName",
+                                        g_variant_new("(su)", FWUPT_INTERFACE, 4),
+                                        G_VARIANT_TYPE("(u)"), G_DBUS_CALL_FLAGS_NONE,
+                                        -1, NULL, NULL);
+    g_assert(reply != NULL);
+    g_variant_unref(reply);
+    g_atomic_int_set(&fake_ready, 1);
+
+    g_main_loop_run(fake_loop);
+
+    g_dbus_connection_close_sync(fake_conn, NULL, NULL);
+    g_object_unref(fake_conn);
+    fake_conn = NULL;
+    g_main_loop_unref(fake_loop);
+    g_main_context_pop_thread_default(ctx);
+    g_main_context_unref(ctx);
+    g_dbus_node_info_unref(node);
+    g_free(address);
+    return NULL;
+}
+
+static void fake_start(void)
+{
+    g_atomic_int_set(&fake_ready, 0);
+    fake_thread = g_thread_new("fake-fwupd", fake_func, NULL);
+    while (!g_atomic_int_get(&fake_ready))
+        g_usleep(1000);
+}
+
+static void fake_stop(void)
+{
+    g_main_loop_quit(fake_loop);
+    g_thread_join(fake_thread);
+    fake_thread = NULL;
+}
+
+static void fake_changed(void)
+{
+    g_assert_true(g_dbus_connection_emit_signal(fake_conn, NULL, "/", FWUPT_INTERFACE,
+                                                "Changed", NULL, NULL));
+}
+
+/* runs the main loop, as the shell does between scans, until *flag is
+ * as wanted */
+static void pump_until(gboolean *flag, gboolean wanted)
+{
+    gint64 until = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+
+    while (*flag != wanted) {
+        g_assert_cmpint(g_get_monotonic_time(), <, until);
+        if (!g_main_context_iteration(NULL, FALSE))
+            g_usleep(1000);
+    }
+}
+
+static gchar *scan(void)
+{
+    static gchar *last;
+
+    g_free(last);
+    return last = fwupdmgr_get_devices_info();
+}
+
+static gboolean has_hinote(void)
+{
+    const char *msg = NULL;
+    gboolean ret = firmware_hinote(&msg);
+
+    g_free((gchar *)msg);
+    return ret;
+}
+
+static void assert_all_devices(const gchar *info)
+{
+    g_assert(strstr(info, "[UEFI dbx#") != NULL);
+    g_assert(strstr(info, "Vendor=Acme\n") != NULL);
+    g_assert(strstr(info, "[SSD (NVMe)#") != NULL);
+    g_assert(strstr(info, "Keyboard") == NULL);
+    g_assert(strstr(info, "ReloadInterval=5000\n") != NULL);
+}
+
+static void assert_one_device(const gchar *info)
+{
+    g_assert(strstr(info, "[UEFI dbx#") != NULL);
+    g_assert(strstr(info, "SSD") == NULL);
+}
+
+static void assert_not_available(const gchar *info)
+{
+    g_assert(strstr(info, "Result=(Not available)\n") != NULL);
+}
+
+static void test_no_daemon(void)
+{
+    /* the first scan waits for the answer */
+    assert_not_available(scan());
+    g_assert_true(has_hinote());
+    g_assert_false(fw_pending);
+
+    /* remembered until the name appears */
+    assert_not_available(scan());
+    g_assert_false(fw_pending);
+}
+
+static void test_appears(void)
+{
+    fake_devices = all_devices;
+    fake_start();
+    pump_until(&fw_valid, FALSE);
+
+    /* the last page while asking */
+    assert_not_available(scan());
+    g_assert_true(fw_pending);
+    pump_until(&fw_pending, FALSE);
+    assert_all_devices(scan());
+    g_assert_false(has_hinote());
+    g_assert_cmpint(g_atomic_int_get(&fake_calls), ==, 1);
+}
+
+static void test_cached(void)
+{
+    gint i;
+
+    for (i = 0; i < 3; i++) {
+        assert_all_devices(scan());
+        g_assert_false(fw_pending);
+        g_main_context_iteration(NULL, FALSE);
+    }
+    g_assert_cmpint(g_atomic_int_get(&fake_calls), ==, 1);
+}
+
+static void test_changed(void)
+{
+    fake_devices = one_device;
+    fake_changed();
+    pump_until(&fw_valid, FALSE);
+
+    assert_all_devices(scan());
+    pump_until(&fw_pending, FALSE);
+    assert_one_device(scan());
+    g_assert_cmpint(g_atomic_int_get(&fake_calls), ==, 2);
+}
+
+static void test_changed_during_call(void)
+{
+    fake_devices = all_devices;
+    fake_delay = 100;
+    fake_changed();
+    pump_until(&fw_valid, FALSE);
+
+    /* a change signalled while the call is out: the answer is shown but
+     * not trusted */
+    assert_one_device(scan());
+    fake_changed();
+    pump_until(&fw_pending, FALSE);
+    g_assert_false(fw_valid);
+    assert_all_devices(scan());
+    g_assert_true(fw_pending);
+    pump_until(&fw_pending, FALSE);
+    g_assert_true(fw_valid);
+    g_assert_cmpint(g_atomic_int_get(&fake_calls), ==, 4);
+    fake_delay = 0;
+}
+
+static void test_slow(void)
+{
+    /* past FW_TIMEOUT: the last list stays and is asked for again */
+    fake_devices = one_device;
+    fake_delay = 3 * FW_TIMEOUT;
+    fake_changed();
+    pump_until(&fw_valid, FALSE);
+
+    assert_all_devices(scan());
+    pump_until(&fw_pending, FALSE);
+    g_assert_false(fw_valid);
+    g_assert_false(has_hinote());
+
+    fake_delay = 0;
+    assert_all_devices(scan());
+    g_assert_true(fw_pending);
+    pump_until(&fw_pending, FALSE);
+    assert_one_device(scan());
+    g_assert_cmpint(g_atomic_int_get(&fake_calls), ==, 6);
+}
+
+/* as if nothing was asked yet */
+static void forget(void)
+{
+    g_free(fw_cache);
+    fw_cache = NULL;
+    fw_valid = FALSE;
+}
+
+static void test_first_wait(void)
+{
+    gchar *info;
+
+    /* past FW_FIRST_WAIT, within FW_TIMEOUT */
+    forget();
+    fake_devices = all_devices;
+    fake_delay = 2 * FW_FIRST_WAIT;
+    info = scan();
+    g_assert(strstr(info, "Result=(Waiting for fwupd)\n") != NULL);
+    g_assert(strstr(info, "ReloadInterval=1000\n") != NULL);
+    pump_until(&fw_pending, FALSE);
+    assert_all_devices(scan());
+    fake_delay = 0;
+}
+
+static void test_report(void)
+{
+    /* a report waits for the whole call */
+    forget();
+    params.create_report = TRUE;
+    fake_delay = 2 * FW_FIRST_WAIT;
+    assert_all_devices(scan());
+    g_assert_false(fw_pending);
+    params.create_report = FALSE;
+    fake_delay = 0;
+}
+
+static void test_gone(void)
+{
+    fake_stop();
+    pump_until(&fw_valid, FALSE);
+
+    assert_all_devices(scan());
+    pump_until(&fw_pending, FALSE);
+    assert_not_available(scan());
+    g_assert_true(has_hinote());
+}
+
+int main(int argc, char **argv)
+{
+    const gchar *session = g_getenv("DBUS_SESSION_BUS_ADDRESS");
+
+    g_test_init(&argc, &argv, NULL);
+    if (!session)
+        return 77; /* not under dbus-run-session */
+    g_setenv("DBUS_SYSTEM_BUS_ADDRESS", session, TRUE);
+
+    g_test_add_func("/firmware/no-daemon", test_no_daemon);
+    g_test_add_func("/firmware/appears", test_appears);
+    g_test_add_func("/firmware/cached", test_cached);
+    g_test_add_func("/firmware/changed", test_changed);
+    g_test_add_func("/firmware/changed-during-call", test_changed_during_call);
+    g_test_add_func("/firmware/slow", test_slow);
+    g_test_add_func("/firmware/first-wait", test_first_wait);
+    g_test_add_func("/firmware/report", test_report);
+    g_test_add_func("/firmware/gone", test_gone);
+    return g_test_run();
+}
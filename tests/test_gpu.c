@@ -0,0 +1,248 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * amdgpu clock levels and live GPU samples, from cards recorded in
+ * fixtures/gpu/<chip>: a desktop Navi 21 and Polaris 10, a laptop Navi 23
+ * that is runtime-suspended, and a Phoenix APU with a deep sleep level.
+ */
+
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include "hardinfo.h"
+#include "gpu_util.h"
+
+/* not reached: only the device list uses these */
+gchar *h_sysfs_path(const gchar *path) { return NULL; }
+gchar *h_sysfs_read_string(const gchar *endpoint, const gchar *entry) { return NULL; }
+const gchar *vendor_get_shortest_name(const gchar *id_str) { return id_str; }
+
+static gchar *tmp_dir;
+
+static void test_dpmclk(void)
+{
+    static const struct {
+        const gchar *chip, *file;
+        int active, min, max;
+    } levels[] = {
+        { "navi21", "pp_dpm_sclk", 1412, 500, 2250 },
+        { "navi21", "pp_dpm_mclk", 96, 96, 1000 },
+        { "polaris10", "pp_dpm_sclk", 300, 300, 1366 },
+        { "polaris10", "pp_dpm_mclk", 2000, 300, 2000 },
+        { "navi23", "pp_dpm_sclk", 2345, 500, 2800 },
+        /* deep sleep: active, but not part of the range */
+        { "phoenix", "pp_dpm_sclk", 19, 800, 2700 },
+        { "phoenix", "pp_dpm_mclk", 2800, 400, 2800 },
+    };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(levels); i++) {
+        gchar *file = g_build_filename(FIXTURES_DIR, "gpu", levels[i].chip, "device",
+                                       levels[i].file, NULL), *buf = NULL;
+        int min, max;
+
+        g_assert_true(g_file_get_contents(file, &buf, NULL, NULL));
+        g_assert_cmpint(amdgpu_dpmclk_parse(buf, &min, &max), ==, levels[i].active);
+        g_assert_cmpint(min, ==, levels[i].min);
+        g_assert_cmpint(max, ==, levels[i].max);
+        g_free(buf);
+        g_free(file);
+    }
+}
+
+static void test_dpmclk_odd(void)
+{
+    int min, max;
+
+    g_assert_cmpint(amdgpu_dpmclk_parse("", &min, &max), ==, -1);
+    g_assert_cmpint(min, ==, -1);
+    g_assert_cmpint(max, ==, -1);
+    /* no final newline, as a short read leaves it */
+    g_assert_cmpint(amdgpu_dpmclk_parse("0: 300Mhz\n1: 600Mhz *", &min, &max), ==, 600);
+    g_assert_cmpint(max, ==, 600);
+    /* between levels: nothing marked */
+    g_assert_cmpint(amdgpu_dpmclk_parse("0: 500Mhz\n1: 2250Mhz\n", &min, &max), ==, -1);
+    g_assert_cmpint(min, ==, 500);
+    /* a mark on a line that is not a level */
+    g_assert_cmpint(amdgpu_dpmclk_parse("junk *\n0: 500Mhz\n", &min, &max), ==, -1);
+    g_assert_cmpint(amdgpu_dpmclk_parse("S: 19Mhz\n", &min, &max), ==, -1);
+    g_assert_cmpint(min, ==, -1);
+}
+
+static void sample(const gchar *card, gpu_sample *out)
+{
+    gpu_sampler *s = gpu_sampler_new(card);
+
+    g_assert(s != NULL);
+    gpu_sampler_read(s, out);
+    gpu_sampler_free(s);
+}
+
+static void sample_chip(const gchar *chip, gpu_sample *out)
+{
+    gchar *card = g_build_filename(FIXTURES_DIR, "gpu", chip, NULL);
+
+    sample(card, out);
+    g_free(card);
+}
+
+static void assert_nothing(const gpu_sample *s)
+{
+    g_assert_cmpint(s->busy_percent, ==, -1);
+    g_assert_cmpint(s->core_mhz, ==, -1);
+    g_assert_cmpint(s->mem_mhz, ==, -1);
+    g_assert_cmpfloat(s->power_w, ==, -1);
+    g_assert_cmpint(s->vram_used, ==, -1);
+    g_assert_cmpint(s->vram_total, ==, -1);
+}
+
+static void test_sampler_active(void)
+{
+    gpu_sample s;
+
+    sample_chip("navi21", &s);
+    g_assert_cmpint(s.busy_percent, ==, 12);
+    g_assert_cmpint(s.core_mhz, ==, 1412);
+    g_assert_cmpint(s.mem_mhz, ==, 96);
+    g_assert_cmpfloat(s.power_w, ==, 35.0);
+    g_assert_cmpint(s.vram_used, ==, G_GINT64_CONSTANT(1073741824));
+    g_assert_cmpint(s.vram_total, ==, G_GINT64_CONSTANT(17163091968));
+
+    sample_chip("phoenix", &s);
+    g_assert_cmpint(s.core_mhz, ==, 19);
+    g_assert_cmpint(s.mem_mhz, ==, 2800);
+}
+
+static void test_sampler_no_runtime_pm(void)
+{
+    gpu_sample s;
+
+    /* "unsupported": runtime pm is off, the card is always powered */
+    sample_chip("polaris10", &s);
+    g_assert_cmpint(s.busy_percent, ==, 0);
+    g_assert_cmpint(s.core_mhz, ==, 300);
+    g_assert_cmpint(s.mem_mhz, ==, 2000);
+    g_assert_cmpfloat(s.power_w, ==, 33.07);
+}
+
+static void test_sampler_suspended(void)
+{
+    gpu_sample s;
+
+    sample_chip("navi23", &s);
+    assert_nothing(&s);
+}
+
+/* rewritten in place, as sysfs does, so open files see it */
+static void write_attr(const gchar *card, const gchar *attr, const gchar *value)
+{
+    gchar *path = g_build_filename(card, "device", attr, NULL), *dir = g_path_get_dirname(path);
+    int fd;
+
+    g_mkdir_with_parents(dir, 0755);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    g_assert_cmpint(fd, >=, 0);
+    g_assert_cmpint(write(fd, value, strlen(value)), ==, strlen(value));
+    close(fd);
+    g_free(dir);
+    g_free(path);
+}
+
+static void test_sampler_resume(void)
+{
+    gchar *card = g_build_filename(tmp_dir, "card1", NULL);
+    gpu_sampler *sampler;
+    gpu_sample s;
+
+    write_attr(card, "gpu_busy_percent", "97\n");
+    write_attr(card, "pp_dpm_sclk", "0: 500Mhz\n1: 2345Mhz *\n2: 2800Mhz\n");
+    write_attr(card, "power/runtime_status", "suspended\n");
+    sampler = gpu_sampler_new(card);
+    g_assert(sampler != NULL);
+
+    gpu_sampler_read(sampler, &s);
+    assert_nothing(&s);
+
+    /* woken by something else: sampled again on the same files */
+    write_attr(card, "power/runtime_status", "active\n");
+    gpu_sampler_read(sampler, &s);
+    g_assert_cmpint(s.busy_percent, ==, 97);
+    g_assert_cmpint(s.core_mhz, ==, 2345);
+
+    write_attr(card, "power/runtime_status", "suspending\n");
+    gpu_sampler_read(sampler, &s);
+    assert_nothing(&s);
+
+    gpu_sampler_free(sampler);
+    g_free(card);
+}
+
+static void test_sampler_no_status(void)
+{
+    gchar *card = g_build_filename(tmp_dir, "card2", NULL);
+    gpu_sample s;
+
+    /* without the file there is nothing to go by: sampled */
+    write_attr(card, "gpu_busy_percent", "5\n");
+    sample(card, &s);
+    g_assert_cmpint(s.busy_percent, ==, 5);
+    g_assert_cmpint(s.core_mhz, ==, -1);
+    g_free(card);
+}
+
+static void rm_rf(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+
+    if (dir) {
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+
+            rm_rf(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+        g_rmdir(path);
+    } else {
+        g_unlink(path);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    tmp_dir = g_dir_make_tmp("test_gpu-XXXXXX", NULL);
+    g_assert(tmp_dir != NULL);
+
+    g_test_add_func("/gpu/dpmclk/recorded", test_dpmclk);
+    g_test_add_func("/gpu/dpmclk/odd", test_dpmclk_odd);
+    g_test_add_func("/gpu/sampler/active", test_sampler_active);
+    g_test_add_func("/gpu/sampler/no-runtime-pm", test_sampler_no_runtime_pm);
+    g_test_add_func("/gpu/sampler/suspended", test_sampler_suspended);
+    g_test_add_func("/gpu/sampler/resume", test_sampler_resume);
+    g_test_add_func("/gpu/sampler/no-status", test_sampler_no_status);
+    ret = g_test_run();
+
+    rm_rf(tmp_dir);
+    g_free(tmp_dir);
+    return ret;
+}
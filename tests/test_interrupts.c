@@ -0,0 +1,263 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * /proc/interrupts parsing and rate math, from recorded pairs of samples
+ * in fixtures/interrupts/<name>.0 and <name>.1 taken two seconds apart.
+ */
+
+#include "../modules/devices/interrupts.c"
+
+#define SECONDS 2.0
+
+typedef struct {
+    irq_snapshot prev, cur;
+    gdouble *rates;
+    gint *cpu_map;
+} Pair;
+
+static void load(irq_snapshot *s, const gchar *name, gint n)
+{
+    gchar *file = g_strdup_printf("%s/interrupts/%s.%d", FIXTURES_DIR, name, n);
+    gchar *buf = NULL;
+
+    g_assert_true(g_file_get_contents(file, &buf, NULL, NULL));
+    g_assert_true(snapshot_parse(s, buf));
+    g_free(buf);
+    g_free(file);
+}
+
+static Pair *pair_load(const gchar *name)
+{
+    Pair *p = g_new0(Pair, 1);
+
+    load(&p->prev, name, 0);
+    load(&p->cur, name, 1);
+    p->rates = g_new0(gdouble, p->cur.nirq * p->cur.ncpu);
+    p->cpu_map = g_new0(gint, p->cur.ncpu);
+    snapshot_rates(&p->prev, &p->cur, SECONDS, p->rates, p->cpu_map);
+
+    return p;
+}
+
+static void pair_free(Pair *p)
+{
+    irq_snapshot *s[] = { &p->prev, &p->cur };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(s); i++) {
+        g_free(s[i]->cpu_id);
+        g_free(s[i]->rows);
+        g_free(s[i]->counts);
+    }
+    g_free(p->rates);
+    g_free(p->cpu_map);
+    g_free(p);
+}
+
+static gint row_of(const irq_snapshot *s, const gchar *name)
+{
+    guint i;
+
+    for (i = 0; i < s->nirq; i++)
+        if (g_str_equal(s->rows[i].name, name))
+            return i;
+    g_assert_not_reached();
+    return -1;
+}
+
+/* rate of IRQ name on the column of CPU cpu_id */
+static gdouble rate(const Pair *p, const gchar *name, guint cpu_id)
+{
+    guint c;
+
+    for (c = 0; c < p->cur.ncpu; c++)
+        if (p->cur.cpu_id[c] == cpu_id)
+            return p->rates[(gsize)row_of(&p->cur, name) * p->cur.ncpu + c];
+    g_assert_not_reached();
+    return -1;
+}
+
+static void test_parse(void)
+{
+    Pair *p = pair_load("basic");
+    const irq_snapshot *s = &p->prev;
+    const irq_row *row;
+
+    g_assert_cmpuint(s->ncpu, ==, 4);
+    g_assert_cmpuint(s->cpu_id[3], ==, 3);
+    g_assert_cmpuint(s->nirq, ==, 9);
+
+    row = &s->rows[row_of(s, "124")];
+    g_assert_cmpstr(row->desc, ==, "IR-PCI-MSI 327680-edge xhci_hcd");
+    g_assert_false(row->total_only);
+    g_assert_cmpuint(s->counts[row_of(s, "124") * s->cpu_cap + 1], ==, 2000);
+
+    row = &s->rows[row_of(s, "LOC")];
+    g_assert_cmpstr(row->desc, ==, "Local timer interrupts");
+    g_assert_cmpuint(s->counts[row_of(s, "LOC") * s->cpu_cap + 3], ==, 2000000);
+
+    /* one system wide count, kept in the first column */
+    row = &s->rows[row_of(s, "ERR")];
+    g_assert_true(row->total_only);
+    g_assert_cmpstr(row->desc, ==, "");
+
+    pair_free(p);
+}
+
+static void test_parse_bad(void)
+{
+    irq_snapshot s = { 0 };
+
+    g_assert_false(snapshot_parse(&s, ""));
+    g_assert_false(snapshot_parse(&s, "no header\n  0: 1 2\n"));
+    g_assert_false(snapshot_parse(&s, "           CPU0\n"));
+
+    g_free(s.cpu_id);
+    g_free(s.rows);
+    g_free(s.counts);
+}
+
+static void test_rates(void)
+{
+    Pair *p = pair_load("basic");
+
+    g_assert_cmpfloat(rate(p, "0", 0), ==, 0);
+    g_assert_cmpfloat(rate(p, "9", 1), ==, 10 / SECONDS);
+    g_assert_cmpfloat(rate(p, "124", 0), ==, 400 / SECONDS);
+    g_assert_cmpfloat(rate(p, "125", 1), ==, 1000 / SECONDS);
+    g_assert_cmpfloat(rate(p, "LOC", 0), ==, 2000 / SECONDS);
+    g_assert_cmpfloat(rate(p, "LOC", 3), ==, 250 / SECONDS);
+    g_assert_cmpfloat(rate(p, "ERR", 0), ==, 4 / SECONDS);
+
+    pair_free(p);
+}
+
+static void test_wrap(void)
+{
+    Pair *p = pair_load("wrap");
+
+    /* 4294967000 -> 200 is 496 counts past 2^32 */
+    g_assert_cmpfloat(rate(p, "LOC", 0), ==, 496 / SECONDS);
+    g_assert_cmpfloat(rate(p, "LOC", 1), ==, 1000 / SECONDS);
+
+    g_assert_cmpuint(counter_delta(10, 10), ==, 0);
+    g_assert_cmpuint(counter_delta((guint64)G_MAXUINT32, 0), ==, 1);
+    /* not a 32-bit wrap, so a reset */
+    g_assert_cmpuint(counter_delta((guint64)G_MAXUINT32 + 10, 5), ==, 0);
+
+    pair_free(p);
+}
+
+static void test_hotplug(void)
+{
+    Pair *p = pair_load("hotplug");
+
+    /* rows are matched by name, not position */
+    g_assert_cmpfloat(rate(p, "9", 1), ==, 10 / SECONDS);
+    g_assert_cmpfloat(rate(p, "124", 0), ==, 400 / SECONDS);
+    g_assert_cmpfloat(rate(p, "LOC", 2), ==, 500 / SECONDS);
+    /* a new IRQ counted from zero */
+    g_assert_cmpfloat(rate(p, "130", 0), ==, 6 / SECONDS);
+
+    pair_free(p);
+}
+
+static void test_offline(void)
+{
+    Pair *p = pair_load("offline");
+
+    g_assert_cmpuint(p->cur.ncpu, ==, 3);
+    g_assert_cmpint(p->cpu_map[0], ==, 0);
+    g_assert_cmpint(p->cpu_map[1], ==, 2);
+    g_assert_cmpint(p->cpu_map[2], ==, 3);
+
+    /* CPU2 and CPU3 keep their own counters after CPU1's column goes */
+    g_assert_cmpfloat(rate(p, "LOC", 2), ==, 500 / SECONDS);
+    g_assert_cmpfloat(rate(p, "LOC", 3), ==, 250 / SECONDS);
+    /* IRQs moved off CPU1 show up on CPU0 */
+    g_assert_cmpfloat(rate(p, "125", 0), ==, 1000 / SECONDS);
+    g_assert_cmpfloat(rate(p, "9", 0), ==, 10 / SECONDS);
+
+    pair_free(p);
+}
+
+static void test_online(void)
+{
+    Pair *p = pair_load("online");
+
+    g_assert_cmpuint(p->cur.ncpu, ==, 4);
+    g_assert_cmpint(p->cpu_map[0], ==, 0);
+    g_assert_cmpint(p->cpu_map[1], ==, -1);
+    g_assert_cmpint(p->cpu_map[2], ==, 1);
+    g_assert_cmpint(p->cpu_map[3], ==, 2);
+
+    /* CPU1 comes back with the counts it had, not new ones */
+    g_assert_cmpfloat(rate(p, "LOC", 1), ==, 0);
+    g_assert_cmpfloat(rate(p, "125", 1), ==, 0);
+    g_assert_cmpfloat(rate(p, "9", 1), ==, 0);
+    /* the others carry on */
+    g_assert_cmpfloat(rate(p, "LOC", 0), ==, 2000 / SECONDS);
+    g_assert_cmpfloat(rate(p, "LOC", 2), ==, 500 / SECONDS);
+    g_assert_cmpfloat(rate(p, "LOC", 3), ==, 250 / SECONDS);
+    g_assert_cmpfloat(rate(p, "124", 0), ==, 400 / SECONDS);
+
+    pair_free(p);
+}
+
+static void test_since_boot(void)
+{
+    irq_snapshot s = { 0 };
+    gdouble *rates;
+    gint *cpu_map;
+    gchar *file = g_strdup_printf("%s/interrupts/basic.0", FIXTURES_DIR), *buf;
+
+    g_assert_true(g_file_get_contents(file, &buf, NULL, NULL));
+    g_assert_true(snapshot_parse(&s, buf));
+    rates = g_new0(gdouble, s.nirq * s.ncpu);
+    cpu_map = g_new0(gint, s.ncpu);
+
+    /* no previous sample: everything counted from boot */
+    snapshot_rates(NULL, &s, 1000, rates, cpu_map);
+    g_assert_cmpint(cpu_map[0], ==, -1);
+    g_assert_cmpfloat(rates[row_of(&s, "LOC") * s.ncpu], ==, 5000);
+
+    g_free(rates);
+    g_free(cpu_map);
+    g_free(buf);
+    g_free(file);
+    g_free(s.cpu_id);
+    g_free(s.rows);
+    g_free(s.counts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/interrupts/parse", test_parse);
+    g_test_add_func("/interrupts/parse-bad", test_parse_bad);
+    g_test_add_func("/interrupts/rates", test_rates);
+    g_test_add_func("/interrupts/wrap", test_wrap);
+    g_test_add_func("/interrupts/hotplug", test_hotplug);
+    g_test_add_func("/interrupts/offline", test_offline);
+    g_test_add_func("/interrupts/online", test_online);
+    g_test_add_func("/interrupts/since-boot", test_since_boot);
+
+    return g_test_run();
+}
@@ -0,0 +1,239 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * The inventory cache: tokens built from /proc/modules-like files, and
+ * entries stored, matched and reloaded from a cache under a temporary
+ * XDG_CONFIG_HOME.
+ */
+
+#include <glib/gstdio.h>
+#include "hardinfo.h"
+#include "inventory.h"
+
+static gchar *tmp_dir;
+
+/* the same modules, used and unused, as two lsmod runs a minute apart see them */
+static const gchar modules_idle[] =
+    "snd_hda_intel 61440 3 - Live 0x0000000000000000\n"
+    "amdgpu 12263424 27 - Live 0x0000000000000000\n"
+    "nvme 61440 4 - Live 0x0000000000000000\n";
+static const gchar modules_busy[] =
+    "snd_hda_intel 61440 5 - Live 0x0000000000000000\n"
+    "amdgpu 12263424 31 - Live 0x0000000000000000\n"
+    "nvme 61440 4 - Loading 0x0000000000000000\n";
+static const gchar modules_loaded[] =
+    "snd_hda_intel 61440 3 - Live 0x0000000000000000\n"
+    "amdgpu 12263424 27 - Live 0x0000000000000000\n"
+    "nvme 61440 4 - Live 0x0000000000000000\n"
+    "uvcvideo 139264 0 - Live 0x0000000000000000\n";
+static const gchar modules_rebuilt[] =
+    "snd_hda_intel 61440 3 - Live 0x0000000000000000\n"
+    "amdgpu 12267520 27 - Live 0x0000000000000000\n"
+    "nvme 61440 4 - Live 0x0000000000000000\n";
+
+static gchar *fields_token(const gchar *contents)
+{
+    gchar *path = g_build_filename(tmp_dir, "modules", NULL), *token;
+
+    g_assert_true(g_file_set_contents(path, contents, -1, NULL));
+    token = inventory_fields_token(path, 2);
+    g_free(path);
+    return token;
+}
+
+static void test_fields_token(void)
+{
+    gchar *idle = fields_token(modules_idle);
+    gchar *busy = fields_token(modules_busy);
+    gchar *loaded = fields_token(modules_loaded);
+    gchar *rebuilt = fields_token(modules_rebuilt);
+    gchar *missing = g_build_filename(tmp_dir, "no-such-file", NULL), *none;
+
+    /* refcounts and states don't matter, names and sizes do */
+    g_assert_cmpstr(idle, ==, busy);
+    g_assert_cmpstr(idle, !=, loaded);
+    g_assert_cmpstr(idle, !=, rebuilt);
+
+    /* the whole file, for comparison, changes with every refcount */
+    {
+        gchar *path = g_build_filename(tmp_dir, "modules", NULL), *a, *b;
+
+        g_file_set_contents(path, modules_idle, -1, NULL);
+        a = inventory_file_token(path);
+        g_file_set_contents(path, modules_busy, -1, NULL);
+        b = inventory_file_token(path);
+        g_assert_cmpstr(a, !=, b);
+        g_free(a);
+        g_free(b);
+        g_free(path);
+    }
+
+    none = inventory_fields_token(missing, 2);
+    g_assert_cmpstr(none, ==, "-");
+
+    g_free(idle);
+    g_free(busy);
+    g_free(loaded);
+    g_free(rebuilt);
+    g_free(missing);
+    g_free(none);
+}
+
+static void test_stat_token(void)
+{
+    gchar *path = g_build_filename(tmp_dir, "modules.dep", NULL);
+    gchar *a, *b, *none;
+
+    g_assert_true(g_file_set_contents(path, "kernel/nvme.ko:\n", -1, NULL));
+    a = inventory_stat_token(path);
+    /* a depmod run after a kernel module update rewrites the file */
+    g_unlink(path);
+    g_assert_true(g_file_set_contents(path, "kernel/nvme.ko:\nkernel/uvcvideo.ko:\n", -1, NULL));
+    b = inventory_stat_token(path);
+    g_assert_cmpstr(a, !=, b);
+
+    none = inventory_stat_token(NULL);
+    g_assert_cmpstr(none, ==, "-");
+
+    g_free(a);
+    g_free(b);
+    g_free(none);
+    g_free(path);
+}
+
+static gchar *entry_token_value;
+
+static gchar *entry_token(gint entry)
+{
+    return g_strdup_printf("%d:%s", entry, entry_token_value);
+}
+
+static void test_store(void)
+{
+    ShellModuleEntry entry = { 0 };
+    gchar *token, *stale, *data, *cache;
+
+    entry.number = 3;
+    entry.tokenfunc = entry_token;
+    entry_token_value = "a";
+
+    inventory_init();
+    token = inventory_entry_token(&entry);
+    g_assert(token != NULL);
+    g_assert_null(inventory_get("computer.so/3", token));
+
+    inventory_put("computer.so/3", token, "[Loaded Modules]\nnvme=NVMe block driver\n");
+    inventory_put_moreinfo("computer.so/3", "MODnvme", "[Module]\nLicense=GPL\n");
+    /* live fields are refreshed from the module, they can't be replayed */
+    inventory_put("computer.so/4", token, "[Memory]\nFree=...\n");
+    inventory_shutdown();
+
+    cache = g_build_filename(tmp_dir, "hardinfo2", "inventory.cache", NULL);
+    g_assert_true(g_file_test(cache, G_FILE_TEST_IS_REGULAR));
+
+    /* another run reads it back */
+    inventory_init();
+    data = inventory_get("computer.so/3", token);
+    g_assert_cmpstr(data, ==, "[Loaded Modules]\nnvme=NVMe block driver\n");
+    g_free(data);
+    data = inventory_get_moreinfo("computer.so/3", "MODnvme");
+    g_assert_cmpstr(data, ==, "[Module]\nLicense=GPL\n");
+    g_free(data);
+    g_assert_null(inventory_get_moreinfo("computer.so/3", "MODuvcvideo"));
+    g_assert_null(inventory_get("computer.so/4", token));
+
+    /* a module load changes the token */
+    entry_token_value = "b";
+    stale = inventory_entry_token(&entry);
+    g_assert_cmpstr(stale, !=, token);
+    g_assert_null(inventory_get("computer.so/3", stale));
+    inventory_shutdown();
+
+    /* so does anything that changes the text modules produce */
+    params.fmt_opts = FMT_OPT_HTML;
+    inventory_init();
+    entry_token_value = "a";
+    g_free(stale);
+    stale = inventory_entry_token(&entry);
+    g_assert_cmpstr(stale, !=, token);
+    g_assert_null(inventory_get("computer.so/3", stale));
+    inventory_shutdown();
+    params.fmt_opts = 0;
+
+    g_free(stale);
+    g_free(token);
+    g_free(cache);
+}
+
+static void test_overrides(void)
+{
+    ShellModuleEntry entry = { 0 };
+
+    entry.tokenfunc = entry_token;
+    entry_token_value = "a";
+
+    /* tokens come from the live system, not from a --sysfs tree */
+    params.path_sysfs = tmp_dir;
+    inventory_init();
+    g_assert_null(inventory_entry_token(&entry));
+    g_assert_null(inventory_get("computer.so/3", "anything"));
+    inventory_shutdown();
+    params.path_sysfs = NULL;
+}
+
+static void rm_rf(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+
+    if (dir) {
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+
+            rm_rf(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+        g_rmdir(path);
+    } else {
+        g_unlink(path);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    tmp_dir = g_dir_make_tmp("test_inventory-XXXXXX", NULL);
+    g_assert(tmp_dir != NULL);
+    /* before anything asks GLib for the user config dir */
+    g_setenv("XDG_CONFIG_HOME", tmp_dir, TRUE);
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/inventory/token/fields", test_fields_token);
+    g_test_add_func("/inventory/token/stat", test_stat_token);
+    g_test_add_func("/inventory/store", test_store);
+    g_test_add_func("/inventory/overrides", test_overrides);
+    ret = g_test_run();
+
+    rm_rf(tmp_dir);
+    g_free(tmp_dir);
+    return ret;
+}
@@ -0,0 +1,331 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Compiled locales read directly, from a locale-archive and a locale
+ * directory generated in a temporary LOCALE_DIR. The archive has good
+ * entries next to empty and damaged slots, and is also read cut short at
+ * every length.
+ */
+
+static char *locale_dir;
+#define LOCALE_DIR locale_dir
+#include "../modules/computer/languages.c"
+#include <glib/gstdio.h>
+
+#ifdef LOCALE_NATIVE
+
+#define ID(item) _NL_ITEM_INDEX(_NL_IDENTIFICATION_##item)
+#define NOWHERE 0x7fffff00
+
+static GByteArray *archive;
+
+/* an LC_* record: magic, count, offsets, strings */
+static GByteArray *lc_record(const gchar **fields, guint n)
+{
+    GByteArray *rec = g_byte_array_new();
+    guint32 word = 0x20031115, off;
+    guint i;
+
+    g_byte_array_append(rec, (guint8 *)&word, 4);
+    g_byte_array_append(rec, (guint8 *)&n, 4);
+    off = 8 + n * 4;
+    for (i = 0; i < n; i++) {
+        g_byte_array_append(rec, (guint8 *)&off, 4);
+        off += strlen(fields[i] ? fields[i] : "") + 1;
+    }
+    for (i = 0; i < n; i++)
+        g_byte_array_append(rec, (guint8 *)(fields[i] ? fields[i] : ""),
+                            strlen(fields[i] ? fields[i] : "") + 1);
+
+    return rec;
+}
+
+static GByteArray *id_record(const gchar *title, const gchar *address)
+{
+    const gchar *fields[16] = { NULL };
+
+    fields[ID(TITLE)] = title;
+    fields[ID(SOURCE)] = "Free Software Foundation, Inc.";
+    fields[ID(ADDRESS)] = address;
+    fields[ID(EMAIL)] = "bug-glibc-locales@gnu.org";
+    fields[ID(LANGUAGE)] = "English";
+    fields[ID(TERRITORY)] = "USA";
+    fields[ID(REVISION)] = "1.0";
+    fields[ID(DATE)] = "2000-06-24";
+    return lc_record(fields, G_N_ELEMENTS(fields));
+}
+
+static GByteArray *ctype_record(const gchar *codeset)
+{
+    const gchar *fields[_NL_ITEM_INDEX(_NL_CTYPE_CODESET_NAME) + 1] = { NULL };
+
+    fields[_NL_ITEM_INDEX(_NL_CTYPE_CODESET_NAME)] = codeset;
+    return lc_record(fields, G_N_ELEMENTS(fields));
+}
+
+static guint32 append(GByteArray *a, const void *data, gsize len)
+{
+    guint32 at = a->len;
+
+    g_byte_array_append(a, data, len);
+    return at;
+}
+
+/* name and records; name_at, rec_at and id_at point the name table or
+ * the LC_IDENTIFICATION record somewhere else */
+typedef struct {
+    const gchar *name;
+    GByteArray *id, *ctype;
+    guint32 name_at, rec_at, id_at;
+} Entry;
+
+static GByteArray *build_archive(Entry *entries, guint n)
+{
+    GByteArray *a = g_byte_array_new();
+    struct locarhead head = { 0 };
+    struct namehashent *ents = g_new0(struct namehashent, n);
+    guint i;
+
+    head.magic = LOCALE_ARCHIVE_MAGIC;
+    head.namehash_offset = sizeof(head);
+    head.namehash_size = n;
+    head.namehash_used = n;
+    append(a, &head, sizeof(head));
+    append(a, ents, n * sizeof(*ents));
+
+    for (i = 0; i < n; i++) {
+        struct locrecent rec = { 0 };
+
+        if (!entries[i].name)
+            continue;
+        ents[i].name_offset = append(a, entries[i].name, strlen(entries[i].name) + 1);
+        rec.refs = 1;
+        if (entries[i].id) {
+            rec.record[LC_IDENTIFICATION].offset = append(a, entries[i].id->data, entries[i].id->len);
+            rec.record[LC_IDENTIFICATION].len = entries[i].id->len;
+        }
+        if (entries[i].id_at) {
+            rec.record[LC_IDENTIFICATION].offset = entries[i].id_at;
+            rec.record[LC_IDENTIFICATION].len = 64;
+        }
+        if (entries[i].ctype) {
+            rec.record[LC_CTYPE].offset = append(a, entries[i].ctype->data, entries[i].ctype->len);
+            rec.record[LC_CTYPE].len = entries[i].ctype->len;
+        }
+        ents[i].locrec_offset = append(a, &rec, sizeof(rec));
+        if (entries[i].name_at)
+            ents[i].name_offset = entries[i].name_at;
+        if (entries[i].rec_at)
+            ents[i].locrec_offset = entries[i].rec_at;
+        ents[i].hashval = i;
+    }
+    memcpy(a->data + sizeof(head), ents, n * sizeof(*ents));
+    g_free(ents);
+
+    return a;
+}
+
+static void write_file(const gchar *name, const gchar *category, const void *data, gsize len)
+{
+    gchar *path = g_build_filename(locale_dir, name, category, NULL),
+          *dir = g_path_get_dirname(path);
+
+    g_mkdir_with_parents(dir, 0755);
+    g_assert_true(g_file_set_contents(path, data, len, NULL));
+    g_free(dir);
+    g_free(path);
+}
+
+static void write_archive(gsize len)
+{
+    write_file("locale-archive", NULL, archive->data, MIN(len, archive->len));
+}
+
+static void setup(void)
+{
+    Entry entries[] = {
+        { "en_US.utf8", id_record("English locale for the USA", ""), ctype_record("UTF-8") },
+        { NULL },
+        { "de_DE.utf8", id_record("German locale for Germany & co", "Boston"),
+          ctype_record("UTF-8") },
+        { "xx_XX", id_record("name out of range", ""), NULL, NOWHERE },
+        { "yy_YY", id_record("record out of range", ""), NULL, 0, NOWHERE },
+        { "fr_FR.utf8", NULL, ctype_record("ISO-8859-1"), 0, 0, NOWHERE },
+    };
+    GByteArray *rec;
+    guint i;
+
+    archive = build_archive(entries, G_N_ELEMENTS(entries));
+    for (i = 0; i < G_N_ELEMENTS(entries); i++) {
+        if (entries[i].id)
+            g_byte_array_unref(entries[i].id);
+        if (entries[i].ctype)
+            g_byte_array_unref(entries[i].ctype);
+    }
+    write_archive(archive->len);
+
+    /* a compiled locale directory, one that the archive shadows and
+     * one that is not a locale */
+    rec = id_record("C locale", "");
+    write_file("C.utf8", "LC_IDENTIFICATION", rec->data, rec->len);
+    g_byte_array_unref(rec);
+    rec = ctype_record("ANSI_X3.4-1968");
+    write_file("C.utf8", "LC_CTYPE", rec->data, rec->len);
+    g_byte_array_unref(rec);
+    rec = id_record("shadowed by the archive", "");
+    write_file("en_US.utf8", "LC_IDENTIFICATION", rec->data, rec->len);
+    g_byte_array_unref(rec);
+    write_file("junk", "README", "", 0);
+}
+
+static void test_scan(void)
+{
+    gchar *list = scan_languages_native();
+
+    g_assert_cmpstr(list, ==,
+        "$C.utf8$C.utf8=C locale\n"
+        "$de_DE.utf8$de_DE.utf8=German locale for Germany &amp; co\n"
+        "$en_US.utf8$en_US.utf8=English locale for the USA\n"
+        "$fr_FR.utf8$fr_FR.utf8=(Unknown)\n");
+    g_free(list);
+}
+
+static void test_info(void)
+{
+    gchar *list = scan_languages_native(), *info;
+
+    info = locale_get_info("en_US.utf8");
+    g_assert(info != NULL);
+    g_assert(strstr(info, "Name=en_US.utf8 (English locale for the USA)\n") != NULL);
+    g_assert(strstr(info, "Source=Free Software Foundation, Inc.\n") != NULL);
+    /* empty fields are unknown */
+    g_assert(strstr(info, "Address=(Unknown)\n") != NULL);
+    g_assert(strstr(info, "E-mail=bug-glibc-locales@gnu.org\n") != NULL);
+    g_assert(strstr(info, "Date=2000-06-24\n") != NULL);
+    g_assert(strstr(info, "Codeset=UTF-8\n") != NULL);
+    g_assert(moreinfo_lookup_with_prefix("COMP", "en_US.utf8") == info);
+
+    info = locale_get_info("de_DE.utf8");
+    g_assert(strstr(info, "(German locale for Germany &amp; co)\n") != NULL);
+    g_assert(strstr(info, "Address=Boston\n") != NULL);
+
+    info = locale_get_info("fr_FR.utf8");
+    g_assert(strstr(info, "Name=fr_FR.utf8 ((Unknown))\n") != NULL);
+    g_assert(strstr(info, "Codeset=ISO-8859-1\n") != NULL);
+
+    info = locale_get_info("C.utf8");
+    g_assert(strstr(info, "Name=C.utf8 (C locale)\n") != NULL);
+    g_assert(strstr(info, "Codeset=ANSI_X3.4-1968\n") != NULL);
+
+    /* only what the scan found */
+    g_assert(locale_get_info("xx_XX") == NULL);
+    g_assert(locale_get_info("junk") == NULL);
+    g_assert(locale_get_info("../etc") == NULL);
+
+    g_free(list);
+}
+
+static void test_truncated(void)
+{
+    gsize len;
+
+    for (len = 0; len < archive->len; len++) {
+        gchar *list, *info;
+
+        write_archive(len);
+        list = scan_languages_native();
+        /* the directory is still there whatever the archive holds */
+        g_assert(list != NULL);
+        g_assert(strstr(list, "$C.utf8$C.utf8=C locale\n") != NULL);
+        if (strstr(list, "$en_US.utf8$")) {
+            info = locale_get_info("en_US.utf8");
+            g_assert(info != NULL);
+        }
+        g_free(list);
+    }
+    write_archive(archive->len);
+}
+
+static void test_bad_header(void)
+{
+    struct locarhead head;
+    gchar *list;
+
+    memcpy(&head, archive->data, sizeof(head));
+    head.namehash_size = G_MAXUINT32 / sizeof(struct namehashent);
+    memcpy(archive->data, &head, sizeof(head));
+    write_archive(archive->len);
+
+    /* a name table that cannot fit is not read at all */
+    list = scan_languages_native();
+    g_assert_cmpstr(list, ==, "$C.utf8$C.utf8=C locale\n"
+                              "$en_US.utf8$en_US.utf8=shadowed by the archive\n");
+    g_free(list);
+}
+
+static void rm_rf(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+
+    if (dir) {
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+
+            rm_rf(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+        g_rmdir(path);
+    } else {
+        g_unlink(path);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    locale_dir = g_dir_make_tmp("test_languages-XXXXXX", NULL);
+    g_assert(locale_dir != NULL);
+    setup();
+
+    g_test_add_func("/languages/scan", test_scan);
+    g_test_add_func("/languages/info", test_info);
+    g_test_add_func("/languages/truncated", test_truncated);
+    g_test_add_func("/languages/bad-header", test_bad_header);
+    ret = g_test_run();
+
+    g_byte_array_unref(archive);
+    rm_rf(locale_dir);
+    g_free(locale_dir);
+    return ret;
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    return 77; /* no compiled glibc locales here */
+}
+
+#endif /* LOCALE_NATIVE */
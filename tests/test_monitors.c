@@ -0,0 +1,267 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Monitors scans against a fake /sys/class/drm, with the uevent socket
+ * replaced by one end of a socketpair the test writes kernel-style
+ * uevents to. EDIDs are only read again after a drm uevent, a reload, or
+ * at every scan when there is no socket; status and enabled are read at
+ * every scan.
+ */
+
+#include <sys/socket.h>
+#include <glib/gstdio.h>
+
+static char *drm_dir;
+#define DRM_CLASS_DIR drm_dir
+/* the socket monitors.c opens; uevent_drain() is the real one */
+#define uevent_open test_uevent_open
+#include "../modules/devices/monitors.c"
+#undef uevent_open
+
+static gchar *tmp_dir;
+static int events[2] = { -1, -1 };
+static gboolean no_socket;
+
+int test_uevent_open(void)
+{
+    return no_socket ? -1 : events[0];
+}
+
+/* what vendor.c would find for the PNP id: nothing */
+gchar *vendor_match_tag(const gchar *vendor_str, int fmt_opts) { return NULL; }
+gchar *vendor_get_link(const gchar *v_str) { return g_strdup(v_str); }
+
+static void send_uevent(const gchar *action, const gchar *subsystem)
+{
+    gchar buf[256];
+    gint len;
+
+    len = g_snprintf(buf, sizeof(buf), "%s@/devices/test", action);
+    len += g_snprintf(buf + len + 1, sizeof(buf) - len - 1, "ACTION=%s", action) + 1;
+    len += g_snprintf(buf + len + 1, sizeof(buf) - len - 1, "SUBSYSTEM=%s", subsystem) + 1;
+    g_assert_cmpint(send(events[1], buf, len + 1, 0), ==, len + 1);
+}
+
+/* a 128-byte EDID from vendor ABC with a monitor name descriptor */
+static void write_edid(const gchar *conn, const gchar *name)
+{
+    guchar e[128] = { 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00 };
+    guint16 pnp = ('A' - '@') << 10 | ('B' - '@') << 5 | ('C' - '@');
+    gchar *path = g_build_filename(drm_dir, conn, "edid", NULL);
+    guchar sum = 0;
+    gint i;
+
+    e[8] = pnp >> 8;
+    e[9] = pnp & 0xff;
+    e[10] = 0x34;
+    e[16] = 1;
+    e[17] = 30;  /* 2020 */
+    e[18] = 1;
+    e[19] = 4;
+    e[20] = 0xa5; /* digital, 8 bits, DisplayPort */
+    for (i = 38; i < 54; i++)
+        e[i] = 1; /* no standard timings */
+    /* four display descriptors, the first one the name */
+    for (i = 54; i < 126; i += 18)
+        e[i + 3] = 0x10;
+    e[57] = 0xfc;
+    memset(e + 59, ' ', 13);
+    memcpy(e + 59, name, strlen(name));
+    e[59 + strlen(name)] = '\n';
+    for (i = 0; i < 127; i++)
+        sum += e[i];
+    e[127] = -sum;
+
+    g_assert_true(g_file_set_contents(path, (gchar *)e, sizeof(e), NULL));
+    g_free(path);
+}
+
+static void write_attr(const gchar *conn, const gchar *attr, const gchar *value)
+{
+    gchar *path = g_build_filename(drm_dir, conn, attr, NULL);
+
+    g_assert_true(g_file_set_contents(path, value, -1, NULL));
+    g_free(path);
+}
+
+static void add_connector(const gchar *conn, const gchar *status, const gchar *name)
+{
+    gchar *path = g_build_filename(drm_dir, conn, NULL);
+
+    g_assert_cmpint(g_mkdir_with_parents(path, 0755), ==, 0);
+    write_attr(conn, "status", status);
+    write_attr(conn, "enabled", "enabled\n");
+    if (name)
+        write_edid(conn, name);
+    else
+        write_attr(conn, "edid", "");
+    g_free(path);
+}
+
+/* the page's row for the connector, or NULL */
+static gchar *scan_row(gboolean reload, const gchar *conn)
+{
+    gchar *info = monitors_get_info(reload), *row = NULL;
+    gchar **lines = g_strsplit(info, "\n", -1);
+    gchar *suffix = g_strdup_printf("$%s=", conn);
+    gint i;
+
+    for (i = 0; lines[i]; i++)
+        if (g_str_has_prefix(lines[i], "$!") && strstr(lines[i], suffix))
+            row = g_strdup(strstr(lines[i], suffix) + strlen(suffix));
+
+    g_free(suffix);
+    g_strfreev(lines);
+    g_free(info);
+    return row;
+}
+
+static void assert_row(gboolean reload, const gchar *conn, const gchar *expected)
+{
+    gchar *row = scan_row(reload, conn);
+
+    g_assert_cmpstr(row, ==, expected);
+    g_free(row);
+}
+
+static void assert_status(const gchar *conn, const gchar *expected)
+{
+    gchar *tag = tag_make_safe_inplace(g_strdup_printf("0-%s", conn)), *details;
+
+    details = moreinfo_lookup_with_prefix("DEV", tag);
+    g_assert(details != NULL);
+    g_assert(strstr(details, expected) != NULL);
+    g_free(tag);
+}
+
+static void test_first_scan(void)
+{
+    add_connector("card0-DP-1", "disconnected\n", NULL);
+    add_connector("card0-HDMI-A-1", "connected\n", "Alpha");
+    write_attr("version", NULL, "drm 1.1.0");
+
+    assert_row(FALSE, "card0-HDMI-A-1", "ABC Alpha");
+    assert_status("card0-HDMI-A-1", "Status=connected enabled\n");
+    g_assert_null(scan_row(FALSE, "card0-DP-1"));
+}
+
+static void test_no_event(void)
+{
+    /* the EDID changes without an event: the kept decode is used, but
+     * status and enabled are read again */
+    write_edid("card0-HDMI-A-1", "Beta");
+    write_attr("card0-HDMI-A-1", "enabled", "disabled\n");
+    assert_row(FALSE, "card0-HDMI-A-1", "ABC Alpha");
+    assert_status("card0-HDMI-A-1", "Status=connected disabled\n");
+
+    /* events from other subsystems don't count */
+    send_uevent("change", "usb");
+    send_uevent("add", "power_supply");
+    assert_row(FALSE, "card0-HDMI-A-1", "ABC Alpha");
+}
+
+static void test_drm_event(void)
+{
+    send_uevent("change", "drm");
+    assert_row(FALSE, "card0-HDMI-A-1", "ABC Beta");
+    /* drained: the next scan keeps it */
+    write_edid("card0-HDMI-A-1", "Gamma");
+    assert_row(FALSE, "card0-HDMI-A-1", "ABC Beta");
+}
+
+static void test_reload(void)
+{
+    assert_row(TRUE, "card0-HDMI-A-1", "ABC Gamma");
+}
+
+static void test_hotplug(void)
+{
+    add_connector("card0-DP-1", "connected\n", "Delta");
+    write_attr("card0-HDMI-A-1", "status", "disconnected\n");
+    send_uevent("change", "drm");
+    assert_row(FALSE, "card0-DP-1", "ABC Delta");
+    g_assert_null(scan_row(FALSE, "card0-HDMI-A-1"));
+
+    /* back, and decoded again as its entry was dropped */
+    write_attr("card0-HDMI-A-1", "status", "connected\n");
+    write_edid("card0-HDMI-A-1", "Epsilon");
+    assert_row(FALSE, "card0-HDMI-A-1", "ABC Epsilon");
+}
+
+static void test_no_socket(void)
+{
+    /* as if the first scan had failed to open the socket */
+    drm_uevent_fd = -2;
+    no_socket = TRUE;
+
+    write_edid("card0-DP-1", "Zeta");
+    assert_row(FALSE, "card0-DP-1", "ABC Zeta");
+    write_edid("card0-DP-1", "Eta");
+    assert_row(FALSE, "card0-DP-1", "ABC Eta");
+}
+
+static void rm_rf(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+
+    if (dir) {
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+
+            rm_rf(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+        g_rmdir(path);
+    } else {
+        g_unlink(path);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    tmp_dir = g_dir_make_tmp("test_monitors-XXXXXX", NULL);
+    g_assert(tmp_dir != NULL);
+    drm_dir = g_build_filename(tmp_dir, "drm", NULL);
+    g_mkdir_with_parents(drm_dir, 0755);
+    /* no edid.ids or ieee_oui.ids anywhere */
+    params.path_data = tmp_dir;
+    g_setenv("XDG_CONFIG_HOME", tmp_dir, TRUE);
+    g_assert_cmpint(socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, events), ==, 0);
+
+    g_test_add_func("/monitors/first-scan", test_first_scan);
+    g_test_add_func("/monitors/no-event", test_no_event);
+    g_test_add_func("/monitors/drm-event", test_drm_event);
+    g_test_add_func("/monitors/reload", test_reload);
+    g_test_add_func("/monitors/hotplug", test_hotplug);
+    g_test_add_func("/monitors/no-socket", test_no_socket);
+    ret = g_test_run();
+
+    close(events[0]);
+    close(events[1]);
+    rm_rf(tmp_dir);
+    g_free(drm_dir);
+    g_free(tmp_dir);
+    return ret;
+}
@@ -0,0 +1,486 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * The IPP client: HTTP bodies and IPP responses decoded from hand-made
+ * ones, then whole scans against a minimal IPP stand-in for cupsd that
+ * answers CUPS-Get-Printers on a loopback port, chunked or not, late or
+ * not at all. lpoptions files live in a temporary HOME and server root.
+ */
+
+static int ipp_port;
+static char *server_root;
+#define IPP_PORT ipp_port
+#define IPP_DEADLINE 600
+#define IPP_FIRST_WAIT 200
+#define CUPS_SERVERROOT server_root
+#include "../modules/devices/printers.c"
+#include <glib/gstdio.h>
+
+gchar *printer_list = NULL;
+gchar *printer_icons = NULL;
+
+static gchar *tmp_dir;
+
+typedef struct {
+    const gchar *name, *info;
+    guint32 type;
+} Queue;
+
+enum {
+    SERVE_CHUNKED,
+    SERVE_LENGTH,
+    SERVE_NONE,     /* client-error-not-found */
+    SERVE_STALL,    /* answers after the client's deadline */
+};
+
+static int listen_fd = -1;
+static GThread *server_thread;
+static int serve_mode = SERVE_CHUNKED;
+static const Queue *queues;
+static guint n_queues;
+
+static void add_int(GByteArray *b, guint8 tag, const char *name, guint32 value)
+{
+    guint16 nlen = htons(strlen(name)), vlen = htons(4);
+
+    value = htonl(value);
+    g_byte_array_append(b, &tag, 1);
+    g_byte_array_append(b, (guint8 *)&nlen, 2);
+    g_byte_array_append(b, (const guint8 *)name, strlen(name));
+    g_byte_array_append(b, (guint8 *)&vlen, 2);
+    g_byte_array_append(b, (guint8 *)&value, 4);
+}
+
+/* a CUPS-Get-Printers response body for the queues */
+static GByteArray *ipp_response(const Queue *q, guint n, guint16 status)
+{
+    guint8 head[] = { 2, 0, status >> 8, status & 0xff, 0, 0, 0, 1, 0x01 };
+    guint8 tag;
+    GByteArray *b = g_byte_array_new();
+    guint i;
+
+    g_byte_array_append(b, head, sizeof(head));
+    ipp_add_attr(b, 0x47, "attributes-charset", "utf-8");
+    ipp_add_attr(b, 0x48, "attributes-natural-language", "en");
+    for (i = 0; i < n; i++) {
+        tag = 0x04;
+        g_byte_array_append(b, &tag, 1);
+        ipp_add_attr(b, 0x42, "printer-name", q[i].name);
+        ipp_add_attr(b, 0x41, "printer-info", q[i].info);
+        add_int(b, 0x23, "printer-type", q[i].type);
+        add_int(b, 0x23, "printer-state", 3);
+        ipp_add_attr(b, 0x44, "printer-state-reasons", "none");
+        ipp_add_attr(b, 0x44, NULL, "media-low");
+        ipp_add_attr(b, 0x44, "media-default", "iso_a4_210x297mm");
+        /* not shown: an unknown value type */
+        ipp_add_attr(b, 0x30, "printer-uuid", "\x01\x02");
+    }
+    tag = 0x03;
+    g_byte_array_append(b, &tag, 1);
+
+    return b;
+}
+
+static void send_all(int fd, const void *data, gsize len)
+{
+    const gchar *p = data;
+
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0)
+            return;
+        p += n;
+        len -= n;
+    }
+}
+
+/* one HTTP exchange: reads the whole request, answers by serve_mode */
+static gpointer serve_client(gpointer data)
+{
+    int fd = GPOINTER_TO_INT(data);
+    GString *req = g_string_new(NULL);
+    gchar buf[4096], *hdr_end = NULL, *cl;
+    gsize want = 0;
+    GByteArray *body;
+    guint i;
+
+    for (;;) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+
+        if (n <= 0)
+            goto out;
+        g_string_append_len(req, buf, n);
+        if (!hdr_end && (hdr_end = strstr(req->str, "\r\n\r\n"))) {
+            cl = g_strstr_len(req->str, hdr_end - req->str, "Content-Length: ");
+            g_assert(cl != NULL);
+            want = hdr_end + 4 - req->str + strtoul(cl + 16, NULL, 10);
+        }
+        if (hdr_end && req->len >= want)
+            break;
+    }
+    g_assert(g_str_has_prefix(req->str, "POST / HTTP/1.1\r\n"));
+    hdr_end = strstr(req->str, "\r\n\r\n") + 4;
+    /* CUPS-Get-Printers */
+    g_assert_cmpint((guint8)hdr_end[2], ==, 0x40);
+    g_assert_cmpint((guint8)hdr_end[3], ==, 0x02);
+
+    switch (serve_mode) {
+    case SERVE_STALL:
+        g_usleep((IPP_DEADLINE + 300) * 1000);
+        goto out;
+    case SERVE_NONE:
+        body = ipp_response(NULL, 0, 0x0406);
+        break;
+    default:
+        body = ipp_response(queues, n_queues, 0);
+    }
+
+    if (serve_mode == SERVE_LENGTH) {
+        gchar *head = g_strdup_printf("HTTP/1.1 200 OK\r\n"
+                                      "Content-Type: application/ipp\r\n"
+                                      "Content-Length: %u\r\n\r\n", body->len);
+        send_all(fd, head, strlen(head));
+        send_all(fd, body->data, body->len);
+        g_free(head);
+    } else {
+        const gchar *head = "HTTP/1.1 200 OK\r\n"
+                            "Content-Type: application/ipp\r\n"
+                            "Transfer-Encoding: chunked\r\n\r\n";
+        send_all(fd, head, strlen(head));
+        /* small chunks so that sizes, data and CRLFs mix in reads */
+        for (i = 0; i < body->len; i += 37) {
+            guint size = MIN(37, body->len - i);
+            gchar *line = g_strdup_printf("%x\r\n", size);
+
+            send_all(fd, line, strlen(line));
+            send_all(fd, body->data + i, size);
+            send_all(fd, "\r\n", 2);
+            g_free(line);
+        }
+        send_all(fd, "0\r\n\r\n", 5);
+    }
+    g_byte_array_free(body, TRUE);
+
+out:
+    g_string_free(req, TRUE);
+    close(fd);
+    return NULL;
+}
+
+static gpointer server_func(gpointer data)
+{
+    int fd;
+
+    /* each exchange on its own thread, so a stalled one holds up nothing */
+    while ((fd = accept(listen_fd, NULL, NULL)) >= 0)
+        g_thread_unref(g_thread_new("ipp-client", serve_client, GINT_TO_POINTER(fd)));
+    return NULL;
+}
+
+static void server_start(void)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr(IPP_HOST);
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    g_assert_cmpint(listen_fd, >=, 0);
+    g_assert_cmpint(bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)), ==, 0);
+    g_assert_cmpint(listen(listen_fd, 8), ==, 0);
+    g_assert_cmpint(getsockname(listen_fd, (struct sockaddr *)&addr, &len), ==, 0);
+    ipp_port = ntohs(addr.sin_port);
+    server_thread = g_thread_new("ipp-server", server_func, NULL);
+}
+
+static void server_stop(void)
+{
+    if (listen_fd < 0)
+        return;
+    shutdown(listen_fd, SHUT_RDWR);
+    g_thread_join(server_thread);
+    close(listen_fd);
+    listen_fd = -1;
+}
+
+static void wait_worker(void)
+{
+    gint64 until = ipp_now_ms() + IPP_DEADLINE + 1000;
+    gboolean done = FALSE;
+
+    while (!done) {
+        G_LOCK(ipp);
+        done = ipp_worker_done;
+        G_UNLOCK(ipp);
+        g_assert_cmpint(ipp_now_ms(), <, until);
+        g_usleep(10000);
+    }
+}
+
+/* a scan shows what the worker the previous one started got: one scan to
+ * start a worker that sees the current setup, one to show its answer */
+static const gchar *scan_fresh(void)
+{
+    wait_worker();
+    scan_printers_do();
+    wait_worker();
+    scan_printers_do();
+    return printer_list;
+}
+
+static void write_lpoptions(const gchar *dir, const gchar *contents)
+{
+    gchar *path = g_build_filename(dir, "lpoptions", NULL);
+
+    g_mkdir_with_parents(dir, 0755);
+    if (contents)
+        g_assert_true(g_file_set_contents(path, contents, -1, NULL));
+    else
+        g_unlink(path);
+    g_free(path);
+}
+
+/* "Office Laser" and "Office_Laser" only differ in what the tag replaces */
+static const Queue office[] = {
+    { "Office Laser", "Laser, 2nd floor", 0x20000 | 0x4 },
+    { "Office_Laser", "Laser, 3rd floor", 0x4 },
+    { "Home-Ink", "Inkjet & scanner", 0x8 },
+};
+
+static void http_body_is(const gchar *resp, gboolean ok, const gchar *expected)
+{
+    GByteArray *b = g_byte_array_new();
+    const guint8 *body;
+    gsize len;
+
+    g_byte_array_append(b, (const guint8 *)resp, strlen(resp));
+    g_assert_cmpint(ipp_http_body(b, &body, &len), ==, ok);
+    if (ok) {
+        g_assert_cmpuint(len, ==, strlen(expected));
+        g_assert(memcmp(body, expected, len) == 0);
+    }
+    g_byte_array_free(b, TRUE);
+}
+
+static void test_http_body(void)
+{
+    http_body_is("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello", TRUE, "hello");
+    http_body_is("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                 "3\r\nhel\r\n2;ext=1\r\nlo\r\n0\r\n\r\n", TRUE, "hello");
+    http_body_is("HTTP/1.1 404 Not Found\r\n\r\n", FALSE, NULL);
+    http_body_is("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n", FALSE, NULL);
+    /* chunks that are damaged, too long or cut short */
+    http_body_is("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                 "x\r\nhello\r\n0\r\n\r\n", FALSE, NULL);
+    http_body_is("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                 "6\r\nhello\r\n", FALSE, NULL);
+    http_body_is("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                 "ffffffffffffffff\r\nhello\r\n0\r\n\r\n", FALSE, NULL);
+    http_body_is("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                 "5\r\nhello\r\n", FALSE, NULL);
+    http_body_is("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                 "5\r\nhello", FALSE, NULL);
+    http_body_is("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                 "5\r\nhel", FALSE, NULL);
+}
+
+static void test_parse(void)
+{
+    GByteArray *b = ipp_response(office, G_N_ELEMENTS(office), 0);
+    GPtrArray *printers = ipp_parse_printers(b->data, b->len);
+    IppPrinter *p;
+    gsize len;
+
+    g_assert(printers != NULL);
+    g_assert_cmpuint(printers->len, ==, 3);
+    p = g_ptr_array_index(printers, 0);
+    g_assert_cmpstr(p->name, ==, "Office Laser");
+    g_assert_cmpstr(g_hash_table_lookup(p->attrs, "printer-type"), ==, "131076");
+    g_assert_cmpstr(g_hash_table_lookup(p->attrs, "printer-state-reasons"), ==, "none,media-low");
+    g_assert_cmpstr(g_hash_table_lookup(p->attrs, "media"), ==, "iso_a4_210x297mm");
+    g_assert_null(g_hash_table_lookup(p->attrs, "printer-uuid"));
+    g_ptr_array_free(printers, TRUE);
+
+    /* cut anywhere, it is refused or read up to the cut */
+    for (len = 0; len < b->len; len++) {
+        printers = ipp_parse_printers(b->data, len);
+        if (printers)
+            g_ptr_array_free(printers, TRUE);
+    }
+    g_byte_array_free(b, TRUE);
+
+    b = ipp_response(NULL, 0, 0x0406);
+    printers = ipp_parse_printers(b->data, b->len);
+    g_assert(printers != NULL);
+    g_assert_cmpuint(printers->len, ==, 0);
+    g_ptr_array_free(printers, TRUE);
+    g_byte_array_free(b, TRUE);
+
+    b = ipp_response(NULL, 0, 0x0500);
+    g_assert_null(ipp_parse_printers(b->data, b->len));
+    g_byte_array_free(b, TRUE);
+}
+
+static void test_scan_timeout(void)
+{
+    /* nothing before the deadline: nothing to show yet */
+    serve_mode = SERVE_STALL;
+    scan_printers_do();
+    g_assert_cmpstr(printer_list, ==, "[Printers]\nCUPS did not answer in time=\n");
+    wait_worker();
+    scan_printers_do();
+    g_assert_cmpstr(printer_list, ==, "[Printers]\nCUPS did not answer in time=\n");
+    serve_mode = SERVE_CHUNKED;
+}
+
+static void test_scan_list(void)
+{
+    queues = office;
+    n_queues = G_N_ELEMENTS(office);
+
+    g_assert_cmpstr(scan_fresh(), ==,
+        "[Printers (CUPS)]\n"
+        "\n$PRN_Office_Laser$Office Laser=(Default)\n"
+        "\n$PRN_Office_Laser_2$Office_Laser=\n"
+        "\n$PRN_Home-Ink$Home-Ink=\n");
+    g_assert(strstr(moreinfo_lookup("DEV:PRN_Office_Laser"), "Destination Name=Laser, 2nd floor\n"));
+    g_assert(strstr(moreinfo_lookup("DEV:PRN_Office_Laser_2"), "Destination Name=Laser, 3rd floor\n"));
+    g_assert(strstr(moreinfo_lookup("DEV:PRN_Home-Ink"), "Destination Name=Inkjet   scanner\n"));
+    g_assert(strstr(moreinfo_lookup("DEV:PRN_Home-Ink"), "State=Idle\n"));
+
+    /* the same with a Content-Length body */
+    serve_mode = SERVE_LENGTH;
+    g_assert(strstr(scan_fresh(), "\n$PRN_Office_Laser_2$Office_Laser=\n"));
+    serve_mode = SERVE_CHUNKED;
+}
+
+static void test_scan_lpoptions(void)
+{
+    gchar *user_dir = g_build_filename(tmp_dir, ".cups", NULL);
+
+    write_lpoptions(server_root, "Default Home-Ink\n");
+    g_assert(strstr(scan_fresh(), "\n$PRN_Office_Laser$Office Laser=\n"
+                                  "\n$PRN_Office_Laser_2$Office_Laser=\n"
+                                  "\n$PRN_Home-Ink$Home-Ink=(Default)\n"));
+
+    /* the user's file wins, instances name their printer */
+    write_lpoptions(user_dir, "Dest Home-Ink/draft\n"
+                              "Default office_laser/duplex sides=two-sided-long-edge\n");
+    g_assert(strstr(scan_fresh(), "\n$PRN_Office_Laser$Office Laser=\n"
+                                  "\n$PRN_Office_Laser_2$Office_Laser=(Default)\n"
+                                  "\n$PRN_Home-Ink$Home-Ink=\n"));
+
+    /* one without a Default line falls back to the system's */
+    write_lpoptions(user_dir, "Dest Home-Ink/draft\n");
+    g_assert(strstr(scan_fresh(), "\n$PRN_Home-Ink$Home-Ink=(Default)\n"));
+
+    /* a printer that is gone leaves it to cupsd */
+    write_lpoptions(user_dir, "Default Basement\n");
+    g_assert(strstr(scan_fresh(), "\n$PRN_Office_Laser$Office Laser=(Default)\n"
+                                  "\n$PRN_Office_Laser_2$Office_Laser=\n"
+                                  "\n$PRN_Home-Ink$Home-Ink=\n"));
+
+    write_lpoptions(user_dir, NULL);
+    write_lpoptions(server_root, NULL);
+    g_free(user_dir);
+}
+
+static void test_scan_removed(void)
+{
+    /* the first one leaves; the other takes the plain tag */
+    queues = office + 1;
+    n_queues = G_N_ELEMENTS(office) - 1;
+    g_assert_cmpstr(scan_fresh(), ==,
+        "[Printers (CUPS)]\n"
+        "\n$PRN_Office_Laser$Office_Laser=\n"
+        "\n$PRN_Home-Ink$Home-Ink=\n");
+    g_assert(strstr(moreinfo_lookup("DEV:PRN_Office_Laser"), "Destination Name=Laser, 3rd floor\n"));
+    g_assert_null(moreinfo_lookup("DEV:PRN_Office_Laser_2"));
+    g_assert(moreinfo_lookup("DEV:PRN_Home-Ink") != NULL);
+}
+
+static void test_scan_none(void)
+{
+    serve_mode = SERVE_NONE;
+    g_assert_cmpstr(scan_fresh(), ==, "[Printers]\nNo printers found=\n");
+    g_assert_null(moreinfo_lookup("DEV:PRN_Office_Laser"));
+    g_assert_null(moreinfo_lookup("DEV:PRN_Home-Ink"));
+    serve_mode = SERVE_CHUNKED;
+}
+
+static void test_scan_no_cupsd(void)
+{
+    g_assert(strstr(scan_fresh(), "$PRN_Home-Ink$"));
+    server_stop();
+    g_assert_cmpstr(scan_fresh(), ==, "[Printers]\nNo printers found=\n");
+}
+
+static void rm_rf(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+
+    if (dir) {
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+
+            rm_rf(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+        g_rmdir(path);
+    } else {
+        g_unlink(path);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    tmp_dir = g_dir_make_tmp("test_printers-XXXXXX", NULL);
+    g_assert(tmp_dir != NULL);
+    /* before anything asks GLib for it */
+    g_setenv("HOME", tmp_dir, TRUE);
+    server_root = g_build_filename(tmp_dir, "etc-cups", NULL);
+
+    g_test_init(&argc, &argv, NULL);
+    server_start();
+
+    g_test_add_func("/printers/http-body", test_http_body);
+    g_test_add_func("/printers/parse", test_parse);
+    g_test_add_func("/printers/scan/timeout", test_scan_timeout);
+    g_test_add_func("/printers/scan/list", test_scan_list);
+    g_test_add_func("/printers/scan/lpoptions", test_scan_lpoptions);
+    g_test_add_func("/printers/scan/removed", test_scan_removed);
+    g_test_add_func("/printers/scan/none", test_scan_none);
+    g_test_add_func("/printers/scan/no-cupsd", test_scan_no_cupsd);
+    ret = g_test_run();
+
+    server_stop();
+    printers_shutdown();
+    g_free(printer_list);
+    g_free(printer_icons);
+    rm_rf(tmp_dir);
+    g_free(server_root);
+    g_free(tmp_dir);
+    return ret;
+}
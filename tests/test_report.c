@@ -0,0 +1,321 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Streamed reports, built from a synthetic module: the streamed output is
+ * the same as the in-memory one, and the memory used while streaming
+ * stays bounded by one page instead of growing with the report. JSON and
+ * CBOR reports come out the same whatever the message locale.
+ */
+
+#include <locale.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <hardinfo.h>
+#include <report.h>
+#include <iconcache.h>
+#include <inventory.h>
+#include "uri_handler.h"
+
+ProgramParameters params = { 0 };
+
+/* what report.c needs from the rest of hardinfo2; pages here only use
+ * plain keys, so the key helpers never see flags */
+gboolean key_is_flagged(const gchar *key) { return FALSE; }
+gboolean key_is_highlighted(const gchar *key) { return FALSE; }
+gboolean key_wants_details(const gchar *key) { return FALSE; }
+gchar *key_mi_tag(const gchar *key) { return NULL; }
+const gchar *key_get_name(const gchar *key) { return key; }
+void key_get_components(const gchar *key, gchar **flags, gchar **tag,
+                        gchar **name, gchar **label, gchar **dis)
+{
+    if (name)
+        *name = g_strdup(key);
+    if (label) {
+        *label = g_strdup(key);
+        strend(*label, '#');
+    }
+}
+
+char *strend(gchar *str, gchar chr)
+{
+    gchar *p;
+
+    if (str && (p = strchr(str, chr)))
+        *p = 0;
+    return str;
+}
+
+void module_entry_reload(ShellModuleEntry *entry) { }
+void module_entry_scan(ShellModuleEntry *entry) { entry->scan_func(FALSE); }
+gchar *module_entry_function(ShellModuleEntry *entry) { return entry->func(); }
+gchar *module_entry_get_moreinfo(ShellModuleEntry *entry, gchar *field) { return NULL; }
+
+gchar *inventory_entry_id(ShellModule *module, ShellModuleEntry *entry) { return NULL; }
+gchar *inventory_entry_token(ShellModuleEntry *entry) { return NULL; }
+gchar *inventory_get(const gchar *id, const gchar *token) { return NULL; }
+gchar *inventory_get_moreinfo(const gchar *id, const gchar *tag) { return NULL; }
+void inventory_put(const gchar *id, const gchar *token, const gchar *data) { }
+void inventory_put_moreinfo(const gchar *id, const gchar *tag, const gchar *data) { }
+
+void file_chooser_open_expander(GtkWidget *chooser) { }
+void file_chooser_add_filters(GtkWidget *chooser, FileTypes *filters) { }
+gchar *file_chooser_get_extension(GtkWidget *chooser, FileTypes *filters) { return NULL; }
+gchar *file_chooser_build_filename(GtkWidget *chooser, gchar *extension) { return NULL; }
+gpointer file_types_get_data_by_name(FileTypes *file_types, gchar *name) { return NULL; }
+GdkPixbuf *icon_cache_get_pixbuf(const gchar *file) { return NULL; }
+GtkWidget *icon_cache_get_image_at_size(const gchar *file, gint wid, gint hei) { return NULL; }
+Shell *shell_get_main_shell() { return NULL; }
+void shell_status_update(const gchar *message) { }
+void shell_status_set_enabled(gboolean setting) { }
+void shell_view_set_enabled(gboolean setting) { }
+gboolean uri_open(const gchar *uri) { return FALSE; }
+
+/* the synthetic module: PAGES pages of ROWS rows each */
+#define PAGES 64
+#define ROWS  4096
+
+static gint pages_scanned;
+
+static void synthetic_scan(gboolean reload)
+{
+    pages_scanned++;
+}
+
+static gchar *synthetic_page(void)
+{
+    GString *page = g_string_new(NULL);
+    gint row;
+
+    for (row = 0; row < ROWS; row++) {
+        if (row % 512 == 0)
+            g_string_append_printf(page, "[Group %d]\n", row / 512);
+        g_string_append_printf(page, "Row %d=value %d of page %d, padded to look like a "
+                               "device description\n", row, row * 7, pages_scanned);
+    }
+
+    return g_string_free(page, FALSE);
+}
+
+static GSList *synthetic_modules(gint pages)
+{
+    ShellModule *module = g_new0(ShellModule, 1);
+    gint i;
+
+    module->name = g_strdup("Synthetic");
+    for (i = 0; i < pages; i++) {
+        ShellModuleEntry *entry = g_new0(ShellModuleEntry, 1);
+
+        entry->name = g_strdup_printf("Page %d", i);
+        entry->msgid = entry->name;
+        entry->icon_file = "";
+        entry->func = synthetic_page;
+        entry->scan_func = synthetic_scan;
+        module->entries = g_slist_append(module->entries, entry);
+    }
+
+    return g_slist_append(NULL, module);
+}
+
+/* peak resident set since the last reset, in kB; 0 if unknown */
+static glong peak_rss_kb(gboolean reset)
+{
+    gchar *status = NULL, *p;
+    glong kb = 0;
+
+    if (reset)
+        g_file_set_contents("/proc/self/clear_refs", "5", 1, NULL);
+    if (g_file_get_contents("/proc/self/status", &status, NULL, NULL)
+        && (p = strstr(status, "VmHWM:")))
+        kb = strtol(p + 6, NULL, 10);
+    g_free(status);
+
+    return kb;
+}
+
+static void check_same_output(ReportFormat format)
+{
+    gchar *path, *streamed = NULL, *built;
+    gint fd;
+    FILE *out;
+
+    fd = g_file_open_tmp("test_report-XXXXXX", &path, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+
+    pages_scanned = 0;
+    out = fopen(path, "w");
+    g_assert(out != NULL);
+    g_assert_true(report_create_to_stream(out, synthetic_modules(3), format));
+    fclose(out);
+    g_assert_true(g_file_get_contents(path, &streamed, NULL, NULL));
+
+    pages_scanned = 0;
+    built = report_create_from_module_list_format(synthetic_modules(3), format);
+    g_assert(built != NULL);
+
+    g_assert_cmpuint(strlen(streamed), ==, strlen(built));
+    g_assert_cmpstr(streamed, ==, built);
+    g_assert(strstr(built, "Row 4095") != NULL);
+
+    g_unlink(path);
+    g_free(path);
+    g_free(streamed);
+    g_free(built);
+}
+
+static void test_same_text(void)
+{
+    check_same_output(REPORT_FORMAT_TEXT);
+}
+
+static void test_same_html(void)
+{
+    check_same_output(REPORT_FORMAT_HTML);
+}
+
+static void test_same_shell(void)
+{
+    check_same_output(REPORT_FORMAT_SHELL);
+}
+
+/* a report many times larger than one page must not need memory in
+ * proportion to its size */
+static void test_bounded(void)
+{
+    FILE *out = fopen("/dev/null", "w");
+    glong before, after, written;
+    gchar *page;
+
+    g_assert(out != NULL);
+
+    /* one page, to know how large the report is going to be */
+    page = synthetic_page();
+    written = strlen(page) / 1024 * PAGES;
+    g_free(page);
+
+    before = peak_rss_kb(TRUE);
+    if (!before) {
+        g_test_skip("no VmHWM in /proc/self/status");
+        fclose(out);
+        return;
+    }
+
+    pages_scanned = 0;
+    g_assert_true(report_create_to_stream(out, synthetic_modules(PAGES), REPORT_FORMAT_TEXT));
+    fclose(out);
+    after = peak_rss_kb(FALSE);
+
+    g_assert_cmpint(pages_scanned, ==, PAGES);
+    g_test_message("report %ld kB, peak grew by %ld kB", written, after - before);
+    g_assert_cmpint(after - before, <, written / 4);
+}
+
+/* stands in for a page built with _(): labels follow the message locale */
+static gchar *translated_page(void)
+{
+    gboolean c = g_str_equal(setlocale(LC_MESSAGES, NULL), "C");
+
+    return g_strdup_printf("[%s]\n%s=%s\n", c ? "Sound Devices" : "Audiogeräte",
+                           c ? "Vendor" : "Hersteller", c ? "Unknown" : "Unbekannt");
+}
+
+static gchar *structured(ReportFormat format, gsize *length)
+{
+    ShellModule module = { 0 };
+    ShellModuleEntry entry = { 0 };
+    GSList *modules;
+    gchar *data = NULL;
+    FILE *out;
+
+    module.name = "Devices";
+    module.dll = g_module_open(NULL, 0);
+    entry.name = entry.icon_file = "";
+    entry.msgid = "Sound";
+    entry.func = translated_page;
+    entry.scan_func = synthetic_scan;
+    module.entries = g_slist_append(NULL, &entry);
+    modules = g_slist_append(NULL, &module);
+
+    out = open_memstream(&data, length);
+    g_assert(out != NULL);
+    report_create_structured(out, modules, format, NULL);
+    fclose(out);
+
+    g_slist_free(module.entries);
+    g_slist_free(modules);
+    return data;
+}
+
+static void test_structured_locale(void)
+{
+    static const gchar *locales[] = { "C.UTF-8", "C.utf8", "en_US.UTF-8", "de_DE.UTF-8", NULL };
+    const gchar *other = NULL;
+    gchar *json_c, *json_other, *cbor_c, *cbor_other;
+    gsize json_len, cbor_c_len, cbor_other_len;
+    gint i;
+
+    for (i = 0; locales[i] && !other; i++)
+        if (setlocale(LC_MESSAGES, locales[i]))
+            other = locales[i];
+    if (!other) {
+        g_test_skip("no locale besides C");
+        return;
+    }
+
+    setlocale(LC_MESSAGES, "C");
+    json_c = structured(REPORT_FORMAT_JSON, &json_len);
+    cbor_c = structured(REPORT_FORMAT_CBOR, &cbor_c_len);
+
+    setlocale(LC_MESSAGES, other);
+    json_other = structured(REPORT_FORMAT_JSON, &json_len);
+    cbor_other = structured(REPORT_FORMAT_CBOR, &cbor_other_len);
+    /* and the caller's locale is back afterwards */
+    g_assert_cmpstr(setlocale(LC_MESSAGES, NULL), ==, other);
+    setlocale(LC_MESSAGES, "C");
+
+    g_assert_cmpstr(json_c, ==, json_other);
+    g_assert(strstr(json_c, "\"sound\"") != NULL);
+    g_assert(strstr(json_c, "\"label\":\"Vendor\",\"value\":\"Unknown\"") != NULL);
+    g_assert_cmpuint(cbor_c_len, ==, cbor_other_len);
+    g_assert(memcmp(cbor_c, cbor_other, cbor_c_len) == 0);
+
+    free(json_c);
+    free(json_other);
+    free(cbor_c);
+    free(cbor_other);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    params.quiet = TRUE;
+    params.markup_ok = TRUE;
+    params.max_bench_results = 10;
+    params.path_data = "/nonexistent";
+
+    g_test_add_func("/report/stream/same-text", test_same_text);
+    g_test_add_func("/report/stream/same-html", test_same_html);
+    g_test_add_func("/report/stream/same-shell", test_same_shell);
+    g_test_add_func("/report/stream/bounded", test_bounded);
+    g_test_add_func("/report/structured/locale", test_structured_locale);
+
+    return g_test_run();
+}
@@ -0,0 +1,590 @@
+/*
+ *    HardInfo2 - System Information and Benchmark
+ *    Copyright (C) 2003-2009 L. A. F. Pereira <l@tia.mat.br>
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, version 2 or later.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * Body decoding, line deltas and the cache of synced files, the part of
+ * syncmanager.c that doesn't need libsoup, under a temporary directory.
+ *
+ *   test_sync                     decoder, delta and cache checks
+ *   test_sync --server <url>      200, 304 and 226 exchanges against
+ *                                 tests/sync_server.py, sending the headers
+ *                                 the cache asks for and storing what
+ *                                 comes back through it
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+#include "config.h"
+#include "sync_util.h"
+
+#if(HARDINFO2_SYNC_ZSTD)
+#include <zstd.h>
+#endif
+
+static const gchar *server = NULL;
+static gchar *tmp_dir;
+
+static const gchar sample[] =
+    "# sample.ids\n"
+    "0001  First vendor\n"
+    "\t0001  First device\n"
+    "\t0002  Second device\n"
+    "0002  Second vendor\n"
+    "\t0100  Third device\n";
+
+static GBytes *compress(GZlibCompressorFormat format, const gchar *data, gsize len)
+{
+    GConverter *conv = G_CONVERTER(g_zlib_compressor_new(format, -1));
+    GByteArray *out = g_byte_array_new();
+    GConverterResult r;
+    guint8 chunk[4096];
+    gsize nread, nwritten;
+
+    do {
+        r = g_converter_convert(conv, data, len, chunk, sizeof(chunk),
+                                G_CONVERTER_INPUT_AT_END, &nread, &nwritten, NULL);
+        g_assert(r != G_CONVERTER_ERROR);
+        data += nread;
+        len -= nread;
+        g_byte_array_append(out, chunk, nwritten);
+    } while (r != G_CONVERTER_FINISHED);
+    g_object_unref(conv);
+
+    return g_byte_array_free_to_bytes(out);
+}
+
+static void check_decode(const gchar *encoding, GBytes *body)
+{
+    GError *error = NULL;
+    gsize len;
+    gchar *out;
+
+    out = sync_decode_body(encoding, g_bytes_get_data(body, NULL),
+                           g_bytes_get_size(body), &len, &error);
+    g_assert_no_error(error);
+    g_assert(out != NULL);
+    g_assert_cmpuint(len, ==, strlen(sample));
+    g_assert_cmpstr(out, ==, sample);
+    g_free(out);
+}
+
+static void test_decode_identity(void)
+{
+    GBytes *body = g_bytes_new_static(sample, strlen(sample));
+
+    check_decode(NULL, body);
+    check_decode("", body);
+    check_decode("identity", body);
+    g_bytes_unref(body);
+}
+
+static void test_decode_zlib(void)
+{
+    GBytes *gz = compress(G_ZLIB_COMPRESSOR_FORMAT_GZIP, sample, strlen(sample));
+    GBytes *zz = compress(G_ZLIB_COMPRESSOR_FORMAT_ZLIB, sample, strlen(sample));
+
+    check_decode("gzip", gz);
+    check_decode("x-gzip", gz);
+    check_decode("deflate", zz);
+    g_bytes_unref(gz);
+    g_bytes_unref(zz);
+}
+
+static void test_decode_truncated(void)
+{
+    GBytes *gz = compress(G_ZLIB_COMPRESSOR_FORMAT_GZIP, sample, strlen(sample));
+    GError *error = NULL;
+    gsize len;
+    gchar *out;
+
+    out = sync_decode_body("gzip", g_bytes_get_data(gz, NULL),
+                           g_bytes_get_size(gz) / 2, &len, &error);
+    g_assert(out == NULL);
+    g_assert(error != NULL);
+    g_clear_error(&error);
+
+    out = sync_decode_body("gzip", (const guint8 *)sample, strlen(sample), &len, &error);
+    g_assert(out == NULL);
+    g_assert(error != NULL);
+    g_clear_error(&error);
+
+    out = sync_decode_body("br", (const guint8 *)sample, strlen(sample), &len, &error);
+    g_assert(out == NULL);
+    g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED);
+    g_clear_error(&error);
+
+    g_bytes_unref(gz);
+}
+
+#if(HARDINFO2_SYNC_ZSTD)
+static void test_decode_zstd(void)
+{
+    gsize bound = ZSTD_compressBound(strlen(sample));
+    guint8 *buf = g_malloc(bound);
+    size_t n = ZSTD_compress(buf, bound, sample, strlen(sample), 3);
+    GError *error = NULL;
+    GBytes *body;
+    gsize len;
+
+    g_assert(!ZSTD_isError(n));
+    body = g_bytes_new_take(buf, n);
+    check_decode("zstd", body);
+
+    g_assert(sync_decode_body("zstd", buf, n - 4, &len, &error) == NULL);
+    g_assert(error != NULL);
+    g_clear_error(&error);
+    g_bytes_unref(body);
+}
+#endif
+
+static const struct {
+    const gchar *base, *delta, *result;  /* result NULL: rejected */
+} deltas[] = {
+    { "a\nb\nc\n", "", "a\nb\nc\n" },
+    { "a\nb\nc\n", "d2 1\n", "a\nc\n" },
+    { "a\nb\nc\n", "a0 1\nx\n", "x\na\nb\nc\n" },
+    { "a\nb\nc\n", "a3 2\nx\ny\n", "a\nb\nc\nx\ny\n" },
+    { "a\nb\nc\n", "d1 1\na1 1\nA\nd3 1\na3 1\nC\n", "A\nb\nC\n" },
+    { "a\nb\nc\n", "d1 3\n", "" },
+    { "", "a0 2\nx\ny\n", "x\ny\n" },
+    /* last line without a newline, in the base and in the delta */
+    { "a\nb", "d2 1\na2 1\nB", "a\nB" },
+    /* out of range, out of order, malformed */
+    { "a\nb\nc\n", "d4 1\n", NULL },
+    { "a\nb\nc\n", "d9 1\n", NULL },
+    { "a\nb\nc\n", "d3 2\n", NULL },
+    { "a\nb\nc\n", "d0 1\n", NULL },
+    { "a\nb\nc\n", "a4 1\nx\n", NULL },
+    { "a\nb\nc\n", "d3 1\nd1 1\n", NULL },
+    { "a\nb\nc\n", "a1 2\nx\n", NULL },
+    { "a\nb\nc\n", "c1 1\n", NULL },
+    { "a\nb\nc\n", "d1 0\n", NULL },
+    { "a\nb\nc\n", "d1 1", NULL },
+    { "a\nb\nc\n", "d1\n", NULL },
+    { "a\nb\nc\n", "d1\n1\n", NULL },
+    { "a\nb\nc\n", "d -1 1\n", NULL },
+    { "a\nb\nc\n", "d1 -1\n", NULL },
+};
+
+static void test_delta(void)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(deltas); i++) {
+        gsize len;
+        gchar *out = sync_apply_line_delta(deltas[i].base, strlen(deltas[i].base),
+                                           deltas[i].delta, strlen(deltas[i].delta), &len);
+
+        if (deltas[i].result) {
+            g_assert(out != NULL);
+            g_assert_cmpuint(len, ==, strlen(deltas[i].result));
+            g_assert(memcmp(out, deltas[i].result, len) == 0);
+        } else {
+            g_assert(out == NULL);
+        }
+        g_free(out);
+    }
+}
+
+/* HTTP/1.0 against the stand-in server: one request per connection, the
+ * body runs until the server closes */
+typedef struct {
+    guint status;
+    GHashTable *headers;    /* lower case name -> value */
+    GByteArray *body;
+} Response;
+
+static void response_free(Response *r)
+{
+    g_hash_table_destroy(r->headers);
+    g_byte_array_free(r->body, TRUE);
+    g_free(r);
+}
+
+static Response *http_get(const gchar *path, const gchar *extra_headers)
+{
+    const gchar *hostport = strstr(server, "://") + 3;
+    gchar **hp = g_strsplit(hostport, ":", 2);
+    struct addrinfo hints = { 0 }, *ai;
+    Response *r = g_new0(Response, 1);
+    GString *req;
+    gchar buf[4096], *head_end, **lines;
+    ssize_t n;
+    int fd, i;
+
+    hints.ai_socktype = SOCK_STREAM;
+    g_assert_cmpint(getaddrinfo(hp[0], hp[1] ? hp[1] : "80", &hints, &ai), ==, 0);
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    g_assert_cmpint(fd, >=, 0);
+    g_assert_cmpint(connect(fd, ai->ai_addr, ai->ai_addrlen), ==, 0);
+    freeaddrinfo(ai);
+
+    req = g_string_new(NULL);
+    g_string_append_printf(req, "GET %s HTTP/1.0\r\nHost: %s\r\n%s\r\n",
+                           path, hp[0], extra_headers ? extra_headers : "");
+    g_assert_cmpint(write(fd, req->str, req->len), ==, (ssize_t)req->len);
+    g_string_free(req, TRUE);
+    g_strfreev(hp);
+
+    r->body = g_byte_array_new();
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+        g_byte_array_append(r->body, (guint8 *)buf, n);
+    close(fd);
+
+    g_byte_array_append(r->body, (guint8 *)"", 1);
+    head_end = strstr((gchar *)r->body->data, "\r\n\r\n");
+    g_assert(head_end != NULL);
+    *head_end = '\0';
+
+    r->headers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    lines = g_strsplit((gchar *)r->body->data, "\r\n", -1);
+    g_assert_cmpint(sscanf(lines[0], "HTTP/%*s %u", &r->status), ==, 1);
+    for (i = 1; lines[i]; i++) {
+        gchar *colon = strchr(lines[i], ':');
+
+        if (colon) {
+            *colon = '\0';
+            g_hash_table_replace(r->headers, g_ascii_strdown(lines[i], -1),
+                                 g_strdup(g_strstrip(colon + 1)));
+        }
+    }
+    g_strfreev(lines);
+
+    g_byte_array_remove_range(r->body, 0, head_end + 4 - (gchar *)r->body->data);
+    g_byte_array_set_size(r->body, r->body->len - 1);
+
+    return r;
+}
+
+/* sample.ids and sync-cache.conf as syncmanager.c keeps them, the
+ * cache reloaded from disk as a new run would */
+static void cache_file_init(SyncCacheFile *f, const gchar *name, const gchar *uri)
+{
+    f->meta = g_key_file_new();
+    f->meta_path = g_build_filename(tmp_dir, "sync-cache.conf", NULL);
+    f->name = name;
+    f->uri = uri;
+    f->path = g_build_filename(tmp_dir, name, NULL);
+    f->upload = FALSE;
+    g_key_file_load_from_file(f->meta, f->meta_path, G_KEY_FILE_NONE, NULL);
+}
+
+static void cache_file_clear(SyncCacheFile *f)
+{
+    g_key_file_free(f->meta);
+    g_free((gchar *)f->meta_path);
+    g_free((gchar *)f->path);
+}
+
+static void add_header(const gchar *name, const gchar *value, gpointer data)
+{
+    g_string_append_printf(data, "%s: %s\r\n", name, value);
+}
+
+static gchar *request_headers(const SyncCacheFile *f)
+{
+    GString *hdrs = g_string_new(NULL);
+
+    sync_cache_request_headers(f, add_header, hdrs);
+    return g_string_free(hdrs, FALSE);
+}
+
+static void assert_stored(const SyncCacheFile *f, const gchar *contents, gsize len)
+{
+    gchar *data;
+    gsize data_len;
+
+    g_assert_true(g_file_get_contents(f->path, &data, &data_len, NULL));
+    g_assert_cmpuint(data_len, ==, len);
+    g_assert(memcmp(data, contents, len) == 0);
+    g_free(data);
+}
+
+static gchar *meta_string(const gchar *group, const gchar *key)
+{
+    GKeyFile *kf = g_key_file_new();
+    gchar *path = g_build_filename(tmp_dir, "sync-cache.conf", NULL), *ret;
+
+    g_key_file_load_from_file(kf, path, G_KEY_FILE_NONE, NULL);
+    ret = g_key_file_get_string(kf, group, key, NULL);
+    g_key_file_free(kf);
+    g_free(path);
+    return ret;
+}
+
+static void remove_cache(void)
+{
+    gchar *path = g_build_filename(tmp_dir, "sync-cache.conf", NULL);
+
+    g_unlink(path);
+    g_free(path);
+    path = g_build_filename(tmp_dir, "sample.ids", NULL);
+    g_unlink(path);
+    g_free(path);
+}
+
+static void test_store(void)
+{
+    SyncCacheFile f;
+    SyncResponse r = { 0 };
+    GError *error = NULL;
+    GBytes *gz;
+    gchar *hdrs, *v;
+    const gchar *delta_applied =
+        "# sample.ids\n\t0001  First device\n\t0002  Second device\n"
+        "0002  Second vendor\n\t0100  Third device\n";
+
+    remove_cache();
+    cache_file_init(&f, "sample.ids", "http://example.org/sample.ids");
+
+    /* nothing stored yet: nothing to validate */
+    hdrs = request_headers(&f);
+    g_assert_cmpstr(hdrs, ==, "Accept-Encoding: " SYNC_ACCEPT_ENCODING "\r\n");
+    g_free(hdrs);
+
+    r.status = 200;
+    r.etag = "\"v0\"";
+    r.last_modified = "Tue, 14 Nov 2023 22:13:20 GMT";
+    g_assert_cmpint(sync_cache_store(&f, &r, (const guint8 *)sample, strlen(sample), &error),
+                    ==, SYNC_STORE_STORED);
+    g_assert_no_error(error);
+    assert_stored(&f, sample, strlen(sample));
+    v = meta_string("sample.ids", "size");
+    g_assert_cmpuint(g_ascii_strtoull(v, NULL, 10), ==, strlen(sample));
+    g_free(v);
+    cache_file_clear(&f);
+
+    /* the next run asks for a delta against it */
+    cache_file_init(&f, "sample.ids", "http://example.org/sample.ids");
+    hdrs = request_headers(&f);
+    g_assert_cmpstr(hdrs, ==, "Accept-Encoding: " SYNC_ACCEPT_ENCODING "\r\n"
+                              "If-None-Match: \"v0\"\r\n"
+                              "A-IM: " SYNC_DELTA_IM "\r\n"
+                              "If-Modified-Since: Tue, 14 Nov 2023 22:13:20 GMT\r\n");
+    g_free(hdrs);
+
+    /* but not for somewhere else, or for an upload */
+    f.uri = "http://example.org/sample.ids?ver=2";
+    hdrs = request_headers(&f);
+    g_assert_null(strstr(hdrs, "If-None-Match"));
+    g_free(hdrs);
+    f.uri = "http://example.org/sample.ids";
+    f.upload = TRUE;
+    hdrs = request_headers(&f);
+    g_assert_null(strstr(hdrs, "If-None-Match"));
+    g_free(hdrs);
+    f.upload = FALSE;
+
+    r.status = SYNC_STATUS_NOT_MODIFIED;
+    g_assert_cmpint(sync_cache_store(&f, &r, NULL, 0, &error), ==, SYNC_STORE_NOT_MODIFIED);
+    assert_stored(&f, sample, strlen(sample));
+
+    /* none of these may touch the stored copy or its validators */
+    r.status = 404;
+    g_assert_cmpint(sync_cache_store(&f, &r, (const guint8 *)"not found\n", 10, &error),
+                    ==, SYNC_STORE_BAD_STATUS);
+    r.status = SYNC_STATUS_IM_USED;
+    r.etag = "\"v1\"";
+    g_assert_cmpint(sync_cache_store(&f, &r, (const guint8 *)"d2 1\n", 5, &error),
+                    ==, SYNC_STORE_UNEXPECTED_DELTA);
+    r.im = SYNC_DELTA_IM;
+    g_assert_cmpint(sync_cache_store(&f, &r, (const guint8 *)"d9 1\n", 5, &error),
+                    ==, SYNC_STORE_INVALID_DELTA);
+    gz = compress(G_ZLIB_COMPRESSOR_FORMAT_GZIP, "d2 1\n", 5);
+    r.content_encoding = "gzip";
+    g_assert_cmpint(sync_cache_store(&f, &r, g_bytes_get_data(gz, NULL),
+                                     g_bytes_get_size(gz) - 4, &error), ==, SYNC_STORE_FAILED);
+    g_assert(error != NULL);
+    g_clear_error(&error);
+    assert_stored(&f, sample, strlen(sample));
+    v = meta_string("sample.ids", "etag");
+    g_assert_cmpstr(v, ==, "\"v0\"");
+    g_free(v);
+
+    /* a delta replaces the file and the validators, Last-Modified
+     * included when the server no longer sends one */
+    r.last_modified = NULL;
+    g_assert_cmpint(sync_cache_store(&f, &r, g_bytes_get_data(gz, NULL),
+                                     g_bytes_get_size(gz), &error), ==, SYNC_STORE_STORED);
+    g_assert_no_error(error);
+    g_bytes_unref(gz);
+    assert_stored(&f, delta_applied, strlen(delta_applied));
+    v = meta_string("sample.ids", "etag");
+    g_assert_cmpstr(v, ==, "\"v1\"");
+    g_free(v);
+    g_assert_null(meta_string("sample.ids", "last-modified"));
+
+    /* a copy changed behind our back is fetched in full */
+    g_assert_true(g_file_set_contents(f.path, delta_applied, 20, NULL));
+    hdrs = request_headers(&f);
+    g_assert_null(strstr(hdrs, "If-None-Match"));
+    g_free(hdrs);
+
+    cache_file_clear(&f);
+}
+
+/* one request for f through the cache, as send_request_for_net_action()
+ * and got_msg() make it */
+static SyncStoreResult fetch(SyncCacheFile *f, const gchar *path, guint *status)
+{
+    gchar *hdrs = request_headers(f);
+    Response *r = http_get(path, hdrs);
+    SyncResponse resp;
+    SyncStoreResult ret;
+    GError *error = NULL;
+
+    resp.status = *status = r->status;
+    resp.content_encoding = g_hash_table_lookup(r->headers, "content-encoding");
+    resp.im = g_hash_table_lookup(r->headers, "im");
+    resp.etag = g_hash_table_lookup(r->headers, "etag");
+    resp.last_modified = g_hash_table_lookup(r->headers, "last-modified");
+    ret = sync_cache_store(f, &resp, r->body->data, r->body->len, &error);
+    g_assert_no_error(error);
+
+    response_free(r);
+    g_free(hdrs);
+    return ret;
+}
+
+/* the current version, as is */
+static gchar *current_version(gsize *len)
+{
+    Response *r = http_get("/sample.ids", NULL);
+    gchar *data;
+
+    g_assert_cmpuint(r->status, ==, 200);
+    g_assert_null(g_hash_table_lookup(r->headers, "content-encoding"));
+    *len = r->body->len;
+    data = g_strndup((gchar *)r->body->data, r->body->len);
+    response_free(r);
+    return data;
+}
+
+static void test_server(void)
+{
+    gchar *uri = g_strdup_printf("%s/sample.ids", server), *v1, *v2, *v;
+    SyncCacheFile f;
+    gsize v1_len, v2_len;
+    guint status;
+
+    remove_cache();
+    response_free(http_get("/reset", NULL));
+    v1 = current_version(&v1_len);
+
+    /* 200, compressed, validators kept */
+    cache_file_init(&f, "sample.ids", uri);
+    g_assert_cmpint(fetch(&f, "/sample.ids", &status), ==, SYNC_STORE_STORED);
+    g_assert_cmpuint(status, ==, 200);
+    assert_stored(&f, v1, v1_len);
+    cache_file_clear(&f);
+
+    /* 304 while they match, in the next run too */
+    cache_file_init(&f, "sample.ids", uri);
+    g_assert_cmpint(fetch(&f, "/sample.ids", &status), ==, SYNC_STORE_NOT_MODIFIED);
+    g_assert_cmpuint(status, ==, 304);
+    assert_stored(&f, v1, v1_len);
+
+    /* 226 once the file changed, patched into the new version */
+    response_free(http_get("/bump", NULL));
+    v2 = current_version(&v2_len);
+    g_assert(v1_len != v2_len || memcmp(v1, v2, v1_len) != 0);
+    g_assert_cmpint(fetch(&f, "/sample.ids", &status), ==, SYNC_STORE_STORED);
+    g_assert_cmpuint(status, ==, SYNC_STATUS_IM_USED);
+    assert_stored(&f, v2, v2_len);
+    v = meta_string("sample.ids", "etag");
+    g_assert_cmpstr(v, ==, "\"v1\"");
+    g_free(v);
+
+    g_assert_cmpint(fetch(&f, "/sample.ids", &status), ==, SYNC_STORE_NOT_MODIFIED);
+    g_assert_cmpuint(status, ==, 304);
+
+    /* a changed local copy gets the whole file */
+    g_assert_true(g_file_set_contents(f.path, v1, v1_len, NULL));
+    g_assert_cmpint(fetch(&f, "/sample.ids", &status), ==, SYNC_STORE_STORED);
+    g_assert_cmpuint(status, ==, 200);
+    assert_stored(&f, v2, v2_len);
+    cache_file_clear(&f);
+
+    /* errors are not file contents */
+    g_free(uri);
+    uri = g_strdup_printf("%s/missing.ids", server);
+    cache_file_init(&f, "missing.ids", uri);
+    g_assert_cmpint(fetch(&f, "/missing.ids", &status), ==, SYNC_STORE_BAD_STATUS);
+    g_assert_cmpuint(status, ==, 404);
+    g_assert_false(g_file_test(f.path, G_FILE_TEST_EXISTS));
+    cache_file_clear(&f);
+
+    g_free(uri);
+    g_free(v1);
+    g_free(v2);
+}
+
+static void rm_rf(const gchar *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const gchar *name;
+
+    if (dir) {
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+
+            rm_rf(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+        g_rmdir(path);
+    } else {
+        g_unlink(path);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    tmp_dir = g_dir_make_tmp("test_sync-XXXXXX", NULL);
+    g_assert(tmp_dir != NULL);
+
+    g_test_init(&argc, &argv, NULL);
+
+    if (argc == 3 && g_str_equal(argv[1], "--server")) {
+        server = argv[2];
+        g_test_add_func("/sync/server", test_server);
+    } else {
+
+        g_test_add_func("/sync/decode/identity", test_decode_identity);
+        g_test_add_func("/sync/decode/zlib", test_decode_zlib);
+        g_test_add_func("/sync/decode/truncated", test_decode_truncated);
+#if(HARDINFO2_SYNC_ZSTD)
+        g_test_add_func("/sync/decode/zstd", test_decode_zstd);
+#endif
+        g_test_add_func("/sync/delta", test_delta);
+        g_test_add_func("/sync/store", test_store);
+    }
+    ret = g_test_run();
+
+    rm_rf(tmp_dir);
+    g_free(tmp_dir);
+    return ret;
+}